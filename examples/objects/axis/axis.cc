@@ -1,4 +1,7 @@
 #include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include "RpArray1D.h"
 
 
@@ -8,7 +11,9 @@ int test(
     const char *expected,
     const char *received)
 {
-/*
+    if ((expected == NULL) || (received == NULL)) {
+        return 0;
+    }
     if (strcmp(expected,received) != 0) {
         printf("Error: %s\n", testname);
         printf("\t%s\n", desc);
@@ -16,7 +21,6 @@ int test(
         printf("\treceived \"%s\"\n",received);
         return 1;
     }
-*/
     return 0;
 }
 
@@ -52,6 +56,137 @@ int axis_0_0 ()
     return test(testname,desc,expected,received);
 }
 
+int axis_1_0 ()
+{
+    const char *desc = "test running summary of the values";
+    const char *testname = "axis_1_0";
+
+    const char *expected = "7 2 -5 4 5 1 10 / 0 nan nan / -3 -1";
+    char received[256];
+
+    double inf = HUGE_VAL;
+    double nan = inf - inf;
+    double d1[] = {1,2,3};
+    double d2[] = {4,nan,inf,-5};
+    Rappture::Array1D a(d1,3);
+    a.append(d2,4);
+    size_t len = sprintf(received,"%lu %lu %g %g %g %g %g",
+        (unsigned long)a.nmemb(),(unsigned long)a.nonfinite(),a.min(),
+        a.max(),a.sum(),a.mean(),a.variance());
+
+    a.clear();
+    len += sprintf(received+len," / %lu %g %g",(unsigned long)a.nmemb(),
+                   a.mean(),a.variance());
+
+    double d3[] = {-3,-1,-2};
+    a.append(d3,3);
+    sprintf(received+len," / %g %g",a.min(),a.max());
+
+    return test(testname,desc,expected,received);
+}
+
+int axis_1_1 ()
+{
+    const char *desc = "test summary of values appended in pieces";
+    const char *testname = "axis_1_1";
+
+    const char *expected = "ok";
+    const char *received = "ok";
+
+    size_t n = 100000;
+    double *d = new double[n];
+    for (size_t i = 0; i < n; i++) {
+        d[i] = 1e9 + (double)((i * 7919) % 1000);
+    }
+    Rappture::Array1D whole(d,n);
+    Rappture::Array1D pieces;
+    for (size_t i = 0; i < n; i += 777) {
+        pieces.append(d+i,(n-i < 777) ? n-i : 777);
+    }
+
+    // two-pass reference
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sum += d[i];
+    }
+    double mean = sum/n;
+    double m2 = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        m2 += (d[i]-mean)*(d[i]-mean);
+    }
+    Rappture::Array1D *arrs[] = { &whole, &pieces };
+    for (int k = 0; k < 2; k++) {
+        if ((fabs(arrs[k]->mean()-mean) > 1e-6) ||
+            (fabs(arrs[k]->variance()-m2/n) > 1e-6*(m2/n)) ||
+            (arrs[k]->min() != 1e9) || (arrs[k]->max() != 1e9+999)) {
+            received = "wrong summary";
+        }
+    }
+    delete[] d;
+    return test(testname,desc,expected,received);
+}
+
+int axis_2_0 ()
+{
+    const char *desc = "test decimating values into min-max bins";
+    const char *testname = "axis_2_0";
+
+    const char *expected = "ok";
+    const char *received = "ok";
+
+    size_t n = 300000;
+    double *d = new double[n];
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < n; i++) {
+        seed = seed * 1103515245 + 12345;
+        d[i] = (double)(seed >> 8) - 8388608.0;
+    }
+    d[1000] = HUGE_VAL;
+    for (size_t i = 5000; i < 6000; i++) {
+        d[i] = HUGE_VAL - HUGE_VAL;
+    }
+
+    // decimate between appends, so the pyramid is extended
+    Rappture::Array1D a;
+    double mins[1000];
+    double maxs[1000];
+    size_t bins[] = { 1, 7, 640, 1000 };
+    for (size_t done = 0; (done < n) && (received == expected); ) {
+        size_t m = (n-done < 65537) ? n-done : 65537;
+        a.append(d+done,m);
+        done += m;
+        for (size_t b = 0; b < 4; b++) {
+            size_t first = (b * 1237) % done;
+            size_t count = done - first - b;
+            size_t nb = a.decimate(first,count,bins[b],mins,maxs);
+            for (size_t i = 0; i < nb; i++) {
+                size_t lo = first + (i*count)/nb;
+                size_t hi = first + ((i+1)*count)/nb;
+                double mn = HUGE_VAL;
+                double mx = -HUGE_VAL;
+                for (size_t j = lo; j < hi; j++) {
+                    if ((d[j]-d[j]) == 0.0) {
+                        mn = (d[j] < mn) ? d[j] : mn;
+                        mx = (d[j] > mx) ? d[j] : mx;
+                    }
+                }
+                if ((mn != mins[i]) || (mx != maxs[i])) {
+                    if ((mn > mx) && (mins[i] != mins[i])) {
+                        continue;       // no finite values, nan
+                    }
+                    received = "wrong min or max";
+                    break;
+                }
+            }
+        }
+    }
+    if (a.decimate(n,10,10,mins,maxs) != 0) {
+        received = "bins past the end";
+    }
+    delete[] d;
+    return test(testname,desc,expected,received);
+}
+
 int main()
 {
     Rappture::Array1D *n = NULL;
@@ -73,6 +208,9 @@ int main()
     delete n;
 
     axis_0_0();
+    axis_1_0();
+    axis_1_1();
+    axis_2_0();
 
     return 0;
 }
@@ -1,5 +1,6 @@
 #include <iostream>
 #include "RpCurve.h"
+#include "RpEncode.h"
 
 size_t indent = 0;
 size_t tabstop = 4;
@@ -97,9 +98,317 @@ int curve_1_0 ()
     return test(testname,desc,expected,received);
 }
 
+int curve_2_0 ()
+{
+    const char *desc = "test configuring a curve from xml text";
+    const char *testname = "curve_2_0";
+
+    const char *xmltext = "<?xml version=\"1.0\"?>\n\
+<curve id=\"myid\">\n\
+    <component>\n\
+        <xy>  1 1\n\
+  2.5 -4e1\n\n\t3   9\n\
+  1e-3 16 99</xy>\n\
+    </component>\n\
+</curve>\n\
+";
+    const char *expected = "4 1 2.5 3 0.001 / 4 1 -40 9 16 / 0.001 3 -40 16";
+    char received[1024];
+    size_t len = 0;
+
+    Rappture::Curve c;
+    c.configure(Rappture::RPCONFIG_XML,(void *)xmltext);
+
+    const char *names[] = { Rappture::Curve::x, Rappture::Curve::y };
+    for (int i = 0; i < 2; i++) {
+        Rappture::Array1D *a = c.getAxis(names[i]);
+        if (a == NULL) {
+            return test(testname,desc,expected,"no axis");
+        }
+        const double *d = a->data();
+        len += sprintf(received+len,"%s%lu",(i > 0) ? " / " : "",
+                       (unsigned long)a->nmemb());
+        for (size_t j = 0; j < a->nmemb(); j++) {
+            len += sprintf(received+len," %g",d[j]);
+        }
+    }
+    sprintf(received+len," / %g %g %g %g",c.getAxis(Rappture::Curve::x)->min(),
+            c.getAxis(Rappture::Curve::x)->max(),
+            c.getAxis(Rappture::Curve::y)->min(),
+            c.getAxis(Rappture::Curve::y)->max());
+
+    return test(testname,desc,expected,received);
+}
+
+int curve_2_1 ()
+{
+    const char *desc = "test configuring a curve with many points";
+    const char *testname = "curve_2_1";
+
+    Rappture::SimpleCharBuffer xml;
+    size_t npts = 100000;
+    xml.appendf("<?xml version=\"1.0\"?>\n<curve id=\"c\">"
+                "<component><xy>");
+    for (size_t i = 0; i < npts; i++) {
+        xml.appendf("%lu %lu\n",(unsigned long)i,(unsigned long)(2*i));
+    }
+    xml.appendf("</xy></component></curve>\n");
+
+    Rappture::Curve c;
+    c.configure(Rappture::RPCONFIG_XML,(void *)xml.bytes());
+
+    Rappture::Array1D *x = c.getAxis(Rappture::Curve::x);
+    Rappture::Array1D *y = c.getAxis(Rappture::Curve::y);
+    const char *expected = "ok";
+    const char *received = "ok";
+    if ((x == NULL) || (y == NULL) || (x->nmemb() != npts) ||
+        (y->nmemb() != npts)) {
+        received = "wrong number of points";
+    } else {
+        for (size_t i = 0; i < npts; i++) {
+            if ((x->data()[i] != i) || (y->data()[i] != 2*i)) {
+                received = "wrong values";
+                break;
+            }
+        }
+    }
+    return test(testname,desc,expected,received);
+}
+
+int curve_3_0 ()
+{
+    const char *desc = "test that dumped xy data reads back exactly";
+    const char *testname = "curve_3_0";
+
+    const char *expected = "         1       0.1\n\
+         2 0.3333333333333333\n\
+         3  -2.5e+20\n\
+         4    1e-300\n\
+ 123456789 1.7976931348623157e+308\n\
+";
+    char received[1024];
+
+    double x[] = {1,2,3,4,123456789};
+    double y[] = {0.1,1.0/3.0,-2.5e20,1e-300,1.7976931348623157e308};
+
+    Rappture::Curve c("myid","mylabel","mydesc","mygroup");
+    c.axis("xaxis","xlabel","xdesc","xunits","xscale",x,5);
+    c.axis("yaxis","ylabel","ydesc","yunits","yscale",y,5);
+
+    Rappture::ClientDataXml xmldata;
+    xmldata.indent = indent;
+    xmldata.tabstop = tabstop;
+    xmldata.retStr = NULL;
+    c.dump(Rappture::RPCONFIG_XML,&xmldata);
+
+    const char *start = strstr(xmldata.retStr,"<xy>");
+    const char *end = strstr(xmldata.retStr,"</xy>");
+    if ((start == NULL) || (end == NULL)) {
+        return test(testname,desc,expected,"no xy data");
+    }
+    start += 4;
+    sprintf(received,"%.*s",(int)(end-start),start);
+
+    char *p = received;
+    for (size_t i = 0; i < 5; i++) {
+        double xv = strtod(p,&p);
+        double yv = strtod(p,&p);
+        if ((xv != x[i]) || (yv != y[i])) {
+            return test(testname,desc,"same values","different values");
+        }
+    }
+    return test(testname,desc,expected,received);
+}
+
+int curve_4_0 ()
+{
+    const char *desc = "test dumping and reading back binary xy data";
+    const char *testname = "curve_4_0";
+
+    const char *expected = "ok";
+    const char *received = "ok";
+
+    size_t npts = 1000;
+    double x[1000];
+    double y[1000];
+    for (size_t i = 0; i < npts; i++) {
+        x[i] = i/7.0;
+        y[i] = -1e10/(i+1);
+    }
+
+    Rappture::Curve c("myid","mylabel","mydesc","mygroup");
+    c.axis("xaxis","xlabel","xdesc","xunits","xscale",x,npts);
+    c.axis("yaxis","ylabel","ydesc","yunits","yscale",y,npts);
+    c.propstr("encoding","zb64-f64le");
+
+    Rappture::ClientDataXml xmldata;
+    xmldata.indent = indent;
+    xmldata.tabstop = tabstop;
+    xmldata.retStr = NULL;
+    c.dump(Rappture::RPCONFIG_XML,&xmldata);
+
+    if ((strstr(xmldata.retStr,"<xy encoding=\"zb64-f64le\">") == NULL) ||
+        (strstr(xmldata.retStr,"@@RP-ENC:zb64") == NULL)) {
+        return test(testname,desc,expected,"xy data is not encoded");
+    }
+
+    // read back the <curve> element
+    Rappture::SimpleCharBuffer xml;
+    const char *start = strstr(xmldata.retStr,"<curve");
+    const char *end = strstr(xmldata.retStr,"</curve>");
+    xml.appendf("<?xml version=\"1.0\"?>\n%.*s</curve>\n",
+                (int)(end-start),start);
+
+    Rappture::Curve c2;
+    c2.configure(Rappture::RPCONFIG_XML,(void *)xml.bytes());
+    Rappture::Array1D *xa = c2.getAxis(Rappture::Curve::x);
+    Rappture::Array1D *ya = c2.getAxis(Rappture::Curve::y);
+    if ((xa == NULL) || (ya == NULL) || (xa->nmemb() != npts) ||
+        (ya->nmemb() != npts)) {
+        received = "wrong number of points";
+    } else {
+        for (size_t i = 0; i < npts; i++) {
+            if ((xa->data()[i] != x[i]) || (ya->data()[i] != y[i])) {
+                received = "wrong values";
+                break;
+            }
+        }
+    }
+    return test(testname,desc,expected,received);
+}
+
+int curve_4_1 ()
+{
+    const char *desc = "test reading compressed text xy data";
+    const char *testname = "curve_4_1";
+
+    const char *expected = "3 points: (1,2) (3,4) (5.5,-6)";
+    char received[128];
+
+    // compressed text has the same header as binary data, but no
+    // encoding attribute
+    Rappture::Outcome status;
+    Rappture::Buffer buf("1 2\n3 4\n5.5 -6\n");
+    if (!Rappture::encoding::encode(status,buf,RPENC_Z|RPENC_B64)) {
+        return test(testname,desc,expected,"can't encode xy data");
+    }
+
+    Rappture::SimpleCharBuffer xml;
+    xml.appendf("<?xml version=\"1.0\"?>\n<curve id=\"myid\">\n"
+                "<component>\n<xy>%.*s</xy>\n</component>\n</curve>\n",
+                (int)buf.size(),buf.bytes());
+
+    Rappture::Curve c;
+    c.configure(Rappture::RPCONFIG_XML,(void *)xml.bytes());
+    Rappture::Array1D *xa = c.getAxis(Rappture::Curve::x);
+    Rappture::Array1D *ya = c.getAxis(Rappture::Curve::y);
+    if ((xa == NULL) || (ya == NULL) || (xa->nmemb() != 3) ||
+        (ya->nmemb() != 3)) {
+        return test(testname,desc,expected,"wrong number of points");
+    }
+    snprintf(received,sizeof(received),"%d points: (%g,%g) (%g,%g) (%g,%g)",
+             (int)xa->nmemb(),xa->data()[0],ya->data()[0],
+             xa->data()[1],ya->data()[1],xa->data()[2],ya->data()[2]);
+    return test(testname,desc,expected,received);
+}
+
+int curve_5_0 ()
+{
+    const char *desc = "test decimating a curve for drawing";
+    const char *testname = "curve_5_0";
+
+    const char *expected = "ok";
+    const char *received = "ok";
+
+    size_t npts = 100000;
+    size_t nbins = 100;
+    double *x = new double[npts];
+    double *y = new double[npts];
+    for (size_t i = 0; i < npts; i++) {
+        x[i] = i*0.5;
+        y[i] = (double)((i*7919) % 1000);
+    }
+    y[12345] = 1e6;
+
+    Rappture::Curve c("myid","mylabel","mydesc","mygroup");
+    c.axis("xaxis","xlabel","xdesc","xunits","xscale",x,npts);
+    c.axis("yaxis","ylabel","ydesc","yunits","yscale",y,npts);
+
+    double dx[200];
+    double dy[200];
+    double lo = 1000.0;
+    double hi = 40000.0;
+    size_t first = 2*(size_t)lo - 1;
+    size_t count = 2*(size_t)hi + 2 - first;
+    size_t n = c.decimate(lo,hi,nbins,dx,dy);
+
+    // every bin gives its lowest and highest value, in order
+    if (n != 2*nbins) {
+        received = "wrong number of points";
+    } else {
+        for (size_t b = 0; b < nbins; b++) {
+            size_t start = first + b*count/nbins;
+            size_t end = first + (b+1)*count/nbins;
+            double min = y[start];
+            double max = y[start];
+            for (size_t i = start; i < end; i++) {
+                min = (y[i] < min) ? y[i] : min;
+                max = (y[i] > max) ? y[i] : max;
+            }
+            if ((dy[2*b] != min) || (dy[2*b+1] != max) ||
+                (dx[2*b] != dx[2*b+1]) || (dx[2*b] < x[start]) ||
+                (dx[2*b] >= x[end])) {
+                received = "wrong bin values";
+                break;
+            }
+        }
+    }
+    if ((strcmp(received,"ok") == 0) && (dy[2*13+1] != 1e6)) {
+        received = "lost the spike";
+    }
+
+    // a small range gives back the points as they are
+    n = c.decimate(10.0,20.0,nbins,dx,dy);
+    if ((strcmp(received,"ok") == 0) &&
+        ((n != 23) || (dx[0] != 9.5) || (dx[22] != 20.5))) {
+        received = "wrong points for a small range";
+    }
+
+    // the dump includes the decimated data
+    c.propstr("lod","50");
+    Rappture::ClientDataXml xmldata;
+    xmldata.indent = indent;
+    xmldata.tabstop = tabstop;
+    xmldata.retStr = NULL;
+    c.dump(Rappture::RPCONFIG_XML,&xmldata);
+    const char *lod = strstr(xmldata.retStr,"<lod>");
+    if ((strcmp(received,"ok") == 0) && (lod == NULL)) {
+        received = "no lod data";
+    } else if (lod != NULL) {
+        size_t lines = 0;
+        const char *end = strstr(lod,"</lod>");
+        for (const char *p = lod; p < end; p++) {
+            lines += (*p == '\n');
+        }
+        if ((strcmp(received,"ok") == 0) && (lines != 100)) {
+            received = "wrong number of lod points";
+        }
+    }
+
+    delete[] x;
+    delete[] y;
+    return test(testname,desc,expected,received);
+}
+
 int main()
 {
     curve_0_0 ();
     curve_1_0 ();
+    curve_2_0 ();
+    curve_2_1 ();
+    curve_3_0 ();
+    curve_4_0 ();
+    curve_4_1 ();
+    curve_5_0 ();
     return 0;
 }
@@ -0,0 +1,372 @@
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include "RpDXWriter.h"
+#include "RpNumFormat.h"
+#include "RpTest.h"
+#include <zlib.h>
+
+static size_t p[] = {2,3,4};
+static double origin[] = {0.0,0.0,0.0};
+static double delta[] = {1.0,0.0,0.0,0.0,0.5,0.0,0.0,0.0,0.25};
+
+static double values[] = {
+    0.0, 1.0, -1.0, 0.5, 1.5e-7, -2.25e-7, 123456.0, 1234567.0,
+    3.14159265358979, -2.718281828, 1e30, -1e-30, 100.0, 1e6, 1e-5, 1e-4,
+    65504.0, 0.1, 0.2, 0.3, 7.0, 8.0, 9.5, -0.0
+};
+
+static void
+setupWriter(Rappture::DXWriter &d)
+{
+    d.rank(3);
+    d.origin(origin);
+    d.delta(delta);
+    d.counts(p);
+}
+
+static std::string
+readStream(FILE *fp)
+{
+    std::string s;
+    char b[4096];
+    size_t n;
+
+    rewind(fp);
+    while ((n = fread(b, 1, sizeof(b), fp)) > 0) {
+        s.append(b, n);
+    }
+    return s;
+}
+
+static std::string
+writeToString(Rappture::DXWriter &d)
+{
+    FILE *fp = tmpfile();
+    d.write(fp);
+    std::string s = readStream(fp);
+    fclose(fp);
+    return s;
+}
+
+static bool
+isBigEndian()
+{
+    union {
+        unsigned int i;
+        unsigned char c[sizeof(unsigned int)];
+    } u;
+    u.i = 1;
+    return (u.c[0] == 0);
+}
+
+static float
+floatAt(const std::string &s, size_t pos, bool bigEndian)
+{
+    union {
+        float f;
+        unsigned char c[sizeof(float)];
+    } u;
+    memcpy(u.c, s.data() + pos, sizeof(float));
+    if (bigEndian != isBigEndian()) {
+        unsigned char c;
+        c = u.c[0], u.c[0] = u.c[3], u.c[3] = c;
+        c = u.c[1], u.c[1] = u.c[2], u.c[2] = c;
+    }
+    return u.f;
+}
+
+int dxWriter_0_0 ()
+{
+    const char *testdesc = "test formatG against sprintf %*.*g";
+    const char *testname = "dxWriter_0_0";
+    int retVal = 0;
+
+    double tests[] = {
+        0.0, -0.0, 1.0, -1.0, 0.1, 1e-5, 1e-4, 9.9999995, 999999.5,
+        123456.0, 1234567.0, 3.14159265358979, 1e300, -1e-300, 5e-324,
+        2.5, 0.5, 1.5e-7, 65504.0, 1.7976931348623157e308
+    };
+    int widths[] = { 0, 10, 14 };
+    int precisions[] = { 1, 6, 17 };
+
+    for (size_t i = 0; i < sizeof(tests)/sizeof(tests[0]); i++) {
+        for (size_t w = 0; w < 3; w++) {
+            for (size_t q = 0; q < 3; q++) {
+                char expected[80], received[80];
+                size_t len;
+
+                sprintf(expected, "%*.*g", widths[w], precisions[q], tests[i]);
+                len = Rappture::numformat::formatG(received, tests[i],
+                        widths[w], precisions[q]);
+                received[len] = '\0';
+                retVal |= testStringVal(testname,testdesc,expected,received);
+            }
+        }
+    }
+    return retVal;
+}
+
+int dxWriter_1_0 ()
+{
+    const char *testdesc = "test ascii dx data section";
+    const char *testname = "dxWriter_1_0";
+    int retVal = 0;
+
+    Rappture::DXWriter d;
+    setupWriter(d);
+    d.data(values, 24);
+
+    std::string dx = writeToString(d);
+    std::string expected;
+    for (size_t i = 0; i < 24; i++) {
+        char b[80];
+        sprintf(b, "    %10g\n", (float)values[i]);
+        expected += b;
+    }
+
+    const char *follows = "items 24 data follows\n";
+    size_t start = dx.find(follows);
+    size_t end = dx.find("attribute \"dep\"");
+    if ((start == std::string::npos) || (end == std::string::npos)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", testdesc);
+        printf("\tno data section in \"%s\"\n", dx.c_str());
+        return 1;
+    }
+    start += strlen(follows);
+    retVal |= testStringVal(testname,testdesc,expected.c_str(),
+                dx.substr(start,end-start).c_str());
+    return retVal;
+}
+
+int dxWriter_1_1 ()
+{
+    const char *testdesc = "test ascii dx replaces non-finite values";
+    const char *testname = "dxWriter_1_1";
+    int retVal = 0;
+
+    double v[24];
+    for (size_t i = 0; i < 24; i++) {
+        v[i] = (i % 2) ? NAN : INFINITY;
+    }
+    Rappture::DXWriter d;
+    setupWriter(d);
+    d.data(v, 24);
+
+    std::string dx = writeToString(d);
+    if ((dx.find("nan") != std::string::npos) ||
+        (dx.find("inf") != std::string::npos)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", testdesc);
+        printf("\tnon-finite value in \"%s\"\n", dx.c_str());
+        retVal = 1;
+    }
+    return retVal;
+}
+
+int dxWriter_2_0 ()
+{
+    const char *testdesc = "test binary dx data section";
+    const char *testname = "dxWriter_2_0";
+    int retVal = 0;
+
+    Rappture::DXWriter d;
+    setupWriter(d);
+    d.format(Rappture::DXWriter::DX_BINARY);
+    d.data(values, 24);
+
+    std::string dx = writeToString(d);
+    std::string follows = "items 24 ";
+    follows += (isBigEndian()) ? "msb" : "lsb";
+    follows += " ieee data follows\n";
+    size_t start = dx.find(follows);
+    if (start == std::string::npos) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", testdesc);
+        printf("\tno \"%s\" in the header\n", follows.c_str());
+        return 1;
+    }
+    start += follows.size();
+    if (dx.compare(start + 24*sizeof(float), 16, "\nattribute \"dep\"") != 0) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", testdesc);
+        printf("\tdata section is not 24 floats long\n");
+        return 1;
+    }
+    for (size_t i = 0; i < 24; i++) {
+        retVal |= testDoubleVal(testname,testdesc,(float)values[i],
+                    floatAt(dx, start + i*sizeof(float), isBigEndian()));
+    }
+    return retVal;
+}
+
+int dxWriter_3_0 ()
+{
+    const char *testdesc = "test binary vtk structured points";
+    const char *testname = "dxWriter_3_0";
+    int retVal = 0;
+
+    Rappture::DXWriter d;
+    setupWriter(d);
+    d.format(Rappture::DXWriter::VTK_BINARY);
+    d.data(values, 24);
+
+    std::string vtk = writeToString(d);
+    const char *header =
+        "# vtk DataFile Version 3.0\n"
+        "Rappture DXWriter\n"
+        "BINARY\n"
+        "DATASET STRUCTURED_POINTS\n"
+        "DIMENSIONS 2 3 4\n"
+        "ORIGIN 0 0 0\n"
+        "SPACING 1 0.5 0.25\n"
+        "POINT_DATA 24\n"
+        "SCALARS data float 1\n"
+        "LOOKUP_TABLE default\n";
+    size_t start = strlen(header);
+    retVal |= testStringVal(testname,testdesc,header,
+                vtk.substr(0,start).c_str());
+    if (vtk.size() != start + 24*sizeof(float) + 1) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", testdesc);
+        printf("\texpected %lu bytes, received %lu\n",
+            (unsigned long)(start + 24*sizeof(float) + 1),
+            (unsigned long)vtk.size());
+        return 1;
+    }
+
+    // vtk wants x varying fastest, dx z
+    size_t n = 0;
+    for (size_t k = 0; k < p[2]; k++) {
+        for (size_t j = 0; j < p[1]; j++) {
+            for (size_t i = 0; i < p[0]; i++) {
+                double v = values[(i*p[1] + j)*p[2] + k];
+                retVal |= testDoubleVal(testname,testdesc,(float)v,
+                            floatAt(vtk, start + n*sizeof(float), true));
+                n++;
+            }
+        }
+    }
+    return retVal;
+}
+
+int dxWriter_4_0 ()
+{
+    const char *testdesc = "test streamed dx matches write()";
+    const char *testname = "dxWriter_4_0";
+    int retVal = 0;
+
+    Rappture::DXWriter::Format formats[] = {
+        Rappture::DXWriter::DX_ASCII, Rappture::DXWriter::DX_BINARY
+    };
+    for (size_t f = 0; f < 2; f++) {
+        Rappture::DXWriter d;
+        setupWriter(d);
+        d.format(formats[f]);
+        d.data(values, 24);
+        std::string expected = writeToString(d);
+
+        Rappture::DXWriter s;
+        setupWriter(s);
+        s.format(formats[f]);
+        FILE *fp = tmpfile();
+        s.open(fp);
+        s.data(values, 5);
+        for (size_t i = 5; i < 24; i++) {
+            s.append(values + i);
+        }
+        s.close();
+        std::string received = readStream(fp);
+        fclose(fp);
+
+        if (expected != received) {
+            printf("Error: %s\n", testname);
+            printf("\t%s\n", testdesc);
+            printf("\tformat %d differs\n", (int)formats[f]);
+            retVal = 1;
+        }
+    }
+    return retVal;
+}
+
+int dxWriter_4_1 ()
+{
+    const char *testdesc = "test values given before open() are streamed";
+    const char *testname = "dxWriter_4_1";
+    int retVal = 0;
+
+    Rappture::DXWriter d;
+    setupWriter(d);
+    d.data(values, 24);
+    std::string expected = writeToString(d);
+
+    Rappture::DXWriter s;
+    setupWriter(s);
+    s.data(values, 10);
+    FILE *fp = tmpfile();
+    s.open(fp);
+    s.data(values + 10, 14);
+    s.close();
+    std::string received = readStream(fp);
+    fclose(fp);
+
+    retVal |= testStringVal(testname,testdesc,expected.c_str(),
+                received.c_str());
+    return retVal;
+}
+
+int dxWriter_4_2 ()
+{
+    const char *testdesc = "test compressed streaming";
+    const char *testname = "dxWriter_4_2";
+    const char *fname = "dxWriter_4_2.dx.gz";
+    int retVal = 0;
+
+    Rappture::DXWriter d;
+    setupWriter(d);
+    d.data(values, 24);
+    std::string expected = writeToString(d);
+
+    Rappture::DXWriter s;
+    setupWriter(s);
+    s.open(fname, true);
+    s.data(values, 24);
+    s.close();
+
+    std::string received;
+    gzFile gz = gzopen(fname, "rb");
+    if (gz == NULL) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", testdesc);
+        printf("\tcan't open \"%s\"\n", fname);
+        return 1;
+    }
+    char b[4096];
+    int n;
+    while ((n = gzread(gz, b, sizeof(b))) > 0) {
+        received.append(b, n);
+    }
+    gzclose(gz);
+    remove(fname);
+
+    retVal |= testStringVal(testname,testdesc,expected.c_str(),
+                received.c_str());
+    return retVal;
+}
+
+int main()
+{
+    dxWriter_0_0();
+    dxWriter_1_0();
+    dxWriter_1_1();
+    dxWriter_2_0();
+    dxWriter_3_0();
+    dxWriter_4_0();
+    dxWriter_4_1();
+    dxWriter_4_2();
+
+    return 0;
+}
@@ -1,5 +1,8 @@
 #include <iostream>
+#include <math.h>
 #include "RpLibObj.h"
+#include "RpLibrary.h"
+#include "RpEncode.h"
 #include "RpInt.h"
 #include "RpChain.h"
 #include "RpTest.h"
@@ -327,6 +330,76 @@ int library_2_3 ()
     return retVal;
 }
 
+int library_3_0 ()
+{
+    const char *testdesc = "test putDoubles() and getDoubles() round trip";
+    const char *testname = "library_3_0";
+    int retVal = 0;
+
+    const size_t nrows = 50;
+    double x[nrows], y[nrows];
+    for (size_t i = 0; i < nrows; i++) {
+        x[i] = i*0.1;
+        y[i] = sin(x[i]);
+    }
+    const double *columns[2] = { x, y };
+
+    // binary values read back exactly, even after a trip through a
+    // file; text values come back to the precision they're written with
+    RpLibrary lib;
+    lib.putDoubles("output.curve.component.xy", columns, 2, nrows);
+    lib.putDoubles("output.curve(text).component.xy", columns, 2, nrows,
+        RPLIB_NO_COMPRESS);
+    std::string xml = lib.xml();
+    if (xml.find("encoding=\"" RPENC_DOUBLES "\"") == std::string::npos) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", testdesc);
+        printf("\texpected encoding=\"%s\" in the xml\n", RPENC_DOUBLES);
+        retVal = 1;
+    }
+
+    const char *xmlFile = "library_3_0_out.xml";
+    FILE *f = fopen(xmlFile, "w");
+    if (f != NULL) {
+        fputs(xml.c_str(), f);
+        fclose(f);
+    }
+    RpLibrary reread(xmlFile);
+    remove(xmlFile);
+
+    const char *paths[3] = {
+        "output.curve.component.xy",
+        "output.curve.component.xy",
+        "output.curve(text).component.xy"
+    };
+    RpLibrary *libs[3] = { &lib, &reread, &lib };
+    for (int n = 0; n < 3; n++) {
+        Rappture::Buffer buf = libs[n]->getDoubles(paths[n]);
+        const double *values = (const double *)buf.bytes();
+        double tolerance = (n == 2) ? 1e-5 : 0.0;
+        size_t nvalues = buf.size()/sizeof(double);
+        size_t i = 0;
+        if (nvalues == 2*nrows) {
+            for (i = 0; i < nrows; i++) {
+                if ((fabs(values[2*i]-x[i]) > tolerance) ||
+                    (fabs(values[2*i+1]-y[i]) > tolerance)) {
+                    break;
+                }
+            }
+        }
+        if ((nvalues != 2*nrows) || (i != nrows)) {
+            printf("Error: %s\n", testname);
+            printf("\t%s\n", testdesc);
+            printf("\texpected %zu values from %s\n", 2*nrows, paths[n]);
+            printf("\treceived %zu values, differing at row %zu\n",
+                nvalues, i);
+            retVal = 1;
+        }
+    }
+
+    return retVal;
+}
+
 int main()
 {
     library_0_0();
@@ -336,6 +409,7 @@ int main()
     library_2_1();
     library_2_2();
     library_2_3();
+    library_3_0();
 
     return 0;
 }
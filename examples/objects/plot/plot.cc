@@ -106,10 +106,49 @@ int plot_1_0 ()
     return test(testname,desc,expected,received);
 }
 
+int plot_2_0 ()
+{
+    const char *desc = "test plot encoding only applies while it is set";
+    const char *testname = "plot_2_0";
+
+    const char *expected = "binary text (null)";
+    char received[128];
+
+    Rappture::Plot p;
+    size_t npts = 10;
+    double x[] = {1,2,3,4,5,6,7,8,9,10};
+    double y[] = {1,4,9,16,25,36,49,64,81,100};
+
+    p.add(npts, x, y, NULL, "myid");
+    p.propstr("encoding","zb64-f64le");
+
+    // each dump is appended to the text returned by the one before
+    const char *dumps[2];
+    size_t skip = 0;
+    for (int i = 0; i < 2; i++) {
+        Rappture::ClientDataXml xmldata;
+        xmldata.indent = indent;
+        xmldata.tabstop = tabstop;
+        xmldata.retStr = NULL;
+        p.dump(Rappture::RPCONFIG_XML,&xmldata);
+        dumps[i] = (strstr(xmldata.retStr+skip,
+                           "<xy encoding=\"zb64-f64le\">") != NULL)
+                   ? "binary" : "text";
+        skip = strlen(xmldata.retStr);
+        p.propremove("encoding");
+    }
+    const char *enc = p.getNthCurve(0)->propstr("encoding");
+    snprintf(received,sizeof(received),"%s %s %s",dumps[0],dumps[1],
+             (enc != NULL) ? enc : "(null)");
+
+    return test(testname,desc,expected,received);
+}
+
 int main()
 {
     plot_0_0 ();
     plot_1_0 ();
+    plot_2_0 ();
     return 0;
 }
 
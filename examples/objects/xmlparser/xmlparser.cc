@@ -1,7 +1,9 @@
 #include <iostream>
+#include <string>
 #include <errno.h>
 #include <fstream>
 #include <sys/stat.h>
+#include <pthread.h>
 #include "RpParserXML.h"
 
 size_t
@@ -380,11 +382,483 @@ run.input.number(Ef).preset.label 4.2K (liquid helium)\n\
     return retVal;
 }
 
+int xmlparser_6_0 ()
+{
+    const char *desc = "test values larger than the parser's pool chunks";
+    const char *testname = "xmlparser_6_0";
+    int retVal = 0;
+
+    std::string value;
+    for (int i = 0; i < 20000; i++) {
+        char line[64];
+        sprintf(line,"%d %d\n",i,i*i);
+        value += line;
+    }
+    std::string xmltext = "<?xml version=\"1.0\"?>\n<run>\n<curve id=\"big\">\n"
+        "<xy>\n\t  " + value + "  \n</xy>\n</curve>\n</run>\n";
+    // the parser trims the spaces around the value
+    value.erase(value.size()-1);
+
+    Rp_ParserXml *p = Rp_ParserXmlCreate();
+    Rp_ParserXmlParse(p, xmltext.c_str());
+
+    const char *received = Rp_ParserXmlGet(p,"curve(big).xy");
+    if ((received == NULL) || (value != received)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected %zu bytes\n",value.size());
+        printf("\treceived %zu bytes\n",(received) ? strlen(received) : 0);
+        retVal = 1;
+    }
+
+    Rp_ParserXmlDestroy(&p);
+
+    return retVal;
+}
+
+int xmlparser_7_0 ()
+{
+    const char *desc = "test put, putf and appendf";
+    const char *testname = "xmlparser_7_0";
+    int retVal = 0;
+
+    const char *xmltext = "<?xml version=\"1.0\"?>\n\
+<run>\n\
+    <number id=\"Ef\">\n\
+        <units>eV</units>\n\
+    </number>\n\
+</run>\n";
+    const char *expected = "\
+run.number(Ef).units K\n\
+run.number(Ef).current 300K\n\
+run.number(Ef).about.label Temperature in kelvin\n\
+";
+
+    Rp_ParserXml *p = Rp_ParserXmlCreate();
+    Rp_ParserXmlParse(p, xmltext);
+
+    Rp_ParserXmlPut(p,"number(Ef).units","K",0);
+    Rp_ParserXmlPutF(p,"number(Ef).current","%d%s",300,"K");
+    Rp_ParserXmlPut(p,"number(Ef).about.label","Temperature",0);
+    Rp_ParserXmlPut(p,"number(Ef).about.label"," in",1);
+    Rp_ParserXmlAppendF(p,"number(Ef).about.label"," %s","kelvin");
+
+    const char *received = Rp_ParserXmlPathVal(p);
+    if (strcmp(expected,received) != 0) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected %zu bytes: \"%s\"\n",strlen(expected), expected);
+        printf("\treceived %zu bytes: \"%s\"\n",strlen(received), received);
+        retVal = 1;
+    }
+
+    Rp_ParserXmlDestroy(&p);
+
+    return retVal;
+}
+
+int xmlparser_8_0 ()
+{
+    const char *desc = "test get and put with many siblings";
+    const char *testname = "xmlparser_8_0";
+    int retVal = 0;
+    char path[100];
+    char expected[100];
+
+    const char *xmltext = "<?xml version=\"1.0\"?>\n\
+<run>\n\
+    <output>\n\
+        <curve id=\"c0\"><about><label>zero</label></about></curve>\n\
+        <curve><about><label>no id</label></about></curve>\n\
+    </output>\n\
+</run>\n";
+
+    Rp_ParserXml *p = Rp_ParserXmlCreate();
+    Rp_ParserXmlParse(p, xmltext);
+
+    int n = 5000;
+    for (int i = 1; i < n; i++) {
+        sprintf(path,"output.curve(c%d).about.label",i);
+        Rp_ParserXmlPutF(p,path,"label %d",i);
+    }
+    for (int i = 1; i < n; i++) {
+        sprintf(path,"output.curve(c%d).about.label",i);
+        sprintf(expected,"label %d",i);
+        const char *received = Rp_ParserXmlGet(p,path);
+        if ((received == NULL) || (strcmp(expected,received) != 0)) {
+            printf("Error: %s\n", testname);
+            printf("\t%s\n", desc);
+            printf("\texpected \"%s\" for %s\n",expected,path);
+            printf("\treceived \"%s\"\n",(received) ? received : "(null)");
+            retVal = 1;
+            break;
+        }
+    }
+
+    const char *checks[] = {
+        "output.curve(c0).about.label", "zero",
+        "output.curve.about.label", "zero",
+        "output.curve2.about.label", "no id",
+        "output.curve3(c2).about.label", NULL,
+        "output.curve3.about.label", "label 1",
+        "output.curve(nope).about.label", NULL,
+        NULL
+    };
+    for (int i = 0; checks[i] != NULL; i += 2) {
+        const char *received = Rp_ParserXmlGet(p,checks[i]);
+        const char *want = checks[i+1];
+        if ((received != want) &&
+            ((received == NULL) || (want == NULL) || strcmp(want,received))) {
+            printf("Error: %s\n", testname);
+            printf("\t%s\n", desc);
+            printf("\texpected \"%s\" for %s\n",(want) ? want : "(null)",
+                checks[i]);
+            printf("\treceived \"%s\"\n",(received) ? received : "(null)");
+            retVal = 1;
+        }
+    }
+
+    if (Rp_ParserXmlNumberChildren(p,"output","curve") != (size_t)n+1) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected %d curves\n",n+1);
+        printf("\treceived %zu curves\n",
+            Rp_ParserXmlNumberChildren(p,"output","curve"));
+        retVal = 1;
+    }
+
+    Rp_ParserXmlDestroy(&p);
+
+    return retVal;
+}
+
+int xmlparser_9_0 ()
+{
+    const char *desc = "test tree values and memory usage";
+    const char *testname = "xmlparser_9_0";
+    int retVal = 0;
+    char key[100];
+    void *val;
+
+    const char *xmltext = "<?xml version=\"1.0\"?>\n\
+<run>\n\
+    <input>\n\
+        <number id=\"Ef\">\n\
+            <units>eV</units>\n\
+            <current>0.5eV</current>\n\
+        </number>\n\
+    </input>\n\
+</run>\n";
+
+    Rp_ParserXml *p = Rp_ParserXmlCreate();
+    Rp_ParserXmlParse(p, xmltext);
+
+    Rp_Tree tree = Rp_ParserXmlTreeClient(p);
+    Rp_TreeNode node = Rp_ParserXmlElement(p,"input.number(Ef)");
+    Rp_TreeMemoryStats before, stats;
+    Rp_TreeMemoryUsage(tree,&before);
+
+    if ((before.nValues == 0) || (before.nInlineValues > before.nValues) ||
+        (before.totalBytes != before.nodeBytes + before.valueBytes +
+                              before.tableBytes)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\tinconsistent memory usage after parse\n");
+        retVal = 1;
+    }
+
+    // enough values to move them from a list into a hash table
+    int n = 100;
+    for (int i = 0; i < n; i++) {
+        sprintf(key,"key%d",i);
+        Rp_TreeSetValue(tree,node,key,(void *)(size_t)(i+1));
+    }
+    Rp_TreeMemoryUsage(tree,&stats);
+    if ((stats.nValues != before.nValues + n) ||
+        (stats.tableBytes <= before.tableBytes)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected %zu values\n",before.nValues + n);
+        printf("\treceived %zu values\n",stats.nValues);
+        retVal = 1;
+    }
+    for (int i = 0; i < n; i++) {
+        sprintf(key,"key%d",i);
+        val = NULL;
+        Rp_TreeGetValue(tree,node,key,&val);
+        if (val != (void *)(size_t)(i+1)) {
+            printf("Error: %s\n", testname);
+            printf("\t%s\n", desc);
+            printf("\texpected %d for %s\n",i+1,key);
+            printf("\treceived %zu\n",(size_t)val);
+            retVal = 1;
+            break;
+        }
+    }
+    const char *received = Rp_ParserXmlGet(p,"input.number(Ef).current");
+    if ((received == NULL) || (strcmp(received,"0.5eV") != 0)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected \"0.5eV\"\n");
+        printf("\treceived \"%s\"\n",(received) ? received : "(null)");
+        retVal = 1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        sprintf(key,"key%d",i);
+        Rp_TreeUnsetValue(tree,node,key);
+    }
+    Rp_TreeMemoryUsage(tree,&stats);
+    if ((stats.nValues != before.nValues) ||
+        (stats.nInlineValues != before.nInlineValues)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected %zu values\n",before.nValues);
+        printf("\treceived %zu values\n",stats.nValues);
+        retVal = 1;
+    }
+
+    // the token keeps the tree alive after the parser is gone
+    Rp_TreeSetValue(tree,node,"kept",(void *)&n);
+    Rp_ParserXmlDestroy(&p);
+    val = NULL;
+    Rp_TreeGetValue(tree,node,"kept",&val);
+    if ((val != (void *)&n) ||
+        (strcmp(Rp_TreeNodeLabel(Rp_TreeNodeParent(node)),"input") != 0)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected value %p after destroying the parser\n",
+            (void *)&n);
+        printf("\treceived %p\n", val);
+        retVal = 1;
+    }
+    Rp_TreeReleaseToken(tree);
+
+    return retVal;
+}
+
+int xmlparser_10_0 ()
+{
+    const char *desc = "test trees and chains sharing an arena";
+    const char *testname = "xmlparser_10_0";
+    int retVal = 0;
+    char name[100];
+
+    Rp_Arena arena = Rp_ArenaCreate();
+    Rp_Tree tree = NULL;
+    Rp_TreeCreateWithArena("arenaTree",arena,&tree);
+    Rp_Chain *chain = Rp_ChainCreateWithArena(arena);
+
+    Rp_TreeNode root = Rp_TreeRootNode(tree);
+    int n = 1000;
+    for (int i = 0; i < n; i++) {
+        sprintf(name,"node%d",i);
+        Rp_TreeNode node = Rp_TreeCreateNode(tree,root,name,-1);
+        Rp_TreeSetValue(tree,node,"id",(void *)(size_t)(i+1));
+        Rp_TreeSetValue(tree,node,"value",(void *)(size_t)(i+2));
+        Rp_ChainAppend(chain,(void *)node);
+    }
+    void *big = Rp_ArenaAlloc(arena,3*RP_ARENA_MAX_ITEM);
+    memset(big,0,3*RP_ARENA_MAX_ITEM);
+
+    Rp_PoolStats stats;
+    Rp_ArenaGetStats(arena,&stats);
+    if ((Rp_ChainGetLength(chain) != n) ||
+        (stats.bytesInUse < 3*RP_ARENA_MAX_ITEM + n*sizeof(Rp_ChainLink)) ||
+        (stats.chunkBytes < stats.bytesInUse) || (stats.nChunks == 0)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\treceived %d links, %zu bytes in use in %zu bytes of %zu chunks\n",
+            Rp_ChainGetLength(chain), stats.bytesInUse, stats.chunkBytes,
+            stats.nChunks);
+        retVal = 1;
+    }
+
+    // freed items are reused
+    size_t inUse = stats.bytesInUse;
+    Rp_ArenaFree(arena,big,3*RP_ARENA_MAX_ITEM);
+    Rp_ChainDestroy(chain);
+    Rp_ArenaGetStats(arena,&stats);
+    if (stats.bytesInUse >= inUse - 3*RP_ARENA_MAX_ITEM) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected less than %zu bytes in use\n",
+            inUse - 3*RP_ARENA_MAX_ITEM);
+        printf("\treceived %zu bytes in use\n",stats.bytesInUse);
+        retVal = 1;
+    }
+
+    // releasing the tree leaves its nodes in the arena, resetting the
+    // arena frees everything at once.
+    Rp_TreeReleaseToken(tree);
+    Rp_ArenaReset(arena);
+    Rp_ArenaGetStats(arena,&stats);
+    if ((stats.bytesInUse != 0) || (stats.chunkBytes != 0) ||
+        (stats.nChunks != 0)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected an empty arena after reset\n");
+        printf("\treceived %zu bytes in use in %zu chunks\n",
+            stats.bytesInUse, stats.nChunks);
+        retVal = 1;
+    }
+
+    // the arena can be used again after a reset
+    Rp_TreeCreateWithArena("arenaTree",arena,&tree);
+    Rp_TreeNode node = Rp_TreeCreateNode(tree,Rp_TreeRootNode(tree),"n",-1);
+    Rp_TreeSetValue(tree,node,"value",(void *)&n);
+    void *val = NULL;
+    Rp_TreeGetValue(tree,node,"value",&val);
+    if (val != (void *)&n) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected value %p after reset\n", (void *)&n);
+        printf("\treceived %p\n", val);
+        retVal = 1;
+    }
+    Rp_TreeReleaseToken(tree);
+    Rp_ArenaDestroy(arena);
+
+    return retVal;
+}
+
+int xmlparser_11_0 ()
+{
+    const char *desc = "test many parsers at once";
+    const char *testname = "xmlparser_11_0";
+    int retVal = 0;
+
+    // more parsers than a process has thread-specific data keys
+    int n = 1100;
+    Rp_ParserXml **parsers = new Rp_ParserXml*[n];
+    for (int i = 0; i < n; i++) {
+        parsers[i] = Rp_ParserXmlCreate();
+        Rp_ParserXmlParse(parsers[i],
+            "<?xml version=\"1.0\"?>\n<run><a id=\"x\">1</a></run>\n");
+    }
+    pthread_key_t key;
+    int status = pthread_key_create(&key,NULL);
+    if (status != 0) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\tcan't create a thread key with %d parsers: %s\n",
+            n, strerror(status));
+        retVal = 1;
+    } else {
+        pthread_key_delete(key);
+    }
+    const char *received = Rp_ParserXmlGet(parsers[n-1],"a(x)");
+    if ((received == NULL) || (strcmp(received,"1") != 0)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected \"1\"\n");
+        printf("\treceived \"%s\"\n",(received) ? received : "(null)");
+        retVal = 1;
+    }
+    for (int i = 0; i < n; i++) {
+        Rp_ParserXmlDestroy(&parsers[i]);
+    }
+    delete[] parsers;
+
+    return retVal;
+}
+
+// Allocates and frees items of many sizes from a shared arena.
+static void *
+arenaThread(void *clientData)
+{
+    Rp_Arena arena = (Rp_Arena) clientData;
+    void *items[500];
+
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 500; i++) {
+            size_t size = 1 + (i*37) % RP_ARENA_MAX_ITEM;
+            items[i] = Rp_ArenaAlloc(arena,size);
+            memset(items[i],i,size);
+        }
+        for (int i = 0; i < 500; i++) {
+            size_t size = 1 + (i*37) % RP_ARENA_MAX_ITEM;
+            Rp_ArenaFree(arena,items[i],size);
+        }
+    }
+    return NULL;
+}
+
+int xmlparser_12_0 ()
+{
+    const char *desc = "test a shared arena used by several threads";
+    const char *testname = "xmlparser_12_0";
+    int retVal = 0;
+
+    Rp_Arena arena = Rp_ArenaCreateShared();
+    pthread_t threads[4];
+    int nThreads = 0;
+    for (int i = 0; i < 4; i++) {
+        if (pthread_create(&threads[nThreads],NULL,arenaThread,arena) == 0) {
+            nThreads++;
+        }
+    }
+    Rp_PoolStats stats;
+    for (int i = 0; i < 100; i++) {
+        Rp_ArenaGetStats(arena,&stats);
+    }
+    for (int i = 0; i < nThreads; i++) {
+        pthread_join(threads[i],NULL);
+    }
+
+    // the threads' caches go back to the arena when they exit
+    Rp_ArenaGetStats(arena,&stats);
+    if ((nThreads == 0) || (stats.bytesInUse != 0) ||
+        (stats.chunkBytes == 0)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected 0 bytes in use after %d threads\n", nThreads);
+        printf("\treceived %zu bytes in use in %zu bytes of chunks\n",
+            stats.bytesInUse, stats.chunkBytes);
+        retVal = 1;
+    }
+    Rp_ArenaDestroy(arena);
+
+    return retVal;
+}
+
+int xmlparser_13_0 ()
+{
+    const char *desc = "test appending to a value many times";
+    const char *testname = "xmlparser_13_0";
+    int retVal = 0;
+
+    Rp_ParserXml *p = Rp_ParserXmlCreate();
+    Rp_Tree tree = Rp_ParserXmlTreeClient(p);
+    const int n = 2000;
+    for (int i = 0; i < n; i++) {
+        Rp_ParserXmlAppendF(p,"output.log","%d",i%10);
+    }
+    Rp_ParserXmlPut(p,"output.log",Rp_ParserXmlGet(p,"output.log"),1);
+
+    // each value replaced by a longer one goes back to the arena, so
+    // the arena holds a few times the value, not n copies of it
+    Rp_PoolStats stats;
+    Rp_ArenaGetStats(Rp_TreeArena(tree),&stats);
+    const char *received = Rp_ParserXmlGet(p,"output.log");
+    size_t len = (received) ? strlen(received) : 0;
+    if ((len != 2*n) || (strncmp(received,"0123456789",10) != 0) ||
+        (strncmp(received+n,"0123456789",10) != 0) ||
+        (stats.bytesInUse > 16*(size_t)n + 65536)) {
+        printf("Error: %s\n", testname);
+        printf("\t%s\n", desc);
+        printf("\texpected a value of %d bytes\n", 2*n);
+        printf("\treceived %zu bytes, %zu bytes in use\n", len,
+            stats.bytesInUse);
+        retVal = 1;
+    }
+    Rp_ParserXmlDestroy(&p);
+    Rp_TreeReleaseToken(tree);
+
+    return retVal;
+}
+
 // FIXME: test what happens when parser sees self closing tag <tag/>
-// FIXME: test get function
-// FIXME: test put function
-// FIXME: test putf function
-// FIXME: test appendf function
 // FIXME: look into why Rp_ParserXmlPathVal hits some nodes twice in gdb
 
 int main()
@@ -396,6 +870,14 @@ int main()
     xmlparser_3_0();
     xmlparser_4_0();
     xmlparser_5_0();
+    xmlparser_6_0();
+    xmlparser_7_0();
+    xmlparser_8_0();
+    xmlparser_9_0();
+    xmlparser_10_0();
+    xmlparser_11_0();
+    xmlparser_12_0();
+    xmlparser_13_0();
 
     return 0;
 }
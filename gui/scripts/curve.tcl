@@ -32,6 +32,7 @@ itcl::class Rappture::Curve {
     public method components {{pattern *}}
     public method mesh {cname }
     public method values { cname }
+    public method lod { cname }
     public method limits {which}
     public method hints {{key ""}}
     public method xmarkers {}
@@ -44,6 +45,8 @@ itcl::class Rappture::Curve {
     private variable _xmlobj ""  ;      # ref to lib obj with curve data
     private variable _curve ""   ;      # lib obj representing this curve
     private variable _comp2xy    ;      # maps component name => x,y vectors
+    private variable _comp2lod   ;      # maps component name => decimated
+                                        # x,y vectors
     private variable _hints      ;      # cache of hints stored in XML
 
     private variable _xmarkers "";      # list of {x,label,options} triplets.
@@ -74,6 +77,9 @@ itcl::body Rappture::Curve::destructor {} {
     foreach name [array names _comp2xy] {
         eval blt::vector destroy $_comp2xy($name)
     }
+    foreach name [array names _comp2lod] {
+        eval blt::vector destroy $_comp2lod($name)
+    }
 }
 
 # ----------------------------------------------------------------------
@@ -121,6 +127,21 @@ itcl::body Rappture::Curve::values {cname} {
     error "bad component \"$cname\": should be one of [join [lsort [array names _comp2xy]] {, }]"
 }
 
+# ----------------------------------------------------------------------
+# USAGE: lod <name>
+#
+# Returns the x and y vectors of the decimated copy of the curve
+# component <name> (the <lod> element next to <xy>), or "" if the
+# component has none.  Plotters can draw these instead of the full
+# data when the whole curve is in view.
+# ----------------------------------------------------------------------
+itcl::body Rappture::Curve::lod {cname} {
+    if {[info exists _comp2lod($cname)]} {
+        return $_comp2lod($cname)
+    }
+    return ""
+}
+
 # ----------------------------------------------------------------------
 # USAGE: xErrorValues <name>
 #
@@ -291,6 +312,10 @@ itcl::body Rappture::Curve::_build {} {
         eval blt::vector destroy $_comp2xy($name)
     }
     catch {unset _comp2xy}
+    foreach name [array names _comp2lod] {
+        eval blt::vector destroy $_comp2lod($name)
+    }
+    catch {unset _comp2lod}
 
     #
     # Scan through the components of the curve and create
@@ -302,7 +327,13 @@ itcl::body Rappture::Curve::_build {} {
         set xev [blt::vector create \#auto]
         set yev [blt::vector create \#auto]
 
-        set xydata [$_curve get $cname.xy]
+        if { [$_curve attribute $cname.xy encoding] == "zb64-f64le" } {
+            # Binary data: x,y pairs packed as little-endian doubles.
+            set xydata [Rappture::encoding::decode -as zb64-f64le \
+                [$_curve get -decode no $cname.xy]]
+        } else {
+            set xydata [$_curve get $cname.xy]
+        }
         if { "" != $xydata} {
             set tmp [blt::vector create \#auto]
             $tmp set $xydata
@@ -322,6 +353,22 @@ itcl::body Rappture::Curve::_build {} {
         $xev set [$_curve get "$cname.xerrorbars"]
         $yev set [$_curve get "$cname.yerrorbars"]
         set _comp2xy($cname) [list $xv $yv $xev $yev]
+
+        if { [$_curve attribute $cname.lod encoding] == "zb64-f64le" } {
+            set lodata [Rappture::encoding::decode -as zb64-f64le \
+                [$_curve get -decode no $cname.lod]]
+        } else {
+            set lodata [$_curve get $cname.lod]
+        }
+        if { "" != $lodata } {
+            set lxv [blt::vector create \#auto]
+            set lyv [blt::vector create \#auto]
+            set tmp [blt::vector create \#auto]
+            $tmp set $lodata
+            $tmp split $lxv $lyv
+            blt::vector destroy $tmp
+            set _comp2lod($cname) [list $lxv $lyv]
+        }
         incr _counter
     }
 
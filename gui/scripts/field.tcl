@@ -915,7 +915,7 @@ itcl::body Rappture::Field::Build {} {
                 close $f
             }
             # Convert to VTK
-            if { [catch { Rappture::DxToVtk $contents } vtkdata] == 0 } {
+            if { [catch { Rappture::DxToVtk $contents -format binary } vtkdata] == 0 } {
                 unset contents
                 # Read back VTK: this will set the field limits and the mesh
                 # dimensions based on the bounds (sets _dim).  We rely on this
@@ -1400,7 +1400,7 @@ itcl::body Rappture::Field::vtkdata {cname} {
     if {[info exists _comp2dx($cname)]} {
         set data $_comp2dx($cname)
         set data [Rappture::encoding::decode -as zb64 $data]
-        return [Rappture::DxToVtk $data]
+        return [Rappture::DxToVtk $data -format binary]
     }
     # Points on mesh:  Construct VTK file output.
     if { [info exists _comp2mesh($cname)] } {
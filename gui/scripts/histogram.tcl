@@ -361,7 +361,13 @@ itcl::body Rappture::Histogram::ParseData { comp } {
         set _comp2hist($comp) [list $_xvalues($comp) $_yvalues($comp)]
         return
     }
-    set xhwdata [$_hist get ${comp}.xhw]
+    if { [$_hist attribute ${comp}.xhw encoding] == "zb64-f64le" } {
+        # Binary data: x,h,w triples packed as little-endian doubles.
+        set xhwdata [Rappture::encoding::decode -as zb64-f64le \
+            [$_hist get -decode no ${comp}.xhw]]
+    } else {
+        set xhwdata [$_hist get ${comp}.xhw]
+    }
     if { $xhwdata != "" } {
         set count 0
         foreach {name h w} [regsub -all "\[ \t\n]+" $xhwdata { }] {
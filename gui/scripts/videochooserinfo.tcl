@@ -123,8 +123,8 @@ itcl::body Rappture::VideoChooserInfo::load {path about} {
             set movie [Rappture::Video file ${_path}]
             $movie seek 60
 
-            ${_preview} put [$movie get image ${_width} ${_height}]
-            ${_selected} put [$movie get image ${_selectedwidth} ${_selectedheight}]
+            $movie get photo ${_preview} ${_width} ${_height}
+            $movie get photo ${_selected} ${_selectedwidth} ${_selectedheight}
 
             $movie release
         }]
@@ -352,7 +352,7 @@ itcl::body Rappture::VideoPreview::fixSize {} {
 
     # get an image with the new size
     ${_imh} blank
-    ${_imh} put [${_movie} get image ${_width} ${_height}]
+    ${_movie} get photo ${_imh} ${_width} ${_height}
 
     # make the canvas fit the image
     $itk_component(main) configure -width ${_width} -height ${_height}
@@ -430,7 +430,7 @@ itcl::body Rappture::VideoPreview::Play {} {
         # not the current frame+1. this happens when we skip frames
         # because the underlying c lib is too slow at reading.
         $_movie seek $cur
-        $_imh put [${_movie} get image ${_width} ${_height}]
+        ${_movie} get photo $_imh ${_width} ${_height}
     } 1]
     regexp {(\d+\.?\d*) microseconds per iteration} ${_ofrd} match _ofrd
     set _ofrd [expr {round(${_ofrd}/1000)}]
@@ -479,7 +479,7 @@ itcl::body Rappture::VideoPreview::Seek {args} {
         return
     }
     ${_movie} seek $val
-    ${_imh} put [${_movie} get image ${_width} ${_height}]
+    ${_movie} get photo ${_imh} ${_width} ${_height}
 
     # update the dial and framenum widgets
     set _settings($this-framenum) [${_movie} get position cur]
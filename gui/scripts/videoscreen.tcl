@@ -630,7 +630,7 @@ itcl::body Rappture::VideoScreen::fixSize {} {
     ${_imh} blank
     ${_imh} configure -width 1 -height 1
     ${_imh} configure -width 0 -height 0
-    ${_imh} put [${_movie} get image ${_width} ${_height}]
+    ${_movie} get photo ${_imh} ${_width} ${_height}
 
     # place the image in the center of the canvas
     set ccw [winfo width $itk_component(main)]
@@ -729,7 +729,7 @@ itcl::body Rappture::VideoScreen::Play {} {
         # not the current frame+1. this happens when we skip frames
         # because the underlying c lib is too slow at reading.
         ${_movie} seek $cur
-        ${_imh} put [${_movie} get image ${_width} ${_height}]
+        ${_movie} get photo ${_imh} ${_width} ${_height}
     } 1]
     regexp {(\d+\.?\d*) microseconds per iteration} ${_ofrd} match _ofrd
     set _ofrd [expr {round(${_ofrd}/1000)}]
@@ -788,7 +788,7 @@ itcl::body Rappture::VideoScreen::Seek {args} {
         return
     }
     ${_movie} seek $val
-    ${_imh} put [${_movie} get image ${_width} ${_height}]
+    ${_movie} get photo ${_imh} ${_width} ${_height}
 
     # update the dial and framenum widgets
     set _settings(framenum) [${_movie} get position cur]
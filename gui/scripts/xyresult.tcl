@@ -87,6 +87,8 @@ itcl::class Rappture::XyResult {
     common _downloadPopup;              # Download options from popup
     private variable _markers
     private variable _nextElement 0
+    private variable _maxPoints 20000;  # Draw decimated curves when more
+                                        # than this many points are in view
 
     constructor {args} {
         # defined below
@@ -109,6 +111,7 @@ itcl::class Rappture::XyResult {
     protected method Zoom {option args}
     protected method Hilite {state x y}
     protected method Axis {option args}
+    protected method UpdateDetail {}
     protected method GetAxes {dataobj}
     protected method GetLineMarkerOptions { style }
     protected method GetTextMarkerOptions { style }
@@ -209,6 +212,8 @@ itcl::body Rappture::XyResult::constructor {args} {
 
     # quick-and-dirty zoom functionality, for now...
     Blt_ZoomStack $itk_component(plot)
+    bind $itk_component(plot) <ButtonPress> \
+        +[list after idle [itcl::code $this UpdateDetail]]
     eval itk_initialize $args
 
     set _hilite(elem) ""
@@ -647,6 +652,7 @@ itcl::body Rappture::XyResult::Zoom {option args} {
     switch -- $option {
         reset {
             ResetLimits
+            UpdateDetail
             Rappture::Logger::log curve zoom -reset
         }
     }
@@ -986,6 +992,7 @@ itcl::body Rappture::XyResult::Axis {option args} {
             }
             # one last movement
             Axis drag $axis $x $y
+            UpdateDetail
 
             # log this change
             Rappture::Logger::log curve axis $axis \
@@ -1678,5 +1685,46 @@ itcl::body Rappture::XyResult::SetElements { dataobj {settings ""} } {
             $g element configure $_comp2elem($tag) -mapx $mapx -mapy $mapy
         }
     }
+    UpdateDetail
+}
+
+# ----------------------------------------------------------------------
+# USAGE: UpdateDetail
+#
+# Called whenever the x-axis limits may have changed.  Curves that
+# come with a decimated copy of their data (see Curve::lod) are drawn
+# from that copy while more than _maxPoints of their points are in
+# view, and from the full data once the user zooms in far enough.
+# ----------------------------------------------------------------------
+itcl::body Rappture::XyResult::UpdateDetail {} {
+    set g $itk_component(plot)
+    foreach elem [array names _elem2comp] {
+        foreach {dataobj cname} [split $_elem2comp($elem) -] break
+        if {[catch {$dataobj lod $cname} lod] || $lod == ""} {
+            continue
+        }
+        set xv [$dataobj mesh $cname]
+        set yv [$dataobj values $cname]
+
+        # estimate the number of points in view from the visible
+        # fraction of the x range
+        foreach {xmin xmax} [$dataobj limits x] break
+        foreach {vmin vmax} [$g axis limits [$g element cget $elem -mapx]] \
+            break
+        set npts [$xv length]
+        if {$xmax > $xmin} {
+            set lo [expr {($vmin > $xmin) ? $vmin : $xmin}]
+            set hi [expr {($vmax < $xmax) ? $vmax : $xmax}]
+            set npts [expr {$npts*($hi-$lo)/($xmax-$xmin)}]
+        }
+        if {$npts > $_maxPoints} {
+            foreach {xv yv} $lod break
+            $g element configure $elem -x $xv -y $yv -xerror "" -yerror ""
+        } else {
+            $g element configure $elem -x $xv -y $yv \
+                -xerror [$dataobj xErrorValues $cname] \
+                -yerror [$dataobj yErrorValues $cname]
+        }
+    }
 }
 
@@ -21,54 +21,137 @@
 #include <limits.h>
 #include <float.h>
 #include "tcl.h"
+#include "RpNumParse.h"
 
 #define DO_WEDGES
 //#define CHECK_WINDINGS
 
-static INLINE char *
-SkipSpaces(char *string) 
+/*
+ * Stores a value as a big-endian 32-bit float, the byte order of
+ * binary legacy VTK files.
+ */
+static INLINE void
+PutFloat(unsigned char *bytes, double value)
+{
+    union {
+        float f;
+        unsigned int i;
+    } u;
+
+    u.f = (float)value;
+    bytes[0] = (unsigned char)(u.i >> 24);
+    bytes[1] = (unsigned char)(u.i >> 16);
+    bytes[2] = (unsigned char)(u.i >> 8);
+    bytes[3] = (unsigned char)(u.i);
+}
+
+static INLINE void
+PutInt(unsigned char *bytes, int value)
+{
+    unsigned int i = (unsigned int)value;
+
+    bytes[0] = (unsigned char)(i >> 24);
+    bytes[1] = (unsigned char)(i >> 16);
+    bytes[2] = (unsigned char)(i >> 8);
+    bytes[3] = (unsigned char)(i);
+}
+
+/*
+ * Grows the byte array objPtr by length bytes and returns a pointer
+ * to the new space.
+ */
+static unsigned char *
+ExtendBytes(Tcl_Obj *objPtr, int length)
+{
+    int oldLength;
+
+    Tcl_GetByteArrayFromObj(objPtr, &oldLength);
+    return Tcl_SetByteArrayLength(objPtr, oldLength + length) + oldLength;
+}
+
+/*
+ * Appends text to the VTK output.  For binary output, objPtr is a
+ * byte array and the (ASCII) text is copied in as bytes, so that
+ * the binary data already there isn't converted to UTF-8.
+ */
+static void
+AppendText(Tcl_Obj *objPtr, int binary, const char *text)
 {
-    while (isspace(*string)) {
-        string++;
+    if (binary) {
+        int length = strlen(text);
+        memcpy(ExtendBytes(objPtr, length), text, length);
+    } else {
+        Tcl_AppendToObj(objPtr, text, -1);
     }
-    return string;
 }
 
-static INLINE char *
-GetLine(char **stringPtr, const char *endPtr) 
+static void
+AppendData(Tcl_Obj *objPtr, int binary, Tcl_Obj *dataObjPtr)
 {
-    char *line, *p;
+    if (binary) {
+        unsigned char *bytes;
+        int length;
 
-    line = SkipSpaces(*stringPtr);
-    for (p = line; p < endPtr; p++) {
-        if (*p == '\n') {
-            *stringPtr = p + 1;
-            return line;
-        }
+        bytes = Tcl_GetByteArrayFromObj(dataObjPtr, &length);
+        memcpy(ExtendBytes(objPtr, length), bytes, length);
+        AppendText(objPtr, binary, "\n");
+    } else {
+        Tcl_AppendObjToObj(objPtr, dataObjPtr);
+    }
+}
+
+/*
+ * Adds point i to the ASCII or binary point list.  For binary output,
+ * bytes is the space for every point, from ExtendBytes(); for ASCII
+ * output it's NULL and the point is appended as text.
+ */
+static void
+AppendPoint(Tcl_Obj *objPtr, unsigned char *bytes, int i, double x,
+            double y, double z)
+{
+    if (bytes != NULL) {
+        bytes += i * 3 * sizeof(float);
+        PutFloat(bytes, x);
+        PutFloat(bytes + 4, y);
+        PutFloat(bytes + 8, z);
+    } else {
+        char mesg[200];
+
+        sprintf(mesg, "%g %g %g\n", x, y, z);
+        Tcl_AppendToObj(objPtr, mesg, -1);
     }
-    *stringPtr = p;
-    return line;
 }
 
+/*
+ * For binary output, the values are written straight into their place
+ * in the VTK byte array as they're parsed.  ASCII output needs them in
+ * VTK order before they can be printed, so they're collected first.
+ */
 static int
-GetUniformFieldValues(Tcl_Interp *interp, int nPoints, int *counts, char **stringPtr, 
-                      const char *endPtr, Tcl_Obj *objPtr) 
+GetUniformFieldValues(Tcl_Interp *interp, int nPoints, int *counts, const char **stringPtr, 
+                      const char *endPtr, Tcl_Obj *objPtr, int binary) 
 {
     int i;
     const char *p;
     char mesg[2000];
     double *array;
+    unsigned char *bytes;
     int iX, iY, iZ;
 
     p = *stringPtr;
-    array = malloc(sizeof(double) * nPoints);
-    if (array == NULL) {
-        return TCL_ERROR;
+    array = NULL;
+    bytes = NULL;
+    if (binary) {
+        bytes = ExtendBytes(objPtr, sizeof(float) * nPoints);
+    } else {
+        array = malloc(sizeof(double) * nPoints);
+        if (array == NULL) {
+            return TCL_ERROR;
+        }
     }
     iX = iY = iZ = 0;
     for (i = 0; i < nPoints; i++) {
         double value;
-        char *nextPtr;
         int loc;
 
         if (p >= endPtr) {
@@ -77,14 +160,12 @@ GetUniformFieldValues(Tcl_Interp *interp, int nPoints, int *counts, char **strin
             free(array);
             return TCL_ERROR;
         }
-        value = strtod(p, &nextPtr);
-        if (nextPtr == p) {
+        if (!Rp_ParseDouble(p, endPtr, &value, &p)) {
             Tcl_AppendResult(interp, "bad value found in reading field values",
                              (char *)NULL);
             free(array);
             return TCL_ERROR;
         }
-        p = nextPtr;
         loc = iZ*counts[0]*counts[1] + iY*counts[0] + iX;
         if (++iZ >= counts[2]) {
             iZ = 0;
@@ -93,34 +174,46 @@ GetUniformFieldValues(Tcl_Interp *interp, int nPoints, int *counts, char **strin
                 ++iX;
             }
         }
-        array[loc] = value;
+        if (binary) {
+            PutFloat(bytes + loc * sizeof(float), value);
+        } else {
+            array[loc] = value;
+        }
     }
-    for (i = 0; i < nPoints; i++) {
-        sprintf(mesg, "%g\n", array[i]);
-        Tcl_AppendToObj(objPtr, mesg, -1);
+    if (!binary) {
+        for (i = 0; i < nPoints; i++) {
+            sprintf(mesg, "%g\n", array[i]);
+            Tcl_AppendToObj(objPtr, mesg, -1);
+        }
+        free(array);
     }
-    free(array);
-    *stringPtr = (char *)p;
+    *stringPtr = p;
     return TCL_OK;
 }
 
 static int
-GetStructuredGridFieldValues(Tcl_Interp *interp, int nPoints, char **stringPtr, 
-                             const char *endPtr, Tcl_Obj *objPtr) 
+GetStructuredGridFieldValues(Tcl_Interp *interp, int nPoints, const char **stringPtr, 
+                             const char *endPtr, Tcl_Obj *objPtr, int binary) 
 {
     int i;
     const char *p;
     char mesg[2000];
     double *array;
+    unsigned char *bytes;
 
     p = *stringPtr;
-    array = malloc(sizeof(double) * nPoints);
-    if (array == NULL) {
-        return TCL_ERROR;
+    array = NULL;
+    bytes = NULL;
+    if (binary) {
+        bytes = ExtendBytes(objPtr, sizeof(float) * nPoints);
+    } else {
+        array = malloc(sizeof(double) * nPoints);
+        if (array == NULL) {
+            return TCL_ERROR;
+        }
     }
     for (i = 0; i < nPoints; i++) {
         double value;
-        char *nextPtr;
 
         if (p >= endPtr) {
             Tcl_AppendResult(interp, "unexpected EOF in reading field values",
@@ -128,47 +221,57 @@ GetStructuredGridFieldValues(Tcl_Interp *interp, int nPoints, char **stringPtr,
             free(array);
             return TCL_ERROR;
         }
-        value = strtod(p, &nextPtr);
-        if (nextPtr == p) {
+        if (!Rp_ParseDouble(p, endPtr, &value, &p)) {
             Tcl_AppendResult(interp, "bad value found in reading field values",
                              (char *)NULL);
             free(array);
             return TCL_ERROR;
         }
-        p = nextPtr;
-        array[i] = value;
+        if (binary) {
+            PutFloat(bytes + i * sizeof(float), value);
+        } else {
+            array[i] = value;
+        }
     }
-    for (i = 0; i < nPoints; i++) {
-        sprintf(mesg, "%g\n", array[i]);
-        Tcl_AppendToObj(objPtr, mesg, -1);
+    if (!binary) {
+        for (i = 0; i < nPoints; i++) {
+            sprintf(mesg, "%g\n", array[i]);
+            Tcl_AppendToObj(objPtr, mesg, -1);
+        }
+        free(array);
     }
-    free(array);
-    *stringPtr = (char *)p;
+    *stringPtr = p;
     return TCL_OK;
 }
 
 static int
-GetCloudFieldValues(Tcl_Interp *interp, int nXYPoints, int nZPoints, char **stringPtr, 
-                    const char *endPtr, Tcl_Obj *objPtr) 
+GetCloudFieldValues(Tcl_Interp *interp, int nXYPoints, int nZPoints, const char **stringPtr, 
+                    const char *endPtr, Tcl_Obj *objPtr, int binary) 
 {
     int i;
     const char *p;
     char mesg[2000];
     double *array;
+    unsigned char *bytes;
     int iXY, iZ;
     int nPoints;
 
     nPoints = nXYPoints * nZPoints;
 
     p = *stringPtr;
-    array = malloc(sizeof(double) * nPoints);
-    if (array == NULL) {
-        return TCL_ERROR;
+    array = NULL;
+    bytes = NULL;
+    if (binary) {
+        bytes = ExtendBytes(objPtr, sizeof(float) * nPoints);
+    } else {
+        array = malloc(sizeof(double) * nPoints);
+        if (array == NULL) {
+            return TCL_ERROR;
+        }
     }
     iXY = iZ = 0;
     for (i = 0; i < nPoints; i++) {
         double value;
-        char *nextPtr;
         int loc;
 
         if (p >= endPtr) {
@@ -177,33 +280,37 @@ GetCloudFieldValues(Tcl_Interp *interp, int nXYPoints, int nZPoints, char **stri
             free(array);
             return TCL_ERROR;
         }
-        value = strtod(p, &nextPtr);
-        if (nextPtr == p) {
+        if (!Rp_ParseDouble(p, endPtr, &value, &p)) {
             Tcl_AppendResult(interp, "bad value found in reading field values",
                              (char *)NULL);
             free(array);
             return TCL_ERROR;
         }
-        p = nextPtr;
         loc = nXYPoints * iZ + iXY;
         if (++iZ >= nZPoints) {
             iZ = 0;
             ++iXY;
         }
-        array[loc] = value;
+        if (binary) {
+            PutFloat(bytes + loc * sizeof(float), value);
+        } else {
+            array[loc] = value;
+        }
     }
-    for (i = 0; i < nPoints; i++) {
-        sprintf(mesg, "%g\n", array[i]);
-        Tcl_AppendToObj(objPtr, mesg, -1);
+    if (!binary) {
+        for (i = 0; i < nPoints; i++) {
+            sprintf(mesg, "%g\n", array[i]);
+            Tcl_AppendToObj(objPtr, mesg, -1);
+        }
+        free(array);
     }
-    free(array);
-    *stringPtr = (char *)p;
+    *stringPtr = p;
     return TCL_OK;
 }
 
 static int
 GetPoints(Tcl_Interp *interp, double *array, int nXYPoints,
-          char **stringPtr, const char *endPtr) 
+          const char **stringPtr, const char *endPtr) 
 {
     int i;
     const char *p;
@@ -213,64 +320,53 @@ GetPoints(Tcl_Interp *interp, double *array, int nXYPoints,
         return TCL_ERROR;
     }
     for (i = 0; i < nXYPoints; i++) {
-        double x, y;
-        char *nextPtr;
+        double xyz[3];
 
         if (p >= endPtr) {
             Tcl_AppendResult(interp, "unexpected EOF in reading points",
                              (char *)NULL);
             return TCL_ERROR;
         }
-        x = strtod(p, &nextPtr);
-        if (nextPtr == p) {
-            Tcl_AppendResult(interp, "bad value found in reading points",
-                             (char *)NULL);
-            return TCL_ERROR;
-        }
-        p = nextPtr;
-        y = strtod(p, &nextPtr);
-        if (nextPtr == p) {
-            Tcl_AppendResult(interp, "bad value found in reading points",
-                             (char *)NULL);
-            return TCL_ERROR;
-        }
-        p = nextPtr;
         /* z is unused */
-        strtod(p, &nextPtr);
-        if (nextPtr == p) {
+        if (Rp_ParseDoubles(&p, endPtr, xyz, 3) != 3) {
             Tcl_AppendResult(interp, "bad value found in reading points",
                              (char *)NULL);
             return TCL_ERROR;
         }
-        p = nextPtr;
-
-        array[i*2  ] = x;
-        array[i*2+1] = y;
+        array[i*2  ] = xyz[0];
+        array[i*2+1] = xyz[1];
     }
 
-    *stringPtr = (char *)p;
+    *stringPtr = p;
     return TCL_OK;
 }
 
 static int
 GetUniformFieldVectors(Tcl_Interp *interp, int nPoints, int *counts,
-                       char **stringPtr, const char *endPtr, Tcl_Obj *objPtr) 
+                       const char **stringPtr, const char *endPtr, Tcl_Obj *objPtr,
+                       int binary) 
 {
     int i;
     const char *p;
     char mesg[2000];
     double *array;
+    unsigned char *bytes;
     int iX, iY, iZ;
 
     p = *stringPtr;
-    array = malloc(sizeof(double) * nPoints * 3);
-    if (array == NULL) {
-        return TCL_ERROR;
+    array = NULL;
+    bytes = NULL;
+    if (binary) {
+        bytes = ExtendBytes(objPtr, sizeof(float) * nPoints * 3);
+    } else {
+        array = malloc(sizeof(double) * nPoints * 3);
+        if (array == NULL) {
+            return TCL_ERROR;
+        }
     }
     iX = iY = iZ = 0;
     for (i = 0; i < nPoints; i++) {
-        double x, y, z;
-        char *nextPtr;
+        double xyz[3];
         int loc;
 
         if (p >= endPtr) {
@@ -279,30 +375,12 @@ GetUniformFieldVectors(Tcl_Interp *interp, int nPoints, int *counts,
             free(array);
             return TCL_ERROR;
         }
-        x = strtod(p, &nextPtr);
-        if (nextPtr == p) {
-            Tcl_AppendResult(interp, "bad value found in reading vectors",
-                             (char *)NULL);
-            free(array);
-            return TCL_ERROR;
-        }
-        p = nextPtr;
-        y = strtod(p, &nextPtr);
-        if (nextPtr == p) {
+        if (Rp_ParseDoubles(&p, endPtr, xyz, 3) != 3) {
             Tcl_AppendResult(interp, "bad value found in reading vectors",
                              (char *)NULL);
             free(array);
             return TCL_ERROR;
         }
-        p = nextPtr;
-        z = strtod(p, &nextPtr);
-        if (nextPtr == p) {
-            Tcl_AppendResult(interp, "bad value found in reading vectors",
-                             (char *)NULL);
-            free(array);
-            return TCL_ERROR;
-        }
-        p = nextPtr;
         loc = iZ*counts[0]*counts[1] + iY*counts[0] + iX;
         if (++iZ >= counts[2]) {
             iZ = 0;
@@ -311,16 +389,24 @@ GetUniformFieldVectors(Tcl_Interp *interp, int nPoints, int *counts,
                 ++iX;
             }
         }
-        array[loc*3  ] = x;
-        array[loc*3+1] = y;
-        array[loc*3+2] = z;
+        if (binary) {
+            PutFloat(bytes + (loc*3  ) * sizeof(float), xyz[0]);
+            PutFloat(bytes + (loc*3+1) * sizeof(float), xyz[1]);
+            PutFloat(bytes + (loc*3+2) * sizeof(float), xyz[2]);
+        } else {
+            array[loc*3  ] = xyz[0];
+            array[loc*3+1] = xyz[1];
+            array[loc*3+2] = xyz[2];
+        }
     }
-    for (i = 0; i < nPoints; i++) {
-        sprintf(mesg, "%g %g %g\n", array[i*3], array[i*3+1], array[i*3+2]);
-        Tcl_AppendToObj(objPtr, mesg, -1);
+    if (!binary) {
+        for (i = 0; i < nPoints; i++) {
+            sprintf(mesg, "%g %g %g\n", array[i*3], array[i*3+1], array[i*3+2]);
+            Tcl_AppendToObj(objPtr, mesg, -1);
+        }
+        free(array);
     }
-    free(array);
-    *stringPtr = (char *)p;
+    *stringPtr = p;
     return TCL_OK;
 }
 
@@ -348,9 +434,28 @@ Cross(double v1[3], double v2[3], double vout[3])
     vout[2] = v1[0]*v2[1] - v1[1]*v2[0];
 }
 #endif
+/*
+ * Starts a legacy VTK file.  Binary output is built up as a byte array.
+ */
+static Tcl_Obj *
+NewVtkObj(int binary)
+{
+    Tcl_Obj *objPtr;
+
+    objPtr = (binary) ? Tcl_NewByteArrayObj(NULL, 0) : Tcl_NewStringObj("", -1);
+    AppendText(objPtr, binary, "# vtk DataFile Version 2.0\n");
+    AppendText(objPtr, binary, "Converted from DX file\n");
+    AppendText(objPtr, binary, (binary) ? "BINARY\n" : "ASCII\n");
+    return objPtr;
+}
+
 /* 
- *  DxToVtk string
+ *  DxToVtk string ?-format ascii|binary?
  *
+ *  With "-format binary", the result is a binary legacy VTK file in a
+ *  Tcl byte array: big-endian floats for points and values, and
+ *  big-endian ints for cells.  This is much smaller and faster to both
+ *  build and read than ASCII for large fields.
  * In DX format:
  *  rank 0 means scalars,
  *  rank 1 means vectors,
@@ -368,8 +473,8 @@ DxToVtkCmd(ClientData clientData, Tcl_Interp *interp, int objc,
 {
     double *points;
     Tcl_Obj *objPtr, *pointsObjPtr, *fieldObjPtr, *cellsObjPtr;
-    char *p, *pend;
-    char *string;
+    const char *p, *pend;
+    const char *string;
     char mesg[2000];
     double dv0[3], dv1[3], dv2[3];
     double dx, dy, dz;
@@ -380,7 +485,10 @@ DxToVtkCmd(ClientData clientData, Tcl_Interp *interp, int objc,
     int isUniform;
     int isStructuredGrid;
     int hasVectors;
+    int binary;
+    const char *type;
     int i, ix, iy, iz;
+    unsigned char *bytes;
 
     name = "component";
     points = NULL;
@@ -395,11 +503,33 @@ DxToVtkCmd(ClientData clientData, Tcl_Interp *interp, int objc,
     isStructuredGrid = 0;
     hasVectors = 0;
 
-    if (objc != 2) {
+    binary = 0;
+    if ((objc != 2) && (objc != 4)) {
         Tcl_AppendResult(interp, "wrong # arguments: should be \"",
-                         Tcl_GetString(objv[0]), " string\"", (char *)NULL);
+                         Tcl_GetString(objv[0]),
+                         " string ?-format ascii|binary?\"", (char *)NULL);
         return TCL_ERROR;
     }
+    if (objc == 4) {
+        const char *opt;
+
+        opt = Tcl_GetString(objv[2]);
+        if (strcmp(opt, "-format") != 0) {
+            Tcl_AppendResult(interp, "unknown switch \"", opt,
+                             "\": should be \"-format\"", (char *)NULL);
+            return TCL_ERROR;
+        }
+        opt = Tcl_GetString(objv[3]);
+        if (strcmp(opt, "binary") == 0) {
+            binary = 1;
+        } else if (strcmp(opt, "ascii") != 0) {
+            Tcl_AppendResult(interp, "bad value \"", opt,
+                             "\" for -format switch: should be ascii or binary",
+                             (char *)NULL);
+            return TCL_ERROR;
+        }
+    }
+    type = (binary) ? "float" : "double";
     string = Tcl_GetStringFromObj(objv[1], &length);
     if (strncmp("<ODX>", string, 5) == 0) {
         string += 5;
@@ -408,18 +538,25 @@ DxToVtkCmd(ClientData clientData, Tcl_Interp *interp, int objc,
         string += 4;
         length -= 4;
     }
-    pointsObjPtr = Tcl_NewStringObj("", -1);
-    cellsObjPtr = Tcl_NewStringObj("", -1);
-    fieldObjPtr = Tcl_NewStringObj("", -1);
+    if (binary) {
+        pointsObjPtr = Tcl_NewByteArrayObj(NULL, 0);
+        cellsObjPtr = Tcl_NewByteArrayObj(NULL, 0);
+        fieldObjPtr = Tcl_NewByteArrayObj(NULL, 0);
+    } else {
+        pointsObjPtr = Tcl_NewStringObj("", -1);
+        cellsObjPtr = Tcl_NewStringObj("", -1);
+        fieldObjPtr = Tcl_NewStringObj("", -1);
+    }
     for (p = string, pend = p + length; p < pend; /*empty*/) {
-        char *line;
+        const char *line;
         double ddx, ddy, ddz;
+        int lineLen;
 
-        line = GetLine(&p, pend);
+        line = Rp_GetLine(&p, pend, &lineLen);
         if (line >= pend) {
             break;                        /* EOF */
         }
-        if ((line[0] == '#') || (line[0] == '\n')) {
+        if ((lineLen == 0) || (line[0] == '#')) {
             continue;                        /* Skip blank or comment lines. */
         }
         if (sscanf(line, "object %*d class gridpositions counts %d %d %d", 
@@ -512,7 +649,7 @@ DxToVtkCmd(ClientData clientData, Tcl_Interp *interp, int objc,
 #endif
             if (isUniform) {
                 hasVectors = 1;
-                if (GetUniformFieldVectors(interp, nPoints, count, &p, pend, fieldObjPtr)
+                if (GetUniformFieldVectors(interp, nPoints, count, &p, pend, fieldObjPtr, binary)
                     != TCL_OK) {
                     return TCL_ERROR;
                 }
@@ -552,17 +689,17 @@ DxToVtkCmd(ClientData clientData, Tcl_Interp *interp, int objc,
                 return TCL_ERROR;
             }
             if (isUniform) {
-                if (GetUniformFieldValues(interp, nPoints, count, &p, pend, fieldObjPtr) 
+                if (GetUniformFieldValues(interp, nPoints, count, &p, pend, fieldObjPtr, binary) 
                     != TCL_OK) {
                     return TCL_ERROR;
                 }
             } else if (isStructuredGrid) {
-                if (GetStructuredGridFieldValues(interp, nPoints, &p, pend, fieldObjPtr) 
+                if (GetStructuredGridFieldValues(interp, nPoints, &p, pend, fieldObjPtr, binary) 
                     != TCL_OK) {
                     return TCL_ERROR;
                 }
             } else {
-                if (GetCloudFieldValues(interp, nXYPoints, count[2], &p, pend, fieldObjPtr) 
+                if (GetCloudFieldValues(interp, nXYPoints, count[2], &p, pend, fieldObjPtr, binary) 
                     != TCL_OK) {
                     return TCL_ERROR;
                 }
@@ -597,40 +734,42 @@ DxToVtkCmd(ClientData clientData, Tcl_Interp *interp, int objc,
             Tcl_AppendResult(interp, mesg, (char *)NULL);
             return TCL_ERROR;
         }
-        objPtr = Tcl_NewStringObj("# vtk DataFile Version 2.0\n", -1);
-        Tcl_AppendToObj(objPtr, "Converted from DX file\n", -1);
-        Tcl_AppendToObj(objPtr, "ASCII\n", -1);
-        Tcl_AppendToObj(objPtr, "DATASET STRUCTURED_POINTS\n", -1);
+        objPtr = NewVtkObj(binary);
+        AppendText(objPtr, binary, "DATASET STRUCTURED_POINTS\n");
         sprintf(mesg, "DIMENSIONS %d %d %d\n", count[0], count[1], count[2]);
-        Tcl_AppendToObj(objPtr, mesg, -1);
+        AppendText(objPtr, binary, mesg);
         sprintf(mesg, "ORIGIN %g %g %g\n", origin[0], origin[1], origin[2]);
-        Tcl_AppendToObj(objPtr, mesg, -1);
+        AppendText(objPtr, binary, mesg);
         sprintf(mesg, "SPACING %g %g %g\n", dx, dy, dz);
-        Tcl_AppendToObj(objPtr, mesg, -1);
+        AppendText(objPtr, binary, mesg);
         sprintf(mesg, "POINT_DATA %d\n", nPoints);
-        Tcl_AppendToObj(objPtr, mesg, -1);
+        AppendText(objPtr, binary, mesg);
         if (hasVectors) {
-            sprintf(mesg, "VECTORS %s double\n", name);
-            Tcl_AppendToObj(objPtr, mesg, -1);
+            sprintf(mesg, "VECTORS %s %s\n", name, type);
+            AppendText(objPtr, binary, mesg);
         } else {
-            sprintf(mesg, "SCALARS %s double 1\n", name);
-            Tcl_AppendToObj(objPtr, mesg, -1);
+            sprintf(mesg, "SCALARS %s %s 1\n", name, type);
+            AppendText(objPtr, binary, mesg);
             sprintf(mesg, "LOOKUP_TABLE default\n");
-            Tcl_AppendToObj(objPtr, mesg, -1);
+            AppendText(objPtr, binary, mesg);
         }
-        Tcl_AppendObjToObj(objPtr, fieldObjPtr);
+        AppendData(objPtr, binary, fieldObjPtr);
     } else if (isStructuredGrid) {
 #ifdef notdef
         fprintf(stderr, "dv0 %g %g %g\n", dv0[0], dv0[1], dv0[2]);
         fprintf(stderr, "dv1 %g %g %g\n", dv1[0], dv1[1], dv1[2]);
         fprintf(stderr, "dv2 %g %g %g\n", dv2[0], dv2[1], dv2[2]);
 #endif
-        objPtr = Tcl_NewStringObj("# vtk DataFile Version 2.0\n", -1);
-        Tcl_AppendToObj(objPtr, "Converted from DX file\n", -1);
-        Tcl_AppendToObj(objPtr, "ASCII\n", -1);
-        Tcl_AppendToObj(objPtr, "DATASET STRUCTURED_GRID\n", -1);
+        objPtr = NewVtkObj(binary);
+        AppendText(objPtr, binary, "DATASET STRUCTURED_GRID\n");
         sprintf(mesg, "DIMENSIONS %d %d %d\n", count[0], count[1], count[2]);
-        Tcl_AppendToObj(objPtr, mesg, -1);
+        AppendText(objPtr, binary, mesg);
+        bytes = NULL;
+        if (binary) {
+            bytes = ExtendBytes(pointsObjPtr,
+                3 * sizeof(float) * count[0] * count[1] * count[2]);
+        }
+        i = 0;
         for (iz = 0; iz < count[2]; iz++) {
             for (iy = 0; iy < count[1]; iy++) {
                 for (ix = 0; ix < count[0]; ix++) {
@@ -638,39 +777,41 @@ DxToVtkCmd(ClientData clientData, Tcl_Interp *interp, int objc,
                     x = origin[0] + dv2[0] * iz + dv1[0] * iy + dv0[0] * ix;
                     y = origin[1] + dv2[1] * iz + dv1[1] * iy + dv0[1] * ix;
                     z = origin[2] + dv2[2] * iz + dv1[2] * iy + dv0[2] * ix;
-                    sprintf(mesg, "%g %g %g\n", x, y, z);
-                    Tcl_AppendToObj(pointsObjPtr, mesg, -1);
+                    AppendPoint(pointsObjPtr, bytes, i++, x, y, z);
                 }
             }
         }
-        sprintf(mesg, "POINTS %d double\n", nPoints);
-        Tcl_AppendToObj(objPtr, mesg, -1);
-        Tcl_AppendObjToObj(objPtr, pointsObjPtr);
+        sprintf(mesg, "POINTS %d %s\n", nPoints, type);
+        AppendText(objPtr, binary, mesg);
+        AppendData(objPtr, binary, pointsObjPtr);
         sprintf(mesg, "POINT_DATA %d\n", nPoints);
-        Tcl_AppendToObj(objPtr, mesg, -1);
-        sprintf(mesg, "SCALARS %s double 1\n", name);
-        Tcl_AppendToObj(objPtr, mesg, -1);
+        AppendText(objPtr, binary, mesg);
+        sprintf(mesg, "SCALARS %s %s 1\n", name, type);
+        AppendText(objPtr, binary, mesg);
         sprintf(mesg, "LOOKUP_TABLE default\n");
-        Tcl_AppendToObj(objPtr, mesg, -1);
-        Tcl_AppendObjToObj(objPtr, fieldObjPtr);
+        AppendText(objPtr, binary, mesg);
+        AppendData(objPtr, binary, fieldObjPtr);
     } else {
         /* Fill points.  Have to wait to do this since origin, delta can come after
          * the point list in the file.
          */
+        bytes = NULL;
+        if (binary) {
+            bytes = ExtendBytes(pointsObjPtr,
+                3 * sizeof(float) * nXYPoints * count[2]);
+        }
         for (iz = 0; iz < count[2]; iz++) {
             for (i = 0; i < nXYPoints; i++) {
-                sprintf(mesg, "%g %g %g\n", points[i*2], points[i*2+1], (origin[2] + dz * iz));
-                Tcl_AppendToObj(pointsObjPtr, mesg, -1);
+                AppendPoint(pointsObjPtr, bytes, iz * nXYPoints + i,
+                            points[i*2], points[i*2+1], (origin[2] + dz * iz));
             }
         }
 
-        objPtr = Tcl_NewStringObj("# vtk DataFile Version 2.0\n", -1);
-        Tcl_AppendToObj(objPtr, "Converted from DX file\n", -1);
-        Tcl_AppendToObj(objPtr, "ASCII\n", -1);
-        Tcl_AppendToObj(objPtr, "DATASET UNSTRUCTURED_GRID\n", -1);
-        sprintf(mesg, "POINTS %d double\n", nPoints);
-        Tcl_AppendToObj(objPtr, mesg, -1);
-        Tcl_AppendObjToObj(objPtr, pointsObjPtr);
+        objPtr = NewVtkObj(binary);
+        AppendText(objPtr, binary, "DATASET UNSTRUCTURED_GRID\n");
+        sprintf(mesg, "POINTS %d %s\n", nPoints, type);
+        AppendText(objPtr, binary, mesg);
+        AppendData(objPtr, binary, pointsObjPtr);
 #ifdef DO_WEDGES
         {
             double xmin, xmax, ymin, ymax;
@@ -752,10 +893,23 @@ DxToVtkCmd(ClientData clientData, Tcl_Interp *interp, int objc,
                                 int base = nXYPoints * iz;
                                 int top = base + nXYPoints;
                                 nCells++;
-                                sprintf(mesg, "%d %d %d %d %d %d %d\n", 6,
-                                        base + c0, base + c1, base + c2,
-                                        top + c0, top + c1, top + c2);
-                                Tcl_AppendToObj(cellsObjPtr, mesg, -1);
+                                if (binary) {
+                                    unsigned char *bytes;
+
+                                    bytes = ExtendBytes(cellsObjPtr, 7 * 4);
+                                    PutInt(bytes,      6);
+                                    PutInt(bytes + 4,  base + c0);
+                                    PutInt(bytes + 8,  base + c1);
+                                    PutInt(bytes + 12, base + c2);
+                                    PutInt(bytes + 16, top + c0);
+                                    PutInt(bytes + 20, top + c1);
+                                    PutInt(bytes + 24, top + c2);
+                                } else {
+                                    sprintf(mesg, "%d %d %d %d %d %d %d\n", 6,
+                                            base + c0, base + c1, base + c2,
+                                            top + c0, top + c1, top + c2);
+                                    Tcl_AppendToObj(cellsObjPtr, mesg, -1);
+                                }
                             }
                         }
                     } else {
@@ -770,25 +924,35 @@ DxToVtkCmd(ClientData clientData, Tcl_Interp *interp, int objc,
             unlink(fcells);
         }
         sprintf(mesg, "CELLS %d %d\n", nCells, 7*nCells);
-        Tcl_AppendToObj(objPtr, mesg, -1);
-        Tcl_AppendObjToObj(objPtr, cellsObjPtr);
+        AppendText(objPtr, binary, mesg);
+        AppendData(objPtr, binary, cellsObjPtr);
         sprintf(mesg, "CELL_TYPES %d\n", nCells);
-        Tcl_AppendToObj(objPtr, mesg, -1);
-        sprintf(mesg, "%d\n", 13);
-        for (i = 0; i < nCells; i++) {
-            Tcl_AppendToObj(objPtr, mesg, -1);
+        AppendText(objPtr, binary, mesg);
+        if (binary) {
+            unsigned char *bytes;
+
+            bytes = ExtendBytes(objPtr, nCells * 4);
+            for (i = 0; i < nCells; i++) {
+                PutInt(bytes + i * 4, 13);
+            }
+            AppendText(objPtr, binary, "\n");
+        } else {
+            sprintf(mesg, "%d\n", 13);
+            for (i = 0; i < nCells; i++) {
+                AppendText(objPtr, binary, mesg);
+            }
         }
 #endif
         if (points != NULL) {
             free(points);
         }
         sprintf(mesg, "POINT_DATA %d\n", nPoints);
-        Tcl_AppendToObj(objPtr, mesg, -1);
-        sprintf(mesg, "SCALARS %s double 1\n", name);
-        Tcl_AppendToObj(objPtr, mesg, -1);
+        AppendText(objPtr, binary, mesg);
+        sprintf(mesg, "SCALARS %s %s 1\n", name, type);
+        AppendText(objPtr, binary, mesg);
         sprintf(mesg, "LOOKUP_TABLE default\n");
-        Tcl_AppendToObj(objPtr, mesg, -1);
-        Tcl_AppendObjToObj(objPtr, fieldObjPtr);
+        AppendText(objPtr, binary, mesg);
+        AppendData(objPtr, binary, fieldObjPtr);
     }
 
     Tcl_DecrRefCount(pointsObjPtr);
@@ -0,0 +1,270 @@
+
+/*
+ * ----------------------------------------------------------------------
+ *  RpNumParse -
+ *
+ *  Line splitting and number parsing shared by the data converters
+ *  (DxToVtk, PdbToVtk, ReadPoints).  Nothing here allocates memory or
+ *  needs the input to be NUL terminated at the end of a field, so
+ *  numbers can be read in place from fixed columns or from the middle
+ *  of a large Tcl string.
+ *
+ * ======================================================================
+ *  Copyright (c) 2004-2012  HUBzero Foundation, LLC
+ *
+ *  See the file "license.terms" for information on usage and
+ *  redistribution of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ * ======================================================================
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "tcl.h"
+#include "RpNumParse.h"
+
+#define UCHAR(c) ((unsigned char) (c))
+
+/* Powers of ten that are exactly representable as doubles. */
+static const double powersOf10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+    1e22
+};
+#define MAXPOW10	22
+
+#define MAXMANTISSA	(((Tcl_WideUInt)1) << 53)
+#define MAXDIGITS	19		/* Digits that always fit in 64 bits. */
+#define MAXTOKEN	128		/* Longest number handed to strtod
+					 * from the stack. */
+
+/*
+ * ------------------------------------------------------------------------
+ *  Rp_SkipSpaces --
+ *
+ *	Returns a pointer to the first non-whitespace character at or
+ *	after p, or endPtr.
+ * ------------------------------------------------------------------------
+ */
+const char *
+Rp_SkipSpaces(const char *p, const char *endPtr)
+{
+    while ((p < endPtr) && isspace(UCHAR(*p))) {
+	p++;
+    }
+    return p;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  Rp_GetLine --
+ *
+ *	Returns the next non-blank line, with leading whitespace
+ *	removed.  The length of the line (not counting the newline) is
+ *	stored in lengthPtr, and stringPtr is moved to the start of the
+ *	following line.  Returns endPtr when there are no more lines.
+ * ------------------------------------------------------------------------
+ */
+const char *
+Rp_GetLine(const char **stringPtr, const char *endPtr, int *lengthPtr)
+{
+    const char *line, *p;
+
+    line = Rp_SkipSpaces(*stringPtr, endPtr);
+    p = memchr(line, '\n', endPtr - line);
+    if (p == NULL) {
+	p = endPtr;
+	*stringPtr = endPtr;
+    } else {
+	*stringPtr = p + 1;
+    }
+    *lengthPtr = p - line;
+    return line;
+}
+
+/*
+ * Converts a number with strtod.  The number is copied out first, since
+ * strtod needs a terminating NUL and could otherwise run past endPtr.
+ */
+static int
+SlowParseDouble(const char *start, const char *endPtr, double *valuePtr,
+		const char **nextPtr)
+{
+    char buf[MAXTOKEN + 1];
+    char *copy, *end;
+    const char *p;
+    int length;
+
+    for (p = start; p < endPtr; p++) {
+	int c = UCHAR(*p);
+
+	/* Anything strtod could take: digits, signs, points, exponents,
+	 * hex digits, "inf" and "nan". */
+	if (!isalnum(c) && (c != '.') && (c != '+') && (c != '-')) {
+	    break;
+	}
+    }
+    length = p - start;
+    copy = (length > MAXTOKEN) ? Tcl_Alloc(length + 1) : buf;
+    memcpy(copy, start, length);
+    copy[length] = '\0';
+    *valuePtr = strtod(copy, &end);
+    length = end - copy;
+    if (copy != buf) {
+	Tcl_Free(copy);
+    }
+    *nextPtr = start + length;
+    return (length > 0);
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  Rp_ParseDouble --
+ *
+ *	Parses a floating point number starting at p, skipping leading
+ *	whitespace and reading no further than endPtr.  It accepts what
+ *	strtod accepts and returns exactly the same (correctly rounded)
+ *	value.
+ *
+ *	Most numbers in data files have at most 19 significant digits
+ *	and a small exponent.  When the digits fit in a double's 53-bit
+ *	mantissa and the power of ten is exact, a single multiply or
+ *	divide gives the correctly rounded result (Clinger's fast path).
+ *	Everything else (long mantissas, large exponents, hex, inf, nan)
+ *	goes to strtod.
+ *
+ *	Returns 1 and stores the value and the position just past the
+ *	number, or returns 0 (with *nextPtr set to p) if there's no
+ *	number there.
+ * ------------------------------------------------------------------------
+ */
+int
+Rp_ParseDouble(const char *p, const char *endPtr, double *valuePtr,
+	       const char **nextPtr)
+{
+    const char *start, *digits;
+    Tcl_WideUInt mantissa;
+    int negative, numDigits, numSignificant, exponent;
+    double value;
+
+    *nextPtr = p;
+    p = Rp_SkipSpaces(p, endPtr);
+    start = p;
+    negative = 0;
+    if ((p < endPtr) && ((*p == '-') || (*p == '+'))) {
+	negative = (*p == '-');
+	p++;
+    }
+    mantissa = 0;
+    numDigits = numSignificant = exponent = 0;
+    digits = p;
+    while ((p < endPtr) && isdigit(UCHAR(*p))) {
+	if ((mantissa > 0) || (*p != '0')) {
+	    mantissa = mantissa * 10 + (*p - '0');
+	    numSignificant++;
+	}
+	p++;
+    }
+    numDigits = p - digits;
+    if ((p < endPtr) && (*p == '.')) {
+	const char *fraction;
+
+	p++;
+	fraction = p;
+	while ((p < endPtr) && isdigit(UCHAR(*p))) {
+	    if ((mantissa > 0) || (*p != '0')) {
+		mantissa = mantissa * 10 + (*p - '0');
+		numSignificant++;
+	    }
+	    p++;
+	}
+	numDigits += p - fraction;
+	exponent = -(p - fraction);
+    }
+    if (numDigits == 0) {
+	/* No digits: "inf", "nan", ".", or not a number at all. */
+	if (SlowParseDouble(start, endPtr, valuePtr, nextPtr)) {
+	    return 1;
+	}
+	*nextPtr = start;
+	return 0;
+    }
+    if ((p < endPtr) && ((*p == 'x') || (*p == 'X'))) {
+	/* Hexadecimal */
+	return SlowParseDouble(start, endPtr, valuePtr, nextPtr);
+    }
+    if ((p < endPtr) && ((*p == 'e') || (*p == 'E'))) {
+	const char *q;
+	int expNegative, expValue;
+
+	q = p + 1;
+	expNegative = 0;
+	if ((q < endPtr) && ((*q == '-') || (*q == '+'))) {
+	    expNegative = (*q == '-');
+	    q++;
+	}
+	if ((q < endPtr) && isdigit(UCHAR(*q))) {
+	    expValue = 0;
+	    while ((q < endPtr) && isdigit(UCHAR(*q))) {
+		if (expValue < 100000) {
+		    expValue = expValue * 10 + (*q - '0');
+		}
+		q++;
+	    }
+	    exponent += (expNegative) ? -expValue : expValue;
+	    p = q;
+	}
+	/* Otherwise the "e" isn't part of the number, as with strtod. */
+    }
+    if ((numSignificant > MAXDIGITS) || (mantissa > MAXMANTISSA)) {
+	return SlowParseDouble(start, endPtr, valuePtr, nextPtr);
+    }
+    value = (double)mantissa;
+    if ((mantissa == 0) || (exponent == 0)) {
+	/* Nothing to scale. */
+    } else if ((exponent < 0) && (exponent >= -MAXPOW10)) {
+	value /= powersOf10[-exponent];
+    } else if ((exponent > 0) && (exponent <= MAXPOW10)) {
+	value *= powersOf10[exponent];
+    } else if ((exponent > MAXPOW10) &&
+	       (exponent <= MAXPOW10 + 15) &&
+	       (mantissa <= MAXMANTISSA /
+		(Tcl_WideUInt)powersOf10[exponent - MAXPOW10])) {
+	/* Move some of the exponent into the mantissa, which stays
+	 * exact as long as it fits in 53 bits. */
+	value = (double)(mantissa * (Tcl_WideUInt)powersOf10[exponent - MAXPOW10]);
+	value *= powersOf10[MAXPOW10];
+    } else {
+	return SlowParseDouble(start, endPtr, valuePtr, nextPtr);
+    }
+    *valuePtr = (negative) ? -value : value;
+    *nextPtr = p;
+    return 1;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  Rp_ParseDoubles --
+ *
+ *	Parses up to n whitespace-separated numbers from *stringPtr into
+ *	array.  Stops early at endPtr or at the first thing that isn't a
+ *	number.  Moves *stringPtr past the numbers read and returns how
+ *	many were read.
+ * ------------------------------------------------------------------------
+ */
+int
+Rp_ParseDoubles(const char **stringPtr, const char *endPtr, double *array,
+		int n)
+{
+    const char *p, *next;
+    int i;
+
+    p = *stringPtr;
+    for (i = 0; i < n; i++) {
+	if (!Rp_ParseDouble(p, endPtr, array + i, &next)) {
+	    break;
+	}
+	p = next;
+    }
+    *stringPtr = p;
+    return i;
+}
@@ -0,0 +1,27 @@
+
+/*
+ * ----------------------------------------------------------------------
+ *  RpNumParse -
+ *
+ *  Line splitting and number parsing shared by the data converters
+ *  (DxToVtk, PdbToVtk, ReadPoints).
+ *
+ * ======================================================================
+ *  Copyright (c) 2004-2012  HUBzero Foundation, LLC
+ *
+ *  See the file "license.terms" for information on usage and
+ *  redistribution of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ * ======================================================================
+ */
+#ifndef RP_NUMPARSE_H
+#define RP_NUMPARSE_H
+
+extern const char *Rp_SkipSpaces(const char *p, const char *endPtr);
+extern const char *Rp_GetLine(const char **stringPtr, const char *endPtr,
+	int *lengthPtr);
+extern int Rp_ParseDouble(const char *p, const char *endPtr,
+	double *valuePtr, const char **nextPtr);
+extern int Rp_ParseDoubles(const char **stringPtr, const char *endPtr,
+	double *array, int n);
+
+#endif /* RP_NUMPARSE_H */
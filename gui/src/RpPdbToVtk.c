@@ -18,6 +18,7 @@
 #include <limits.h>
 #include <float.h>
 #include "tcl.h"
+#include "RpNumParse.h"
 
 #define BOND_NONE	(0)
 #define BOND_CONECT	(1<<0)
@@ -174,70 +175,232 @@ Itoa(int number)
     return buf;
 }
 
+static int
+CompareInts(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  ComputeBonds --
+ *
+ *	Adds a bond between each pair of atoms that are closer than the
+ *	sum of their covalent radii (plus a tolerance).  The atoms are
+ *	sorted into a grid of cubic cells as large as the longest possible
+ *	bond, so each atom only needs to be compared with the atoms in its
+ *	own and the 26 surrounding cells.  This keeps the search linear in
+ *	the number of atoms, instead of comparing every pair.
+ *
+ *	Bonds are added in the same order as the all-pairs search (by
+ *	atom, then by partner), so the output doesn't change.
+ * ------------------------------------------------------------------------
+ */
 static void
 ComputeBonds(Tcl_HashTable *atomTablePtr, Tcl_HashTable *conectTablePtr)
 {
     PdbAtom **array;
-    int i;
+    int *cellStart, *cellAtoms, *atomCell, *partners;
+    int i, numAtoms, numCells, numPartners, maxPartners;
+    int nx, ny, nz;
+    double rmax, cellSize, min[3], max[3];
     Tcl_HashEntry *hPtr;
     Tcl_HashSearch iter;
 
 #define TOLERANCE 0.45			/* Fuzz factor for comparing distances
 					 * (in angstroms) */
-    array = calloc(atomTablePtr->numEntries, sizeof(PdbAtom *));
+#define MAXCELLSPERATOM 8		/* Limit on the size of the cell grid,
+					 * so sparse inputs don't allocate a
+					 * huge, mostly empty grid. */
+    numAtoms = atomTablePtr->numEntries;
+    if (numAtoms < 2) {
+	return;
+    }
+    array = calloc(numAtoms, sizeof(PdbAtom *));
     if (array == NULL) {
 	return;
     }
+    rmax = 0.0;
+    min[0] = min[1] = min[2] = DBL_MAX;
+    max[0] = max[1] = max[2] = -DBL_MAX;
     for (i = 0, hPtr = Tcl_FirstHashEntry(atomTablePtr, &iter); hPtr != NULL;
 	 hPtr = Tcl_NextHashEntry(&iter), i++) {
 	PdbAtom *atomPtr = Tcl_GetHashValue(hPtr);
 	array[i] = atomPtr;
+	if (elements[atomPtr->number].radius > rmax) {
+	    rmax = elements[atomPtr->number].radius;
+	}
+	if (atomPtr->x < min[0]) min[0] = atomPtr->x;
+	if (atomPtr->x > max[0]) max[0] = atomPtr->x;
+	if (atomPtr->y < min[1]) min[1] = atomPtr->y;
+	if (atomPtr->y > max[1]) max[1] = atomPtr->y;
+	if (atomPtr->z < min[2]) min[2] = atomPtr->z;
+	if (atomPtr->z > max[2]) max[2] = atomPtr->z;
+    }
+
+    /* No bond can be longer than the cutoff for the two largest atoms. */
+    cellSize = 2.0 * rmax + TOLERANCE;
+    nx = ny = nz = 1;
+    for (i = 0; i < 64; i++) {
+	double dnx, dny, dnz;
+
+	dnx = floor((max[0] - min[0]) / cellSize) + 1.0;
+	dny = floor((max[1] - min[1]) / cellSize) + 1.0;
+	dnz = floor((max[2] - min[2]) / cellSize) + 1.0;
+	if ((dnx * dny * dnz) <= (double)numAtoms * MAXCELLSPERATOM) {
+	    nx = (int)dnx, ny = (int)dny, nz = (int)dnz;
+	    break;
+	}
+	cellSize *= 2.0;
+    }
+    numCells = nx * ny * nz;
+
+    cellStart = calloc(numCells + 1, sizeof(int));
+    cellAtoms = malloc(numAtoms * sizeof(int));
+    atomCell = malloc(numAtoms * sizeof(int));
+    maxPartners = 64;
+    partners = malloc(maxPartners * sizeof(int));
+    if ((cellStart == NULL) || (cellAtoms == NULL) || (atomCell == NULL) ||
+	(partners == NULL)) {
+	goto done;
     }
-    for (i = 0; i < atomTablePtr->numEntries; i++) {
+
+    /* Counting sort of the atoms by cell.  Each cell's atoms end up in
+     * increasing array order. */
+    for (i = 0; i < numAtoms; i++) {
+	int ix, iy, iz;
+
+	ix = (int)((array[i]->x - min[0]) / cellSize);
+	iy = (int)((array[i]->y - min[1]) / cellSize);
+	iz = (int)((array[i]->z - min[2]) / cellSize);
+	if (ix >= nx) ix = nx - 1;
+	if (iy >= ny) iy = ny - 1;
+	if (iz >= nz) iz = nz - 1;
+	atomCell[i] = (iz * ny + iy) * nx + ix;
+	cellStart[atomCell[i] + 1]++;
+    }
+    for (i = 0; i < numCells; i++) {
+	cellStart[i + 1] += cellStart[i];
+    }
+    {
+	int *fill;
+
+	fill = malloc(numCells * sizeof(int));
+	if (fill == NULL) {
+	    goto done;
+	}
+	memcpy(fill, cellStart, numCells * sizeof(int));
+	for (i = 0; i < numAtoms; i++) {
+	    cellAtoms[fill[atomCell[i]]++] = i;
+	}
+	free(fill);
+    }
+
+    for (i = 0; i < numAtoms; i++) {
 	PdbAtom *atom1Ptr;
 	double r1;
-	int j;
+	int ix, iy, iz, cx, cy, cz, k;
 
 	atom1Ptr = array[i];
         r1 = elements[atom1Ptr->number].radius;
-        for (j = i+1; j < atomTablePtr->numEntries; j++) {
-	    PdbAtom *atom2Ptr;
-            double ds2, cut;
-	    double r2;
-
-	    atom2Ptr  = array[j];
-            if ((atom2Ptr->number == 1) && (atom1Ptr->number == 1)) {
-                continue;
-	    }
-	    r2 = elements[atom2Ptr->number].radius;
-	    cut = (r1 + r2 + TOLERANCE);
-	    ds2 = (((atom1Ptr->x - atom2Ptr->x) * (atom1Ptr->x - atom2Ptr->x)) +
-		   ((atom1Ptr->y - atom2Ptr->y) * (atom1Ptr->y - atom2Ptr->y)) +
-		   ((atom1Ptr->z - atom2Ptr->z) * (atom1Ptr->z - atom2Ptr->z)));
-
-	    // perform distance test, but ignore pairs between atoms
-	    // with nearly identical coords
-	    if (ds2 < 0.16) {
+	cx = atomCell[i] % nx;
+	cy = (atomCell[i] / nx) % ny;
+	cz = atomCell[i] / (nx * ny);
+	numPartners = 0;
+	for (iz = cz - 1; iz <= cz + 1; iz++) {
+	    if ((iz < 0) || (iz >= nz)) {
 		continue;
 	    }
-	    if (ds2 < (cut*cut)) {
-		ConnectKey key;
-		int isNew;
-
-		if (atom1Ptr->ordinal > atom2Ptr->ordinal) {
-		    key.from = atom2Ptr->ordinal;
-		    key.to = atom1Ptr->ordinal;
-		} else {
-		    key.from = atom1Ptr->ordinal;
-		    key.to = atom2Ptr->ordinal;
+	    for (iy = cy - 1; iy <= cy + 1; iy++) {
+		if ((iy < 0) || (iy >= ny)) {
+		    continue;
 		}
-		Tcl_CreateHashEntry(conectTablePtr, (char *)&key, &isNew);
-		if (isNew) {
-		    atom1Ptr->numConnections++;
-		    atom2Ptr->numConnections++;
+		for (ix = cx - 1; ix <= cx + 1; ix++) {
+		    int cell, n;
+
+		    if ((ix < 0) || (ix >= nx)) {
+			continue;
+		    }
+		    cell = (iz * ny + iy) * nx + ix;
+		    for (n = cellStart[cell]; n < cellStart[cell + 1]; n++) {
+			PdbAtom *atom2Ptr;
+			double ds2, cut;
+			double r2;
+			int j;
+
+			j = cellAtoms[n];
+			if (j <= i) {
+			    continue;	/* Each pair is tested once. */
+			}
+			atom2Ptr  = array[j];
+			if ((atom2Ptr->number == 1) && (atom1Ptr->number == 1)) {
+			    continue;
+			}
+			r2 = elements[atom2Ptr->number].radius;
+			cut = (r1 + r2 + TOLERANCE);
+			ds2 = (((atom1Ptr->x - atom2Ptr->x) *
+				(atom1Ptr->x - atom2Ptr->x)) +
+			       ((atom1Ptr->y - atom2Ptr->y) *
+				(atom1Ptr->y - atom2Ptr->y)) +
+			       ((atom1Ptr->z - atom2Ptr->z) *
+				(atom1Ptr->z - atom2Ptr->z)));
+
+			// perform distance test, but ignore pairs between
+			// atoms with nearly identical coords
+			if ((ds2 < 0.16) || (ds2 >= (cut*cut))) {
+			    continue;
+			}
+			if (numPartners == maxPartners) {
+			    int *newPtr;
+
+			    newPtr = realloc(partners,
+					     2 * maxPartners * sizeof(int));
+			    if (newPtr == NULL) {
+				goto done;
+			    }
+			    partners = newPtr;
+			    maxPartners *= 2;
+			}
+			partners[numPartners++] = j;
+		    }
 		}
-            }
-        }
+	    }
+	}
+	if (numPartners > 1) {
+	    qsort(partners, numPartners, sizeof(int), CompareInts);
+	}
+	for (k = 0; k < numPartners; k++) {
+	    PdbAtom *atom2Ptr;
+	    ConnectKey key;
+	    int isNew;
+
+	    atom2Ptr = array[partners[k]];
+	    if (atom1Ptr->ordinal > atom2Ptr->ordinal) {
+		key.from = atom2Ptr->ordinal;
+		key.to = atom1Ptr->ordinal;
+	    } else {
+		key.from = atom1Ptr->ordinal;
+		key.to = atom2Ptr->ordinal;
+	    }
+	    Tcl_CreateHashEntry(conectTablePtr, (char *)&key, &isNew);
+	    if (isNew) {
+		atom1Ptr->numConnections++;
+		atom2Ptr->numConnections++;
+	    }
+	}
+    }
+ done:
+    if (cellStart != NULL) {
+	free(cellStart);
+    }
+    if (cellAtoms != NULL) {
+	free(cellAtoms);
+    }
+    if (atomCell != NULL) {
+	free(atomCell);
+    }
+    if (partners != NULL) {
+	free(partners);
     }
     free(array);
 }
@@ -344,6 +507,27 @@ GetAtomicNumber(Tcl_Interp *interp, PdbAtom *atomPtr, const char *atomName,
     return TCL_ERROR;
 }
 
+/*
+ * Reads the coordinate in the 8-character field starting at column.
+ * The number is parsed in place and must fill the field, apart from
+ * blanks.
+ */
+static int
+GetCoordinate(const char *line, int lineLength, int column, double *valuePtr)
+{
+    const char *field, *fieldEnd, *next;
+
+    field = line + column;
+    fieldEnd = field + 8;
+    if (fieldEnd > line + lineLength) {
+	fieldEnd = line + lineLength;
+    }
+    if (!Rp_ParseDouble(field, fieldEnd, valuePtr, &next)) {
+	return 0;
+    }
+    return (Rp_SkipSpaces(next, fieldEnd) == fieldEnd);
+}
+
 static PdbAtom *
 NewAtom(Tcl_Interp *interp, int ordinal, const char *line, int lineLength)
 {
@@ -352,7 +536,6 @@ NewAtom(Tcl_Interp *interp, int ordinal, const char *line, int lineLength)
     char atomName[6];			/* Atom name.  */
     char symbolName[3];			/* Symbol name.  */
     char residueName[4];		/* Residue name. */
-    double value;
 
     atomPtr = calloc(1, sizeof(PdbAtom));
     if (atomPtr == NULL) {
@@ -364,30 +547,27 @@ NewAtom(Tcl_Interp *interp, int ordinal, const char *line, int lineLength)
     strncpy(residueName, line + 17, 3);
     residueName[3] = '\0';
 
-    strncpy(buf, line + 30, 8);
-    buf[8] = '\0';
-    if (Tcl_GetDouble(interp, buf, &value) != TCL_OK) {
+    if (!GetCoordinate(line, lineLength, 30, &atomPtr->x)) {
+	strncpy(buf, line + 30, 8);
+	buf[8] = '\0';
 	Tcl_AppendResult(interp, "bad x-coordinate \"", buf,
 			 "\"", (char *)NULL);
 	return NULL;
     }
-    atomPtr->x = value;
-    strncpy(buf, line + 38, 8);
-    buf[8] = '\0';
-    if (Tcl_GetDouble(interp, buf, &value) != TCL_OK) {
+    if (!GetCoordinate(line, lineLength, 38, &atomPtr->y)) {
+	strncpy(buf, line + 38, 8);
+	buf[8] = '\0';
 	Tcl_AppendResult(interp, "bad y-coordinate \"", buf,
 			 "\"", (char *)NULL);
 	return NULL;
     }
-    atomPtr->y = value;
-    strncpy(buf, line + 46, 8);
-    buf[8] = '\0';
-    if (Tcl_GetDouble(interp, buf, &value) != TCL_OK) {
+    if (!GetCoordinate(line, lineLength, 46, &atomPtr->z)) {
+	strncpy(buf, line + 46, 8);
+	buf[8] = '\0';
 	Tcl_AppendResult(interp, "bad z-coordinate \"", buf,
 			 "\"", (char *)NULL);
 	return NULL;
     }
-    atomPtr->z = value;
     symbolName[2] = symbolName[1]  = symbolName[0] = '\0';
     if (lineLength >= 77) {
 	symbolName[0] = line[76];
@@ -439,26 +619,6 @@ IsSpaces(const char *string)
     return 1;
 }
 
-static INLINE const char *
-GetLine(const char **stringPtr, const char *endPtr, int *lengthPtr) 
-{
-    const char *line;
-    const char *p;
-
-    line = SkipSpaces(*stringPtr);
-    for (p = line; p < endPtr; p++) {
-	if (*p == '\n') {
-	    *stringPtr = p + 1;
-	    *lengthPtr = p - line;
-	    return line;
-	}
-    }
-    *lengthPtr = (p - line) - 1;
-    *stringPtr = p;
-    return line;
-}
-
-
 static int 
 SerialToAtom(Tcl_Interp *interp, Tcl_HashTable *tablePtr, const char *string,
              PdbAtom **atomPtrPtr)
@@ -553,11 +713,11 @@ PdbToVtkCmd(ClientData clientData, Tcl_Interp *interp, int objc,
 
 	lineLength = 0;			/* Suppress compiler warning. */
 	lineNum++;
-	line = GetLine(&p, pend, &lineLength);
+	line = Rp_GetLine(&p, pend, &lineLength);
         if (line >= pend) {
 	    break;			/* EOF */
 	}
-        if ((line[0] == '#') || (line[0] == '\n')) {
+        if ((lineLength == 0) || (line[0] == '#')) {
 	    continue;			/* Skip blank or comment lines. */
 	}
 	c = line[0];
@@ -16,151 +16,270 @@
 #include <ctype.h>
 #include <math.h>
 #include <limits.h>
-#include <errno.h>
 #include <float.h>
 #include "tcl.h"
+#include "RpNumParse.h"
 
 #define UCHAR(c) ((unsigned char) (c))
 
-static INLINE const char *
-SkipSpaces(const char *s, const char *endPtr) 
+#define FORMAT_LIST	0		/* Tcl list of doubles. */
+#define FORMAT_FLOAT	1		/* Packed 32-bit floats. */
+#define FORMAT_DOUBLE	2		/* Packed 64-bit doubles. */
+
+/*
+ * Where the points are collected.  A list costs a Tcl_Obj for each
+ * coordinate.  The packed formats store the values in a byte array
+ * (4 or 8 bytes per coordinate), which is grown by doubling and
+ * trimmed to size at the end.
+ */
+typedef struct {
+    int format;				/* FORMAT_LIST, FORMAT_FLOAT, or
+					 * FORMAT_DOUBLE. */
+    int bigEndian;			/* If non-zero, packed values are
+					 * stored most significant byte
+					 * first. */
+    Tcl_Obj *objPtr;			/* List or byte array of values. */
+    unsigned char *bytes;		/* Start of the byte array. */
+    size_t numBytes;			/* # of bytes used in the array. */
+    size_t numAlloc;			/* # of bytes allocated. */
+} PointBuffer;
+
+static int
+IsBigEndian(void)
 {
-    while ((s < endPtr) && ((*s == ' ') || (*s == '\t'))) {
-	s++;
-    }
-    return s;
+    union {
+	unsigned int i;
+	unsigned char c[sizeof(unsigned int)];
+    } u;
+
+    u.i = 1;
+    return (u.c[0] == 0);
 }
 
-static INLINE const char *
-GetLine(Tcl_DString *dsPtr, const char *s, const char *endPtr) 
+/*
+ * Stores the nBytes bytes of the value's bit pattern (held in a 32 or
+ * 64-bit unsigned integer) in the buffer's byte order.
+ */
+static INLINE void
+PutBits(unsigned char *bytes, Tcl_WideUInt bits, int nBytes, int bigEndian)
 {
-    const char *line, *p;
-    Tcl_DStringSetLength(dsPtr, 0);
-    line = SkipSpaces(s, endPtr);
-    for (p = line; p < endPtr; p++) {
-	if (*p == '\n') {
-	    if (p == line) {
-		line++;
-		continue;
-	    }
-	    Tcl_DStringAppend(dsPtr, line, p - line);
-	    return p + 1;
+    int i;
+
+    if (bigEndian) {
+	for (i = nBytes - 1; i >= 0; i--) {
+	    bytes[i] = (unsigned char)bits;
+	    bits >>= 8;
+	}
+    } else {
+	for (i = 0; i < nBytes; i++) {
+	    bytes[i] = (unsigned char)bits;
+	    bits >>= 8;
 	}
     }
-    Tcl_DStringAppend(dsPtr, line, p - line);
-    return p;
 }
 
-int
-GetDouble(Tcl_Interp *interp, const char *s, double *valuePtr)
+/*
+ * Adds a value to the point buffer.  Returns TCL_ERROR (with an error
+ * message in the interpreter) if a packed buffer would grow past the
+ * largest byte array Tcl can hold.
+ */
+static int
+AppendValue(Tcl_Interp *interp, PointBuffer *bufPtr, double value)
 {
-    char *end;
-    double d;
-    
-    errno = 0;
-    d = strtod(s, &end); /* INTL: TCL source. */
-    if (end == s) {
-	badDouble:
-        if (interp != (Tcl_Interp *) NULL) {
-            Tcl_AppendResult(interp,
-		"expected floating-point number but got \"", s, "\"", 
-		(char *) NULL);
-        }
-	return TCL_ERROR;
-    }
-    if (errno != 0 && (d == HUGE_VAL || d == -HUGE_VAL || d == 0)) {
-        if (interp != (Tcl_Interp *) NULL) {
-	    char msg[64 + TCL_INTEGER_SPACE];
-	
-	    sprintf(msg, "unknown floating-point error, errno = %d", errno);
-	    Tcl_AppendToObj(Tcl_GetObjResult(interp), msg, -1);
-	    Tcl_SetErrorCode(interp, "ARITH", "UNKNOWN", msg, (char *) NULL);
-        }
-	return TCL_ERROR;
+    size_t size;
+
+    if (bufPtr->format == FORMAT_LIST) {
+	Tcl_ListObjAppendElement(interp, bufPtr->objPtr,
+		Tcl_NewDoubleObj(value));
+	return TCL_OK;
     }
-    while ((*end != 0) && isspace(UCHAR(*end))) { /* INTL: ISO space. */
-	end++;
+    size = (bufPtr->format == FORMAT_FLOAT) ? sizeof(float) : sizeof(double);
+    if (bufPtr->numBytes + size > bufPtr->numAlloc) {
+	if (bufPtr->numBytes + size > INT_MAX) {
+	    Tcl_AppendResult(interp, "too many points: packed values "
+		    "don't fit in a byte array", (char *)NULL);
+	    return TCL_ERROR;
+	}
+	bufPtr->numAlloc = (bufPtr->numAlloc == 0) ? 4096 : 
+	    bufPtr->numAlloc * 2;
+	if (bufPtr->numAlloc > INT_MAX) {
+	    bufPtr->numAlloc = INT_MAX;
+	}
+	bufPtr->bytes = Tcl_SetByteArrayLength(bufPtr->objPtr, 
+		(int)bufPtr->numAlloc);
     }
-    if (*end != 0) {
-	goto badDouble;
+    if (bufPtr->format == FORMAT_FLOAT) {
+	union {
+	    float f;
+	    unsigned int i;
+	} u;
+
+	u.f = (float)value;
+	PutBits(bufPtr->bytes + bufPtr->numBytes, u.i, size, 
+		bufPtr->bigEndian);
+    } else {
+	union {
+	    double d;
+	    Tcl_WideUInt i;
+	} u;
+
+	u.d = value;
+	PutBits(bufPtr->bytes + bufPtr->numBytes, u.i, size, 
+		bufPtr->bigEndian);
     }
-    *valuePtr = d;
+    bufPtr->numBytes += size;
     return TCL_OK;
 }
 
+/*
+ * Parses the numbers on one line into the point buffer.  Each number
+ * must be followed by whitespace or the end of the line.  Returns the
+ * number of values read, or -1 (with an error message in the
+ * interpreter) if something on the line isn't a number.
+ */
+static int
+GetLineValues(Tcl_Interp *interp, const char *line, int lineLength,
+	      PointBuffer *bufPtr)
+{
+    const char *p, *endPtr, *next;
+    int count;
+
+    count = 0;
+    endPtr = line + lineLength;
+    for (p = Rp_SkipSpaces(line, endPtr); p < endPtr; 
+	 p = Rp_SkipSpaces(next, endPtr)) {
+	double d;
+
+	if ((!Rp_ParseDouble(p, endPtr, &d, &next)) ||
+	    ((next < endPtr) && (!isspace(UCHAR(*next))))) {
+	    const char *q;
+
+	    for (q = p; (q < endPtr) && (!isspace(UCHAR(*q))); q++) {
+		/*empty*/
+	    }
+	    Tcl_AppendResult(interp, "expected floating-point number but got \"",
+			     (char *)NULL);
+	    Tcl_AppendToObj(Tcl_GetObjResult(interp), p, q - p);
+	    Tcl_AppendResult(interp, "\"", (char *)NULL);
+	    return -1;
+	}
+	if (AppendValue(interp, bufPtr, d) != TCL_OK) {
+	    return -1;
+	}
+	count++;
+    }
+    return count;
+}
+
 /* 
- *  ReadPoints string dimVar pointsVar
+ *  ReadPoints string dimVar pointsVar ?-format list|float|double? 
+ *	?-byteorder native|bigendian|littleendian?
+ *
+ *  By default pointsVar is set to a list of the coordinates.  With
+ *  -format float or double it's set to a byte array of packed 32 or
+ *  64-bit values instead (in the host's byte order unless -byteorder
+ *  says otherwise), ready for "binary scan" or a binary VTK file.
  */
 static int
 ReadPoints(ClientData clientData, Tcl_Interp *interp, int objc,
 	   Tcl_Obj *const *objv) 
 {
-    Tcl_Obj *listObjPtr;
+    PointBuffer buffer;
     const char *p, *pend;
     const char *string;
-    int count, length, dim;
-    Tcl_DString ds;
+    int length, dim, i;
 
-    if (objc != 4) {
+    if ((objc < 4) || (objc & 1)) {
 	Tcl_AppendResult(interp, "wrong # arguments: should be \"",
-		Tcl_GetString(objv[0]), " string dimVar pointsVar\"", 
+		Tcl_GetString(objv[0]), " string dimVar pointsVar"
+		" ?-format list|float|double?"
+		" ?-byteorder native|bigendian|littleendian?\"",
 		(char *)NULL);
 	return TCL_ERROR;
     }
+    memset(&buffer, 0, sizeof(buffer));
+    buffer.format = FORMAT_LIST;
+    buffer.bigEndian = IsBigEndian();
+    for (i = 4; i < objc; i += 2) {
+	const char *opt, *value;
+
+	opt = Tcl_GetString(objv[i]);
+	value = Tcl_GetString(objv[i+1]);
+	if (strcmp(opt, "-format") == 0) {
+	    if (strcmp(value, "list") == 0) {
+		buffer.format = FORMAT_LIST;
+	    } else if (strcmp(value, "float") == 0) {
+		buffer.format = FORMAT_FLOAT;
+	    } else if (strcmp(value, "double") == 0) {
+		buffer.format = FORMAT_DOUBLE;
+	    } else {
+		Tcl_AppendResult(interp, "bad value \"", value,
+			"\" for -format switch: should be list, float, "
+			"or double", (char *)NULL);
+		return TCL_ERROR;
+	    }
+	} else if (strcmp(opt, "-byteorder") == 0) {
+	    if (strcmp(value, "native") == 0) {
+		buffer.bigEndian = IsBigEndian();
+	    } else if (strcmp(value, "bigendian") == 0) {
+		buffer.bigEndian = 1;
+	    } else if (strcmp(value, "littleendian") == 0) {
+		buffer.bigEndian = 0;
+	    } else {
+		Tcl_AppendResult(interp, "bad value \"", value,
+			"\" for -byteorder switch: should be native, "
+			"bigendian, or littleendian", (char *)NULL);
+		return TCL_ERROR;
+	    }
+	} else {
+	    Tcl_AppendResult(interp, "unknown switch \"", opt,
+		    "\": should be -format or -byteorder", (char *)NULL);
+	    return TCL_ERROR;
+	}
+    }
+    if (buffer.format == FORMAT_LIST) {
+	buffer.objPtr = Tcl_NewListObj(0, (Tcl_Obj **)NULL);
+    } else {
+	buffer.objPtr = Tcl_NewByteArrayObj(NULL, 0);
+    }
+    Tcl_IncrRefCount(buffer.objPtr);
     dim = 0;
     string = Tcl_GetStringFromObj(objv[1], &length);
-    count = 0;
-    Tcl_DStringInit(&ds);
-    listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **)NULL);
     for (p = string, pend = p + length; p < pend; /*empty*/) {
-	int i, argc;
-	const char **argv;
-	int result;
+	const char *line;
+	int lineLength, n;
 
-	p = GetLine(&ds, p, pend);
-	if (Tcl_DStringLength(&ds) == 0) {
+	line = Rp_GetLine(&p, pend, &lineLength);
+	if (lineLength == 0) {
 	    break;			/* EOF */
 	}
-	result = Tcl_SplitList(interp, Tcl_DStringValue(&ds), &argc, &argv);
-	if (result != TCL_OK) {
-	    goto error;
-	}
-	if (argc == 0) {
-	    Tcl_Free((char *)argv);
+	n = GetLineValues(interp, line, lineLength, &buffer);
+	if (n < 0) {
 	    goto error;
 	}
 	if (dim == 0) {
-	    dim = argc;
+	    dim = n;
 	}
-	if (dim != argc) {
+	if (dim != n) {
 	    Tcl_AppendResult(interp, "wrong # of elements on line", (char *)NULL);
-	    Tcl_Free((char *)argv);
 	    goto error;
 	}
-	for (i = 0; i < argc; i++) {
-	    double d;
-
-	    if (GetDouble(interp, argv[i], &d) != TCL_OK) {
-		Tcl_Free((char *)argv);
-		goto error;
-	    }
-	    Tcl_ListObjAppendElement(interp, listObjPtr, Tcl_NewDoubleObj(d));
-	    count++;
-	}
-	Tcl_Free((char *)argv);
     }
-    Tcl_DStringFree(&ds);
+    if (buffer.format != FORMAT_LIST) {
+	Tcl_SetByteArrayLength(buffer.objPtr, (int)buffer.numBytes);
+    }
     if (Tcl_ObjSetVar2(interp, objv[2], NULL, Tcl_NewIntObj(dim),
 		      TCL_LEAVE_ERR_MSG) == NULL) {
-	return TCL_ERROR;
+	goto error;
     }
-    if (Tcl_ObjSetVar2(interp, objv[3], NULL, listObjPtr, 
+    if (Tcl_ObjSetVar2(interp, objv[3], NULL, buffer.objPtr, 
 		      TCL_LEAVE_ERR_MSG) == NULL) {
-	return TCL_ERROR;
+	goto error;
     }
+    Tcl_DecrRefCount(buffer.objPtr);
     return TCL_OK;
  error:
-    Tcl_DStringFree(&ds);
+    Tcl_DecrRefCount(buffer.objPtr);
     return TCL_ERROR;
 }
 
@@ -218,6 +218,7 @@ itcl::class Rappture::LibraryObj {
     public method parent {args}
     public method children {args}
     public method get {args}
+    public method attribute {path name}
     public method put {args}
     public method copy {path from args}
     public method remove {{path ""}}
@@ -532,6 +533,24 @@ itcl::body Rappture::LibraryObj::get {args} {
     return $string
 }
 
+# ----------------------------------------------------------------------
+# USAGE: attribute <path> <name>
+#
+# Clients use this to query an attribute of the element specified by
+# the path, such as the "encoding" of an <xy> element holding binary
+# data.  Returns "" if the element or the attribute doesn't exist.
+# ----------------------------------------------------------------------
+itcl::body Rappture::LibraryObj::attribute {path name} {
+    set node [find $path]
+    if {$node == ""} {
+        return ""
+    }
+    if {[catch {$node getAttribute $name} value]} {
+        return ""
+    }
+    return $value
+}
+
 # ----------------------------------------------------------------------
 # USAGE: put ?-append yes? ?-id num? ?-type string|file? ?-compress no? ?<path>? <string>
 #
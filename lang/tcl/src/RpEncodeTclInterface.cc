@@ -225,22 +225,70 @@ EncodeCmd(ClientData clientData, Tcl_Interp *interp, int objc,
  * If binary data is provided, the data is base64 decoded and uncompressed.
  * RpTclEncodingIs is used to qualify binary data.
  *
+ * With "-as zb64-f64le", the string holds packed doubles (see
+ * RPENC_DOUBLES) and the result is a list of the values.
+ *
  * Full function call:
- * ::Rappture::encoding::decode ?-as z|b64|zb64? <string>
+ * ::Rappture::encoding::decode ?-as z|b64|zb64|zb64-f64le? <string>
  *
  *        I'd rather the interface be
  *        
  *                decode -b64 -z string 
  */
 
+/*
+ * Not an RPENC flag: set by "-as zb64-f64le" to return the decoded
+ * data as a list of doubles (see RPENC_DOUBLES).
+ */
+#define DECODE_DOUBLES  (1<<8)
+
+/*
+ *---------------------------------------------------------------------------
+ *
+ * DecodeAsSwitch --
+ *
+ *        Like AsSwitch, but also accepts RPENC_DOUBLES for packed
+ *        doubles.
+ *
+ * Results:
+ *        The return value is a standard Tcl result.
+ *
+ *---------------------------------------------------------------------------
+ */
+/*ARGSUSED*/
+static int
+DecodeAsSwitch(
+    ClientData clientData,        /* Not used. */
+    Tcl_Interp *interp,                /* Interpreter to send results back to */
+    const char *switchName,        /* Not used. */
+    Tcl_Obj *objPtr,                /* String representation */
+    char *record,                /* Structure record */
+    int offset,                        /* Offset to field in structure */
+    int flags)                        /* Not used. */
+{
+    int *flagsPtr = (int *)(record + offset);
+
+    if (strcmp(Tcl_GetString(objPtr), RPENC_DOUBLES) == 0) {
+        *flagsPtr = RPENC_Z | RPENC_B64 | DECODE_DOUBLES;
+        return TCL_OK;
+    }
+    return AsSwitch(clientData, interp, switchName, objPtr, record, offset,
+                    flags);
+}
+
+static SwitchParseProc DecodeAsSwitch;
+static SwitchCustom decodeAsSwitch = {
+    DecodeAsSwitch, NULL, 0,
+};
+
 typedef struct {
     unsigned int flags;
 } DecodeSwitches;
 
 static SwitchSpec decodeSwitches[] = 
 {
-    {SWITCH_CUSTOM, "-as", "z|b64|zb64",
-        offsetof(DecodeSwitches, flags), 0, 0, &asSwitch},
+    {SWITCH_CUSTOM, "-as", "z|b64|zb64|" RPENC_DOUBLES,
+        offsetof(DecodeSwitches, flags), 0, 0, &decodeAsSwitch},
     {SWITCH_BITMASK, "-noheader", "", 
         offsetof(DecodeSwitches, flags), 0, RPENC_RAW},
     {SWITCH_END}
@@ -285,6 +333,24 @@ DecodeCmd(ClientData clientData, Tcl_Interp *interp, int objc,
     }
     Rappture::Buffer buf(string, numBytes); 
     Rappture::Outcome status;
+    if (switches.flags & DECODE_DOUBLES) {
+        if (!Rappture::encoding::decodeDoubles(status, buf)) {
+            Tcl_AppendResult(interp, status.remark(), "\n", status.context(),
+                NULL);
+            return TCL_ERROR;
+        }
+        Tcl_Obj *listObjPtr = Tcl_NewListObj(0, (Tcl_Obj **)NULL);
+        const char *p = buf.bytes();
+        for (size_t i = 0; i + sizeof(double) <= buf.size();
+             i += sizeof(double)) {
+            double value;
+            memcpy(&value, p + i, sizeof(double));
+            Tcl_ListObjAppendElement(interp, listObjPtr,
+                Tcl_NewDoubleObj(value));
+        }
+        Tcl_SetObjResult(interp, listObjPtr);
+        return TCL_OK;
+    }
     if (!Rappture::encoding::decode(status, buf, switches.flags)) {
         Tcl_AppendResult(interp, status.remark(), "\n", status.context(), NULL);
         return TCL_ERROR;
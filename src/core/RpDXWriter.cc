@@ -17,7 +17,9 @@
 #include <cstdlib>
 #include <cfloat>
 #include <RpDXWriter.h>
+#include <RpNumFormat.h>
 #include <assert.h>
+#include <zlib.h>
 using namespace Rappture;
 
 DXWriter::DXWriter() :
@@ -27,7 +29,13 @@ DXWriter::DXWriter() :
     _shape(0),
     _positions(NULL),
     _delta(NULL),
-    _origin(NULL)
+    _origin(NULL),
+    _format(DX_ASCII),
+    _stream(NULL),
+    _gzStream(NULL),
+    _ownStream(false),
+    _nStreamItems(0),
+    _nStreamed(0)
 {
     _delta  = (double*) malloc(_rank*_rank*sizeof(double));
     if (_delta == NULL) {
@@ -67,7 +75,13 @@ DXWriter::DXWriter(double* data, size_t nmemb, size_t rank, size_t shape) :
     _shape(shape),
     _positions(NULL),
     _delta(NULL),
-    _origin(NULL)
+    _origin(NULL),
+    _format(DX_ASCII),
+    _stream(NULL),
+    _gzStream(NULL),
+    _ownStream(false),
+    _nStreamItems(0),
+    _nStreamed(0)
 {
     _delta  = (double*) malloc(_rank*_rank*sizeof(double));
     if (_delta == NULL) {
@@ -101,6 +115,10 @@ DXWriter::DXWriter(double* data, size_t nmemb, size_t rank, size_t shape) :
 
 DXWriter::~DXWriter()
 {
+    if (isStreaming()) {
+        close();
+    }
+
     if (_positions) {
         free(_positions);
     }
@@ -190,14 +208,17 @@ DXWriter::counts(size_t *p)
 DXWriter&
 DXWriter::append(double* value)
 {
-    _dataBuf.append(value,1);
-    return *this;
+    return data(value,1);
 }
 
 DXWriter&
 DXWriter::data(double *d, size_t nmemb)
 {
-    _dataBuf.append(d,nmemb);
+    if (isStreaming()) {
+        _streamData(d,nmemb);
+    } else {
+        _dataBuf.append(d,nmemb);
+    }
     return *this;
 }
 
@@ -215,8 +236,12 @@ DXWriter::write(FILE *f)
         fprintf(stderr,"FILE is NULL, cannot write to NULL file inside DXWriter::write\n");
         return *this;
     }
+    if (isStreaming()) {
+        fprintf(stderr,"DXWriter::write called while streaming, use DXWriter::close\n");
+        return *this;
+    }
     SimpleCharBuffer dxfile;
-    _writeDxToBuffer(dxfile);
+    _writeToBuffer(dxfile);
     ssize_t nWritten;
     nWritten = fwrite(dxfile.bytes(), 1, dxfile.size(), f);
     assert(nWritten == (ssize_t)dxfile.size());
@@ -246,7 +271,7 @@ DXWriter::write(char *str)
     SimpleCharBuffer dxfile;
     int sz;
 
-    _writeDxToBuffer(dxfile);
+    _writeToBuffer(dxfile);
     sz = dxfile.size();
     str = new char[sz+1];
     memcpy(str, dxfile.bytes(), sz);
@@ -254,24 +279,64 @@ DXWriter::write(char *str)
     return *this;
 }
 
+DXWriter&
+DXWriter::_writeToBuffer(SimpleCharBuffer &outfile)
+{
+    if (_format == VTK_BINARY) {
+        return _writeVtkToBuffer(outfile);
+    }
+    return _writeDxToBuffer(outfile);
+}
+
+/*
+ * Data values are written as floats.  nanovis and many other progs
+ * fail when you send them inf data, so non-finite values become zero.
+ */
+static inline float
+_dxValue(double d)
+{
+    return (std::isfinite(d)) ? (float)d : 0.0f;
+}
+
+static bool
+_isBigEndian()
+{
+    union {
+        unsigned int i;
+        unsigned char c[sizeof(unsigned int)];
+    } u;
+    u.i = 1;
+    return (u.c[0] == 0);
+}
+
 /*
- *  even though dxfile.append() is more expensive,
- *  we don't only use sprintf inside the for loops because
- *  we don't know how many loop iterations there will be
- *  and our static buffer is a constant number of chars.
+ *  the header is formatted with sprintf into a small static buffer,
+ *  the data section, which is where all of the time goes, is sized
+ *  up front and formatted directly into the output buffer.
  */
 
 DXWriter&
 DXWriter::_writeDxToBuffer(SimpleCharBuffer &dxfile)
 {
-    char b[80];
-    double f = 0.0;
+    size_t nValues = _dataBuf.nmemb();
 
     // expand our original buffer to 512 characters
     // because we know there are at least
     // 400 characters in even our smallest dx file.
     dxfile.set(512);
 
+    _writeDxHeader(dxfile, nValues);
+    _writeDxData(dxfile, _dataBuf.bytes(), nValues);
+    _writeDxTrailer(dxfile);
+
+    return *this;
+}
+
+DXWriter&
+DXWriter::_writeDxHeader(SimpleCharBuffer &dxfile, size_t nValues)
+{
+    char b[80];
+
     dxfile.append("<ODX>object 1 class gridpositions counts",40);
     for (size_t i=0; i < _rank; i++) {
         sprintf(b, " %10lu", (unsigned long)_positions[i]);
@@ -301,25 +366,53 @@ DXWriter::_writeDxToBuffer(SimpleCharBuffer &dxfile)
     dxfile.append("\nattribute \"element type\" string \"cubes\"\n",41);
     dxfile.append("attribute \"ref\" string \"positions\"\n",35);
 
-    sprintf(b,"object 3 class array type float rank 0 items %lu data follows\n",
-        (unsigned long)_dataBuf.nmemb());
+    if (_format == DX_BINARY) {
+        sprintf(b,"object 3 class array type float rank 0 items %lu "
+            "%s ieee data follows\n", (unsigned long)nValues,
+            (_isBigEndian()) ? "msb" : "lsb");
+    } else {
+        sprintf(b,"object 3 class array type float rank 0 items %lu "
+            "data follows\n", (unsigned long)nValues);
+    }
     dxfile.append(b);
 
-    _dataBuf.seek(0,SEEK_SET);
-    while (!_dataBuf.eof()) {
-        _dataBuf.read(&f,1);
-        // nanovis and many other progs fail when you send it inf data
-        if (!std::isfinite(f)) {
-            f = 0.0;
+    return *this;
+}
+
+DXWriter&
+DXWriter::_writeDxData(SimpleCharBuffer &dxfile, const double *values,
+                       size_t nValues)
+{
+    if (_format == DX_BINARY) {
+        dxfile.extend(nValues*sizeof(float));
+        for (size_t i=0; i < nValues; i++) {
+            float f = _dxValue(values[i]);
+            dxfile.append((const char *)&f, sizeof(float));
+        }
+    } else {
+        char b[80];
+
+        // each line is "    %10g\n", at most 4+RPNUMFMT_MAXLEN+1 chars,
+        // and usually exactly 15 of them.
+        dxfile.extend(nValues*15);
+        for (size_t i=0; i < nValues; i++) {
+            size_t len;
+
+            memcpy(b, "    ", 4);
+            len = 4 + numformat::formatG(b+4, _dxValue(values[i]), 10, 6);
+            b[len++] = '\n';
+            dxfile.append(b,len);
         }
-        sprintf(b,"    %10g\n",f);
-        // we do not know the length of the string
-        // only that it has 10 sigdigs, so we cannot tell
-        // append the size of the data
-        // dxfile.append(b,15);
-        dxfile.append(b);
     }
+    return *this;
+}
 
+DXWriter&
+DXWriter::_writeDxTrailer(SimpleCharBuffer &dxfile)
+{
+    if (_format == DX_BINARY) {
+        dxfile.append("\n",1);
+    }
     dxfile.append("attribute \"dep\" string \"positions\"\n",35);
     dxfile.append("object \"density\" class field\n",29);
     dxfile.append("component \"positions\" value 1\n",30);
@@ -329,6 +422,77 @@ DXWriter::_writeDxToBuffer(SimpleCharBuffer &dxfile)
     return *this;
 }
 
+/*
+ *  legacy vtk structured points.  vtk orders the samples with the
+ *  first axis varying fastest, dx with the last axis varying fastest,
+ *  so the data is transposed on the way out.  The spacing is taken from
+ *  the diagonal of the delta matrix; vtk can't represent rotated grids.
+ */
+
+DXWriter&
+DXWriter::_writeVtkToBuffer(SimpleCharBuffer &vtkfile)
+{
+    char b[256];
+    size_t n[3] = { 1, 1, 1 };
+    double o[3] = { 0.0, 0.0, 0.0 };
+    double d[3] = { 1.0, 1.0, 1.0 };
+    const double *values = _dataBuf.bytes();
+    size_t nValues = _dataBuf.nmemb();
+
+    for (size_t i=0; (i < _rank) && (i < 3); i++) {
+        n[i] = _positions[i];
+        o[i] = _origin[i];
+        d[i] = _delta[(_rank*i)+i];
+    }
+    size_t nPoints = n[0] * n[1] * n[2];
+    if (nPoints != nValues) {
+        fprintf(stderr,"DXWriter: %lu data values don't match the %lu grid"
+            " points of the vtk file\n", (unsigned long)nValues,
+            (unsigned long)nPoints);
+        return *this;
+    }
+
+    vtkfile.set(512 + nPoints*sizeof(float));
+
+    vtkfile.append("# vtk DataFile Version 3.0\n");
+    vtkfile.append("Rappture DXWriter\n");
+    vtkfile.append("BINARY\n");
+    vtkfile.append("DATASET STRUCTURED_POINTS\n");
+    sprintf(b, "DIMENSIONS %lu %lu %lu\n", (unsigned long)n[0],
+        (unsigned long)n[1], (unsigned long)n[2]);
+    vtkfile.append(b);
+    sprintf(b, "ORIGIN %.17g %.17g %.17g\n", o[0], o[1], o[2]);
+    vtkfile.append(b);
+    sprintf(b, "SPACING %.17g %.17g %.17g\n", d[0], d[1], d[2]);
+    vtkfile.append(b);
+    sprintf(b, "POINT_DATA %lu\n", (unsigned long)nPoints);
+    vtkfile.append(b);
+    vtkfile.append("SCALARS data float 1\n");
+    vtkfile.append("LOOKUP_TABLE default\n");
+
+    bool swap = !_isBigEndian();
+    for (size_t k=0; k < n[2]; k++) {
+        for (size_t j=0; j < n[1]; j++) {
+            for (size_t i=0; i < n[0]; i++) {
+                union {
+                    float f;
+                    unsigned char c[sizeof(float)];
+                } u;
+                u.f = _dxValue(values[(i*n[1] + j)*n[2] + k]);
+                if (swap) {
+                    unsigned char c;
+                    c = u.c[0], u.c[0] = u.c[3], u.c[3] = c;
+                    c = u.c[1], u.c[1] = u.c[2], u.c[2] = c;
+                }
+                vtkfile.append((const char *)u.c, sizeof(float));
+            }
+        }
+    }
+    vtkfile.append("\n",1);
+
+    return *this;
+}
+
 size_t
 DXWriter::size() const
 {
@@ -354,3 +518,189 @@ DXWriter::shape(size_t shape)
 
     return _shape;
 }
+
+DXWriter::Format
+DXWriter::format() const
+{
+    return _format;
+}
+
+DXWriter&
+DXWriter::format(Format format)
+{
+    _format = format;
+    return *this;
+}
+
+/*
+ *  streaming mode.  open() writes the header, whose item count comes
+ *  from counts(), each call to data() or append() formats its values
+ *  and writes them straight through, and close() writes the trailer.
+ *  Only one slab of formatted values is held in memory at a time.
+ *  Values given to data() before open() are written right after the
+ *  header.
+ */
+
+DXWriter&
+DXWriter::open(FILE *stream)
+{
+    if (stream == NULL) {
+        fprintf(stderr,"FILE is NULL, cannot stream to NULL file inside DXWriter::open\n");
+        return *this;
+    }
+    if (!_beginStream()) {
+        return *this;
+    }
+    _stream = stream;
+    _ownStream = false;
+    return _streamHeader();
+}
+
+DXWriter&
+DXWriter::open(const char *fname, bool compress)
+{
+    if (fname == NULL) {
+        fprintf(stderr,"filename is NULL, cannot stream to NULL file inside DXWriter::open\n");
+        return *this;
+    }
+    if (!_beginStream()) {
+        return *this;
+    }
+    if (compress) {
+        gzFile gz = gzopen(fname, "wb");
+        if (gz == NULL) {
+            fprintf(stderr,"can't open \"%s\" inside DXWriter::open\n", fname);
+            return *this;
+        }
+        _gzStream = (void *)gz;
+    } else {
+        _stream = fopen(fname, "wb");
+        if (_stream == NULL) {
+            fprintf(stderr,"can't open \"%s\" inside DXWriter::open\n", fname);
+            return *this;
+        }
+    }
+    _ownStream = true;
+    return _streamHeader();
+}
+
+DXWriter&
+DXWriter::close()
+{
+    if (!isStreaming()) {
+        return *this;
+    }
+    if (_nStreamed != _nStreamItems) {
+        fprintf(stderr,"DXWriter::close: streamed %lu of %lu data values\n",
+            (unsigned long)_nStreamed, (unsigned long)_nStreamItems);
+    }
+
+    SimpleCharBuffer trailer;
+    _writeDxTrailer(trailer);
+    _streamWrite(trailer);
+
+    if (_gzStream != NULL) {
+        gzclose((gzFile)_gzStream);
+    } else if (_ownStream) {
+        fclose(_stream);
+    } else {
+        fflush(_stream);
+    }
+    _stream = NULL;
+    _gzStream = NULL;
+    _ownStream = false;
+    return *this;
+}
+
+bool
+DXWriter::isStreaming() const
+{
+    return ((_stream != NULL) || (_gzStream != NULL));
+}
+
+bool
+DXWriter::_beginStream()
+{
+    if (isStreaming()) {
+        fprintf(stderr,"DXWriter::open: already streaming\n");
+        return false;
+    }
+    if (_format == VTK_BINARY) {
+        // vtk wants the first axis varying fastest, which would mean
+        // holding the whole field to transpose it.
+        fprintf(stderr,"DXWriter::open: vtk files can't be streamed\n");
+        return false;
+    }
+    if (_positions == NULL) {
+        fprintf(stderr,"DXWriter::open: counts must be set before streaming\n");
+        return false;
+    }
+    _nStreamItems = 1;
+    for (size_t i=0; i < _rank; i++) {
+        _nStreamItems *= _positions[i];
+    }
+    _nStreamed = 0;
+    return true;
+}
+
+DXWriter&
+DXWriter::_streamHeader()
+{
+    SimpleCharBuffer header;
+    _writeDxHeader(header, _nStreamItems);
+    _streamWrite(header);
+    if (_dataBuf.nmemb() > 0) {
+        _streamData(_dataBuf.bytes(), _dataBuf.nmemb());
+        _dataBuf.clear();
+    }
+    return *this;
+}
+
+/*
+ *  values are formatted in slabs of a fixed number of items so the
+ *  memory used doesn't grow with the size of a single data() call.
+ */
+
+DXWriter&
+DXWriter::_streamData(const double *values, size_t nValues)
+{
+    const size_t slab = 4096;
+    SimpleCharBuffer chunk;
+
+    if (_nStreamed + nValues > _nStreamItems) {
+        fprintf(stderr,"DXWriter::data: more data values than counts allow,"
+            " extra values dropped\n");
+        nValues = _nStreamItems - _nStreamed;
+    }
+    while (nValues > 0) {
+        size_t n = (nValues < slab) ? nValues : slab;
+
+        chunk.count(0);
+        _writeDxData(chunk, values, n);
+        _streamWrite(chunk);
+        values += n;
+        nValues -= n;
+        _nStreamed += n;
+    }
+    return *this;
+}
+
+DXWriter&
+DXWriter::_streamWrite(const SimpleCharBuffer &buf)
+{
+    size_t nWritten;
+
+    if (buf.size() == 0) {
+        return *this;
+    }
+    if (_gzStream != NULL) {
+        nWritten = gzwrite((gzFile)_gzStream, buf.bytes(), buf.size());
+    } else {
+        nWritten = fwrite(buf.bytes(), 1, buf.size(), _stream);
+    }
+    if (nWritten != buf.size()) {
+        fprintf(stderr,"DXWriter: short write, %lu of %lu bytes\n",
+            (unsigned long)nWritten, (unsigned long)buf.size());
+    }
+    return *this;
+}
@@ -23,6 +23,18 @@ namespace Rappture {
 
 class DXWriter {
 public:
+    /*
+     * Layout of the text produced by write().  The numeric values are
+     * part of the Fortran interface (rp_dxwriter_format) and must not
+     * change.
+     */
+    enum Format {
+        DX_ASCII = 0,           // dx file, data as ascii text (default)
+        DX_BINARY = 1,          // dx file, data as native ieee floats
+        VTK_BINARY = 2          // legacy vtk structured points,
+                                // data as big-endian ieee floats
+    };
+
     DXWriter();
     DXWriter(double* data, size_t nmemb, size_t rank, size_t shape);
     DXWriter(const DXWriter& rpdx);
@@ -40,10 +52,17 @@ public:
     virtual DXWriter& write(FILE *stream);
     virtual DXWriter& write(const char* fname);
     virtual DXWriter& write(char *str);
+
+    virtual DXWriter& open(FILE *stream);
+    virtual DXWriter& open(const char *fname, bool compress=false);
+    virtual DXWriter& close();
+    virtual bool isStreaming() const;
     virtual size_t size() const;
 
     virtual size_t rank(size_t rank=0);
     virtual size_t shape(size_t shape=0);
+    virtual Format format() const;
+    virtual DXWriter& format(Format format);
 protected:
 
 private:
@@ -58,7 +77,26 @@ private:
     double* _delta;        // array holding deltas of the uniform mesh
     double* _origin;       // array holding coord of origin
 
+    Format _format;        // layout of the file produced by write()
+
+    FILE* _stream;         // stream data() is written to, or NULL
+    void* _gzStream;       // gzFile data() is written to, or NULL
+    bool _ownStream;       // close() closes the stream
+    size_t _nStreamItems;  // number of values announced in the header
+    size_t _nStreamed;     // number of values written so far
+
+    DXWriter& _writeToBuffer(SimpleCharBuffer &outfile);
     DXWriter& _writeDxToBuffer(SimpleCharBuffer &dxfile);
+    DXWriter& _writeDxHeader(SimpleCharBuffer &dxfile, size_t nValues);
+    DXWriter& _writeDxData(SimpleCharBuffer &dxfile, const double *values,
+                           size_t nValues);
+    DXWriter& _writeDxTrailer(SimpleCharBuffer &dxfile);
+    DXWriter& _writeVtkToBuffer(SimpleCharBuffer &vtkfile);
+
+    bool _beginStream();
+    DXWriter& _streamHeader();
+    DXWriter& _streamData(const double *values, size_t nValues);
+    DXWriter& _streamWrite(const SimpleCharBuffer &buf);
 };
 
 } // namespace Rappture
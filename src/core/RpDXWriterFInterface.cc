@@ -283,3 +283,92 @@ int rp_dxwriter_shape(int* handle,    /* integer handle of dxwriter */
 
     return retVal;
 }
+
+/**********************************************************************/
+// FUNCTION: rp_dxwriter_format()
+/// change the layout of the file written by rp_dxwriter_write()
+/**
+ * 0 writes a dx file with ascii data (the default), 1 a dx file with
+ * binary ieee float data, 2 a legacy binary vtk structured points file.
+ */
+int rp_dxwriter_format(int* handle,    /* integer handle of dxwriter */
+                        int* format     /* format of the written file */
+                        )
+{
+    size_t retVal = RP_ERROR;
+    Rappture::DXWriter* dxwriter = NULL;
+
+    if ((handle) && (*handle != 0) && (format)) {
+        dxwriter = (Rappture::DXWriter*) getObject_Void(*handle);
+        if (dxwriter) {
+            switch (*format) {
+            case Rappture::DXWriter::DX_ASCII:
+            case Rappture::DXWriter::DX_BINARY:
+            case Rappture::DXWriter::VTK_BINARY:
+                dxwriter->format((Rappture::DXWriter::Format)*format);
+                retVal = RP_OK;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    return retVal;
+}
+
+/**********************************************************************/
+// FUNCTION: rp_dxwriter_open()
+/// start streaming the dx file to disk.
+/**
+ * The header is written immediately, so the rank, origin, delta and
+ * counts must already be set.  Values passed to rp_dxwriter_data() and
+ * rp_dxwriter_append() afterwards go straight to the file, which is
+ * gzip compressed if compress is non-zero.  Finish with
+ * rp_dxwriter_close().
+ */
+int rp_dxwriter_open(int* handle,     /* integer handle of dxwriter */
+                        char *fname,     /* filename to stream dx file to */
+                        int *compress,   /* non-zero to gzip the file */
+                        int str_len      /* length of fname */
+                        )
+{
+    size_t retVal = RP_ERROR;
+    Rappture::DXWriter* dxwriter = NULL;
+    std::string inFname = "";
+
+    if ((handle) && (*handle != 0)) {
+        dxwriter = (Rappture::DXWriter*) getObject_Void(*handle);
+        if (dxwriter) {
+            inFname = null_terminate_str(fname,str_len);
+            dxwriter->open(inFname.c_str(), (compress) && (*compress != 0));
+            if (dxwriter->isStreaming()) {
+                retVal = RP_OK;
+            }
+        }
+    }
+
+    return retVal;
+}
+
+/**********************************************************************/
+// FUNCTION: rp_dxwriter_close()
+/// finish a dx file started with rp_dxwriter_open().
+/**
+ */
+int rp_dxwriter_close(int* handle     /* integer handle of dxwriter */
+                        )
+{
+    size_t retVal = RP_ERROR;
+    Rappture::DXWriter* dxwriter = NULL;
+
+    if ((handle) && (*handle != 0)) {
+        dxwriter = (Rappture::DXWriter*) getObject_Void(*handle);
+        if (dxwriter) {
+            dxwriter->close();
+            retVal = RP_OK;
+        }
+    }
+
+    return retVal;
+}
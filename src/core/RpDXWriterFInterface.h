@@ -43,6 +43,12 @@ int rp_dxwriter_rank(int *handle, size_t *rank);
 
 int rp_dxwriter_shape(int *handle, size_t *shape);
 
+int rp_dxwriter_format(int *handle, int *format);
+
+int rp_dxwriter_open(int *handle, char *fname, int *compress, int str_len);
+
+int rp_dxwriter_close(int *handle);
+
 /**********************************************************/
 
 #ifdef __cplusplus
@@ -159,6 +159,45 @@ int RP_DXWRITER_SHAPE(int *handle, size_t *shape) {
 }
 
 
+int rp_dxwriter_format_(int *handle, int *format) {
+    return rp_dxwriter_format(handle,format);
+}
+
+int rp_dxwriter_format__(int *handle, int *format) {
+    return rp_dxwriter_format(handle,format);
+}
+
+int RP_DXWRITER_FORMAT(int *handle, int *format) {
+    return rp_dxwriter_format(handle,format);
+}
+
+
+int rp_dxwriter_open_(int *handle, char *fname, int *compress, int str_len) {
+    return rp_dxwriter_open(handle,fname,compress,str_len);
+}
+
+int rp_dxwriter_open__(int *handle, char *fname, int *compress, int str_len) {
+    return rp_dxwriter_open(handle,fname,compress,str_len);
+}
+
+int RP_DXWRITER_OPEN(int *handle, char *fname, int *compress, int str_len) {
+    return rp_dxwriter_open(handle,fname,compress,str_len);
+}
+
+
+int rp_dxwriter_close_(int *handle) {
+    return rp_dxwriter_close(handle);
+}
+
+int rp_dxwriter_close__(int *handle) {
+    return rp_dxwriter_close(handle);
+}
+
+int RP_DXWRITER_CLOSE(int *handle) {
+    return rp_dxwriter_close(handle);
+}
+
+
 /**********************************************************/
 
 #ifdef __cplusplus
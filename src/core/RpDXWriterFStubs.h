@@ -59,6 +59,18 @@ int rp_dxwriter_shape_(int *handle, size_t *shape);
 int rp_dxwriter_shape__(int *handle, size_t *shape);
 int RP_DXWRITER_SHAPE(int *handle, size_t *shape);
 
+int rp_dxwriter_format_(int *handle, int *format);
+int rp_dxwriter_format__(int *handle, int *format);
+int RP_DXWRITER_FORMAT(int *handle, int *format);
+
+int rp_dxwriter_open_(int *handle, char *fname, int *compress, int str_len);
+int rp_dxwriter_open__(int *handle, char *fname, int *compress, int str_len);
+int RP_DXWRITER_OPEN(int *handle, char *fname, int *compress, int str_len);
+
+int rp_dxwriter_close_(int *handle);
+int rp_dxwriter_close__(int *handle);
+int RP_DXWRITER_CLOSE(int *handle);
+
 /**********************************************************/
 
 #ifdef __cplusplus
@@ -12,6 +12,7 @@
  *  redistribution of this file, and for a DISCLAIMER OF ALL WARRANTIES.
  * ======================================================================
  */
+#include "config.h"
 #include "RpEncode.h"
 #include <cstring>
 
@@ -421,3 +422,94 @@ Rappture::encoding::decode(Rappture::Outcome &status, Rappture::Buffer& buf,
     return true;
 }
 
+#ifdef WORDS_BIGENDIAN
+/*
+ * Reverses the bytes of a double in place, so the stored values are
+ * always little endian.  Only needed on big-endian hosts.
+ */
+static inline void
+_swapDouble(char *p)
+{
+    for (size_t i = 0; i < sizeof(double)/2; i++) {
+        char c = p[i];
+        p[i] = p[sizeof(double)-1-i];
+        p[sizeof(double)-1-i] = c;
+    }
+}
+#endif
+
+/**********************************************************************/
+// FUNCTION: Rappture::encoding::encodeDoubles()
+/// Store columns of doubles in buf as RPENC_DOUBLES encoded text.
+/**
+ * Row i holds columns[0][i], columns[1][i], ... as 8-byte little-endian
+ * values.  The rows are compressed and base64 encoded with a header,
+ * so the text can be decoded by decode() or by anything that reads
+ * Rappture encoded data.  The values read back exactly, and a large
+ * curve is much smaller than the same numbers written as text.
+ *
+ * Full function call:
+ * Rappture::encoding::encodeDoubles(status,buf,columns,ncols,nrows)
+ */
+
+bool
+Rappture::encoding::encodeDoubles(Rappture::Outcome &status,
+                                  Rappture::Buffer& buf,
+                                  const double *const *columns,
+                                  size_t ncols, size_t nrows)
+{
+    size_t nbytes = ncols * nrows * sizeof(double);
+
+    buf.clear();
+    if (nbytes == 0) {
+        return true;                // Nothing to encode.
+    }
+    if (buf.extend(nbytes) < nbytes) {
+        status.addError("can't allocate %lu bytes", (unsigned long)nbytes);
+        return false;
+    }
+    for (size_t row = 0; row < nrows; row++) {
+        for (size_t col = 0; col < ncols; col++) {
+            char bytes[sizeof(double)];
+
+            memcpy(bytes, columns[col] + row, sizeof(double));
+#ifdef WORDS_BIGENDIAN
+            _swapDouble(bytes);
+#endif
+            buf.append(bytes, sizeof(double));
+        }
+    }
+    return encode(status, buf, RPENC_Z | RPENC_B64);
+}
+
+/**********************************************************************/
+// FUNCTION: Rappture::encoding::decodeDoubles()
+/// Decode RPENC_DOUBLES encoded text in buf into doubles.
+/**
+ * On success buf holds the values row by row in the host's byte order,
+ * and buf.size()/sizeof(double) is the number of values.
+ *
+ * Full function call:
+ * Rappture::encoding::decodeDoubles(status,buf)
+ */
+
+bool
+Rappture::encoding::decodeDoubles(Rappture::Outcome &status,
+                                  Rappture::Buffer& buf)
+{
+    if (!decode(status, buf, RPENC_Z | RPENC_B64)) {
+        return false;
+    }
+    if ((buf.size() % sizeof(double)) != 0) {
+        status.addError("encoded data is %lu bytes, not a whole number of "
+                        "doubles", (unsigned long)buf.size());
+        return false;
+    }
+#ifdef WORDS_BIGENDIAN
+    char *p = (char *)buf.bytes();
+    for (size_t i = 0; i < buf.size(); i += sizeof(double)) {
+        _swapDouble(p + i);
+    }
+#endif
+    return true;
+}
@@ -38,6 +38,18 @@ unsigned int headerFlags(const char* buf, int size);
 bool encode(Rappture::Outcome &err, Rappture::Buffer& buf, unsigned int flags);
 bool decode(Rappture::Outcome &err, Rappture::Buffer& buf, unsigned int flags);
 
+/*
+ * Columns of doubles stored as rows of little-endian IEEE 754 values,
+ * compressed and base64 encoded with a "@@RP-ENC:zb64" header.  This
+ * is the name used for it in the "encoding" attribute of <xy> and
+ * <xhw> elements.
+ */
+#define RPENC_DOUBLES   "zb64-f64le"
+
+bool encodeDoubles(Rappture::Outcome &err, Rappture::Buffer& buf,
+                   const double *const *columns, size_t ncols, size_t nrows);
+bool decodeDoubles(Rappture::Outcome &err, Rappture::Buffer& buf);
+
 }
 }
 #endif /*RP_ENCODE_H*/
@@ -17,6 +17,7 @@
 #include "RpLibrary.h"
 #include "RpEntityRef.h"
 #include "RpEncode.h"
+#include "RpNumFormat.h"
 #include <algorithm>
 #include <iostream>
 #include <string>
@@ -1736,6 +1737,68 @@ RpLibrary::getData (std::string path) const
     return buf;
 }
 
+/**********************************************************************/
+// METHOD: getDoubles()
+/// Return the numbers held at location 'path' as an array of doubles.
+/**
+ * The values may be whitespace separated text, possibly compressed, or
+ * binary data written by putDoubles() with compression, which is marked
+ * encoding="zb64-f64le".  Either way the returned buffer holds the
+ * values in order, in the host's byte order; its size divided by
+ * sizeof(double) is the number of values.  For an <xy> element,
+ * values alternate between x and y.
+ */
+
+Rappture::Buffer
+RpLibrary::getDoubles (std::string path) const
+{
+    Rappture::Buffer buf;
+    scew_element* retNode = NULL;
+    XML_Char const* contents = NULL;
+
+    status.addContext("RpLibrary::getDoubles()");
+    if (!this->root) {
+        // library doesn't exist, do nothing;
+        return buf;
+    }
+    retNode = _find(path,NO_CREATE_PATH);
+    if (retNode == NULL) {
+        return buf;
+    }
+    contents = scew_element_contents(retNode);
+    if (contents == NULL) {
+        return buf;
+    }
+    if (_get_attribute(retNode,"encoding") == RPENC_DOUBLES) {
+        buf.append(contents);
+        if (!Rappture::encoding::decodeDoubles(status, buf)) {
+            buf.clear();
+        }
+        return buf;
+    }
+    Rappture::Buffer text;
+    if (Rappture::encoding::headerFlags(contents,-1) != 0) {
+        // text stored with compression
+        text.append(contents);
+        if (!Rappture::encoding::decode(status, text, 0)) {
+            return buf;
+        }
+        text.append("",1);
+        contents = text.bytes();
+    }
+    const char *p = contents;
+    char *end = NULL;
+    while (1) {
+        double value = strtod(p, &end);
+        if (end == p) {
+            break;
+        }
+        buf.append((const char *)&value, sizeof(double));
+        p = end;
+    }
+    return buf;
+}
+
 
 /**********************************************************************/
 // METHOD: getFile()
@@ -2021,6 +2084,58 @@ RpLibrary::putData (std::string path,
 }
 
 
+/**********************************************************************/
+// METHOD: putDoubles()
+/// Put columns of doubles into the xml, as text or binary.
+/**
+ * Row i of the data holds columns[0][i], columns[1][i], ...  With
+ * RPLIB_COMPRESS the rows are stored as compressed binary, marked
+ * with encoding="zb64-f64le", which is many times smaller than text
+ * and reads back exactly.  With RPLIB_NO_COMPRESS they're written as
+ * text, one row per line, for readers that don't know the encoding.
+ */
+
+RpLibrary&
+RpLibrary::putDoubles (std::string path,
+                       const double *const *columns,
+                       size_t ncols,
+                       size_t nrows,
+                       unsigned int compress )
+{
+    scew_element* retNode = NULL;
+    Rappture::Buffer outData;
+    unsigned int bytesWritten = 0;
+
+    status.addContext("RpLibrary::putDoubles()");
+    if (!this->root) {
+        // library doesn't exist, do nothing;
+        return *this;
+    }
+    retNode = _find(path,CREATE_PATH);
+    if (retNode == NULL) {
+        status.addError("can't create node from path \"%s\"", path.c_str());
+        return *this;
+    }
+    if (compress == RPLIB_COMPRESS) {
+        if (!Rappture::encoding::encodeDoubles(status, outData, columns,
+                                               ncols, nrows)) {
+            return *this;
+        }
+        scew_element_add_attr_pair(retNode, "encoding", RPENC_DOUBLES);
+    } else {
+        Rappture::numformat::appendColumns(outData, columns, ncols, nrows);
+        scew_element_del_attr(retNode, "encoding");
+    }
+    bytesWritten = (unsigned int) outData.size();
+    if (bytesWritten == 0) {
+        scew_element_set_contents(retNode, "");
+    } else {
+        scew_element_set_contents_binary(retNode,outData.bytes(),&bytesWritten);
+    }
+    return *this;
+}
+
+
 /**********************************************************************/
 // METHOD: putFile()
 /// Put data from a file into the xml.
@@ -14,6 +14,9 @@
 #ifndef _RpLIBRARY_H
 #define _RpLIBRARY_H
 
+/* RpLibObj.h defines the same constants; the guard lets both be included */
+#ifndef RP_LIBRARY_CONSTS_DEFINED
+#define RP_LIBRARY_CONSTS_DEFINED
 enum RP_LIBRARY_CONSTS {
     RPLIB_OVERWRITE     = 0,
     RPLIB_APPEND        = 1,
@@ -22,6 +25,7 @@ enum RP_LIBRARY_CONSTS {
     RPLIB_NO_COMPRESS   = 0,
     RPLIB_COMPRESS      = 1,
 };
+#endif
 
 
 #ifdef __cplusplus
@@ -80,6 +84,7 @@ class RpLibrary
         int         getInt    ( std::string path = "") const;
         bool        getBool   ( std::string path = "") const;
         Rappture::Buffer getData ( std::string path = "") const;
+        Rappture::Buffer getDoubles ( std::string path = "") const;
         size_t      getFile   ( std::string path,
                                 std::string fileName) const;
 
@@ -123,6 +128,12 @@ class RpLibrary
                             int nbytes,
                             unsigned int append = RPLIB_OVERWRITE    );
 
+        RpLibrary& putDoubles( std::string path,
+                            const double *const *columns,
+                            size_t ncols,
+                            size_t nrows,
+                            unsigned int compress = RPLIB_COMPRESS );
+
         RpLibrary& putFile( std::string path,
                             std::string fileName,
                             unsigned int compress = RPLIB_COMPRESS,
@@ -0,0 +1,641 @@
+
+/*
+ * ----------------------------------------------------------------------
+ *  Rappture::numformat
+ *
+ *  Fast conversion of doubles to text for the writers that dump large
+ *  arrays of numbers (dx files, curves, histograms).
+ * ======================================================================
+ *  Copyright (c) 2004-2012  HUBzero Foundation, LLC
+ *
+ *  See the file "license.terms" for information on usage and
+ *  redistribution of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ * ======================================================================
+ */
+#include "RpNumFormat.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+
+using namespace Rappture;
+
+/* Powers of ten that are exactly representable as doubles. */
+static const double _pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+    1e22
+};
+#define MAXPOW10 22
+
+/* Largest precision handled without falling back to sprintf. */
+#define MAXPRECISION 9
+
+static const unsigned long _ipow10[] = {
+    1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL,
+    100000000UL, 1000000000UL
+};
+
+/*
+ * Multiply by 10^shift using at most two correctly rounded operations,
+ * so the result is within a few ulps of the exact product.
+ */
+static double
+_scale10(double x, int shift)
+{
+    if (shift >= 0) {
+        if (shift > MAXPOW10) {
+            x *= _pow10[MAXPOW10];
+            shift -= MAXPOW10;
+        }
+        return x * _pow10[shift];
+    }
+    shift = -shift;
+    if (shift > MAXPOW10) {
+        x /= _pow10[MAXPOW10];
+        shift -= MAXPOW10;
+    }
+    return x / _pow10[shift];
+}
+
+static size_t
+_slowFormatG(char *buf, double value, int width, int precision)
+{
+    return (size_t)sprintf(buf, "%*.*g", width, precision, value);
+}
+
+/*
+ * Lays out ndigits significant digits (with the first one at 10^exp10)
+ * the way "%g" does for the given precision, after whatever sign is
+ * already in tmp up to p, and right aligns the result in width
+ * characters of buf.
+ */
+static size_t
+_layoutG(char *buf, char *tmp, char *p, const char *digits, int ndigits,
+         int exp10, int precision, int width)
+{
+    if ((exp10 < -4) || (exp10 >= precision)) {
+        /* d.ddde+XX */
+        int e;
+
+        *p++ = digits[0];
+        if (ndigits > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, ndigits - 1);
+            p += ndigits - 1;
+        }
+        *p++ = 'e';
+        if (exp10 < 0) {
+            *p++ = '-';
+            e = -exp10;
+        } else {
+            *p++ = '+';
+            e = exp10;
+        }
+        if (e >= 100) {
+            *p++ = (char)('0' + e / 100);
+            e %= 100;
+        }
+        *p++ = (char)('0' + e / 10);
+        *p++ = (char)('0' + e % 10);
+    } else if (exp10 >= 0) {
+        /* ddd.ddd */
+        int nint = exp10 + 1;
+
+        for (int i = 0; i < nint; i++) {
+            *p++ = (i < ndigits) ? digits[i] : '0';
+        }
+        if (ndigits > nint) {
+            *p++ = '.';
+            memcpy(p, digits + nint, ndigits - nint);
+            p += ndigits - nint;
+        }
+    } else {
+        /* 0.000ddd */
+        *p++ = '0';
+        *p++ = '.';
+        for (int i = -1; i > exp10; i--) {
+            *p++ = '0';
+        }
+        memcpy(p, digits, ndigits);
+        p += ndigits;
+    }
+
+    size_t len = p - tmp;
+    size_t pad = ((size_t)width > len) ? (size_t)width - len : 0;
+    memset(buf, ' ', pad);
+    memcpy(buf + pad, tmp, len);
+    buf[pad + len] = '\0';
+    return pad + len;
+}
+
+/**********************************************************************/
+// FUNCTION: Rappture::numformat::formatG()
+/// Format a double exactly like sprintf(buf, "%*.*g", width, precision, x).
+
+/**
+ * The digits are produced with integer arithmetic on the value scaled
+ * by a power of ten.  Values whose rounding can't be decided from the
+ * scaled double (halfway cases, precision above 9 digits, very large or
+ * very small exponents, inf and nan) are handed to sprintf, so the
+ * output is byte for byte what "%g" would have produced.
+ *
+ * buf must hold at least max(width, RPNUMFMT_MAXLEN)+1 characters
+ * (precision is expected to be at most 17).
+ * Returns the number of characters written, not counting the NUL.
+ */
+
+size_t
+numformat::formatG(char *buf, double value, int width, int precision)
+{
+    char digits[MAXPRECISION+1];
+    char tmp[RPNUMFMT_MAXLEN+1];
+    char *p;
+    double mag;
+    int exp10, shift, ndigits;
+
+    if (precision == 0) {
+        precision = 1;                  /* Same as printf. */
+    }
+    if ((precision < 0) || (precision > MAXPRECISION) || (width < 0) ||
+        (!std::isfinite(value))) {
+        return _slowFormatG(buf, value, width, precision);
+    }
+    p = tmp;
+    if (std::signbit(value)) {
+        *p++ = '-';
+    }
+    mag = std::fabs(value);
+    if (mag == 0.0) {
+        digits[0] = '0';
+        ndigits = 1;
+        exp10 = 0;
+    } else {
+        double scaled, ip, frac;
+        unsigned long n;
+
+        exp10 = (int)std::floor(std::log10(mag));
+        shift = precision - 1 - exp10;
+        if ((shift > 2*MAXPOW10) || (shift < -2*MAXPOW10)) {
+            return _slowFormatG(buf, value, width, precision);
+        }
+        scaled = _scale10(mag, shift);
+        /* log10 can be off by one right at a power of ten. */
+        if (scaled < (double)_ipow10[precision-1]) {
+            exp10--, shift++;
+            scaled = _scale10(mag, shift);
+        } else if (scaled >= (double)_ipow10[precision]) {
+            exp10++, shift--;
+            scaled = _scale10(mag, shift);
+        }
+        ip = std::floor(scaled);
+        frac = scaled - ip;
+        if (std::fabs(frac - 0.5) < 1e-6) {
+            /* Too close to a tie to round correctly from the scaled
+             * value.  Let printf look at the exact binary value. */
+            return _slowFormatG(buf, value, width, precision);
+        }
+        n = (unsigned long)ip;
+        if (frac > 0.5) {
+            n++;
+            if (n == _ipow10[precision]) {
+                n = _ipow10[precision-1];
+                exp10++;
+            }
+        }
+        for (int i = precision - 1; i >= 0; i--) {
+            digits[i] = (char)('0' + (n % 10));
+            n /= 10;
+        }
+        /* "%g" drops trailing zeros. */
+        ndigits = precision;
+        while ((ndigits > 1) && (digits[ndigits-1] == '0')) {
+            ndigits--;
+        }
+    }
+
+    return _layoutG(buf, tmp, p, digits, ndigits, exp10, precision, width);
+}
+
+/*
+ * Shortest digits that read back as the same double, found with the
+ * Grisu3 algorithm (Florian Loitsch, "Printing Floating-Point Numbers
+ * Quickly and Accurately with Integers", PLDI 2010).  The value and
+ * the halfway points to its neighbours are scaled by a cached power of
+ * ten into 64-bit integers, and digits are generated until the number
+ * is inside those bounds.  The multiplies aren't exact, so for about
+ * one value in 200 Grisu3 can't prove its answer is the shortest; those
+ * go to sprintf and strtod instead.
+ */
+
+typedef struct {
+    uint64_t f;                         /* Significand. */
+    int e;                              /* Binary exponent. */
+} _DiyFp;
+
+#define DP_SIGNIFICAND_MASK     0x000FFFFFFFFFFFFFULL
+#define DP_EXPONENT_MASK        0x7FF0000000000000ULL
+#define DP_HIDDEN_BIT           0x0010000000000000ULL
+#define DP_SIGNIFICAND_SIZE     52
+#define DP_EXPONENT_BIAS        (0x3FF + DP_SIGNIFICAND_SIZE)
+#define DP_DENORMAL_EXPONENT    (-DP_EXPONENT_BIAS + 1)
+
+/* Range of binary exponents the scaled value is brought into, so its
+ * integer part fits in 32 bits. */
+#define MIN_TARGET_EXPONENT     (-60)
+#define MAX_TARGET_EXPONENT     (-32)
+
+/* 10^k for k = -348, -340, ..., 340, as normalized 64-bit significands
+ * and binary exponents. */
+#define CACHED_POWERS_OFFSET    348
+#define CACHED_POWERS_STEP      8
+static const _DiyFp _cachedPowers[] = {
+    { 0xfa8fd5a0081c0288ULL, -1220 },  /* 1e-348 */
+    { 0xbaaee17fa23ebf76ULL, -1193 },  /* 1e-340 */
+    { 0x8b16fb203055ac76ULL, -1166 },  /* 1e-332 */
+    { 0xcf42894a5dce35eaULL, -1140 },  /* 1e-324 */
+    { 0x9a6bb0aa55653b2dULL, -1113 },  /* 1e-316 */
+    { 0xe61acf033d1a45dfULL, -1087 },  /* 1e-308 */
+    { 0xab70fe17c79ac6caULL, -1060 },  /* 1e-300 */
+    { 0xff77b1fcbebcdc4fULL, -1034 },  /* 1e-292 */
+    { 0xbe5691ef416bd60cULL, -1007 },  /* 1e-284 */
+    { 0x8dd01fad907ffc3cULL,  -980 },  /* 1e-276 */
+    { 0xd3515c2831559a83ULL,  -954 },  /* 1e-268 */
+    { 0x9d71ac8fada6c9b5ULL,  -927 },  /* 1e-260 */
+    { 0xea9c227723ee8bcbULL,  -901 },  /* 1e-252 */
+    { 0xaecc49914078536dULL,  -874 },  /* 1e-244 */
+    { 0x823c12795db6ce57ULL,  -847 },  /* 1e-236 */
+    { 0xc21094364dfb5637ULL,  -821 },  /* 1e-228 */
+    { 0x9096ea6f3848984fULL,  -794 },  /* 1e-220 */
+    { 0xd77485cb25823ac7ULL,  -768 },  /* 1e-212 */
+    { 0xa086cfcd97bf97f4ULL,  -741 },  /* 1e-204 */
+    { 0xef340a98172aace5ULL,  -715 },  /* 1e-196 */
+    { 0xb23867fb2a35b28eULL,  -688 },  /* 1e-188 */
+    { 0x84c8d4dfd2c63f3bULL,  -661 },  /* 1e-180 */
+    { 0xc5dd44271ad3cdbaULL,  -635 },  /* 1e-172 */
+    { 0x936b9fcebb25c996ULL,  -608 },  /* 1e-164 */
+    { 0xdbac6c247d62a584ULL,  -582 },  /* 1e-156 */
+    { 0xa3ab66580d5fdaf6ULL,  -555 },  /* 1e-148 */
+    { 0xf3e2f893dec3f126ULL,  -529 },  /* 1e-140 */
+    { 0xb5b5ada8aaff80b8ULL,  -502 },  /* 1e-132 */
+    { 0x87625f056c7c4a8bULL,  -475 },  /* 1e-124 */
+    { 0xc9bcff6034c13053ULL,  -449 },  /* 1e-116 */
+    { 0x964e858c91ba2655ULL,  -422 },  /* 1e-108 */
+    { 0xdff9772470297ebdULL,  -396 },  /* 1e-100 */
+    { 0xa6dfbd9fb8e5b88fULL,  -369 },  /* 1e-92 */
+    { 0xf8a95fcf88747d94ULL,  -343 },  /* 1e-84 */
+    { 0xb94470938fa89bcfULL,  -316 },  /* 1e-76 */
+    { 0x8a08f0f8bf0f156bULL,  -289 },  /* 1e-68 */
+    { 0xcdb02555653131b6ULL,  -263 },  /* 1e-60 */
+    { 0x993fe2c6d07b7facULL,  -236 },  /* 1e-52 */
+    { 0xe45c10c42a2b3b06ULL,  -210 },  /* 1e-44 */
+    { 0xaa242499697392d3ULL,  -183 },  /* 1e-36 */
+    { 0xfd87b5f28300ca0eULL,  -157 },  /* 1e-28 */
+    { 0xbce5086492111aebULL,  -130 },  /* 1e-20 */
+    { 0x8cbccc096f5088ccULL,  -103 },  /* 1e-12 */
+    { 0xd1b71758e219652cULL,   -77 },  /* 1e-4 */
+    { 0x9c40000000000000ULL,   -50 },  /* 1e4 */
+    { 0xe8d4a51000000000ULL,   -24 },  /* 1e12 */
+    { 0xad78ebc5ac620000ULL,     3 },  /* 1e20 */
+    { 0x813f3978f8940984ULL,    30 },  /* 1e28 */
+    { 0xc097ce7bc90715b3ULL,    56 },  /* 1e36 */
+    { 0x8f7e32ce7bea5c70ULL,    83 },  /* 1e44 */
+    { 0xd5d238a4abe98068ULL,   109 },  /* 1e52 */
+    { 0x9f4f2726179a2245ULL,   136 },  /* 1e60 */
+    { 0xed63a231d4c4fb27ULL,   162 },  /* 1e68 */
+    { 0xb0de65388cc8ada8ULL,   189 },  /* 1e76 */
+    { 0x83c7088e1aab65dbULL,   216 },  /* 1e84 */
+    { 0xc45d1df942711d9aULL,   242 },  /* 1e92 */
+    { 0x924d692ca61be758ULL,   269 },  /* 1e100 */
+    { 0xda01ee641a708deaULL,   295 },  /* 1e108 */
+    { 0xa26da3999aef774aULL,   322 },  /* 1e116 */
+    { 0xf209787bb47d6b85ULL,   348 },  /* 1e124 */
+    { 0xb454e4a179dd1877ULL,   375 },  /* 1e132 */
+    { 0x865b86925b9bc5c2ULL,   402 },  /* 1e140 */
+    { 0xc83553c5c8965d3dULL,   428 },  /* 1e148 */
+    { 0x952ab45cfa97a0b3ULL,   455 },  /* 1e156 */
+    { 0xde469fbd99a05fe3ULL,   481 },  /* 1e164 */
+    { 0xa59bc234db398c25ULL,   508 },  /* 1e172 */
+    { 0xf6c69a72a3989f5cULL,   534 },  /* 1e180 */
+    { 0xb7dcbf5354e9beceULL,   561 },  /* 1e188 */
+    { 0x88fcf317f22241e2ULL,   588 },  /* 1e196 */
+    { 0xcc20ce9bd35c78a5ULL,   614 },  /* 1e204 */
+    { 0x98165af37b2153dfULL,   641 },  /* 1e212 */
+    { 0xe2a0b5dc971f303aULL,   667 },  /* 1e220 */
+    { 0xa8d9d1535ce3b396ULL,   694 },  /* 1e228 */
+    { 0xfb9b7cd9a4a7443cULL,   720 },  /* 1e236 */
+    { 0xbb764c4ca7a44410ULL,   747 },  /* 1e244 */
+    { 0x8bab8eefb6409c1aULL,   774 },  /* 1e252 */
+    { 0xd01fef10a657842cULL,   800 },  /* 1e260 */
+    { 0x9b10a4e5e9913129ULL,   827 },  /* 1e268 */
+    { 0xe7109bfba19c0c9dULL,   853 },  /* 1e276 */
+    { 0xac2820d9623bf429ULL,   880 },  /* 1e284 */
+    { 0x80444b5e7aa7cf85ULL,   907 },  /* 1e292 */
+    { 0xbf21e44003acdd2dULL,   933 },  /* 1e300 */
+    { 0x8e679c2f5e44ff8fULL,   960 },  /* 1e308 */
+    { 0xd433179d9c8cb841ULL,   986 },  /* 1e316 */
+    { 0x9e19db92b4e31ba9ULL,  1013 },  /* 1e324 */
+    { 0xeb96bf6ebadf77d9ULL,  1039 },  /* 1e332 */
+    { 0xaf87023b9bf0ee6bULL,  1066 },  /* 1e340 */
+};
+
+static const uint32_t _upow10[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    1000000000
+};
+
+static _DiyFp
+_diyFp(uint64_t f, int e)
+{
+    _DiyFp x;
+
+    x.f = f;
+    x.e = e;
+    return x;
+}
+
+/* Product of the significands, rounded to the upper 64 bits. */
+static _DiyFp
+_diyMultiply(_DiyFp x, _DiyFp y)
+{
+    const uint64_t M32 = 0xFFFFFFFFULL;
+    uint64_t a = x.f >> 32, b = x.f & M32;
+    uint64_t c = y.f >> 32, d = y.f & M32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+
+    tmp += 1ULL << 31;
+    return _diyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64);
+}
+
+static _DiyFp
+_diyNormalize(_DiyFp x)
+{
+    while ((x.f & (1ULL << 63)) == 0) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+/*
+ * Moves the last digit down while that brings the number closer to
+ * the value without leaving the bounds, then decides whether the
+ * digits are certain to be the shortest and closest.  Distances are
+ * measured from the upper bound; unit is the size of the error in
+ * them.  (This is RoundWeed from the paper.)
+ */
+static bool
+_roundWeed(char *digits, int len, uint64_t distanceTooHighW,
+           uint64_t unsafeInterval, uint64_t rest, uint64_t tenKappa,
+           uint64_t unit)
+{
+    uint64_t smallDistance = distanceTooHighW - unit;
+    uint64_t bigDistance = distanceTooHighW + unit;
+
+    while ((rest < smallDistance) && (unsafeInterval - rest >= tenKappa) &&
+           ((rest + tenKappa < smallDistance) ||
+            (smallDistance - rest >= rest + tenKappa - smallDistance))) {
+        digits[len - 1]--;
+        rest += tenKappa;
+    }
+    if ((rest < bigDistance) && (unsafeInterval - rest >= tenKappa) &&
+        ((rest + tenKappa < bigDistance) ||
+         (bigDistance - rest > rest + tenKappa - bigDistance))) {
+        return false;
+    }
+    return (2 * unit <= rest) && (rest <= unsafeInterval - 4 * unit);
+}
+
+/*
+ * Generates the digits of the scaled value w, stopping as soon as the
+ * number is inside (low, high).  Returns false if the result might not
+ * be the shortest.
+ */
+static bool
+_digitGen(_DiyFp low, _DiyFp w, _DiyFp high, char *digits, int *lenPtr,
+          int *kappaPtr)
+{
+    uint64_t unit = 1;
+    _DiyFp tooLow = _diyFp(low.f - unit, low.e);
+    _DiyFp tooHigh = _diyFp(high.f + unit, high.e);
+    uint64_t unsafeInterval = tooHigh.f - tooLow.f;
+    _DiyFp one = _diyFp(1ULL << -w.e, w.e);
+    uint32_t integrals = (uint32_t)(tooHigh.f >> -one.e);
+    uint64_t fractionals = tooHigh.f & (one.f - 1);
+    int kappa, len;
+
+    kappa = 1;
+    while ((kappa < 10) && (integrals >= _upow10[kappa])) {
+        kappa++;
+    }
+    len = 0;
+    while (kappa > 0) {
+        uint32_t divisor = _upow10[kappa - 1];
+        uint64_t rest;
+
+        digits[len++] = (char)('0' + integrals / divisor);
+        integrals %= divisor;
+        kappa--;
+        rest = ((uint64_t)integrals << -one.e) + fractionals;
+        if (rest < unsafeInterval) {
+            *lenPtr = len;
+            *kappaPtr = kappa;
+            return _roundWeed(digits, len, tooHigh.f - w.f, unsafeInterval,
+                              rest, (uint64_t)divisor << -one.e, unit);
+        }
+    }
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafeInterval *= 10;
+        digits[len++] = (char)('0' + (fractionals >> -one.e));
+        fractionals &= one.f - 1;
+        kappa--;
+        if (fractionals < unsafeInterval) {
+            *lenPtr = len;
+            *kappaPtr = kappa;
+            return _roundWeed(digits, len, (tooHigh.f - w.f) * unit,
+                              unsafeInterval, fractionals, one.f, unit);
+        }
+        if (len >= 18) {
+            return false;
+        }
+    }
+}
+
+/*
+ * Stores the shortest digits of a positive, finite value in digits
+ * and returns how many there are (at most 17).  The value is
+ * digits * 10^(*kPtr).  Returns 0 if Grisu3 can't be sure.
+ */
+static int
+_grisu3(double value, char *digits, int *kPtr)
+{
+    union {
+        double d;
+        uint64_t u;
+    } bits;
+    _DiyFp v, w, plus, minus, cached;
+    int biasedExp, len, kappa, minExp, k, index;
+
+    bits.d = value;
+    biasedExp = (int)((bits.u & DP_EXPONENT_MASK) >> DP_SIGNIFICAND_SIZE);
+    if (biasedExp != 0) {
+        v = _diyFp((bits.u & DP_SIGNIFICAND_MASK) + DP_HIDDEN_BIT,
+                   biasedExp - DP_EXPONENT_BIAS);
+    } else {
+        v = _diyFp(bits.u & DP_SIGNIFICAND_MASK, DP_DENORMAL_EXPONENT);
+    }
+
+    /* The points halfway to the neighbouring doubles.  Just above a
+     * power of two, the gap below is half the gap above. */
+    plus = _diyNormalize(_diyFp((v.f << 1) + 1, v.e - 1));
+    if (((bits.u & DP_SIGNIFICAND_MASK) == 0) && (biasedExp > 1)) {
+        minus = _diyFp((v.f << 2) - 1, v.e - 2);
+    } else {
+        minus = _diyFp((v.f << 1) - 1, v.e - 1);
+    }
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    w = _diyNormalize(v);
+
+    /* Pick the cached power of ten that moves the binary exponent into
+     * [MIN_TARGET_EXPONENT, MAX_TARGET_EXPONENT]. */
+    minExp = MIN_TARGET_EXPONENT - (w.e + 64);
+    k = (int)std::ceil((minExp + 63) * 0.30102999566398114);
+    index = (CACHED_POWERS_OFFSET + k - 1) / CACHED_POWERS_STEP + 1;
+    cached = _cachedPowers[index];
+
+    if (!_digitGen(_diyMultiply(minus, cached), _diyMultiply(w, cached),
+                   _diyMultiply(plus, cached), digits, &len, &kappa)) {
+        return 0;
+    }
+    *kPtr = CACHED_POWERS_OFFSET - index * CACHED_POWERS_STEP + kappa;
+    return len;
+}
+
+/*
+ * The shortest digits by brute force: the closest 15, 16 or 17 digit
+ * decimal, whichever is the first to read back as the value.  A number
+ * with 15 or fewer digits that reads back as the value is always what
+ * %.15e rounds to, so trailing zeros are dropped from that one.
+ */
+static int
+_slowShortest(double value, char *digits, int *kPtr)
+{
+    char b[40];
+    int precision, len, exp10;
+
+    for (precision = 15; precision < 17; precision++) {
+        sprintf(b, "%.*e", precision - 1, value);
+        if (strtod(b, NULL) == value) {
+            break;
+        }
+    }
+    if (precision == 17) {
+        sprintf(b, "%.*e", precision - 1, value);
+    }
+    len = 0;
+    digits[len++] = b[0];
+    for (const char *p = b + 2; *p != 'e'; p++) {
+        digits[len++] = *p;
+    }
+    exp10 = atoi(strchr(b, 'e') + 1);
+    while ((len > 1) && (digits[len-1] == '0')) {
+        len--;
+    }
+    *kPtr = exp10 - len + 1;
+    return len;
+}
+
+/**********************************************************************/
+// FUNCTION: Rappture::numformat::formatShortest()
+/// Format a double with the fewest digits that read back exactly.
+
+/**
+ * The digits are laid out the way "%g" would lay them out with a
+ * precision of the number of digits (but at least 6), so values that
+ * "%g" already printed exactly come out unchanged: 1e+06, 0.0001,
+ * 123.5.  Others get as many digits as they need, e.g. 0.1 stays 0.1
+ * but 1/3 is 0.3333333333333333.  inf and nan are printed as printf
+ * prints them.
+ *
+ * buf must hold at least max(width, RPNUMFMT_MAXLEN)+1 characters.
+ * Returns the number of characters written, not counting the NUL.
+ */
+
+size_t
+numformat::formatShortest(char *buf, double value, int width)
+{
+    char digits[20];
+    char tmp[RPNUMFMT_MAXLEN+1];
+    char *p;
+    int ndigits, k, exp10;
+
+    if (width < 0) {
+        width = 0;
+    }
+    if (!std::isfinite(value)) {
+        return _slowFormatG(buf, value, width, 6);
+    }
+    p = tmp;
+    if (std::signbit(value)) {
+        *p++ = '-';
+    }
+    if (value == 0.0) {
+        digits[0] = '0';
+        ndigits = 1;
+        exp10 = 0;
+    } else {
+        ndigits = _grisu3(std::fabs(value), digits, &k);
+        if (ndigits == 0) {
+            ndigits = _slowShortest(std::fabs(value), digits, &k);
+        }
+        exp10 = ndigits + k - 1;
+    }
+    return _layoutG(buf, tmp, p, digits, ndigits, exp10,
+                    (ndigits > 6) ? ndigits : 6, width);
+}
+
+/**********************************************************************/
+// FUNCTION: Rappture::numformat::appendColumns()
+/// Append rows of numbers, one column per array, to a buffer.
+
+/**
+ * Row i holds columns[0][i], columns[1][i], ... each formatted with
+ * formatShortest() and right aligned in width characters.  Values
+ * are always separated by at least one space, even ones wider than
+ * width.  Each row ends with a newline.  The buffer is grown once up
+ * front for the usual case.
+ */
+
+void
+numformat::appendColumns(SimpleCharBuffer &buf, const double *const *columns,
+                         size_t ncols, size_t nrows, int width)
+{
+    char b[RPNUMFMT_MAXLEN+2];
+    size_t len;
+
+    if (width > RPNUMFMT_MAXLEN) {
+        width = RPNUMFMT_MAXLEN;
+    }
+    buf.extend(nrows * (ncols * (width + 1) + 1) + 1);
+    for (size_t row = 0; row < nrows; row++) {
+        for (size_t col = 0; col < ncols; col++) {
+            len = formatShortest(b + 1, columns[col][row], width);
+            if (b[1] != ' ') {
+                b[0] = ' ';
+                buf.append(b, len + 1);
+            } else {
+                buf.append(b + 1, len);
+            }
+        }
+        buf.append("\n", 1);
+    }
+    /* Leave a NUL after the data, as appendf() does, so bytes() can
+     * still be used as a string. */
+    buf.append("", 1);
+    buf.remove(1);
+}
@@ -0,0 +1,35 @@
+
+/*
+ * ======================================================================
+ *  Rappture::numformat
+ *
+ *  Copyright (c) 2004-2012  HUBzero Foundation, LLC
+ * ----------------------------------------------------------------------
+ *  See the file "license.terms" for information on usage and
+ *  redistribution of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ * ======================================================================
+ */
+
+#ifndef RP_NUMFORMAT_H
+#define RP_NUMFORMAT_H
+
+#include <cstddef>
+#include "RpSimpleBuffer.h"
+
+namespace Rappture {
+namespace numformat {
+
+/*
+ * Largest number of characters formatG() or formatShortest() writes
+ * for a width of 0, not counting the terminating NUL.
+ */
+#define RPNUMFMT_MAXLEN 32
+
+size_t formatG(char *buf, double value, int width=0, int precision=6);
+size_t formatShortest(char *buf, double value, int width=0);
+void appendColumns(SimpleCharBuffer &buf, const double *const *columns,
+                   size_t ncols, size_t nrows, int width=10);
+
+}
+}
+#endif /*RP_NUMFORMAT_H*/
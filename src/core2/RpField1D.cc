@@ -20,6 +20,12 @@
 
 using namespace Rappture;
 
+// serialization version 'A' for Field1D...
+SerialConversion Field1D::versionA("Field1D", 'A',
+    (Serializable::serializeObjectMethod)&Field1D::serialize_A,
+    &Field1D::create,
+    (Serializable::deserializeObjectMethod)&Field1D::deserialize_A);
+
 Field1D::Field1D()
   : _vmin(NAN),
     _vmax(NAN),
@@ -196,3 +202,51 @@ Field1D::valueMax() const
 {
     return _vmax;
 }
+
+Ptr<Serializable>
+Field1D::create()
+{
+    return Ptr<Serializable>( (Serializable*) new Field1D() );
+}
+
+void
+Field1D::serialize_A(SerialBuffer& buffer) const
+{
+    if (_meshPtr.isNull()) {
+        buffer.writeChar('0');
+    } else {
+        buffer.writeChar('1');
+        _meshPtr->serialize_B(buffer);
+    }
+    std::vector<double> values(_valuelist.begin(), _valuelist.end());
+    buffer.writeDoubles((values.size() > 0) ? &values[0] : NULL,
+        values.size());
+    buffer.writeDouble(_vmin);
+    buffer.writeDouble(_vmax);
+    buffer.writeInt(_counter);
+}
+
+Outcome
+Field1D::deserialize_A(SerialBuffer& buffer)
+{
+    Outcome status;
+
+    _meshPtr.clear();
+    if (buffer.readChar() == '1') {
+        _meshPtr = Ptr<Mesh1D>( new Mesh1D() );
+        status = _meshPtr->deserialize_B(buffer);
+        if (status != 0) {
+            return status.addContext("while deserializing Field1D");
+        }
+    }
+    std::vector<double> values;
+    if (buffer.readDoubles(values) < 0) {
+        return status.error("can't deserialize Field1D: corrupt value data");
+    }
+    _valuelist.assign(values.begin(), values.end());
+    _vmin = buffer.readDouble();
+    _vmax = buffer.readDouble();
+    _counter = buffer.readInt();
+
+    return status;
+}
@@ -22,7 +22,7 @@
 
 namespace Rappture {
 
-class Field1D {
+class Field1D : public Serializable {
 public:
     Field1D();
     Field1D(const Ptr<Mesh1D>& meshPtr);
@@ -45,12 +45,23 @@ public:
     virtual double valueMin() const;
     virtual double valueMax() const;
 
+    // required for base class Serializable:
+    const char* serializerType() const { return "Field1D"; }
+    char serializerVersion() const { return 'A'; }
+
+    static Ptr<Serializable> create();
+    void serialize_A(SerialBuffer& buffer) const;
+    Outcome deserialize_A(SerialBuffer& buffer);
+
 private:
     std::deque<double> _valuelist;  // list of all values, in nodeId order
     double _vmin;                   // minimum value in _valuelist
     double _vmax;                   // maximum value in _valuelist
     Ptr<Mesh1D> _meshPtr;           // mesh for all x-points
     int _counter;                   // counter for generating node IDs
+
+    // methods for serializing/deserializing version 'A'
+    static SerialConversion versionA;
 };
 
 } // namespace Rappture
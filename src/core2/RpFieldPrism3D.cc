@@ -17,6 +17,12 @@
 
 using namespace Rappture;
 
+// serialization version 'A' for FieldPrism3D...
+SerialConversion FieldPrism3D::versionA("FieldPrism3D", 'A',
+    (Serializable::serializeObjectMethod)&FieldPrism3D::serialize_A,
+    &FieldPrism3D::create,
+    (Serializable::deserializeObjectMethod)&FieldPrism3D::deserialize_A);
+
 FieldPrism3D::FieldPrism3D()
   : _valuelist(),
     _vmin(NAN),
@@ -152,3 +158,48 @@ FieldPrism3D::valueMax() const
 {
     return _vmax;
 }
+
+Ptr<Serializable>
+FieldPrism3D::create()
+{
+    return Ptr<Serializable>( (Serializable*) new FieldPrism3D() );
+}
+
+void
+FieldPrism3D::serialize_A(SerialBuffer& buffer) const
+{
+    if (_meshPtr.isNull()) {
+        buffer.writeChar('0');
+    } else {
+        buffer.writeChar('1');
+        _meshPtr->serialize_A(buffer);
+    }
+    buffer.writeDoubles((_valuelist.size() > 0) ? &_valuelist[0] : NULL,
+        _valuelist.size());
+    buffer.writeDouble(_vmin);
+    buffer.writeDouble(_vmax);
+    buffer.writeInt(_counter);
+}
+
+Outcome
+FieldPrism3D::deserialize_A(SerialBuffer& buffer)
+{
+    Outcome status;
+
+    _meshPtr.clear();
+    if (buffer.readChar() == '1') {
+        _meshPtr = Ptr<MeshPrism3D>( new MeshPrism3D() );
+        status = _meshPtr->deserialize_A(buffer);
+        if (status != 0) {
+            return status.addContext("while deserializing FieldPrism3D");
+        }
+    }
+    if (buffer.readDoubles(_valuelist) < 0) {
+        return status.error("can't deserialize FieldPrism3D: corrupt value data");
+    }
+    _vmin = buffer.readDouble();
+    _vmax = buffer.readDouble();
+    _counter = buffer.readInt();
+
+    return status;
+}
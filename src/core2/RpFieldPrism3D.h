@@ -23,7 +23,7 @@
 
 namespace Rappture {
 
-class FieldPrism3D {
+class FieldPrism3D : public Serializable {
 public:
     FieldPrism3D();
     FieldPrism3D(const MeshTri2D& xyg, const Mesh1D& zg);
@@ -40,12 +40,23 @@ public:
     virtual double valueMin() const;
     virtual double valueMax() const;
 
+    // required for base class Serializable:
+    const char* serializerType() const { return "FieldPrism3D"; }
+    char serializerVersion() const { return 'A'; }
+
+    static Ptr<Serializable> create();
+    void serialize_A(SerialBuffer& buffer) const;
+    Outcome deserialize_A(SerialBuffer& buffer);
+
 private:
     std::vector<double> _valuelist;  // list of all values, in nodeId order
     double _vmin;                    // minimum value in _valuelist
     double _vmax;                    // maximum value in _valuelist
     Ptr<MeshPrism3D> _meshPtr;       // mesh for all (x,y,z) points
     int _counter;                    // counter for generating node IDs
+
+    // methods for serializing/deserializing version 'A'
+    static SerialConversion versionA;
 };
 
 } // namespace Rappture
@@ -1,9 +1,10 @@
 /*
  * ----------------------------------------------------------------------
  *  Rappture::FieldRect3D
- *    This is a continuous, linear function defined by a series of
- *    points on a 3D structured mesh.  It's a scalar field defined
- *    in 3D space.
+ *    This is a continuous function defined by a series of points
+ *    on a 3D structured mesh.  It's a scalar field defined in 3D
+ *    space, interpolated trilinearly or tricubically between the
+ *    points.
  *
  * ======================================================================
  *  AUTHOR:  Michael McLennan, Purdue University
@@ -17,12 +18,82 @@
 
 using namespace Rappture;
 
+/*
+ * Computes the weights w and their derivatives dw (with respect to
+ * the coordinate) for the four nodes xs[0..3] around c along one
+ * axis.  c lies in the interval [xs[1],xs[2]]; nodes with ids < 0
+ * are off the end of the mesh.  The weights are those of a cubic
+ * Hermite spline with Catmull-Rom tangents, or of a straight line
+ * for LINEAR, written out so that f(c) = sum w[i]*f[i].
+ */
+static void
+_axisWeights(FieldRect3D::Interpolation interp, const int* ids,
+    const double* xs, double c, double* w, double* dw)
+{
+    double h = xs[2] - xs[1];
+
+    w[0] = w[1] = w[2] = w[3] = 0.0;
+    dw[0] = dw[1] = dw[2] = dw[3] = 0.0;
+    if (h == 0.0) {
+        w[1] = w[2] = 0.5;
+        return;
+    }
+    double t = (c - xs[1])/h;
+
+    if (interp == FieldRect3D::LINEAR) {
+        w[1] = 1.0-t;
+        w[2] = t;
+        dw[1] = -1.0/h;
+        dw[2] = 1.0/h;
+        return;
+    }
+
+    double t2 = t*t, t3 = t2*t;
+    double h00 = 2*t3 - 3*t2 + 1, h10 = t3 - 2*t2 + t;
+    double h01 = -2*t3 + 3*t2,    h11 = t3 - t2;
+    double d00 = (6*t2 - 6*t)/h,  d10 = (3*t2 - 4*t + 1)/h;
+    double d01 = (-6*t2 + 6*t)/h, d11 = (3*t2 - 2*t)/h;
+
+    // h times the tangent at xs[1] and xs[2], as weights on the nodes
+    double m1[4] = { 0.0, -1.0, 1.0, 0.0 };
+    double m2[4] = { 0.0, -1.0, 1.0, 0.0 };
+    if (ids[0] >= 0) {
+        double a = h/(xs[2] - xs[0]);
+        m1[0] = -a; m1[1] = 0.0; m1[2] = a;
+    }
+    if (ids[3] >= 0) {
+        double b = h/(xs[3] - xs[1]);
+        m2[1] = -b; m2[2] = 0.0; m2[3] = b;
+    }
+
+    for (int i=0; i < 4; i++) {
+        w[i]  = h10*m1[i] + h11*m2[i];
+        dw[i] = d10*m1[i] + d11*m2[i];
+    }
+    w[1] += h00;  dw[1] += d00;
+    w[2] += h01;  dw[2] += d01;
+}
+
+// serialization version 'A' for FieldRect3D...
+SerialConversion FieldRect3D::versionA("FieldRect3D", 'A',
+    (Serializable::serializeObjectMethod)&FieldRect3D::serialize_A,
+    &FieldRect3D::create,
+    (Serializable::deserializeObjectMethod)&FieldRect3D::deserialize_A);
+
+// serialization version 'B' for FieldRect3D...
+// same content as 'A', plus the interpolation mode
+SerialConversion FieldRect3D::versionB("FieldRect3D", 'B',
+    (Serializable::serializeObjectMethod)&FieldRect3D::serialize_B,
+    &FieldRect3D::create,
+    (Serializable::deserializeObjectMethod)&FieldRect3D::deserialize_B);
+
 FieldRect3D::FieldRect3D()
   : _valuelist(),
     _vmin(NAN),
     _vmax(NAN),
     _meshPtr(NULL),
-    _counter(0)
+    _counter(0),
+    _interp(LINEAR)
 {
 }
 
@@ -31,7 +102,8 @@ FieldRect3D::FieldRect3D(const Mesh1D& xg, const Mesh1D& yg, const Mesh1D& zg)
     _vmin(NAN),
     _vmax(NAN),
     _meshPtr(NULL),
-    _counter(0)
+    _counter(0),
+    _interp(LINEAR)
 {
     _meshPtr = Ptr<MeshRect3D>( new MeshRect3D(xg,yg,zg) );
     int npts = xg.size()*yg.size()*zg.size();
@@ -43,7 +115,8 @@ FieldRect3D::FieldRect3D(const FieldRect3D& field)
     _vmin(field._vmin),
     _vmax(field._vmax),
     _meshPtr(field._meshPtr),
-    _counter(field._counter)
+    _counter(field._counter),
+    _interp(field._interp)
 {
 }
 
@@ -55,6 +128,7 @@ FieldRect3D::operator=(const FieldRect3D& field)
     _vmax = field._vmax;
     _meshPtr = field._meshPtr;
     _counter = field._counter;
+    _interp = field._interp;
     return *this;
 }
 
@@ -122,6 +196,9 @@ FieldRect3D::value(double x, double y, double z, double outside) const
 {
     double f0, f1, fy0, fy1, fz0, fz1;
 
+    if (_interp != LINEAR) {
+        return gradient(x, y, z, NULL, outside);
+    }
     if (!_meshPtr.isNull()) {
         CellRect3D cell = _meshPtr->locate(Node3D(x,y,z));
 
@@ -129,6 +206,11 @@ FieldRect3D::value(double x, double y, double z, double outside) const
         if (cell.isOutside()) {
             return outside;
         }
+        for (int n=0; n < 8; n++) {
+            if ((unsigned int)cell.nodeId(n) >= _valuelist.size()) {
+                return outside;
+            }
+        }
 
         // yuck! brute force...
         // interpolate x @ y0,z0
@@ -163,6 +245,105 @@ FieldRect3D::value(double x, double y, double z, double outside) const
     return outside;
 }
 
+/**
+ * Returns the value at (x,y,z) and stores the gradient
+ * (df/dx, df/dy, df/dz) in grad[0..2], computed analytically from
+ * the same interpolant as the value.  With LINEAR interpolation the
+ * gradient is the derivative of the trilinear function, so it is
+ * continuous within a cell but not across cell faces.  grad may be
+ * NULL to get the value alone.  Outside the mesh, or where a node
+ * around (x,y,z) has no value, returns the outside value and sets
+ * the gradient to NAN.
+ */
+double
+FieldRect3D::gradient(double x, double y, double z, double* grad,
+    double outside) const
+{
+    int ids[3][4];
+    double xs[3][4], w[3][4], dw[3][4];
+    double coord[3];
+
+    coord[0] = x; coord[1] = y; coord[2] = z;
+    for (int a=0; a < 3; a++) {
+        if (_meshPtr.isNull()
+              || !_meshPtr->locate((Axis)a, coord[a], ids[a], xs[a])) {
+            if (grad) {
+                grad[0] = grad[1] = grad[2] = NAN;
+            }
+            return outside;
+        }
+        _axisWeights(_interp, ids[a], xs[a], coord[a], w[a], dw[a]);
+    }
+    double f;
+    if (_sample(ids, w, dw, &f, grad) < 0) {
+        if (grad) {
+            grad[0] = grad[1] = grad[2] = NAN;
+        }
+        return outside;
+    }
+    return f;
+}
+
+/**
+ * Evaluates the field at npts points stored as (x,y,z) triples in
+ * xyz.  Values go into fvals, and if grads is not NULL, gradients go
+ * into grads as triples.  Successive points that fall in the same
+ * interval along an axis reuse the mesh lookup, so sampling along a
+ * streamline or a slice costs little more than the interpolation.
+ */
+void
+FieldRect3D::values(int npts, const double* xyz, double* fvals,
+    double* grads, double outside) const
+{
+    int ids[3][4];
+    double xs[3][4], w[3][4], dw[3][4];
+    int valid[3];
+
+    valid[0] = valid[1] = valid[2] = 0;
+    for (int n=0; n < npts; n++) {
+        const double* coord = xyz + 3*n;
+        double* grad = (grads) ? grads + 3*n : NULL;
+        int inside = !_meshPtr.isNull();
+
+        for (int a=0; a < 3 && inside; a++) {
+            double c = coord[a];
+            if (!valid[a] || !(c >= xs[a][1] && c <= xs[a][2])) {
+                valid[a] = _meshPtr->locate((Axis)a, c, ids[a], xs[a]);
+                inside = valid[a];
+            }
+            if (inside) {
+                _axisWeights(_interp, ids[a], xs[a], c, w[a], dw[a]);
+            }
+        }
+        if (!inside || _sample(ids, w, dw, &fvals[n], grad) < 0) {
+            fvals[n] = outside;
+            if (grad) {
+                grad[0] = grad[1] = grad[2] = NAN;
+            }
+        }
+    }
+}
+
+FieldRect3D::Interpolation
+FieldRect3D::interpolation() const
+{
+    return _interp;
+}
+
+/**
+ * Chooses how value(), gradient() and values() interpolate between
+ * nodes.  CUBIC uses a Catmull-Rom spline along each axis, which
+ * passes through the node values and has a continuous gradient; on
+ * a non-uniform mesh the tangents are central differences over the
+ * neighboring nodes, and one-sided at the ends of the mesh.
+ */
+FieldRect3D&
+FieldRect3D::interpolation(Interpolation mode)
+{
+    _interp = mode;
+    return *this;
+}
+
 double
 FieldRect3D::valueMin() const
 {
@@ -186,3 +367,125 @@ FieldRect3D::_interpolate(double x0, double y0, double x1, double y1,
     return (y1-y0)*((x-x0)/dx) + y0;
 }
 
+/**
+ * Sums the weighted node values over the 4x4x4 neighborhood found
+ * by gradient() or values() and stores the result in fval.  Nodes
+ * with zero weight (off the end of the mesh, or outside the cell for
+ * LINEAR) are skipped.  Returns -1 without touching fval or grad if
+ * a node that's needed has no value, or 0 if successful.
+ */
+int
+FieldRect3D::_sample(int ids[3][4], double w[3][4], double dw[3][4],
+    double* fval, double* grad) const
+{
+    int nx = _meshPtr->size(xaxis);
+    int nxy = nx*_meshPtr->size(yaxis);
+    int nvals = _valuelist.size();
+    double f = 0.0, fx = 0.0, fy = 0.0, fz = 0.0;
+
+    for (int k=0; k < 4; k++) {
+        if (w[2][k] == 0.0 && dw[2][k] == 0.0) {
+            continue;
+        }
+        for (int j=0; j < 4; j++) {
+            if (w[1][j] == 0.0 && dw[1][j] == 0.0) {
+                continue;
+            }
+            double wyz = w[1][j]*w[2][k];
+            double dyz = dw[1][j]*w[2][k];
+            double wdz = w[1][j]*dw[2][k];
+            int base = ids[2][k]*nxy + ids[1][j]*nx;
+
+            for (int i=0; i < 4; i++) {
+                if (w[0][i] == 0.0 && dw[0][i] == 0.0) {
+                    continue;
+                }
+                int node = base + ids[0][i];
+                if (node < 0 || node >= nvals) {
+                    return -1;
+                }
+                double fn = _valuelist[node];
+                f  += fn*w[0][i]*wyz;
+                fx += fn*dw[0][i]*wyz;
+                fy += fn*w[0][i]*dyz;
+                fz += fn*w[0][i]*wdz;
+            }
+        }
+    }
+    *fval = f;
+    if (grad) {
+        grad[0] = fx;
+        grad[1] = fy;
+        grad[2] = fz;
+    }
+    return 0;
+}
+
+Ptr<Serializable>
+FieldRect3D::create()
+{
+    return Ptr<Serializable>( (Serializable*) new FieldRect3D() );
+}
+
+void
+FieldRect3D::serialize_A(SerialBuffer& buffer) const
+{
+    if (_meshPtr.isNull()) {
+        buffer.writeChar('0');
+    } else {
+        buffer.writeChar('1');
+        _meshPtr->serialize_A(buffer);
+    }
+    buffer.writeDoubles((_valuelist.size() > 0) ? &_valuelist[0] : NULL,
+        _valuelist.size());
+    buffer.writeDouble(_vmin);
+    buffer.writeDouble(_vmax);
+    buffer.writeInt(_counter);
+}
+
+Outcome
+FieldRect3D::deserialize_A(SerialBuffer& buffer)
+{
+    Outcome status;
+
+    _meshPtr.clear();
+    if (buffer.readChar() == '1') {
+        _meshPtr = Ptr<MeshRect3D>( new MeshRect3D() );
+        status = _meshPtr->deserialize_A(buffer);
+        if (status != 0) {
+            return status.addContext("while deserializing FieldRect3D");
+        }
+    }
+    if (buffer.readDoubles(_valuelist) < 0) {
+        return status.error("can't deserialize FieldRect3D: corrupt value data");
+    }
+    _vmin = buffer.readDouble();
+    _vmax = buffer.readDouble();
+    _counter = buffer.readInt();
+
+    return status;
+}
+
+void
+FieldRect3D::serialize_B(SerialBuffer& buffer) const
+{
+    serialize_A(buffer);
+    buffer.writeInt(_interp);
+}
+
+Outcome
+FieldRect3D::deserialize_B(SerialBuffer& buffer)
+{
+    Outcome status = deserialize_A(buffer);
+    if (status != 0) {
+        return status;
+    }
+    int mode = buffer.readInt();
+    if (mode != LINEAR && mode != CUBIC) {
+        return status.error("can't deserialize FieldRect3D: "
+            "unknown interpolation mode");
+    }
+    _interp = (Interpolation)mode;
+
+    return status;
+}
@@ -1,9 +1,10 @@
 /*
  * ----------------------------------------------------------------------
  *  Rappture::FieldRect3D
- *    This is a continuous, linear function defined by a series of
- *    points on a 3D structured mesh.  It's a scalar field defined
- *    in 3D space.
+ *    This is a continuous function defined by a series of points
+ *    on a 3D structured mesh.  It's a scalar field defined in 3D
+ *    space, interpolated trilinearly or tricubically between the
+ *    points.
  *
  * ======================================================================
  *  AUTHOR:  Michael McLennan, Purdue University
@@ -23,8 +24,13 @@
 
 namespace Rappture {
 
-class FieldRect3D {
+class FieldRect3D : public Serializable {
 public:
+    enum Interpolation {
+        LINEAR=0,       // trilinear within each cell
+        CUBIC=1         // tricubic Catmull-Rom over 4x4x4 nodes
+    };
+
     FieldRect3D();
     FieldRect3D(const Mesh1D& xg, const Mesh1D& yg, const Mesh1D& zg);
     FieldRect3D(const FieldRect3D& field);
@@ -39,12 +45,30 @@ public:
     virtual FieldRect3D& define(int nodeId, double f);
     virtual double value(double x, double y, double z,
         double outside=NAN) const;
+    virtual double gradient(double x, double y, double z, double* grad,
+        double outside=NAN) const;
+    virtual void values(int npts, const double* xyz, double* fvals,
+        double* grads=NULL, double outside=NAN) const;
+    virtual Interpolation interpolation() const;
+    virtual FieldRect3D& interpolation(Interpolation mode);
     virtual double valueMin() const;
     virtual double valueMax() const;
 
+    // required for base class Serializable:
+    const char* serializerType() const { return "FieldRect3D"; }
+    char serializerVersion() const { return 'B'; }
+
+    static Ptr<Serializable> create();
+    void serialize_A(SerialBuffer& buffer) const;
+    Outcome deserialize_A(SerialBuffer& buffer);
+    void serialize_B(SerialBuffer& buffer) const;
+    Outcome deserialize_B(SerialBuffer& buffer);
+
 protected:
     virtual double _interpolate(double x0, double y0, double x1, double y1,
         double x) const;
+    virtual int _sample(int ids[3][4], double w[3][4], double dw[3][4],
+        double* fval, double* grad) const;
 
 private:
     std::vector<double> _valuelist; // list of all values, in nodeId order
@@ -52,6 +76,13 @@ private:
     double _vmax;                   // maximum value in _valuelist
     Ptr<MeshRect3D> _meshPtr;       // mesh for all (x,y,z) points
     int _counter;                   // counter for generating node IDs
+    Interpolation _interp;          // LINEAR or CUBIC
+
+    // methods for serializing/deserializing version 'A'
+    static SerialConversion versionA;
+
+    // methods for serializing/deserializing version 'B'
+    static SerialConversion versionB;
 };
 
 } // namespace Rappture
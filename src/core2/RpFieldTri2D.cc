@@ -17,6 +17,12 @@
 
 using namespace Rappture;
 
+// serialization version 'A' for FieldTri2D...
+SerialConversion FieldTri2D::versionA("FieldTri2D", 'A',
+    (Serializable::serializeObjectMethod)&FieldTri2D::serialize_A,
+    &FieldTri2D::create,
+    (Serializable::deserializeObjectMethod)&FieldTri2D::deserialize_A);
+
 FieldTri2D::FieldTri2D()
   : _valuelist(),
     _vmin(NAN),
@@ -136,6 +142,62 @@ FieldTri2D::value(double x, double y, double outside) const
     return outside;
 }
 
+/**
+ * Returns the value at (x,y) and stores the gradient (df/dx, df/dy)
+ * in grad[0..1].  The field is linear within each triangle, so the
+ * gradient is constant over a triangle and comes straight from the
+ * three node values.  grad may be NULL.  Outside the mesh, returns
+ * the outside value and sets the gradient to NAN.
+ */
+double
+FieldTri2D::gradient(double x, double y, double* grad, double outside) const
+{
+    if (!_meshPtr.isNull()) {
+        Node2D node(x,y);
+        CellTri2D cell = _meshPtr->locate(node);
+
+        if (!cell.isNull()) {
+            double phi[3];
+            cell.barycentrics(node, phi);
+
+            double f0 = _valuelist[cell.nodeId(0)];
+            double f1 = _valuelist[cell.nodeId(1)];
+            double f2 = _valuelist[cell.nodeId(2)];
+
+            if (grad) {
+                double x2 = cell.x(1) - cell.x(0);
+                double y2 = cell.y(1) - cell.y(0);
+                double x3 = cell.x(2) - cell.x(0);
+                double y3 = cell.y(2) - cell.y(0);
+                double det = x2*y3 - x3*y2;
+
+                grad[0] = ((f1-f0)*y3 - (f2-f0)*y2)/det;
+                grad[1] = ((f2-f0)*x2 - (f1-f0)*x3)/det;
+            }
+            return phi[0]*f0 + phi[1]*f1 + phi[2]*f2;
+        }
+    }
+    if (grad) {
+        grad[0] = grad[1] = NAN;
+    }
+    return outside;
+}
+
+/**
+ * Evaluates the field at npts points stored as (x,y) pairs in xy.
+ * Values go into fvals, and if grads is not NULL, gradients go into
+ * grads as pairs.
+ */
+void
+FieldTri2D::values(int npts, const double* xy, double* fvals,
+    double* grads, double outside) const
+{
+    for (int n=0; n < npts; n++) {
+        fvals[n] = gradient(xy[2*n], xy[2*n+1],
+            (grads) ? grads + 2*n : NULL, outside);
+    }
+}
+
 double
 FieldTri2D::valueMin() const
 {
@@ -147,3 +209,48 @@ FieldTri2D::valueMax() const
 {
     return _vmax;
 }
+
+Ptr<Serializable>
+FieldTri2D::create()
+{
+    return Ptr<Serializable>( (Serializable*) new FieldTri2D() );
+}
+
+void
+FieldTri2D::serialize_A(SerialBuffer& buffer) const
+{
+    if (_meshPtr.isNull()) {
+        buffer.writeChar('0');
+    } else {
+        buffer.writeChar('1');
+        _meshPtr->serialize_A(buffer);
+    }
+    buffer.writeDoubles((_valuelist.size() > 0) ? &_valuelist[0] : NULL,
+        _valuelist.size());
+    buffer.writeDouble(_vmin);
+    buffer.writeDouble(_vmax);
+    buffer.writeInt(_counter);
+}
+
+Outcome
+FieldTri2D::deserialize_A(SerialBuffer& buffer)
+{
+    Outcome status;
+
+    _meshPtr.clear();
+    if (buffer.readChar() == '1') {
+        _meshPtr = Ptr<MeshTri2D>( new MeshTri2D() );
+        status = _meshPtr->deserialize_A(buffer);
+        if (status != 0) {
+            return status.addContext("while deserializing FieldTri2D");
+        }
+    }
+    if (buffer.readDoubles(_valuelist) < 0) {
+        return status.error("can't deserialize FieldTri2D: corrupt value data");
+    }
+    _vmin = buffer.readDouble();
+    _vmax = buffer.readDouble();
+    _counter = buffer.readInt();
+
+    return status;
+}
@@ -23,7 +23,7 @@
 
 namespace Rappture {
 
-class FieldTri2D {
+class FieldTri2D : public Serializable {
 public:
     FieldTri2D();
     FieldTri2D(const MeshTri2D& grid);
@@ -38,15 +38,30 @@ public:
 
     virtual FieldTri2D& define(int nodeId, double f);
     virtual double value(double x, double y, double outside=NAN) const;
+    virtual double gradient(double x, double y, double* grad,
+        double outside=NAN) const;
+    virtual void values(int npts, const double* xy, double* fvals,
+        double* grads=NULL, double outside=NAN) const;
     virtual double valueMin() const;
     virtual double valueMax() const;
 
+    // required for base class Serializable:
+    const char* serializerType() const { return "FieldTri2D"; }
+    char serializerVersion() const { return 'A'; }
+
+    static Ptr<Serializable> create();
+    void serialize_A(SerialBuffer& buffer) const;
+    Outcome deserialize_A(SerialBuffer& buffer);
+
 private:
     std::vector<double> _valuelist; // list of all values, in nodeId order
     double _vmin;                   // minimum value in _valuelist
     double _vmax;                   // maximum value in _valuelist
     Ptr<MeshTri2D> _meshPtr;        // mesh for all (x,y) points
     int _counter;                   // counter for generating node IDs
+
+    // methods for serializing/deserializing version 'A'
+    static SerialConversion versionA;
 };
 
 } // namespace Rappture
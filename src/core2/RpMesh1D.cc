@@ -26,6 +26,13 @@ SerialConversion Mesh1D::versionA("Mesh1D", 'A',
     &Mesh1D::create,
     (Serializable::deserializeObjectMethod)&Mesh1D::deserialize_A);
 
+// serialization version 'B' for Mesh1D...
+// same content as 'A', but stored as contiguous arrays
+SerialConversion Mesh1D::versionB("Mesh1D", 'B',
+    (Serializable::serializeObjectMethod)&Mesh1D::serialize_B,
+    &Mesh1D::create,
+    (Serializable::deserializeObjectMethod)&Mesh1D::deserialize_B);
+
 
 Cell1D::Cell1D()
 {
@@ -264,6 +271,34 @@ Mesh1D::locate(const Node1D& node) const
     return rval;
 }
 
+/**
+ * Finds the interval containing x, along with one more node on
+ * either side, for interpolation schemes wider than linear.  Fills
+ * nodeIds and xs with the nodes at positions n-1, n, n+1, n+2 where
+ * n is the start of the interval.  Positions past either end of the
+ * mesh get a node ID of -1.  Returns 0 if x is outside the mesh.
+ */
+int
+Mesh1D::locate(double x, int* nodeIds, double* xs) const
+{
+    int n = _locateInterval(x);
+    if (n < 0) {
+        return 0;
+    }
+    int last = _nodelist.size()-1;
+    for (int i=0; i < 4; i++) {
+        int pos = n-1+i;
+        if (pos >= 0 && pos <= last) {
+            nodeIds[i] = _nodelist[pos].id();
+            xs[i] = _nodelist[pos].x();
+        } else {
+            nodeIds[i] = -1;
+            xs[i] = 0.0;
+        }
+    }
+    return 1;
+}
+
 int
 Mesh1D::_locateInterval(double x) const
 {
@@ -374,3 +409,47 @@ Mesh1D::deserialize_A(SerialBuffer& buffer)
 
     return status;
 }
+
+void
+Mesh1D::serialize_B(SerialBuffer& buffer) const
+{
+    std::vector<int> ids;
+    std::vector<double> xs;
+
+    ids.reserve(_nodelist.size());
+    xs.reserve(_nodelist.size());
+
+    std::deque<Node1D>::const_iterator iter = _nodelist.begin();
+    while (iter != _nodelist.end()) {
+        ids.push_back( (*iter).id() );
+        xs.push_back( (*iter).x() );
+        ++iter;
+    }
+    buffer.writeInts((ids.size() > 0) ? &ids[0] : NULL, ids.size());
+    buffer.writeDoubles((xs.size() > 0) ? &xs[0] : NULL, xs.size());
+    buffer.writeInt(_counter);
+}
+
+Outcome
+Mesh1D::deserialize_B(SerialBuffer& buffer)
+{
+    Outcome status;
+    Node1D newnode(0.0);
+    std::vector<int> ids;
+    std::vector<double> xs;
+
+    clear();
+    if (buffer.readInts(ids) < 0 || buffer.readDoubles(xs) < 0
+          || ids.size() != xs.size()) {
+        return status.error("can't deserialize Mesh1D: corrupt node data");
+    }
+    for (unsigned int n=0; n < ids.size(); n++) {
+        newnode.id( ids[n] );
+        newnode.x( xs[n] );
+        _nodelist.push_back(newnode);
+    }
+    _counter = buffer.readInt();
+    _id2nodeDirty = 1;
+
+    return status;
+}
@@ -57,14 +57,17 @@ public:
     virtual double rangeMax() const;
 
     virtual Cell1D locate(const Node1D& node) const;
+    virtual int locate(double x, int* nodeIds, double* xs) const;
 
     // required for base class Serializable:
     const char* serializerType() const { return "Mesh1D"; }
-    char serializerVersion() const { return 'A'; }
+    char serializerVersion() const { return 'B'; }
 
     void serialize_A(SerialBuffer& buffer) const;
     static Ptr<Serializable> create();
     Outcome deserialize_A(SerialBuffer& buffer);
+    void serialize_B(SerialBuffer& buffer) const;
+    Outcome deserialize_B(SerialBuffer& buffer);
 
 protected:
     virtual int _locateInterval(double x) const;
@@ -79,6 +82,9 @@ private:
 
     // methods for serializing/deserializing version 'A'
     static SerialConversion versionA;
+
+    // methods for serializing/deserializing version 'B'
+    static SerialConversion versionB;
 };
 
 } // namespace Rappture
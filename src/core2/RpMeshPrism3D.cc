@@ -17,6 +17,12 @@
 
 using namespace Rappture;
 
+// serialization version 'A' for MeshPrism3D...
+SerialConversion MeshPrism3D::versionA("MeshPrism3D", 'A',
+    (Serializable::serializeObjectMethod)&MeshPrism3D::serialize_A,
+    &MeshPrism3D::create,
+    (Serializable::deserializeObjectMethod)&MeshPrism3D::deserialize_A);
+
 CellPrism3D::CellPrism3D()
 {
     for (int i=0; i < 6; i++) {
@@ -163,3 +169,31 @@ MeshPrism3D::locate(const Node3D& node) const
     }
     return result;
 }
+
+Ptr<Serializable>
+MeshPrism3D::create()
+{
+    return Ptr<Serializable>( (Serializable*) new MeshPrism3D() );
+}
+
+void
+MeshPrism3D::serialize_A(SerialBuffer& buffer) const
+{
+    _xymesh.serialize_A(buffer);
+    _zmesh.serialize_B(buffer);
+}
+
+Outcome
+MeshPrism3D::deserialize_A(SerialBuffer& buffer)
+{
+    Outcome status;
+
+    status = _xymesh.deserialize_A(buffer);
+    if (status == 0) {
+        status = _zmesh.deserialize_B(buffer);
+    }
+    if (status != 0) {
+        return status.addContext("while deserializing MeshPrism3D");
+    }
+    return status;
+}
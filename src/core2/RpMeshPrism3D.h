@@ -39,7 +39,7 @@ private:
     double _z[6];
 };
 
-class MeshPrism3D {
+class MeshPrism3D : public Serializable {
 public:
     MeshPrism3D();
     MeshPrism3D(const MeshTri2D& xym, const Mesh1D& zm);
@@ -56,9 +56,16 @@ public:
     const char* serializerType() const { return "MeshPrism3D"; }
     char serializerVersion() const { return 'A'; }
 
+    static Ptr<Serializable> create();
+    void serialize_A(SerialBuffer& buffer) const;
+    Outcome deserialize_A(SerialBuffer& buffer);
+
 private:
     MeshTri2D _xymesh;  // triangular mesh in x/y axes
     Mesh1D _zmesh;      // mesh along z-axis
+
+    // methods for serializing/deserializing version 'A'
+    static SerialConversion versionA;
 };
 
 } // namespace Rappture
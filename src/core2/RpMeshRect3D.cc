@@ -17,6 +17,12 @@
 
 using namespace Rappture;
 
+// serialization version 'A' for MeshRect3D...
+SerialConversion MeshRect3D::versionA("MeshRect3D", 'A',
+    (Serializable::serializeObjectMethod)&MeshRect3D::serialize_A,
+    &MeshRect3D::create,
+    (Serializable::deserializeObjectMethod)&MeshRect3D::deserialize_A);
+
 CellRect3D::CellRect3D()
 {
     for (int i=0; i < 8; i++) {
@@ -208,3 +214,41 @@ MeshRect3D::locate(const Node3D& node) const
     }
     return result;
 }
+
+/**
+ * Finds the 4-node neighborhood of x along one axis.  See
+ * Mesh1D::locate(double, int*, double*).
+ */
+int
+MeshRect3D::locate(Axis which, double x, int* nodeIds, double* xs) const
+{
+    return _axis[which].locate(x, nodeIds, xs);
+}
+
+Ptr<Serializable>
+MeshRect3D::create()
+{
+    return Ptr<Serializable>( (Serializable*) new MeshRect3D() );
+}
+
+void
+MeshRect3D::serialize_A(SerialBuffer& buffer) const
+{
+    for (int i=0; i < 3; i++) {
+        _axis[i].serialize_B(buffer);
+    }
+}
+
+Outcome
+MeshRect3D::deserialize_A(SerialBuffer& buffer)
+{
+    Outcome status;
+
+    for (int i=0; i < 3; i++) {
+        status = _axis[i].deserialize_B(buffer);
+        if (status != 0) {
+            return status.addContext("while deserializing MeshRect3D");
+        }
+    }
+    return status;
+}
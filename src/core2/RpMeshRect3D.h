@@ -39,7 +39,7 @@ private:
     double _z[8];
 };
 
-class MeshRect3D {
+class MeshRect3D : public Serializable {
 public:
     MeshRect3D();
     MeshRect3D(const Mesh1D& xm, const Mesh1D& ym, const Mesh1D& zm);
@@ -58,13 +58,21 @@ public:
     virtual double rangeMax(Axis which) const;
 
     virtual CellRect3D locate(const Node3D& node) const;
+    virtual int locate(Axis which, double x, int* nodeIds, double* xs) const;
 
     // required for base class Serializable:
     const char* serializerType() const { return "MeshRect3D"; }
     char serializerVersion() const { return 'A'; }
 
+    static Ptr<Serializable> create();
+    void serialize_A(SerialBuffer& buffer) const;
+    Outcome deserialize_A(SerialBuffer& buffer);
+
 private:
     Mesh1D _axis[3];  // mesh along x-, y-, and z-axes
+
+    // methods for serializing/deserializing version 'A'
+    static SerialConversion versionA;
 };
 
 } // namespace Rappture
@@ -21,6 +21,12 @@
 
 using namespace Rappture;
 
+// serialization version 'A' for MeshTri2D...
+SerialConversion MeshTri2D::versionA("MeshTri2D", 'A',
+    (Serializable::serializeObjectMethod)&MeshTri2D::serialize_A,
+    &MeshTri2D::create,
+    (Serializable::deserializeObjectMethod)&MeshTri2D::deserialize_A);
+
 CellTri2D::CellTri2D()
 {
     _cellId = -1;
@@ -277,6 +283,10 @@ MeshTri2D::clear()
 {
     _nodelist.clear();
     _counter = 0;
+    _min[0] = _min[1] = NAN;
+    _max[0] = _max[1] = NAN;
+    _celllist.clear();
+    _edge2neighbor.clear();
     _id2nodeDirty = 0;
     _id2node.assign(100, -1);
     _lastLocate.clear();
@@ -392,12 +402,65 @@ MeshTri2D::create()
 void
 MeshTri2D::serialize_A(SerialBuffer& buffer) const
 {
+    int nnodes = _nodelist.size();
+    std::vector<int> ids(nnodes);
+    std::vector<double> xs(nnodes);
+    std::vector<double> ys(nnodes);
+
+    for (int n=0; n < nnodes; n++) {
+        ids[n] = _nodelist[n].id();
+        xs[n] = _nodelist[n].x();
+        ys[n] = _nodelist[n].y();
+    }
+    buffer.writeInts((nnodes > 0) ? &ids[0] : NULL, nnodes);
+    buffer.writeDoubles((nnodes > 0) ? &xs[0] : NULL, nnodes);
+    buffer.writeDoubles((nnodes > 0) ? &ys[0] : NULL, nnodes);
+
+    int ncells = _celllist.size();
+    std::vector<int> cells(3*ncells);
+    for (int n=0; n < ncells; n++) {
+        cells[3*n]   = _celllist[n].nodes[0];
+        cells[3*n+1] = _celllist[n].nodes[1];
+        cells[3*n+2] = _celllist[n].nodes[2];
+    }
+    buffer.writeInts((ncells > 0) ? &cells[0] : NULL, 3*ncells);
+    buffer.writeInt(_counter);
 }
 
 Outcome
-deserialize_A(SerialBuffer& buffer)
+MeshTri2D::deserialize_A(SerialBuffer& buffer)
 {
     Outcome status;
+    std::vector<int> ids;
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<int> cells;
+
+    clear();
+    if (buffer.readInts(ids) < 0 || buffer.readDoubles(xs) < 0
+          || buffer.readDoubles(ys) < 0
+          || ids.size() != xs.size() || ids.size() != ys.size()) {
+        return status.error("can't deserialize MeshTri2D: corrupt node data");
+    }
+    if (buffer.readInts(cells) < 0 || cells.size() % 3 != 0) {
+        return status.error("can't deserialize MeshTri2D: corrupt cell data");
+    }
+
+    _nodelist.reserve(ids.size());
+    for (unsigned int n=0; n < ids.size(); n++) {
+        Node2D node(xs[n], ys[n]);
+        node.id(ids[n]);
+        _nodelist.push_back(node);
+    }
+    _id2nodeDirty = 1;
+    _rebuildNodeIdMap();
+
+    _celllist.reserve(cells.size()/3);
+    for (unsigned int n=0; n < cells.size(); n += 3) {
+        addCell(cells[n], cells[n+1], cells[n+2]);
+    }
+    _counter = buffer.readInt();
+
     return status;
 }
 
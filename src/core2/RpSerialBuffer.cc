@@ -11,6 +11,8 @@
  *  redistribution of this file, and for a DISCLAIMER OF ALL WARRANTIES.
  * ======================================================================
  */
+#include <string.h>
+#include <stdint.h>
 #include "RpSerialBuffer.h"
 
 #ifdef BIGENDIAN
@@ -28,7 +30,8 @@ using namespace Rappture;
  */
 SerialBuffer::SerialBuffer()
   : _buffer(),
-    _pos(0)
+    _pos(0),
+    _version('B')
 {
 }
 
@@ -39,13 +42,13 @@ SerialBuffer::SerialBuffer()
  * @param bytes pointer to bytes being decoded.
  * @param nbytes number of bytes being decoded.
  */
-SerialBuffer::SerialBuffer(const char* bytes, int nbytes)
+SerialBuffer::SerialBuffer(const char* bytes, size_t nbytes)
   : _buffer(),
-    _pos(0)
+    _pos(0),
+    _version('B')
 {
-    _buffer.reserve(nbytes);
-    while (nbytes-- > 0) {
-        _buffer.push_back( *bytes++ );
+    if (nbytes > 0) {
+        _buffer.assign(bytes, bytes+nbytes);
     }
 }
 
@@ -54,7 +57,8 @@ SerialBuffer::SerialBuffer(const char* bytes, int nbytes)
  */
 SerialBuffer::SerialBuffer(const SerialBuffer& sb)
   : _buffer(sb._buffer),
-    _pos(0)  // auto-rewind
+    _pos(0),  // auto-rewind
+    _version(sb._version)
 {
 }
 
@@ -66,6 +70,7 @@ SerialBuffer::operator=(const SerialBuffer& sb)
 {
     _buffer = sb._buffer;
     _pos = 0;  // auto-rewind
+    _version = sb._version;
     return *this;
 }
 
@@ -90,12 +95,33 @@ SerialBuffer::bytes() const
  * Get the number of bytes currently stored in the buffer.
  * @return Number of the bytes in the buffer.
  */
-int
+size_t
 SerialBuffer::size() const
 {
     return _buffer.size();
 }
 
+/**
+ * Get the version of the stream layout used to read arrays.
+ * @return 'B' for the current layout, or 'A' for older streams.
+ */
+char
+SerialBuffer::version() const
+{
+    return _version;
+}
+
+/**
+ * Set the version of the stream layout used to read arrays.  The
+ * Serializer sets this from the marker at the start of a stream.
+ */
+SerialBuffer&
+SerialBuffer::version(char v)
+{
+    _version = v;
+    return *this;
+}
+
 /**
  * Clear the buffer, making it empty.
  */
@@ -151,12 +177,64 @@ SerialBuffer&
 SerialBuffer::writeBytes(const char* bval, int nbytes)
 {
     writeInt(nbytes);
-    while (nbytes-- > 0) {
-        _buffer.push_back(*bval++);
+    if (nbytes > 0) {
+        _buffer.insert(_buffer.end(), bval, bval+nbytes);
     }
     return *this;
 }
 
+/**
+ * Write a size or count as a 64-bit value.
+ */
+SerialBuffer&
+SerialBuffer::writeSize(size_t nval)
+{
+    uint64_t val = nval;
+    char *ptr = (char*)(&val);
+    int i = 0;
+
+    ENDIAN_FOR_LOOP(i, (int)sizeof(uint64_t)) {
+        _buffer.push_back(ptr[i]);
+    }
+    return *this;
+}
+
+/**
+ * Write an array of chars as a count followed by the bytes.  Unlike
+ * writeBytes(), the count is 64 bits.
+ */
+SerialBuffer&
+SerialBuffer::writeChars(const char* cvals, size_t nvals)
+{
+    writeSize(nvals);
+    _writeArray(cvals, nvals, sizeof(char));
+    return *this;
+}
+
+/**
+ * Write an array of ints as a count followed by the values.  Like
+ * all other values in the buffer, they are stored little-endian, so
+ * on most machines this is a single memcpy.
+ */
+SerialBuffer&
+SerialBuffer::writeInts(const int* ivals, size_t nvals)
+{
+    writeSize(nvals);
+    _writeArray(ivals, nvals, sizeof(int));
+    return *this;
+}
+
+/**
+ * Write an array of doubles as a count followed by the values.
+ */
+SerialBuffer&
+SerialBuffer::writeDoubles(const double* dvals, size_t nvals)
+{
+    writeSize(nvals);
+    _writeArray(dvals, nvals, sizeof(double));
+    return *this;
+}
+
 void
 SerialBuffer::rewind()
 {
@@ -166,14 +244,14 @@ SerialBuffer::rewind()
 int
 SerialBuffer::atEnd() const
 {
-    return ((unsigned int)_pos >= _buffer.size());
+    return (_pos >= _buffer.size());
 }
 
 char
 SerialBuffer::readChar()
 {
     char c = '\0';
-    if ((unsigned int)_pos < _buffer.size()) {
+    if (_pos < _buffer.size()) {
         c = _buffer[_pos++];
     }
     return c;
@@ -187,7 +265,7 @@ SerialBuffer::readInt()
     unsigned int i = 0;
 
     ENDIAN_FOR_LOOP(i, sizeof(int)) {
-        if ((unsigned int)_pos < _buffer.size()) {
+        if (_pos < _buffer.size()) {
             ptr[i] = _buffer[_pos++];
         }
     }
@@ -202,7 +280,7 @@ SerialBuffer::readDouble()
     unsigned int i = 0;
 
     ENDIAN_FOR_LOOP(i, sizeof(double)) {
-        if ((unsigned int)_pos < _buffer.size()) {
+        if (_pos < _buffer.size()) {
             ptr[i] = _buffer[_pos++];
         }
     }
@@ -214,7 +292,7 @@ SerialBuffer::readString()
 {
     std::string sval;
     char c;
-    while ((unsigned int)_pos < _buffer.size()) {
+    while (_pos < _buffer.size()) {
         c = _buffer[_pos++];
         if (c == '\0') {
             break;
@@ -232,8 +310,174 @@ SerialBuffer::readBytes()
     std::vector<char> bval;
 
     nbytes = readInt();
-    while ((unsigned int)_pos < _buffer.size() && nbytes-- > 0) {
-        bval.push_back( _buffer[_pos++] );
+    if (nbytes > 0) {
+        if ((unsigned int)nbytes > _buffer.size() - _pos) {
+            nbytes = _buffer.size() - _pos;
+        }
+        bval.assign(_buffer.begin()+_pos, _buffer.begin()+_pos+nbytes);
+        _pos += nbytes;
     }
     return bval;
 }
+
+/**
+ * Read a size or count written by writeSize().
+ */
+size_t
+SerialBuffer::readSize()
+{
+    uint64_t val = 0;
+    char *ptr = (char*)(&val);
+    int i = 0;
+
+    ENDIAN_FOR_LOOP(i, (int)sizeof(uint64_t)) {
+        if (_pos < _buffer.size()) {
+            ptr[i] = _buffer[_pos++];
+        }
+    }
+    return (size_t)val;
+}
+
+/**
+ * Read an array written by writeChars().  The array is replaced with
+ * the bytes read.
+ *
+ * @return 0 if successful, or -1 if the buffer is too short to
+ *         hold the array.
+ */
+int
+SerialBuffer::readChars(std::vector<char>& cvals)
+{
+    size_t nvals = _readCount();
+    cvals.clear();
+    if (_checkArray(nvals, sizeof(char)) < 0) {
+        return -1;
+    }
+    cvals.resize(nvals);
+    _readArray((nvals > 0) ? &cvals[0] : NULL, nvals, sizeof(char));
+    return 0;
+}
+
+/**
+ * Read an array written by writeInts().  The array is replaced with
+ * the values read.
+ *
+ * @return 0 if successful, or -1 if the buffer is too short to
+ *         hold the array.
+ */
+int
+SerialBuffer::readInts(std::vector<int>& ivals)
+{
+    size_t nvals = _readCount();
+    ivals.clear();
+    if (_checkArray(nvals, sizeof(int)) < 0) {
+        return -1;
+    }
+    ivals.resize(nvals);
+    _readArray((nvals > 0) ? &ivals[0] : NULL, nvals, sizeof(int));
+    return 0;
+}
+
+/**
+ * Read an array written by writeDoubles().  The array is replaced
+ * with the values read.
+ *
+ * @return 0 if successful, or -1 if the buffer is too short to
+ *         hold the array.
+ */
+int
+SerialBuffer::readDoubles(std::vector<double>& dvals)
+{
+    size_t nvals = _readCount();
+    dvals.clear();
+    if (_checkArray(nvals, sizeof(double)) < 0) {
+        return -1;
+    }
+    dvals.resize(nvals);
+    _readArray((nvals > 0) ? &dvals[0] : NULL, nvals, sizeof(double));
+    return 0;
+}
+
+/*
+ * Arrays start at an offset that is a multiple of the element size,
+ * padded with zeros after the count.  A stream written to a file and
+ * mapped into memory (see SerialMap) can then be used in place.
+ */
+void
+SerialBuffer::_writeArray(const void* vals, size_t nvals, size_t size)
+{
+    if (nvals == 0) {
+        return;
+    }
+    size_t start = _buffer.size();
+    start += (size - start % size) % size;
+    _buffer.resize(start + nvals*size, '\0');
+    char *dest = &_buffer[start];
+#ifdef BIGENDIAN
+    const char *src = (const char*)vals;
+    for (size_t n=0; n < nvals; n++, src += size) {
+        for (size_t i=0; i < size; i++) {
+            *dest++ = src[size-1-i];
+        }
+    }
+#else
+    memcpy(dest, vals, nvals*size);
+#endif
+}
+
+/*
+ * Reads the count in front of an array.  Version 'A' counts are
+ * ints; a negative one comes back huge and fails _checkArray().
+ */
+size_t
+SerialBuffer::_readCount()
+{
+    if (_version == 'A') {
+        return (size_t)(long)readInt();
+    }
+    return readSize();
+}
+
+/*
+ * Skips the padding in front of an array of nvals values and makes
+ * sure they all fit in what's left of the buffer.  Returns -1 and
+ * moves to the end of the buffer if they don't, so a corrupt count
+ * is caught before anything is allocated for it.
+ */
+int
+SerialBuffer::_checkArray(size_t nvals, size_t size)
+{
+    if (nvals == 0) {
+        return 0;
+    }
+    if (_version != 'A') {
+        _pos += (size - _pos % size) % size;
+    }
+    if (_pos > _buffer.size()
+          || nvals > (_buffer.size() - _pos) / size) {
+        _pos = _buffer.size();
+        return -1;
+    }
+    return 0;
+}
+
+void
+SerialBuffer::_readArray(void* vals, size_t nvals, size_t size)
+{
+    if (nvals == 0) {
+        return;
+    }
+    size_t nbytes = nvals*size;
+    const char *src = &_buffer[_pos];
+#ifdef BIGENDIAN
+    char *dest = (char*)vals;
+    for (size_t n=0; n < nvals; n++, dest += size) {
+        for (size_t i=0; i < size; i++) {
+            dest[size-1-i] = *src++;
+        }
+    }
+#else
+    memcpy(vals, src, nbytes);
+#endif
+    _pos += nbytes;
+}
@@ -23,18 +23,28 @@ namespace Rappture {
  * Used by the Serializer to build up the buffer of serialized
  * data.  Similar to a string, but it handles nulls and other
  * control characters.  Also handles big/little endian order
- * properly.
+ * properly.  Arrays written with writeInts() and writeDoubles()
+ * are aligned to their element size within the buffer.  Sizes
+ * and array counts are stored as 64-bit values, so neither the
+ * buffer nor a single array is limited to 2GB.
+ *
+ * That layout is version 'B' of the stream.  Streams of version 'A'
+ * stored array counts as ints and didn't pad the arrays; a buffer
+ * set to version 'A' reads arrays that way.  Writing always uses
+ * the current version.
  */
 class SerialBuffer {
 public:
     SerialBuffer();
-    SerialBuffer(const char* bytes, int nbytes);
+    SerialBuffer(const char* bytes, size_t nbytes);
     SerialBuffer(const SerialBuffer& buffer);
     SerialBuffer& operator=(const SerialBuffer& buffer);
     virtual ~SerialBuffer();
 
     const char* bytes() const;
-    int size() const;
+    size_t size() const;
+    char version() const;
+    SerialBuffer& version(char v);
 
     SerialBuffer& clear();
     SerialBuffer& writeChar(char cval);
@@ -42,6 +52,10 @@ public:
     SerialBuffer& writeDouble(double dval);
     SerialBuffer& writeString(const char* sval);
     SerialBuffer& writeBytes(const char* bval, int nbytes);
+    SerialBuffer& writeSize(size_t nval);
+    SerialBuffer& writeChars(const char* cvals, size_t nvals);
+    SerialBuffer& writeInts(const int* ivals, size_t nvals);
+    SerialBuffer& writeDoubles(const double* dvals, size_t nvals);
 
     void rewind();
     int atEnd() const;
@@ -50,13 +64,25 @@ public:
     double readDouble();
     std::string readString();
     std::vector<char> readBytes();
+    size_t readSize();
+    int readChars(std::vector<char>& cvals);
+    int readInts(std::vector<int>& ivals);
+    int readDoubles(std::vector<double>& dvals);
 
 private:
+    void _writeArray(const void* vals, size_t nvals, size_t size);
+    size_t _readCount();
+    int _checkArray(size_t nvals, size_t size);
+    void _readArray(void* vals, size_t nvals, size_t size);
+
     /// Contains the actual data within this buffer.
     std::vector<char> _buffer;
 
     /// Position for the various readXyz() functions.
-    int _pos;
+    size_t _pos;
+
+    /// Layout of arrays being read: 'A' or 'B'.
+    char _version;
 };
 
 } // namespace Rappture
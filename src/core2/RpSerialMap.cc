@@ -0,0 +1,394 @@
+/*
+ * ----------------------------------------------------------------------
+ *  Rappture::SerialMap
+ *    Maps a file holding a Serializer stream into memory and gives
+ *    read-only access to the meshes and fields inside without
+ *    copying them.
+ *
+ * ======================================================================
+ *  Copyright (c) 2004-2012  HUBzero Foundation, LLC
+ *
+ *  See the file "license.terms" for information on usage and
+ *  redistribution of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ * ======================================================================
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sstream>
+#include "RpSerialMap.h"
+
+using namespace Rappture;
+
+/**
+ * Walks through the mapped bytes the same way SerialBuffer reads
+ * them, but hands back pointers into the file for arrays instead of
+ * copying them.  Reading past the end sets the error flag and
+ * returns zero values, so callers can check once at the end.
+ */
+class SerialCursor {
+public:
+    SerialCursor(const char* bytes, size_t nbytes)
+        : _bytes(bytes), _nbytes(nbytes), _pos(0), _error(0) {}
+
+    int error() const { return _error; }
+    int atEnd() const { return (_pos >= _nbytes); }
+
+    char readChar();
+    int readInt();
+    double readDouble();
+    size_t readSize();
+    std::string readString();
+    template <class Type> SerialArray<Type> readArray();
+
+private:
+    const char* _take(size_t nbytes);
+
+    const char* _bytes;
+    size_t _nbytes;
+    size_t _pos;
+    int _error;
+};
+
+const char*
+SerialCursor::_take(size_t nbytes)
+{
+    if (_error || nbytes > _nbytes - _pos) {
+        _error = 1;
+        _pos = _nbytes;
+        return NULL;
+    }
+    const char* ptr = _bytes + _pos;
+    _pos += nbytes;
+    return ptr;
+}
+
+char
+SerialCursor::readChar()
+{
+    const char* ptr = _take(1);
+    return (ptr) ? *ptr : '\0';
+}
+
+int
+SerialCursor::readInt()
+{
+    const char* ptr = _take(sizeof(int));
+    return (ptr) ? SerialArray<int>(ptr, 1)[0] : 0;
+}
+
+double
+SerialCursor::readDouble()
+{
+    const char* ptr = _take(sizeof(double));
+    return (ptr) ? SerialArray<double>(ptr, 1)[0] : 0.0;
+}
+
+size_t
+SerialCursor::readSize()
+{
+    const char* ptr = _take(sizeof(uint64_t));
+    return (ptr) ? (size_t)SerialArray<uint64_t>(ptr, 1)[0] : 0;
+}
+
+std::string
+SerialCursor::readString()
+{
+    if (_error) {
+        return std::string();
+    }
+    const char* start = _bytes + _pos;
+    const char* end = (const char*)memchr(start, '\0', _nbytes - _pos);
+    if (end == NULL) {
+        _error = 1;
+        _pos = _nbytes;
+        return std::string();
+    }
+    _pos += (end - start) + 1;
+    return std::string(start, end - start);
+}
+
+/**
+ * Reads an array written by SerialBuffer::writeInts() or
+ * writeDoubles(), skipping the same alignment padding.
+ */
+template <class Type>
+SerialArray<Type>
+SerialCursor::readArray()
+{
+    size_t nvals = readSize();
+    if (_error || nvals == 0) {
+        return SerialArray<Type>();
+    }
+    size_t pad = (sizeof(Type) - _pos % sizeof(Type)) % sizeof(Type);
+    if (_take(pad) == NULL) {
+        return SerialArray<Type>();
+    }
+    if (nvals > (_nbytes - _pos) / sizeof(Type)) {
+        _error = 1;
+        _pos = _nbytes;
+        return SerialArray<Type>();
+    }
+    const char* ptr = _take(nvals*sizeof(Type));
+    if (ptr == NULL) {
+        return SerialArray<Type>();
+    }
+    return SerialArray<Type>(ptr, nvals);
+}
+
+static Outcome _mapObject(SerialCursor& cursor, MappedObject& obj);
+
+SerialMap::SerialMap()
+  : _bytes(NULL),
+    _nbytes(0)
+{
+}
+
+SerialMap::~SerialMap()
+{
+    close();
+}
+
+/**
+ * Maps a file written from Serializer::serialize() and indexes the
+ * objects in it.  Only the uncompressed format can be mapped, since
+ * a compressed stream has to be inflated into memory anyway.
+ */
+Outcome
+SerialMap::open(const char* fileName)
+{
+    Outcome result;
+    struct stat info;
+
+    close();
+
+    int fd = ::open(fileName, O_RDONLY);
+    if (fd < 0) {
+        std::string errmsg("can't open file \"");
+        errmsg += fileName;
+        errmsg += "\": ";
+        errmsg += strerror(errno);
+        return result.error(errmsg.data());
+    }
+    if (fstat(fd, &info) < 0 || info.st_size == 0) {
+        ::close(fd);
+        std::string errmsg("can't map file \"");
+        errmsg += fileName;
+        errmsg += "\": file is empty";
+        return result.error(errmsg.data());
+    }
+    void* addr = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        std::string errmsg("can't map file \"");
+        errmsg += fileName;
+        errmsg += "\": ";
+        errmsg += strerror(errno);
+        return result.error(errmsg.data());
+    }
+    _bytes = (const char*)addr;
+    _nbytes = info.st_size;
+
+    SerialCursor cursor(_bytes, _nbytes);
+    std::string token = cursor.readString();
+    if (token == "RpSerial:Z" || token == "RpSerial:ZB") {
+        close();
+        std::string errmsg("can't map file \"");
+        errmsg += fileName;
+        errmsg += "\": compressed streams must be loaded with a Serializer";
+        return result.error(errmsg.data());
+    }
+    if (token == "RpSerial:A") {
+        // arrays weren't aligned before version B, so can't be mapped
+        close();
+        std::string errmsg("can't map file \"");
+        errmsg += fileName;
+        errmsg += "\": streams older than RpSerial:B must be loaded ";
+        errmsg += "with a Serializer";
+        return result.error(errmsg.data());
+    }
+    if (token != "RpSerial:B") {
+        close();
+        std::string errmsg("can't map file \"");
+        errmsg += fileName;
+        errmsg += "\": bad marker \"";
+        errmsg += token;
+        errmsg += "\" (should be RpSerial:B)";
+        return result.error(errmsg.data());
+    }
+
+    int nobj = cursor.readInt();
+    if (nobj < 0) {
+        close();
+        std::string errmsg("can't map file: ");
+        errmsg += "corrupt data (number of objects is negative)";
+        return result.error(errmsg.data());
+    }
+
+    _objects.resize(nobj);
+    for (int i=0; i < nobj; i++) {
+        result = _mapObject(cursor, _objects[i]);
+        if (result != 0) {
+            close();
+            std::ostringstream context;
+            context << "while mapping object #" << i+1 << " of " << nobj
+              << " from file \"" << fileName << "\"";
+            return result.addContext(context.str().data());
+        }
+    }
+    return result;
+}
+
+/**
+ * Unmaps the file.  Any views obtained from at() are invalid after
+ * this.
+ */
+void
+SerialMap::close()
+{
+    if (_bytes) {
+        munmap((void*)_bytes, _nbytes);
+    }
+    _bytes = NULL;
+    _nbytes = 0;
+    _objects.clear();
+}
+
+int
+SerialMap::size() const
+{
+    return _objects.size();
+}
+
+const MappedObject&
+SerialMap::at(int pos) const
+{
+    assert(pos >= 0 && (unsigned int)pos < _objects.size());
+    return _objects[pos];
+}
+
+static void
+_mapMesh1D(SerialCursor& cursor, MappedMesh1D& mesh)
+{
+    mesh.ids = cursor.readArray<int>();
+    mesh.x = cursor.readArray<double>();
+    mesh.counter = cursor.readInt();
+}
+
+static void
+_mapMeshTri2D(SerialCursor& cursor, MappedMeshTri2D& mesh)
+{
+    mesh.ids = cursor.readArray<int>();
+    mesh.x = cursor.readArray<double>();
+    mesh.y = cursor.readArray<double>();
+    mesh.cells = cursor.readArray<int>();
+    mesh.counter = cursor.readInt();
+}
+
+static void
+_mapMeshRect3D(SerialCursor& cursor, MappedMeshRect3D& mesh)
+{
+    for (int i=0; i < 3; i++) {
+        _mapMesh1D(cursor, mesh.axis[i]);
+    }
+}
+
+static void
+_mapMeshPrism3D(SerialCursor& cursor, MappedMeshPrism3D& mesh)
+{
+    _mapMeshTri2D(cursor, mesh.xymesh);
+    _mapMesh1D(cursor, mesh.zmesh);
+}
+
+static void
+_mapFieldValues(SerialCursor& cursor, MappedField& field)
+{
+    field.values = cursor.readArray<double>();
+    field.vmin = cursor.readDouble();
+    field.vmax = cursor.readDouble();
+    field.counter = cursor.readInt();
+}
+
+/**
+ * Reads one "RpObj:" entry.  The stream doesn't record the size of
+ * each object, so an object that can't be mapped stops the whole
+ * file from being mapped.
+ */
+static Outcome
+_mapObject(SerialCursor& cursor, MappedObject& obj)
+{
+    Outcome result;
+
+    std::string token = cursor.readString();
+    if (token != "RpObj:") {
+        std::string errmsg("can't map stream: ");
+        errmsg += "bad marker \"";
+        errmsg += token;
+        errmsg += "\" (should be RpObj:)";
+        return result.error(errmsg.data());
+    }
+    obj.id = cursor.readString();
+    obj.type = cursor.readString();
+    obj.version = cursor.readChar();
+
+    int known = 1;
+    if (obj.type == "Mesh1D" && obj.version == 'B') {
+        _mapMesh1D(cursor, obj.mesh1D);
+    } else if (obj.type == "MeshTri2D" && obj.version == 'A') {
+        _mapMeshTri2D(cursor, obj.meshTri2D);
+    } else if (obj.type == "MeshRect3D" && obj.version == 'A') {
+        _mapMeshRect3D(cursor, obj.meshRect3D);
+    } else if (obj.type == "MeshPrism3D" && obj.version == 'A') {
+        _mapMeshPrism3D(cursor, obj.meshPrism3D);
+    } else if (obj.type == "Field1D" && obj.version == 'A') {
+        obj.field.hasMesh = (cursor.readChar() == '1');
+        if (obj.field.hasMesh) {
+            _mapMesh1D(cursor, obj.mesh1D);
+        }
+        _mapFieldValues(cursor, obj.field);
+    } else if (obj.type == "FieldTri2D" && obj.version == 'A') {
+        obj.field.hasMesh = (cursor.readChar() == '1');
+        if (obj.field.hasMesh) {
+            _mapMeshTri2D(cursor, obj.meshTri2D);
+        }
+        _mapFieldValues(cursor, obj.field);
+    } else if (obj.type == "FieldRect3D"
+          && (obj.version == 'A' || obj.version == 'B')) {
+        obj.field.hasMesh = (cursor.readChar() == '1');
+        if (obj.field.hasMesh) {
+            _mapMeshRect3D(cursor, obj.meshRect3D);
+        }
+        _mapFieldValues(cursor, obj.field);
+        if (obj.version == 'B') {
+            obj.field.interp = cursor.readInt();
+        }
+    } else if (obj.type == "FieldPrism3D" && obj.version == 'A') {
+        obj.field.hasMesh = (cursor.readChar() == '1');
+        if (obj.field.hasMesh) {
+            _mapMeshPrism3D(cursor, obj.meshPrism3D);
+        }
+        _mapFieldValues(cursor, obj.field);
+    } else {
+        known = 0;
+    }
+
+    if (!known) {
+        std::string errmsg("can't map object of type \"");
+        errmsg += obj.type;
+        errmsg += "\" version \"";
+        errmsg += obj.version;
+        errmsg += "\" (load it with a Serializer instead)";
+        return result.error(errmsg.data());
+    }
+    if (cursor.error()) {
+        std::string errmsg("can't map ");
+        errmsg += obj.type;
+        errmsg += ": data is truncated or corrupt";
+        return result.error(errmsg.data());
+    }
+    return result;
+}
@@ -0,0 +1,177 @@
+/*
+ * ----------------------------------------------------------------------
+ *  Rappture::SerialMap
+ *    Maps a file holding a Serializer stream into memory and gives
+ *    read-only access to the meshes and fields inside without
+ *    copying them.  Only the headers and array counts are read when
+ *    the file is opened; the node coordinates and field values are
+ *    views into the mapped file and are paged in as they're used.
+ *
+ * ======================================================================
+ *  Copyright (c) 2004-2012  HUBzero Foundation, LLC
+ *
+ *  See the file "license.terms" for information on usage and
+ *  redistribution of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ * ======================================================================
+ */
+#ifndef RPSERIALMAP_H
+#define RPSERIALMAP_H
+
+#include <assert.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <RpOutcome.h>
+
+namespace Rappture {
+
+/**
+ * Read-only view of an array written by SerialBuffer::writeInts()
+ * or SerialBuffer::writeDoubles().  The values stay in the mapped
+ * file, which must stay open while the view is used.
+ */
+template <class Type>
+class SerialArray {
+public:
+    SerialArray() : _data(NULL), _size(0) {}
+    SerialArray(const char* bytes, size_t nvals)
+        : _data(bytes), _size(nvals) {}
+
+    size_t size() const { return _size; }
+    Type operator[](size_t pos) const;
+    const Type* data() const;
+
+private:
+    const char* _data;      // first value in the mapped file
+    size_t _size;           // number of values
+};
+
+/**
+ * Value at a position in the array.  The file is little-endian, so
+ * big-endian hosts swap each value as it's read.
+ */
+template <class Type>
+Type
+SerialArray<Type>::operator[](size_t pos) const
+{
+#ifdef BIGENDIAN
+    Type val;
+    const char *src = _data + pos*sizeof(Type);
+    char *dest = (char*)&val;
+    for (unsigned int i=0; i < sizeof(Type); i++) {
+        dest[sizeof(Type)-1-i] = src[i];
+    }
+    return val;
+#else
+    // the file may not be aligned for Type, so copy the bytes
+    Type val;
+    memcpy(&val, _data + pos*sizeof(Type), sizeof(Type));
+    return val;
+#endif
+}
+
+/**
+ * Pointer to the values in place.  Arrays are aligned to their
+ * element size in the stream, so this is a plain C array on
+ * little-endian hosts.  Returns NULL on big-endian hosts, where the
+ * values have to be read one at a time through operator[].
+ */
+template <class Type>
+const Type*
+SerialArray<Type>::data() const
+{
+#ifdef BIGENDIAN
+    return NULL;
+#else
+    return (const Type*)_data;
+#endif
+}
+
+class MappedMesh1D {
+public:
+    MappedMesh1D() : counter(0) {}
+
+    SerialArray<int> ids;           // node IDs, in sorted order of x
+    SerialArray<double> x;          // node coordinates
+    int counter;                    // auto counter for node IDs
+};
+
+class MappedMeshTri2D {
+public:
+    MappedMeshTri2D() : counter(0) {}
+
+    SerialArray<int> ids;           // node IDs
+    SerialArray<double> x;          // node x-coordinates
+    SerialArray<double> y;          // node y-coordinates
+    SerialArray<int> cells;         // 3 node IDs per triangle
+    int counter;                    // auto counter for node IDs
+};
+
+class MappedMeshRect3D {
+public:
+    MappedMesh1D axis[3];           // mesh along x-, y-, and z-axes
+};
+
+class MappedMeshPrism3D {
+public:
+    MappedMeshTri2D xymesh;         // triangular mesh in x/y axes
+    MappedMesh1D zmesh;             // mesh along z-axis
+};
+
+class MappedField {
+public:
+    MappedField()
+        : hasMesh(0), vmin(0.0), vmax(0.0), counter(0), interp(0) {}
+
+    int hasMesh;                    // non-zero => mesh was stored
+    SerialArray<double> values;     // list of all values, in nodeId order
+    double vmin;                    // minimum value
+    double vmax;                    // maximum value
+    int counter;                    // counter for generating node IDs
+    int interp;                     // FieldRect3D::Interpolation mode
+};
+
+/**
+ * One object in the mapped stream.  Only the members that match the
+ * type are filled in: a Mesh1D fills mesh1D, a FieldRect3D fills
+ * field and meshRect3D, and so forth.
+ */
+class MappedObject {
+public:
+    MappedObject() : version('\0') {}
+
+    std::string id;                 // id from the Serializer
+    std::string type;               // serializerType(), e.g. "Mesh1D"
+    char version;                   // serializerVersion()
+
+    MappedMesh1D mesh1D;
+    MappedMeshTri2D meshTri2D;
+    MappedMeshRect3D meshRect3D;
+    MappedMeshPrism3D meshPrism3D;
+    MappedField field;
+};
+
+class SerialMap {
+public:
+    SerialMap();
+    virtual ~SerialMap();
+
+    virtual Outcome open(const char* fileName);
+    virtual void close();
+
+    virtual int size() const;
+    virtual const MappedObject& at(int pos) const;
+
+private:
+    // disallow these operations
+    SerialMap(const SerialMap&) { assert(0); }
+    SerialMap& operator=(const SerialMap&) { assert(0); return *this; }
+
+    const char* _bytes;             // start of the mapped file
+    size_t _nbytes;                 // size of the mapped file
+    std::vector<MappedObject> _objects;
+};
+
+} // namespace Rappture
+
+#endif /*RPSERIALMAP_H*/
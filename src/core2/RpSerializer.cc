@@ -17,6 +17,7 @@
  */
 #include <assert.h>
 #include <sstream>
+#include <zlib.h>
 #include "RpSerializer.h"
 
 using namespace Rappture;
@@ -30,7 +31,7 @@ Serializer::~Serializer()
 }
 
 Outcome
-Serializer::deserialize(const char* bytes, int nbytes)
+Serializer::deserialize(const char* bytes, size_t nbytes)
 {
     Outcome result;
     std::string token;
@@ -40,11 +41,43 @@ Serializer::deserialize(const char* bytes, int nbytes)
 
     // read the format and make sure we've got the right reader
     token = buffer.readString();
-    if (token != "RpSerial:A") {
+    if (token == "RpSerial:Z" || token == "RpSerial:ZB") {
+        // compressed stream -- inflate it and read what's inside.
+        // "RpSerial:Z" came before sizes were 64 bits.
+        uLongf nraw;
+        std::vector<char> zbytes;
+        int status = 0;
+        if (token == "RpSerial:Z") {
+            nraw = (unsigned int)buffer.readInt();
+            zbytes = buffer.readBytes();
+        } else {
+            nraw = buffer.readSize();
+            status = buffer.readChars(zbytes);
+        }
+        // deflate can't do better than about 1032:1, so a larger size
+        // is corrupt -- don't allocate it
+        if (status < 0 || zbytes.size() == 0 || nraw == 0
+              || nraw > (uLongf)zbytes.size()*1032) {
+            std::string errmsg("can't deserialize stream: ");
+            errmsg += "corrupt compressed data";
+            return result.error(errmsg.data());
+        }
+        std::vector<char> raw(nraw);
+        if (uncompress((Bytef*)&raw[0], &nraw, (const Bytef*)&zbytes[0],
+                zbytes.size()) != Z_OK) {
+            std::string errmsg("can't deserialize stream: ");
+            errmsg += "corrupt compressed data";
+            return result.error(errmsg.data());
+        }
+        return deserialize(&raw[0], nraw);
+    }
+    if (token == "RpSerial:A") {
+        buffer.version('A');
+    } else if (token != "RpSerial:B") {
         std::string errmsg("can't deserialize stream: ");
         errmsg += "bad marker \"";
         errmsg += token;
-        errmsg += "\" (should be RpSerial:A)";
+        errmsg += "\" (should be RpSerial:B)";
         return result.error(errmsg.data());
     }
 
@@ -89,11 +122,21 @@ Serializer::deserialize(const char* bytes, int nbytes)
     return result;
 }
 
+/**
+ * Serialize all objects into a single stream.  If compress is a
+ * zlib compression level (1-9), the stream is deflated and wrapped
+ * in an "RpSerial:ZB" stream that deserialize() recognizes.  Level 1
+ * is usually the right choice for large numeric fields.
+ *
+ * Streams are written as version "RpSerial:B", with 64-bit array
+ * counts and aligned arrays (see SerialBuffer).  deserialize() also
+ * reads version "RpSerial:A".
+ */
 Ptr<SerialBuffer>
-Serializer::serialize()
+Serializer::serialize(int compress)
 {
     Ptr<SerialBuffer> bufferPtr( new SerialBuffer() );
-    bufferPtr->writeString("RpSerial:A");
+    bufferPtr->writeString("RpSerial:B");
 
     // write out number of objects in the stream
     bufferPtr->writeInt(_idlist.size());
@@ -107,6 +150,21 @@ Serializer::serialize()
         bufferPtr->writeString(id);
         objPtr->serialize(*bufferPtr.pointer());
     }
+
+    if (compress > 0) {
+        uLongf nz = compressBound(bufferPtr->size());
+        std::vector<char> zbytes(nz);
+        if (compress2((Bytef*)&zbytes[0], &nz,
+                (const Bytef*)bufferPtr->bytes(), bufferPtr->size(),
+                (compress > Z_BEST_COMPRESSION) ? Z_BEST_COMPRESSION : compress)
+              == Z_OK) {
+            Ptr<SerialBuffer> zbufferPtr( new SerialBuffer() );
+            zbufferPtr->writeString("RpSerial:ZB");
+            zbufferPtr->writeSize(bufferPtr->size());
+            zbufferPtr->writeChars(&zbytes[0], nz);
+            return zbufferPtr;
+        }
+    }
     return bufferPtr;
 }
 
@@ -31,8 +31,8 @@ public:
     Serializer();
     virtual ~Serializer();
 
-    virtual Ptr<SerialBuffer> serialize();
-    virtual Outcome deserialize(const char* bytes, int nbytes);
+    virtual Ptr<SerialBuffer> serialize(int compress=0);
+    virtual Outcome deserialize(const char* bytes, size_t nbytes);
 
     virtual int size() const;
     virtual Ptr<Serializable> get(int pos) const;
@@ -0,0 +1,601 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <math.h>
+#include "RpMesh1D.h"
+#include "RpMeshTri2D.h"
+#include "RpMeshRect3D.h"
+#include "RpMeshPrism3D.h"
+#include "RpField1D.h"
+#include "RpFieldTri2D.h"
+#include "RpFieldRect3D.h"
+#include "RpFieldPrism3D.h"
+#include "RpSerializer.h"
+#include "RpSerialMap.h"
+
+using namespace Rappture;
+
+static int
+testFail(const char *testname, const char *desc, const char *why)
+{
+    printf("Error: %s\n", testname);
+    printf("\t%s\n", desc);
+    printf("\t%s\n", why);
+    return 1;
+}
+
+/*
+ * Compares two values that should be bit-for-bit the same after a
+ * round trip.  NAN matches NAN.
+ */
+static int
+testSame(const char *testname, const char *desc, double expected,
+    double received)
+{
+    if (expected == received || (isnan(expected) && isnan(received))) {
+        return 0;
+    }
+    printf("Error: %s\n", testname);
+    printf("\t%s\n", desc);
+    printf("\texpected \"%.17g\"\n", expected);
+    printf("\treceived \"%.17g\"\n", received);
+    return 1;
+}
+
+/*
+ * Serializes the object in out, optionally compressed, and loads the
+ * stream back into a new Serializer.  Returns the single object read,
+ * or a null pointer if anything went wrong.  out owns the original.
+ */
+static Ptr<Serializable>
+roundTrip(Serializer& out, int compress=0)
+{
+    Ptr<SerialBuffer> bufPtr = out.serialize(compress);
+
+    Serializer in;
+    Outcome status = in.deserialize(bufPtr->bytes(), bufPtr->size());
+    if (status != 0 || in.size() != 1) {
+        printf("%s\n", status.remark());
+        return Ptr<Serializable>();
+    }
+    return in.get(0);
+}
+
+static Mesh1D
+mesh1D(double x0, double x1, int npts)
+{
+    // uneven spacing, so the cubic tangents aren't trivial
+    Mesh1D mesh;
+    for (int i=0; i < npts; i++) {
+        double t = (double)i/(npts-1);
+        mesh.add(Node1D(x0 + (x1-x0)*t*(0.5+0.5*t)));
+    }
+    return mesh;
+}
+
+static MeshTri2D
+meshTri2D()
+{
+    // unit square split along its diagonal
+    MeshTri2D mesh;
+    mesh.addNode(Node2D(0.0, 0.0));
+    mesh.addNode(Node2D(1.0, 0.0));
+    mesh.addNode(Node2D(1.0, 1.0));
+    mesh.addNode(Node2D(0.0, 1.0));
+    mesh.addCell(0, 1, 2);
+    mesh.addCell(0, 2, 3);
+    return mesh;
+}
+
+static double
+fieldValue(int nodeId)
+{
+    return sin(0.37*nodeId) + 0.01*nodeId*nodeId;
+}
+
+int
+testMesh1D()
+{
+    const char *testdesc = "test Mesh1D round trip";
+    const char *testname = "testMesh1D";
+    int retVal = 0;
+
+    Mesh1D *mesh = new Mesh1D(mesh1D(-2.0, 5.0, 17));
+    Serializer out;
+    out.add(mesh);
+    Ptr<Serializable> objPtr = roundTrip(out);
+    Mesh1D *copy = dynamic_cast<Mesh1D*>(objPtr.pointer());
+    if (copy == NULL) {
+        return testFail(testname, testdesc, "can't deserialize Mesh1D");
+    }
+    if (copy->size() != mesh->size()) {
+        return testFail(testname, testdesc, "wrong number of nodes");
+    }
+    for (int i=0; i < mesh->size(); i++) {
+        retVal |= testSame(testname, testdesc, mesh->at(i).x(),
+                    copy->at(i).x());
+        retVal |= testSame(testname, testdesc, mesh->at(i).id(),
+                    copy->at(i).id());
+    }
+    return retVal;
+}
+
+int
+testMeshTri2D()
+{
+    const char *testdesc = "test MeshTri2D round trip";
+    const char *testname = "testMeshTri2D";
+    int retVal = 0;
+
+    MeshTri2D *mesh = new MeshTri2D(meshTri2D());
+    Serializer out;
+    out.add(mesh);
+    Ptr<Serializable> objPtr = roundTrip(out);
+    MeshTri2D *copy = dynamic_cast<MeshTri2D*>(objPtr.pointer());
+    if (copy == NULL) {
+        return testFail(testname, testdesc, "can't deserialize MeshTri2D");
+    }
+    if (copy->sizeNodes() != mesh->sizeNodes()
+          || copy->sizeCells() != mesh->sizeCells()) {
+        return testFail(testname, testdesc, "wrong number of nodes or cells");
+    }
+    for (int i=0; i < mesh->sizeNodes(); i++) {
+        retVal |= testSame(testname, testdesc, mesh->atNode(i).x(),
+                    copy->atNode(i).x());
+        retVal |= testSame(testname, testdesc, mesh->atNode(i).y(),
+                    copy->atNode(i).y());
+    }
+    for (int i=0; i < mesh->sizeCells(); i++) {
+        CellTri2D c0 = mesh->atCell(i);
+        CellTri2D c1 = copy->atCell(i);
+        for (int n=0; n < 3; n++) {
+            retVal |= testSame(testname, testdesc, c0.nodeId(n), c1.nodeId(n));
+        }
+    }
+    return retVal;
+}
+
+int
+testMeshRect3D()
+{
+    const char *testdesc = "test MeshRect3D round trip";
+    const char *testname = "testMeshRect3D";
+    int retVal = 0;
+
+    MeshRect3D *mesh = new MeshRect3D(mesh1D(0.0, 1.0, 4),
+        mesh1D(-1.0, 1.0, 5), mesh1D(2.0, 3.0, 6));
+    Serializer out;
+    out.add(mesh);
+    Ptr<Serializable> objPtr = roundTrip(out);
+    MeshRect3D *copy = dynamic_cast<MeshRect3D*>(objPtr.pointer());
+    if (copy == NULL) {
+        return testFail(testname, testdesc, "can't deserialize MeshRect3D");
+    }
+    for (int a=0; a < 3; a++) {
+        Axis axis = (Axis)a;
+        if (copy->size(axis) != mesh->size(axis)) {
+            return testFail(testname, testdesc, "wrong number of nodes");
+        }
+        for (int i=0; i < mesh->size(axis); i++) {
+            retVal |= testSame(testname, testdesc, mesh->at(axis,i).x(),
+                        copy->at(axis,i).x());
+        }
+    }
+    return retVal;
+}
+
+int
+testMeshPrism3D()
+{
+    const char *testdesc = "test MeshPrism3D round trip";
+    const char *testname = "testMeshPrism3D";
+    int retVal = 0;
+
+    MeshPrism3D *mesh = new MeshPrism3D(meshTri2D(), mesh1D(0.0, 2.0, 3));
+    Serializer out;
+    out.add(mesh);
+    Ptr<Serializable> objPtr = roundTrip(out);
+    MeshPrism3D *copy = dynamic_cast<MeshPrism3D*>(objPtr.pointer());
+    if (copy == NULL) {
+        return testFail(testname, testdesc, "can't deserialize MeshPrism3D");
+    }
+    for (int a=0; a < 3; a++) {
+        retVal |= testSame(testname, testdesc, mesh->rangeMin((Axis)a),
+                    copy->rangeMin((Axis)a));
+        retVal |= testSame(testname, testdesc, mesh->rangeMax((Axis)a),
+                    copy->rangeMax((Axis)a));
+    }
+    CellPrism3D c0 = mesh->locate(Node3D(0.7, 0.2, 1.5));
+    CellPrism3D c1 = copy->locate(Node3D(0.7, 0.2, 1.5));
+    for (int n=0; n < 6; n++) {
+        retVal |= testSame(testname, testdesc, c0.nodeId(n), c1.nodeId(n));
+    }
+    return retVal;
+}
+
+int
+testField1D()
+{
+    const char *testdesc = "test Field1D round trip";
+    const char *testname = "testField1D";
+    int retVal = 0;
+
+    Field1D *field = new Field1D();
+    for (int i=0; i < 20; i++) {
+        field->define(0.25*i*i, fieldValue(i));
+    }
+    Serializer out;
+    out.add(field);
+    Ptr<Serializable> objPtr = roundTrip(out);
+    Field1D *copy = dynamic_cast<Field1D*>(objPtr.pointer());
+    if (copy == NULL) {
+        return testFail(testname, testdesc, "can't deserialize Field1D");
+    }
+    for (double x=-1.0; x < 100.0; x += 0.7) {
+        retVal |= testSame(testname, testdesc, field->value(x),
+                    copy->value(x));
+    }
+    retVal |= testSame(testname, testdesc, field->valueMin(),
+                copy->valueMin());
+    retVal |= testSame(testname, testdesc, field->valueMax(),
+                copy->valueMax());
+    return retVal;
+}
+
+int
+testFieldTri2D()
+{
+    const char *testdesc = "test FieldTri2D round trip";
+    const char *testname = "testFieldTri2D";
+    int retVal = 0;
+
+    FieldTri2D *field = new FieldTri2D(meshTri2D());
+    for (int i=0; i < 4; i++) {
+        field->define(i, fieldValue(i));
+    }
+    Serializer out;
+    out.add(field);
+    Ptr<Serializable> objPtr = roundTrip(out);
+    FieldTri2D *copy = dynamic_cast<FieldTri2D*>(objPtr.pointer());
+    if (copy == NULL) {
+        return testFail(testname, testdesc, "can't deserialize FieldTri2D");
+    }
+    for (double y=-0.1; y < 1.2; y += 0.15) {
+        for (double x=-0.1; x < 1.2; x += 0.15) {
+            retVal |= testSame(testname, testdesc, field->value(x,y),
+                        copy->value(x,y));
+        }
+    }
+    return retVal;
+}
+
+/*
+ * Builds a 5x6x7 rectangular field, serializes it, optionally
+ * compressed, and compares values and gradients over the mesh.
+ */
+static int
+testRect3D(const char *testname, const char *testdesc, int compress,
+    FieldRect3D::Interpolation mode=FieldRect3D::LINEAR)
+{
+    int retVal = 0;
+
+    FieldRect3D *field = new FieldRect3D(mesh1D(0.0, 1.0, 5),
+        mesh1D(-1.0, 1.0, 6), mesh1D(2.0, 3.0, 7));
+    for (int i=0; i < 5*6*7; i++) {
+        field->define(i, fieldValue(i));
+    }
+    field->interpolation(mode);
+    Serializer out;
+    out.add(field);
+    Ptr<Serializable> objPtr = roundTrip(out, compress);
+    FieldRect3D *copy = dynamic_cast<FieldRect3D*>(objPtr.pointer());
+    if (copy == NULL) {
+        return testFail(testname, testdesc, "can't deserialize FieldRect3D");
+    }
+    if (copy->interpolation() != mode) {
+        return testFail(testname, testdesc, "wrong interpolation mode");
+    }
+    for (double z=1.9; z < 3.1; z += 0.13) {
+        for (double y=-1.1; y < 1.1; y += 0.23) {
+            for (double x=-0.1; x < 1.1; x += 0.17) {
+                double g0[3], g1[3];
+                retVal |= testSame(testname, testdesc,
+                            field->gradient(x,y,z,g0), copy->gradient(x,y,z,g1));
+                for (int a=0; a < 3; a++) {
+                    retVal |= testSame(testname, testdesc, g0[a], g1[a]);
+                }
+            }
+        }
+    }
+    return retVal;
+}
+
+int
+testFieldRect3D()
+{
+    return testRect3D("testFieldRect3D", "test FieldRect3D round trip", 0);
+}
+
+int
+testFieldRect3DCubic()
+{
+    return testRect3D("testFieldRect3DCubic",
+        "test FieldRect3D round trip with CUBIC interpolation", 0,
+        FieldRect3D::CUBIC);
+}
+
+int
+testFieldRect3DMissing()
+{
+    const char *testdesc = "test FieldRect3D nodes without values";
+    const char *testname = "testFieldRect3DMissing";
+    int retVal = 0;
+
+    // values only for the bottom z-plane
+    FieldRect3D field(mesh1D(0.0, 1.0, 5), mesh1D(-1.0, 1.0, 6),
+        mesh1D(2.0, 3.0, 7));
+    for (int i=0; i < 5*6; i++) {
+        field.define(i, fieldValue(i));
+    }
+    for (int mode=FieldRect3D::LINEAR; mode <= FieldRect3D::CUBIC; mode++) {
+        double g[3], xyz[3], f;
+        field.interpolation((FieldRect3D::Interpolation)mode);
+        retVal |= testSame(testname, testdesc, -1.0,
+                    field.value(0.5, 0.0, 2.9, -1.0));
+        retVal |= testSame(testname, testdesc, -1.0,
+                    field.gradient(0.5, 0.0, 2.9, g, -1.0));
+        retVal |= testSame(testname, testdesc, NAN, g[0]);
+        xyz[0] = 0.5; xyz[1] = 0.0; xyz[2] = 2.9;
+        field.values(1, xyz, &f, g, -1.0);
+        retVal |= testSame(testname, testdesc, -1.0, f);
+        retVal |= testSame(testname, testdesc, NAN, g[2]);
+    }
+    return retVal;
+}
+
+int
+testFieldPrism3D()
+{
+    const char *testdesc = "test FieldPrism3D round trip";
+    const char *testname = "testFieldPrism3D";
+    int retVal = 0;
+
+    FieldPrism3D *field = new FieldPrism3D(meshTri2D(), mesh1D(0.0, 2.0, 3));
+    for (int i=0; i < 4*3; i++) {
+        field->define(i, fieldValue(i));
+    }
+    Serializer out;
+    out.add(field);
+    Ptr<Serializable> objPtr = roundTrip(out);
+    FieldPrism3D *copy = dynamic_cast<FieldPrism3D*>(objPtr.pointer());
+    if (copy == NULL) {
+        return testFail(testname, testdesc, "can't deserialize FieldPrism3D");
+    }
+    for (double z=-0.1; z < 2.2; z += 0.3) {
+        for (double y=-0.1; y < 1.2; y += 0.15) {
+            for (double x=-0.1; x < 1.2; x += 0.15) {
+                retVal |= testSame(testname, testdesc, field->value(x,y,z),
+                            copy->value(x,y,z));
+            }
+        }
+    }
+    return retVal;
+}
+
+int
+testCompressed()
+{
+    return testRect3D("testCompressed",
+        "test FieldRect3D round trip through a compressed stream", 1);
+}
+
+int
+testTruncated()
+{
+    const char *testdesc = "test truncated streams are rejected";
+    const char *testname = "testTruncated";
+    int retVal = 0;
+
+    for (int compress=0; compress <= 1; compress++) {
+        FieldRect3D *field = new FieldRect3D(mesh1D(0.0, 1.0, 5),
+            mesh1D(-1.0, 1.0, 6), mesh1D(2.0, 3.0, 7));
+        for (int i=0; i < 5*6*7; i++) {
+            field->define(i, fieldValue(i));
+        }
+        Serializer out;
+        out.add(field);
+        Ptr<SerialBuffer> bufPtr = out.serialize(compress);
+
+        // cut the stream off in the middle of the value array
+        Serializer in;
+        Outcome status = in.deserialize(bufPtr->bytes(), bufPtr->size()/2);
+        if (status == 0) {
+            retVal |= testFail(testname, testdesc,
+                "half a stream deserialized without an error");
+        }
+    }
+
+    // an array count far larger than the buffer
+    SerialBuffer buffer;
+    buffer.writeSize((size_t)1 << 40);
+    buffer.writeDouble(1.0);
+    SerialBuffer reader(buffer.bytes(), buffer.size());
+    std::vector<double> dvals;
+    if (reader.readDoubles(dvals) >= 0 || dvals.size() != 0) {
+        retVal |= testFail(testname, testdesc,
+            "array count larger than the buffer was accepted");
+    }
+
+    // a compressed stream claiming a raw size far larger than its data
+    SerialBuffer zbuffer;
+    zbuffer.writeString("RpSerial:ZB");
+    zbuffer.writeSize((size_t)1 << 62);
+    zbuffer.writeChars("\x78\x9c\x03\x00\x00\x00\x00\x01", 8);
+    Serializer in;
+    if (in.deserialize(zbuffer.bytes(), zbuffer.size()) == 0) {
+        retVal |= testFail(testname, testdesc,
+            "compressed size larger than zlib can produce was accepted");
+    }
+    return retVal;
+}
+
+/*
+ * Writes the stream in the buffer to a scratch file for SerialMap.
+ */
+static int
+writeFile(const char *fileName, const SerialBuffer& buffer)
+{
+    FILE *f = fopen(fileName, "wb");
+    if (f == NULL) {
+        return -1;
+    }
+    size_t n = fwrite(buffer.bytes(), 1, buffer.size(), f);
+    fclose(f);
+    return (n == buffer.size()) ? 0 : -1;
+}
+
+int
+testSerialMap()
+{
+    const char *testdesc = "test mapped values match the serialized field";
+    const char *testname = "testSerialMap";
+    const char *fileName = "RpSerializer_test.map";
+    int retVal = 0;
+
+    // vmin/vmax and the counters land at unaligned offsets in the file
+    FieldRect3D *field = new FieldRect3D(mesh1D(0.0, 1.0, 5),
+        mesh1D(-1.0, 1.0, 6), mesh1D(2.0, 3.0, 7));
+    for (int i=0; i < 5*6*7; i++) {
+        field->define(i, fieldValue(i));
+    }
+    field->interpolation(FieldRect3D::CUBIC);
+    Serializer out;
+    out.add(field);
+    if (writeFile(fileName, *out.serialize().pointer()) < 0) {
+        return testFail(testname, testdesc, "can't write scratch file");
+    }
+
+    SerialMap map;
+    Outcome status = map.open(fileName);
+    unlink(fileName);
+    if (status != 0 || map.size() != 1) {
+        return testFail(testname, testdesc, "can't map serialized field");
+    }
+    const MappedObject& obj = map.at(0);
+    if (obj.type != "FieldRect3D" || obj.field.values.size() != 5*6*7
+          || obj.field.interp != FieldRect3D::CUBIC) {
+        return testFail(testname, testdesc, "wrong object mapped");
+    }
+    const double *vals = obj.field.values.data();
+    for (int i=0; i < 5*6*7; i++) {
+        retVal |= testSame(testname, testdesc, fieldValue(i),
+                    obj.field.values[i]);
+        if (vals != NULL) {
+            retVal |= testSame(testname, testdesc, fieldValue(i), vals[i]);
+        }
+    }
+    Mesh1D xmesh(mesh1D(0.0, 1.0, 5));
+    const MappedMesh1D& xaxis = obj.meshRect3D.axis[0];
+    if (xaxis.x.size() != 5 || xaxis.ids.size() != 5) {
+        return testFail(testname, testdesc, "wrong number of x nodes");
+    }
+    for (int i=0; i < 5; i++) {
+        retVal |= testSame(testname, testdesc, xmesh.at(i).x(), xaxis.x[i]);
+        retVal |= testSame(testname, testdesc, i, xaxis.ids[i]);
+    }
+    return retVal;
+}
+
+int
+testSerialMapRejects()
+{
+    const char *testdesc = "test SerialMap rejects streams it can't map";
+    const char *testname = "testSerialMapRejects";
+    const char *fileName = "RpSerializer_test.map";
+    int retVal = 0;
+
+    SerialBuffer buffer;
+    buffer.writeString("RpSerial:A");
+    buffer.writeInt(0);
+    writeFile(fileName, buffer);
+
+    SerialMap map;
+    if (map.open(fileName) == 0) {
+        retVal |= testFail(testname, testdesc, "mapped a version A stream");
+    }
+
+    Serializer out;
+    out.add(new Mesh1D(mesh1D(0.0, 1.0, 5)));
+    writeFile(fileName, *out.serialize(1).pointer());
+    if (map.open(fileName) == 0) {
+        retVal |= testFail(testname, testdesc, "mapped a compressed stream");
+    }
+    unlink(fileName);
+    return retVal;
+}
+
+int
+testVersionA()
+{
+    const char *testdesc = "test streams written before version B load";
+    const char *testname = "testVersionA";
+    int retVal = 0;
+
+    // Mesh1D "B" as written into an "RpSerial:A" stream: int counts
+    // and no padding in front of the arrays
+    int ids[3] = { 0, 1, 2 };
+    double xs[3] = { -1.0, 0.5, 2.25 };
+    SerialBuffer buffer;
+    buffer.writeString("RpSerial:A");
+    buffer.writeInt(1);
+    buffer.writeString("RpObj:");
+    buffer.writeString("m");
+    buffer.writeString("Mesh1D");
+    buffer.writeChar('B');
+    buffer.writeInt(3);
+    for (int i=0; i < 3; i++) {
+        buffer.writeInt(ids[i]);
+    }
+    buffer.writeInt(3);
+    for (int i=0; i < 3; i++) {
+        buffer.writeDouble(xs[i]);
+    }
+    buffer.writeInt(3);
+
+    Serializer in;
+    Outcome status = in.deserialize(buffer.bytes(), buffer.size());
+    Mesh1D *mesh = (in.size() == 1)
+        ? dynamic_cast<Mesh1D*>(in.get(0).pointer()) : NULL;
+    if (status != 0 || mesh == NULL || mesh->size() != 3) {
+        return testFail(testname, testdesc, "can't deserialize Mesh1D");
+    }
+    for (int i=0; i < 3; i++) {
+        retVal |= testSame(testname, testdesc, xs[i], mesh->at(i).x());
+        retVal |= testSame(testname, testdesc, ids[i], mesh->at(i).id());
+    }
+    return retVal;
+}
+
+int
+main()
+{
+    int retVal = 0;
+
+    retVal |= testMesh1D();
+    retVal |= testMeshTri2D();
+    retVal |= testMeshRect3D();
+    retVal |= testMeshPrism3D();
+    retVal |= testField1D();
+    retVal |= testFieldTri2D();
+    retVal |= testFieldRect3D();
+    retVal |= testFieldRect3DCubic();
+    retVal |= testFieldRect3DMissing();
+    retVal |= testFieldPrism3D();
+    retVal |= testCompressed();
+    retVal |= testTruncated();
+    retVal |= testSerialMap();
+    retVal |= testSerialMapRejects();
+    retVal |= testVersionA();
+
+    return retVal;
+}
@@ -12,16 +12,102 @@
  */
 
 #include <limits>
+#include <cmath>
+#include <algorithm>
 #include "RpArray1D.h"
 
 using namespace Rappture;
 
 const char Array1D::type[] = "RAPPTURE_AXIS_TYPE_IRREGULAR";
 
+// values per pair in the lowest level of the min-max pyramid
+#define ARRAY1D_LOD_BLOCK   64
+
+// values summarized at a time by append(), small enough that the
+// second pass over them hits the cache
+#define ARRAY1D_STATS_CHUNK 4096
+
+/*
+ * Count, sum, min and max of the finite values in a block.  The loops
+ * keep four independent accumulators and pick values without
+ * branching, so the compiler can turn them into vector instructions.
+ * inf and nan are the only values for which v-v isn't 0.
+ */
+typedef struct {
+    size_t count;               // number of finite values
+    double sum;
+    double min;
+    double max;
+} _Array1DSummary;
+
+static void
+_summarize(const double *val, size_t nmemb, _Array1DSummary *s)
+{
+    double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+    double mn[4] = { HUGE_VAL, HUGE_VAL, HUGE_VAL, HUGE_VAL };
+    double mx[4] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+    size_t count[4] = { 0, 0, 0, 0 };
+    size_t i = 0;
+
+    for (; i + 4 <= nmemb; i += 4) {
+        for (int k = 0; k < 4; k++) {
+            double v = val[i+k];
+            bool finite = ((v - v) == 0.0);
+            count[k] += finite;
+            sum[k] += finite ? v : 0.0;
+            mn[k] = (finite && (v < mn[k])) ? v : mn[k];
+            mx[k] = (finite && (v > mx[k])) ? v : mx[k];
+        }
+    }
+    for (; i < nmemb; i++) {
+        double v = val[i];
+        bool finite = ((v - v) == 0.0);
+        count[0] += finite;
+        sum[0] += finite ? v : 0.0;
+        mn[0] = (finite && (v < mn[0])) ? v : mn[0];
+        mx[0] = (finite && (v > mx[0])) ? v : mx[0];
+    }
+    s->count = count[0] + count[1] + count[2] + count[3];
+    s->sum = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    s->min = std::min(std::min(mn[0],mn[1]),std::min(mn[2],mn[3]));
+    s->max = std::max(std::max(mx[0],mx[1]),std::max(mx[2],mx[3]));
+}
+
+/*
+ * Sum of the squared distances of the finite values from their mean.
+ * Done as a second pass, which stays accurate when the values are
+ * large compared to their spread.
+ */
+static double
+_sumSquares(const double *val, size_t nmemb, double mean)
+{
+    double m2[4] = { 0.0, 0.0, 0.0, 0.0 };
+    size_t i = 0;
+
+    for (; i + 4 <= nmemb; i += 4) {
+        for (int k = 0; k < 4; k++) {
+            double v = val[i+k];
+            double d = ((v - v) == 0.0) ? v - mean : 0.0;
+            m2[k] += d * d;
+        }
+    }
+    for (; i < nmemb; i++) {
+        double v = val[i];
+        double d = ((v - v) == 0.0) ? v - mean : 0.0;
+        m2[0] += d * d;
+    }
+    return (m2[0] + m2[1]) + (m2[2] + m2[3]);
+}
+
 Array1D::Array1D()
     : Object(),
       _min(std::numeric_limits<double>::max()),
-      _max(std::numeric_limits<double>::min())
+      _max(-std::numeric_limits<double>::max()),
+      _nonfinite(0),
+      _sum(0.0),
+      _m2(0.0),
+      _lodLevels(0),
+      _lodSamples(0)
 {
     name("");
     label("");
@@ -33,7 +119,12 @@ Array1D::Array1D()
 Array1D::Array1D(const double *val, size_t size)
     : Object(),
       _min(std::numeric_limits<double>::max()),
-      _max(std::numeric_limits<double>::min())
+      _max(-std::numeric_limits<double>::max()),
+      _nonfinite(0),
+      _sum(0.0),
+      _m2(0.0),
+      _lodLevels(0),
+      _lodSamples(0)
 {
     name("");
     label("");
@@ -47,7 +138,12 @@ Array1D::Array1D(const double *val, size_t size)
 Array1D::Array1D(const Array1D& o)
     : _val(o._val),
       _min(o._min),
-      _max(o._max)
+      _max(o._max),
+      _nonfinite(o._nonfinite),
+      _sum(o._sum),
+      _m2(o._m2),
+      _lodLevels(0),
+      _lodSamples(0)
 {
     name(o.name());
     label(o.label());
@@ -66,29 +162,16 @@ Array1D::~Array1D ()
 // METHOD: append()
 /// Append value to the axis
 /**
- * Append value to the axis object.
+ * Append value to the axis object.  The min, max and the running
+ * summary returned by sum(), mean() and variance() are updated from
+ * the new values only.
  */
 
 Array1D&
 Array1D::append(const double *val, size_t nmemb)
 {
-    double nmin = _min;
-    double nmax = _max;
-
-    for (size_t i = 0; i < nmemb; i++) {
-        if (val[i] < nmin) {
-            nmin = val[i];
-        }
-        if (val[i] > nmax) {
-            nmax = val[i];
-        }
-    }
-
+    __addStats(val,nmemb);
     _val.append(val,nmemb);
-
-    _min = nmin;
-    _max = nmax;
-
     return *this;
 }
 
@@ -96,13 +179,33 @@ Array1D::append(const double *val, size_t nmemb)
 // METHOD: clear()
 /// clear data values from the object
 /**
- * Clear data values from the object
+ * Clear data values from the object, along with their min, max and
+ * summary.
  */
 
 Array1D&
 Array1D::clear()
 {
     _val.clear();
+    __resetStats();
+    return *this;
+}
+
+/**********************************************************************/
+// METHOD: reserve()
+/// Make room for more values
+/**
+ * Allocate room for nmemb more values in one step, so a following
+ * run of append() calls that adds up to nmemb values doesn't have
+ * to grow the buffer.
+ */
+
+Array1D&
+Array1D::reserve(size_t nmemb)
+{
+    if (nmemb > 0) {
+        _val.set(_val.nmemb()+nmemb);
+    }
     return *this;
 }
 
@@ -158,6 +261,130 @@ Array1D::max() const
     return _max;
 }
 
+/**********************************************************************/
+// METHOD: nonfinite()
+/// Return the number of inf and nan values
+/**
+ * Return the number of inf and nan values.  They are left out of the
+ * min, max and the rest of the summary.
+ */
+
+size_t
+Array1D::nonfinite() const
+{
+    return _nonfinite;
+}
+
+/**********************************************************************/
+// METHOD: sum()
+/// Return the sum of the finite values
+/**
+ * Return the sum of the finite values
+ */
+
+double
+Array1D::sum() const
+{
+    return _sum;
+}
+
+/**********************************************************************/
+// METHOD: mean()
+/// Return the mean of the finite values
+/**
+ * Return the mean of the finite values, or nan if there are none.
+ */
+
+double
+Array1D::mean() const
+{
+    size_t count = nmemb() - _nonfinite;
+
+    if (count == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return _sum / count;
+}
+
+/**********************************************************************/
+// METHOD: variance()
+/// Return the variance of the finite values
+/**
+ * Return the (population) variance of the finite values, or nan if
+ * there are none.
+ */
+
+double
+Array1D::variance() const
+{
+    size_t count = nmemb() - _nonfinite;
+
+    if (count == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return _m2 / count;
+}
+
+/**********************************************************************/
+// METHOD: decimate()
+/// Return the min and max of each of nbins bins of the values
+/**
+ * The count values starting at index first are split into nbins bins
+ * of (nearly) equal size, and the smallest and largest finite value
+ * of each bin are stored in mins and maxs.  A bin with no finite
+ * values gets nan for both.  This is what a plot needs to draw an
+ * axis of millions of points at screen resolution.
+ *
+ * The bins are computed from a min-max pyramid that's built the first
+ * time it's needed and extended as values are appended, so each bin
+ * costs a few pyramid lookups plus at most a couple of hundred values
+ * at its edges, however large it is.
+ *
+ * Returns the number of bins filled, which is less than nbins if
+ * there are fewer values than bins.
+ */
+
+size_t
+Array1D::decimate(size_t first, size_t count, size_t nbins,
+                  double *mins, double *maxs) const
+{
+    size_t n = nmemb();
+
+    if (first >= n) {
+        return 0;
+    }
+    if (count > n - first) {
+        count = n - first;
+    }
+    if (nbins > count) {
+        nbins = count;
+    }
+    if (nbins == 0) {
+        return 0;
+    }
+    __lodUpdate();
+
+    for (size_t i = 0; i < nbins; i++) {
+        size_t a = first + (i * count) / nbins;
+        size_t b = first + ((i + 1) * count) / nbins;
+        double mn = HUGE_VAL;
+        double mx = -HUGE_VAL;
+        int level = (int)_lodLevels - 1;
+
+        // start at the largest blocks that fit in the bin
+        while ((level >= 0) && (((size_t)ARRAY1D_LOD_BLOCK << level) > b - a)) {
+            level--;
+        }
+        __rangeMinMax(a,b,level,&mn,&mx);
+        if (mn > mx) {
+            mn = mx = std::numeric_limits<double>::quiet_NaN();
+        }
+        mins[i] = mn;
+        maxs[i] = mx;
+    }
+    return nbins;
+}
+
 /**********************************************************************/
 // METHOD: data()
 /// Return the actual data pointer
@@ -198,5 +425,178 @@ Array1D::is() const
     return 0x61723164;
 }
 
+/**********************************************************************/
+// METHOD: __resetStats()
+/// Forget the min, max and summary of the values
+/**
+ * Forget the min, max and summary of the values
+ */
+
+void
+Array1D::__resetStats()
+{
+    _min = std::numeric_limits<double>::max();
+    _max = -std::numeric_limits<double>::max();
+    _nonfinite = 0;
+    _sum = 0.0;
+    _m2 = 0.0;
+    _lod.clear();
+    _lodLevels = 0;
+    _lodSamples = 0;
+}
+
+/**********************************************************************/
+// METHOD: __addStats()
+/// Add values to the min, max and summary
+/**
+ * Each chunk of values is summarized on its own and then merged into
+ * the running totals (Chan et al.'s formula for combining variances),
+ * so the values are only read while they're in the cache.
+ */
+
+void
+Array1D::__addStats(const double *val, size_t nmemb)
+{
+    for (size_t i = 0; i < nmemb; i += ARRAY1D_STATS_CHUNK) {
+        size_t n = nmemb - i;
+        if (n > ARRAY1D_STATS_CHUNK) {
+            n = ARRAY1D_STATS_CHUNK;
+        }
+
+        _Array1DSummary s;
+        _summarize(val+i,n,&s);
+
+        // finite values before this chunk
+        size_t na = _val.nmemb() + i - _nonfinite;
+        if (s.count > 0) {
+            double m2 = _sumSquares(val+i,n,s.sum/s.count);
+            if (na == 0) {
+                _m2 = m2;
+            } else {
+                double delta = s.sum/s.count - _sum/na;
+                _m2 += m2 + delta*delta*((double)na*s.count/(na+s.count));
+            }
+            _sum += s.sum;
+            if (s.min < _min) {
+                _min = s.min;
+            }
+            if (s.max > _max) {
+                _max = s.max;
+            }
+        }
+        _nonfinite += n - s.count;
+    }
+}
+
+/**********************************************************************/
+// METHOD: __lodUpdate()
+/// Bring the min-max pyramid up to date with the values
+/**
+ * Pairs for complete blocks at level 0 are kept between calls, so
+ * after an append only the new values are scanned.  The levels above
+ * are small (together no bigger than level 0) and are rebuilt.
+ */
+
+void
+Array1D::__lodUpdate() const
+{
+    size_t n = nmemb();
+    if (n == _lodSamples) {
+        return;
+    }
+
+    // drop everything after the complete level 0 blocks
+    size_t keep = _lodSamples / ARRAY1D_LOD_BLOCK;
+    if (n < _lodSamples) {
+        keep = 0;
+    }
+    _lod.remove(_lod.nmemb() - 2*keep);
+
+    const double *d = data();
+    size_t nblocks = (n + ARRAY1D_LOD_BLOCK - 1) / ARRAY1D_LOD_BLOCK;
+    _lod.set(4*nblocks);
+    for (size_t a = keep*ARRAY1D_LOD_BLOCK; a < n; a += ARRAY1D_LOD_BLOCK) {
+        size_t len = n - a;
+        if (len > ARRAY1D_LOD_BLOCK) {
+            len = ARRAY1D_LOD_BLOCK;
+        }
+        _Array1DSummary s;
+        _summarize(d+a,len,&s);
+        double pair[2] = { s.min, s.max };
+        _lod.append(pair,2);
+    }
+
+    _lodOffset[0] = 0;
+    _lodLevels = 1;
+    while (nblocks > 1) {
+        size_t below = _lodOffset[_lodLevels-1];
+        _lodOffset[_lodLevels] = below + nblocks;
+        for (size_t j = 0; j < nblocks; j += 2) {
+            const double *p = _lod.bytes() + 2*(below+j);
+            double pair[2] = { p[0], p[1] };
+            if (j + 1 < nblocks) {
+                pair[0] = std::min(p[0],p[2]);
+                pair[1] = std::max(p[1],p[3]);
+            }
+            _lod.append(pair,2);
+        }
+        nblocks = (nblocks + 1) / 2;
+        _lodLevels++;
+    }
+    _lodSamples = n;
+}
+
+/**********************************************************************/
+// METHOD: __rangeMinMax()
+/// Merge the min and max of values a to b-1 into *minPtr and *maxPtr
+/**
+ * Uses the blocks of the given level that lie inside the range, and
+ * the next level down for the pieces left at each end.  Below level 0
+ * the values themselves are scanned.
+ */
+
+void
+Array1D::__rangeMinMax(size_t a, size_t b, int level,
+                       double *minPtr, double *maxPtr) const
+{
+    const double *d = data();
+    size_t n = nmemb();
+
+    while ((level >= 0) && (a < b)) {
+        size_t size = (size_t)ARRAY1D_LOD_BLOCK << level;
+        size_t fa = (a + size - 1) / size;
+        // the last block may be short, and counts as inside the range
+        // when the range runs to the end of the values
+        size_t fb = (b == n) ? (n + size - 1) / size : b / size;
+
+        if (fa >= fb) {
+            level--;
+            continue;
+        }
+        const double *p = _lod.bytes() + 2*_lodOffset[level];
+        for (size_t j = fa; j < fb; j++) {
+            if (p[2*j] < *minPtr) {
+                *minPtr = p[2*j];
+            }
+            if (p[2*j+1] > *maxPtr) {
+                *maxPtr = p[2*j+1];
+            }
+        }
+        __rangeMinMax(a,fa*size,level-1,minPtr,maxPtr);
+        a = std::min(fb*size,b);
+        level--;
+    }
+    if ((level < 0) && (a < b)) {
+        _Array1DSummary s;
+        _summarize(d+a,b-a,&s);
+        if (s.min < *minPtr) {
+            *minPtr = s.min;
+        }
+        if (s.max > *maxPtr) {
+            *maxPtr = s.max;
+        }
+    }
+}
+
 // -------------------------------------------------------------------- //
 
@@ -32,12 +32,23 @@ public:
 
     virtual Array1D& append(const double *val, size_t nmemb);
     virtual Array1D& clear();
+    virtual Array1D& reserve(size_t nmemb);
     virtual size_t read(double *val, size_t nmemb);
     virtual size_t nmemb() const;
     virtual double min() const;
     virtual double max() const;
     virtual const double *data() const;
 
+    // running summary of the finite values
+    size_t nonfinite() const;
+    double sum() const;
+    double mean() const;
+    double variance() const;
+
+    // min and max of each of nbins bins, for drawing large axes
+    size_t decimate(size_t first, size_t count, size_t nbins,
+                    double *mins, double *maxs) const;
+
     static const char type[];
 
     const char *xml(size_t indent, size_t tabstop);
@@ -48,6 +59,28 @@ protected:
     SimpleDoubleBuffer _val;
     double _min;
     double _max;
+
+    size_t _nonfinite;          // number of inf and nan values
+    double _sum;                // sum of the finite values
+    double _m2;                 // sum of their squared distances
+                                // from the mean
+
+    void __resetStats();
+    void __addStats(const double *val, size_t nmemb);
+
+private:
+
+    // min-max pyramid used by decimate(), built when needed.  Level
+    // 0 holds a (min,max) pair for every ARRAY1D_LOD_BLOCK values, and
+    // each level above has one pair for every two pairs below it.
+    mutable SimpleDoubleBuffer _lod;
+    mutable size_t _lodOffset[64];      // first pair of each level
+    mutable size_t _lodLevels;
+    mutable size_t _lodSamples;         // values covered by _lod
+
+    void __lodUpdate() const;
+    void __rangeMinMax(size_t a, size_t b, int level,
+                       double *minPtr, double *maxPtr) const;
 };
 
 } // namespace Rappture
@@ -66,7 +66,6 @@ void
 Array1DUniform::min(double min)
 {
     _min = min;
-    clear();
     __fillBuffer();
     return;
 }
@@ -82,7 +81,6 @@ void
 Array1DUniform::max(double max)
 {
     _max = max;
-    clear();
     __fillBuffer();
     return;
 }
@@ -111,7 +109,6 @@ void
 Array1DUniform::step(double step)
 {
     _step = step;
-    clear();
     __fillBuffer();
     return;
 }
@@ -144,17 +141,34 @@ void
 Array1DUniform::__fillBuffer()
 {
     size_t bufSize = 0;
+    double lo = _min;
+    double hi = _max;
+
+    // clear() resets the min and max, which here are the settings
+    // for the range of the values
+    clear();
+    _min = lo;
+    _max = hi;
 
     if (_step == 0) {
         return;
     }
 
     bufSize = __calcNmembFromStep(_step);
-    _val.set(bufSize);
-
-    for(double i=_min; i <= _max; i=i+_step) {
-        _val.append(&i,1);
+    reserve(bufSize);
+
+    double block[512];
+    size_t n = 0;
+    for(double i=lo; i <= hi; i=i+_step) {
+        block[n++] = i;
+        if (n == 512) {
+            append(block,n);
+            n = 0;
+        }
     }
+    append(block,n);
+    _min = lo;
+    _max = hi;
 
     return;
 }
@@ -26,6 +26,7 @@
 
 #include "RpInt.h"
 #include "RpChain.h"
+#include "RpPool.h"
 
 #ifndef ALIGN
 #define ALIGN(a) \
@@ -57,6 +58,84 @@ Rp_ChainCreate()
     return chainPtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_ChainCreateWithArena --
+ *
+ *  Creates a chain whose structure and links come from the given
+ *  arena, so that they are freed along with everything else in
+ *  the arena.  Links can only be moved between chains that use
+ *  the same arena, and must be added to the chain with
+ *  Rp_ChainAppend or Rp_ChainPrepend.
+ *
+ * Results:
+ *  Returns a pointer to the newly created chain structure.
+ *
+ *----------------------------------------------------------------------
+ */
+Rp_Chain *
+Rp_ChainCreateWithArena(arena)
+    Rp_Arena arena;
+{
+    Rp_Chain *chainPtr;
+
+    chainPtr = (Rp_Chain *) Rp_ArenaAlloc(arena, sizeof(Rp_Chain));
+    if (chainPtr != NULL) {
+        Rp_ChainInit(chainPtr);
+        chainPtr->arena = arena;
+    }
+    return chainPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewLink --
+ *
+ *  Creates a new link for the chain, from its arena if it has
+ *  one.
+ *
+ *----------------------------------------------------------------------
+ */
+static Rp_ChainLink *
+NewLink(chainPtr)
+    Rp_Chain *chainPtr;
+{
+    Rp_ChainLink *linkPtr;
+
+    if (chainPtr->arena == NULL) {
+        return Rp_ChainNewLink();
+    }
+    linkPtr = (Rp_ChainLink *) Rp_ArenaAlloc(chainPtr->arena,
+        sizeof(Rp_ChainLink));
+    assert(linkPtr);
+    linkPtr->clientData = NULL;
+    linkPtr->nextPtr = linkPtr->prevPtr = NULL;
+    return linkPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeLink --
+ *
+ *  Frees a link of the chain.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+FreeLink(chainPtr, linkPtr)
+    Rp_Chain *chainPtr;
+    Rp_ChainLink *linkPtr;
+{
+    if (chainPtr->arena == NULL) {
+        Rp_Free(linkPtr);
+    } else {
+        Rp_ArenaFree(chainPtr->arena, linkPtr, sizeof(Rp_ChainLink));
+    }
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -136,9 +215,10 @@ Rp_ChainReset(chainPtr)
         while (linkPtr != NULL) {
             oldPtr = linkPtr;
             linkPtr = linkPtr->nextPtr;
-            Rp_Free(oldPtr);
+            FreeLink(chainPtr, oldPtr);
         }
-        Rp_ChainInit(chainPtr);
+        chainPtr->nLinks = 0;
+        chainPtr->headPtr = chainPtr->tailPtr = NULL;
     }
 }
 
@@ -162,7 +242,11 @@ Rp_ChainDestroy(chainPtr)
 {
     if (chainPtr != NULL) {
         Rp_ChainReset(chainPtr);
-        Rp_Free(chainPtr);
+        if (chainPtr->arena == NULL) {
+            Rp_Free(chainPtr);
+        } else {
+            Rp_ArenaFree(chainPtr->arena, chainPtr, sizeof(Rp_Chain));
+        }
     }
 }
 
@@ -184,6 +268,7 @@ Rp_ChainInit(chainPtr)
 {
     chainPtr->nLinks = 0;
     chainPtr->headPtr = chainPtr->tailPtr = NULL;
+    chainPtr->arena = NULL;
 }
 
 /*
@@ -329,7 +414,7 @@ Rp_ChainDeleteLink(chainPtr, linkPtr)
     Rp_ChainLink *linkPtr;
 {
     Rp_ChainUnlinkLink(chainPtr, linkPtr);
-    Rp_Free(linkPtr);
+    FreeLink(chainPtr, linkPtr);
 }
 
 Rp_ChainLink *
@@ -339,7 +424,7 @@ Rp_ChainAppend(chainPtr, clientData)
 {
     Rp_ChainLink *linkPtr;
 
-    linkPtr = Rp_ChainNewLink();
+    linkPtr = NewLink(chainPtr);
     Rp_ChainLinkBefore(chainPtr, linkPtr, (Rp_ChainLink *)NULL);
     Rp_ChainSetValue(linkPtr, clientData);
     return linkPtr;
@@ -352,7 +437,7 @@ Rp_ChainPrepend(chainPtr, clientData)
 {
     Rp_ChainLink *linkPtr;
 
-    linkPtr = Rp_ChainNewLink();
+    linkPtr = NewLink(chainPtr);
     Rp_ChainLinkAfter(chainPtr, linkPtr, (Rp_ChainLink *)NULL);
     Rp_ChainSetValue(linkPtr, clientData);
     return linkPtr;
@@ -50,10 +50,15 @@ typedef struct {
     Rp_ChainLink *headPtr;  /* Pointer to first element in chain */
     Rp_ChainLink *tailPtr;  /* Pointer to last element in chain */
     int nLinks;             /* Number of elements in chain */
+    struct Rp_ArenaStruct *arena;
+                            /* Arena holding the chain and its links,
+                             * or NULL if they are malloc'ed. */
 } Rp_Chain;
 
 extern void Rp_ChainInit _ANSI_ARGS_((Rp_Chain * chainPtr));
 extern Rp_Chain *Rp_ChainCreate _ANSI_ARGS_(());
+extern Rp_Chain *Rp_ChainCreateWithArena _ANSI_ARGS_((
+    struct Rp_ArenaStruct *arena));
 extern void Rp_ChainDestroy _ANSI_ARGS_((Rp_Chain * chainPtr));
 extern Rp_ChainLink *Rp_ChainNewLink _ANSI_ARGS_((void));
 extern Rp_ChainLink *Rp_ChainAllocLink _ANSI_ARGS_((unsigned int extraSize));
@@ -11,7 +11,13 @@
  * ======================================================================
  */
 
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <algorithm>
 #include "RpCurve.h"
+#include "RpNumFormat.h"
+#include "RpEncode.h"
 
 using namespace Rappture;
 
@@ -241,6 +247,82 @@ Curve::getNthAxis(size_t n) const
     return (Array1D *) Rp_ChainGetValue(l);
 }
 
+/**********************************************************************/
+// METHOD: decimate()
+/// Reduce the curve to at most 2*nbins points for drawing.
+/**
+ * The points with x between xmin and xmax (the whole curve if xmin >=
+ * xmax) are split into nbins bins of the same number of points, and
+ * each bin is replaced by its lowest and highest y value, placed at
+ * the x of the middle of the bin.  With a bin per pixel column this
+ * draws the same picture as the full data, spikes included.  The
+ * points just outside the range are kept, so lines reach the edges.
+ * If there are no more than 2*nbins points, they're copied as is.
+ *
+ * The y axis keeps a min-max pyramid of its values (see
+ * Array1D::decimate()), built the first time and reused after that,
+ * so zooming doesn't touch every point.  The x values must be in
+ * increasing order when a range is given.
+ *
+ * x and y must have room for 2*nbins values.  Returns the number of
+ * points stored.
+ */
+
+size_t
+Curve::decimate(double xmin, double xmax, size_t nbins, double *x,
+                double *y) const
+{
+    Array1D *xaxis = getAxis(Curve::x);
+    Array1D *yaxis = getAxis(Curve::y);
+
+    if ((xaxis == NULL) || (yaxis == NULL) || (nbins == 0)) {
+        return 0;
+    }
+    const double *xd = xaxis->data();
+    const double *yd = yaxis->data();
+    size_t n = std::min(xaxis->nmemb(),yaxis->nmemb());
+    size_t first = 0;
+    size_t last = n;
+
+    if (xmin < xmax) {
+        first = std::lower_bound(xd,xd+n,xmin) - xd;
+        last = std::upper_bound(xd,xd+n,xmax) - xd;
+        if (first > 0) {
+            first--;
+        }
+        if (last < n) {
+            last++;
+        }
+    }
+    size_t count = last - first;
+    if (count <= 2*nbins) {
+        memcpy(x,xd+first,count*sizeof(double));
+        memcpy(y,yd+first,count*sizeof(double));
+        return count;
+    }
+
+    double *ymin = new double[nbins];
+    double *ymax = new double[nbins];
+    size_t npts = 0;
+
+    nbins = yaxis->decimate(first,count,nbins,ymin,ymax);
+    for (size_t i = 0; i < nbins; i++) {
+        if (ymin[i] != ymin[i]) {
+            continue;                   // no finite values in the bin
+        }
+        double xmid = xd[first + ((2*i+1)*count)/(2*nbins)];
+        x[npts] = xmid;
+        y[npts++] = ymin[i];
+        if (ymax[i] != ymin[i]) {
+            x[npts] = xmid;
+            y[npts++] = ymax[i];
+        }
+    }
+    delete[] ymin;
+    delete[] ymax;
+    return npts;
+}
+
 /**********************************************************************/
 // METHOD: dims()
 /// Return the dimensionality of the object
@@ -289,6 +371,7 @@ Curve::__configureFromXml(const char *xmltext)
     Rp_ParserXml *p = Rp_ParserXmlCreate();
     Rp_ParserXmlParse(p, xmltext);
     configure(RPCONFIG_TREE, p);
+    Rp_ParserXmlDestroy(&p);
 
     return;
 }
@@ -360,17 +443,108 @@ Curve::__configureFromTree(Rp_ParserXml *p)
     pathObj.add("xy");
     const char *values = Rp_ParserXmlGet(p,pathObj.path());
 
-    double x,y;
-    int n;
-    while (sscanf(values,"%lf%lf%n",&x,&y,&n) == 2) {
-        xaxis->append(&x,1);
-        yaxis->append(&y,1);
-        values += n;
+    if (values == NULL) {
+        return;
+    }
+    const char *enc = Rp_ParserXmlGetAttr(p,pathObj.path(),"encoding");
+    if ((enc != NULL) && (strcmp(enc,RPENC_DOUBLES) == 0)) {
+        // binary values, see RPENC_DOUBLES
+        Rappture::Buffer buf(values);
+        if (!encoding::decodeDoubles(_status,buf)) {
+            _status.addContext("Rappture::Curve::__configureFromTree()");
+            return;
+        }
+        const double *d = (const double *) buf.bytes();
+        size_t npts = buf.size()/(2*sizeof(double));
+        double xbuf[512];
+        double ybuf[512];
+        xaxis->reserve(npts);
+        yaxis->reserve(npts);
+        for (size_t i = 0; i < npts; i += 512) {
+            size_t n = (npts-i < 512) ? npts-i : 512;
+            for (size_t j = 0; j < n; j++) {
+                xbuf[j] = d[2*(i+j)];
+                ybuf[j] = d[2*(i+j)+1];
+            }
+            xaxis->append(xbuf,n);
+            yaxis->append(ybuf,n);
+        }
+    } else if (encoding::headerFlags(values,-1) != 0) {
+        // text stored with compression
+        Rappture::Buffer buf(values);
+        if (!encoding::decode(_status,buf,0)) {
+            _status.addContext("Rappture::Curve::__configureFromTree()");
+            return;
+        }
+        buf.append("",1);
+        __parseXY(buf.bytes(),xaxis,yaxis);
+    } else {
+        __parseXY(values,xaxis,yaxis);
     }
 
     return;
 }
 
+/**********************************************************************/
+// METHOD: __parseXY(const char *values, Array1D *xaxis, Array1D *yaxis)
+/// read pairs of numbers from the text of an xy element
+/**
+ * Reads x y pairs from values until the end of the string or the
+ * first word that isn't a number.  The words are counted first so
+ * each axis is allocated once, and the numbers are read in a single
+ * pass with strtod.  (A sscanf loop scans to the end of the string
+ * on every call, which made loading an N point curve O(N^2).)
+ */
+
+void
+Curve::__parseXY(const char *values, Array1D *xaxis, Array1D *yaxis)
+{
+    size_t nwords = 0;
+    const char *p = values;
+
+    while (1) {
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        nwords++;
+        while ((*p != '\0') && (!isspace((unsigned char)*p))) {
+            p++;
+        }
+    }
+    xaxis->reserve(nwords/2);
+    yaxis->reserve(nwords/2);
+
+    // append in blocks so min and max are updated a block at a time
+    double xbuf[512];
+    double ybuf[512];
+    size_t n = 0;
+    char *end = NULL;
+
+    p = values;
+    while (1) {
+        xbuf[n] = strtod(p,&end);
+        if (end == p) {
+            break;
+        }
+        p = end;
+        ybuf[n] = strtod(p,&end);
+        if (end == p) {
+            break;
+        }
+        p = end;
+        if (++n == 512) {
+            xaxis->append(xbuf,n);
+            yaxis->append(ybuf,n);
+            n = 0;
+        }
+    }
+    xaxis->append(xbuf,n);
+    yaxis->append(ybuf,n);
+}
+
 /**********************************************************************/
 // METHOD: dump(size_t as, void *p)
 /// construct a number object from the provided tree
@@ -484,20 +658,59 @@ Curve::__dumpToTree(ClientData c)
         p.del();
     }
 
-    SimpleCharBuffer tmpBuf;
-    for (size_t idx=0; idx < nmemb; idx++) {
-        for(size_t dim=0; dim < dims(); dim++) {
-            tmpBuf.appendf("%10g",dataArr[dim][idx]);
-        }
-        tmpBuf.appendf("\n");
-    }
     p.add("component");
     p.add("xy");
-    Rp_ParserXmlPutF(parser,p.path(),"%s",tmpBuf.bytes());
+    __putColumns(parser,p.path(),dataArr,dims(),nmemb);
+
+    // with the "lod" property set to a number of bins, a decimated
+    // copy of the data is written to <lod> next to <xy>, so a viewer
+    // can draw the whole curve without loading every point
+    const char *lod = propstr("lod");
+    size_t nbins = (lod != NULL) ? strtoul(lod,NULL,10) : 0;
+    if ((nbins > 0) && (dims() == 2) && (nmemb > 2*nbins)) {
+        double *lx = new double[2*nbins];
+        double *ly = new double[2*nbins];
+        size_t npts = decimate(0,0,nbins,lx,ly);
+        const double *lodArr[2] = { lx, ly };
+
+        p.del();
+        p.add("lod");
+        __putColumns(parser,p.path(),lodArr,2,npts);
+        delete[] lx;
+        delete[] ly;
+    }
 
     return;
 }
 
+/**********************************************************************/
+// METHOD: __putColumns()
+/// Store columns of values at path in the tree.
+/**
+ * The values are written as text, or as binary when the "encoding"
+ * property is set to RPENC_DOUBLES.
+ */
+
+void
+Curve::__putColumns(Rp_ParserXml *parser, const char *path,
+                    const double **columns, size_t ncols, size_t nrows)
+{
+    const char *enc = propstr("encoding");
+    if ((enc != NULL) && (strcmp(enc,RPENC_DOUBLES) == 0)) {
+        Rappture::Buffer encBuf;
+        if (encoding::encodeDoubles(_status,encBuf,columns,ncols,nrows)) {
+            encBuf.append("",1);
+            Rp_ParserXmlPut(parser,path,encBuf.bytes(),0);
+            Rp_ParserXmlPutAttr(parser,path,"encoding",RPENC_DOUBLES);
+            return;
+        }
+    }
+
+    SimpleCharBuffer tmpBuf;
+    numformat::appendColumns(tmpBuf,columns,ncols,nrows,10);
+    Rp_ParserXmlPutF(parser,path,"%s",tmpBuf.bytes());
+}
+
 /**********************************************************************/
 // METHOD: is()
 /// what kind of object is this
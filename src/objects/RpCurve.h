@@ -43,6 +43,9 @@ class Curve : public Object
         Array1D *getAxis(const char *name) const;
         Array1D *getNthAxis(size_t n) const;
 
+        size_t decimate(double xmin, double xmax, size_t nbins,
+                        double *x, double *y) const;
+
         // should be a list of groups to add this curve to?
         Accessor <const char *> group;
         size_t dims() const;
@@ -64,8 +67,12 @@ class Curve : public Object
 
         void __configureFromXml(const char *p);
         void __configureFromTree(Rp_ParserXml *p);
+        void __parseXY(const char *values, Array1D *xaxis, Array1D *yaxis);
         void __dumpToXml(ClientData c);
         void __dumpToTree(ClientData c);
+        void __putColumns(Rp_ParserXml *parser, const char *path,
+                          const double **columns, size_t ncols,
+                          size_t nrows);
 };
 
 
@@ -6,7 +6,8 @@
  * This module implements an in-memory hash table for the BLT
  * toolkit.  Built upon the Tcl hash table, it adds pool
  * allocation 64-bit address handling, improved array hash
- * function.
+ * function.  The buckets are kept in an open-addressed array
+ * probed a group of slots at a time, instead of chains.
  *
  * Copyright 2001 Silicon Metrics Corporation.
  *
@@ -49,29 +50,51 @@
 
 #include "RpHash.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /*
- * When there are this many entries per bucket, on average, rebuild
- * the hash table to make it larger.
+ * The table is open-addressed.  Slots hold pointers to the entries,
+ * so an entry never moves once created, and each slot has a control
+ * byte that is either CTRL_EMPTY, CTRL_DELETED, or the low 7 bits of
+ * the hash of the entry in it.  Slots are probed a group of
+ * RP_SMALL_HASH_TABLE at a time: the group's control bytes are
+ * compared all at once with the 7 bits being looked for, and only the
+ * slots that match are looked at.  The control bytes are stored just
+ * ahead of the slots of their group, so that both are usually in the
+ * same cache line.  The rest of the hash picks the first group, and
+ * groups are probed in triangular order from there.
+ *
+ * A lookup stops at the first group with an empty slot.  A group
+ * with no empty slot only ever gets one again when the table is
+ * rebuilt, or when an entry is deleted from it while it still has an
+ * empty slot; otherwise the deleted slot is marked CTRL_DELETED so
+ * that lookups keep going past it.
  */
 
-#define REBUILD_MULTIPLIER  3
+#define GROUP_SIZE          RP_SMALL_HASH_TABLE
+#define CTRL_EMPTY          ((unsigned char)0x80)
+#define CTRL_DELETED        ((unsigned char)0xFE)
 
-#if (SIZEOF_VOID_P == 8)
-#define RANDOM_INDEX        HashOneWord
-#define DOWNSHIFT_START     62
-#else
+#define GROUP_INDEX(h)      ((size_t)((h) >> 7))
+#define CTRL(t, i)          ((t)->buckets[(i) / GROUP_SIZE].ctrl[(i) % GROUP_SIZE])
+#define SLOT(t, i)          ((t)->buckets[(i) / GROUP_SIZE].slots[(i) % GROUP_SIZE])
+#define CTRL_BITS(h)        ((unsigned char)((h) & 0x7F))
 
 /*
- * The following macro takes a preliminary integer hash value and
- * produces an index into a hash tables bucket list.  The idea is
- * to make it so that preliminary values that are arbitrarily similar
- * will end up in different buckets.  The hash function was taken
- * from a random-number generator.
+ * Rebuild the table when it is 7/8 full, counting deleted slots.
  */
-#define RANDOM_INDEX(tablePtr, i) \
-    (((((long) (i))*1103515245) >> (tablePtr)->downShift) & (tablePtr)->mask)
-#define DOWNSHIFT_START     28
-#endif
+#define MAX_LOAD(n)         ((n) - ((n) >> 3))
+
+/*
+ * Ways of comparing keys.  These are passed as constants to the
+ * inline probing routines below, so that each kind of key gets its
+ * own copy of the loop.
+ */
+#define KEY_STRING          0
+#define KEY_ONE_WORD        1
+#define KEY_ARRAY           2
 
 /*
  * Procedure prototypes for static procedures in this file:
@@ -96,11 +119,105 @@ static Rp_HashEntry *OneWordFind _ANSI_ARGS_((Rp_HashTable *tablePtr,
 static Rp_HashEntry *OneWordCreate _ANSI_ARGS_((Rp_HashTable *tablePtr,
     CONST void *key, int *newPtr));
 
-#if (SIZEOF_VOID_P == 8)
-static Rp_Hash HashOneWord _ANSI_ARGS_((Rp_HashTable *tablePtr,
-    CONST void *key));
+/*
+ *----------------------------------------------------------------------
+ *
+ * MatchByte, MatchEmpty, MatchFree, MatchFull --
+ *
+ *  Compare the control bytes of a group of slots.  Bit i of the
+ *  result is set if the i-th slot of the group holds the given
+ *  hash bits, is empty, is empty or deleted, or holds an entry.
+ *  With SSE2 the whole group is compared with one instruction.
+ *
+ *----------------------------------------------------------------------
+ */
+#if defined(__SSE2__)
 
-#endif /* SIZEOF_VOID_P == 8 */
+static INLINE unsigned int
+MatchByte(CONST unsigned char *ctrl, unsigned char bits)
+{
+    __m128i group = _mm_loadu_si128((CONST __m128i *)ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(bits)));
+}
+
+static INLINE unsigned int
+MatchFree(CONST unsigned char *ctrl)
+{
+    return _mm_movemask_epi8(_mm_loadu_si128((CONST __m128i *)ctrl));
+}
+
+#else
+
+static INLINE unsigned int
+MatchByte(CONST unsigned char *ctrl, unsigned char bits)
+{
+    unsigned int i, mask;
+
+    mask = 0;
+    for (i = 0; i < GROUP_SIZE; i++) {
+        mask |= (unsigned int)(ctrl[i] == bits) << i;
+    }
+    return mask;
+}
+
+static INLINE unsigned int
+MatchFree(CONST unsigned char *ctrl)
+{
+    unsigned int i, mask;
+
+    mask = 0;
+    for (i = 0; i < GROUP_SIZE; i++) {
+        mask |= (unsigned int)(ctrl[i] >> 7) << i;
+    }
+    return mask;
+}
+
+#endif /* __SSE2__ */
+
+#define MatchEmpty(ctrl)    MatchByte((ctrl), CTRL_EMPTY)
+#define MatchFull(ctrl)     (~MatchFree(ctrl) & ((1U << GROUP_SIZE) - 1))
+
+/*
+ * Index of the lowest bit set in a non-zero match.
+ */
+#if defined(__GNUC__)
+#define LowestBit(mask)     ((unsigned int)__builtin_ctz(mask))
+#else
+static INLINE unsigned int
+LowestBit(unsigned int mask)
+{
+    unsigned int i;
+
+    for (i = 0; (mask & 1) == 0; i++) {
+        mask >>= 1;
+    }
+    return i;
+}
+#endif
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MixHash --
+ *
+ *  Spread the bits of a hash value, so that both the 7 bits kept
+ *  in the control byte and the bits that select the first group
+ *  depend on all of the key.  Pointers used as one-word keys are
+ *  aligned, and string hashes are weak in their high bits.
+ *
+ *----------------------------------------------------------------------
+ */
+static INLINE Rp_Hash
+MixHash(Rp_Hash hval)
+{
+#if (SIZEOF_VOID_P == 8)
+    hval *= 0x9e3779b97f4a7c15ULL;
+    return hval ^ (hval >> 32);
+#else
+    hval *= 0x9e3779b9U;
+    return hval ^ (hval >> 16);
+#endif
+}
 
 /*
  *----------------------------------------------------------------------
@@ -146,7 +263,183 @@ HashString(register CONST char *string) /* String from which to
     while ((c = *string++) != 0) {
         result += (result << 3) + c;
     }
-    return (Rp_Hash)result;
+    return MixHash(result);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * KeysMatch --
+ *
+ *  Compare a key with the key of an entry whose hash value is
+ *  the same.
+ *
+ * Results:
+ *  Returns non-zero if the keys are equal.
+ *
+ *----------------------------------------------------------------------
+ */
+static INLINE int
+KeysMatch(
+    Rp_HashTable *tablePtr,
+    int kind,                   /* KEY_STRING, KEY_ONE_WORD or
+                                 * KEY_ARRAY. */
+    CONST void *key,
+    Rp_HashEntry *hPtr)
+{
+    switch (kind) {
+    case KEY_ONE_WORD:
+        return (hPtr->key.oneWordValue == key);
+    case KEY_STRING:
+        return (strcmp(hPtr->key.string, key) == 0);
+    default:
+        return (memcmp(hPtr->key.words, key,
+                       tablePtr->keyType * sizeof(uint32_t)) == 0);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * LookupEntry --
+ *
+ *  Probe the table for the entry with the given key and hash
+ *  value.
+ *
+ * Results:
+ *  The return value is the matching entry, or NULL if there is
+ *  none.
+ *
+ * Side effects:
+ *  None.
+ *
+ *----------------------------------------------------------------------
+ */
+static INLINE Rp_HashEntry *
+LookupEntry(
+    Rp_HashTable *tablePtr,
+    int kind,
+    CONST void *key,
+    Rp_Hash hval)
+{
+    size_t group, step;
+    unsigned char bits;
+
+    bits = CTRL_BITS(hval);
+    group = GROUP_INDEX(hval) & tablePtr->mask;
+    for (step = 1; /*empty*/; step++) {
+        Rp_HashGroup *groupPtr;
+        unsigned int match;
+
+        groupPtr = tablePtr->buckets + group;
+        for (match = MatchByte(groupPtr->ctrl, bits); match != 0;
+             match &= match - 1) {
+            Rp_HashEntry *hPtr;
+
+            hPtr = groupPtr->slots[LowestBit(match)];
+            if ((hPtr->hval == hval) && (KeysMatch(tablePtr, kind, key, hPtr))) {
+                return hPtr;
+            }
+        }
+        if ((MatchEmpty(groupPtr->ctrl) != 0) || (step > tablePtr->mask)) {
+            return NULL;
+        }
+        group = (group + step) & tablePtr->mask;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindFreeSlot --
+ *
+ *  Probe the table for the first empty or deleted slot for an
+ *  entry with the given hash value.  There is always one, since
+ *  the table is never allowed to fill up.
+ *
+ * Results:
+ *  The return value is the index of the slot.
+ *
+ * Side effects:
+ *  None.
+ *
+ *----------------------------------------------------------------------
+ */
+static INLINE size_t
+FindFreeSlot(Rp_HashTable *tablePtr, Rp_Hash hval)
+{
+    size_t group, step;
+
+    group = GROUP_INDEX(hval) & tablePtr->mask;
+    for (step = 1; /*empty*/; step++) {
+        unsigned int match;
+
+        match = MatchFree(tablePtr->buckets[group].ctrl);
+        if (match != 0) {
+            return group * GROUP_SIZE + LowestBit(match);
+        }
+        group = (group + step) & tablePtr->mask;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * InsertEntry --
+ *
+ *  Add a new entry to the table, rebuilding the table first if
+ *  there's no more room.
+ *
+ * Results:
+ *  None.
+ *
+ * Side effects:
+ *  The table may be rebuilt.
+ *
+ *----------------------------------------------------------------------
+ */
+static INLINE void
+InsertEntry(Rp_HashTable *tablePtr, Rp_HashEntry *hPtr)
+{
+    size_t i;
+
+    i = FindFreeSlot(tablePtr, hPtr->hval);
+    if ((CTRL(tablePtr, i) == CTRL_EMPTY) && (tablePtr->growthLeft == 0)) {
+        RebuildTable(tablePtr);
+        i = FindFreeSlot(tablePtr, hPtr->hval);
+    }
+    if (CTRL(tablePtr, i) == CTRL_EMPTY) {
+        tablePtr->growthLeft--;
+    }
+    CTRL(tablePtr, i) = CTRL_BITS(hPtr->hval);
+    SLOT(tablePtr, i) = hPtr;
+    tablePtr->numEntries++;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewEntry --
+ *
+ *  Allocate an entry of the given size, from the table's pool if
+ *  it has one.
+ *
+ *----------------------------------------------------------------------
+ */
+static INLINE Rp_HashEntry *
+NewEntry(Rp_HashTable *tablePtr, size_t size, Rp_Hash hval)
+{
+    Rp_HashEntry *hPtr;
+
+    if (tablePtr->hPool != NULL) {
+        hPtr = Rp_PoolAllocItem(tablePtr->hPool, size);
+    } else {
+        hPtr = Rp_Malloc(size);
+    }
+    hPtr->hval = hval;
+    hPtr->clientData = 0;
+    return hPtr;
 }
 
 /*
@@ -171,33 +464,7 @@ StringFind(
     Rp_HashTable *tablePtr, /* Table in which to lookup entry. */
     CONST void *key)        /* Key to use to find matching entry. */
 {
-    Rp_Hash hval;
-    register Rp_HashEntry *hPtr;
-    size_t hindex;
-
-    hval = HashString((char *)key);
-    hindex = hval & tablePtr->mask;
-
-    /*
-     * Search all of the entries in the appropriate bucket.
-     */
-
-    for (hPtr = tablePtr->buckets[hindex]; hPtr != NULL;
-        hPtr = hPtr->nextPtr) {
-        if (hPtr->hval == hval) {
-            register CONST char *p1, *p2;
-
-            for (p1 = key, p2 = hPtr->key.string; ; p1++, p2++) {
-                if (*p1 != *p2) {
-                    break;
-                }
-                if (*p1 == '\0') {
-                    return hPtr;
-                }
-            }
-        }
-    }
-    return NULL;
+    return LookupEntry(tablePtr, KEY_STRING, key, HashString(key));
 }
 
 /*
@@ -229,132 +496,28 @@ StringCreate(
                              * entry was created. */
 {
     Rp_Hash hval;
-    Rp_HashEntry **bucketPtr;
     register Rp_HashEntry *hPtr;
-    size_t size, hindex;
+    size_t size;
 
     hval = HashString(key);
-    hindex = hval & tablePtr->mask;
-
-    /*
-     * Search all of the entries in this bucket.
-     */
-
-    for (hPtr = tablePtr->buckets[hindex]; hPtr != NULL;
-        hPtr = hPtr->nextPtr) {
-        if (hPtr->hval == hval) {
-            register CONST char *p1, *p2;
-
-            for (p1 = key, p2 = hPtr->key.string; ; p1++, p2++) {
-                if (*p1 != *p2) {
-                    break;
-                }
-                if (*p1 == '\0') {
-                    *newPtr = FALSE;
-                    return hPtr;
-                }
-            }
-        }
+    hPtr = LookupEntry(tablePtr, KEY_STRING, key, hval);
+    if (hPtr != NULL) {
+        *newPtr = FALSE;
+        return hPtr;
     }
 
     /*
-     * Entry not found.  Add a new one to the bucket.
+     * Entry not found.  Add a new one to the table.
      */
 
     *newPtr = TRUE;
     size = sizeof(Rp_HashEntry) + strlen(key) - sizeof(Rp_HashKey) + 1;
-    if (tablePtr->hPool != NULL) {
-        hPtr = Rp_PoolAllocItem(tablePtr->hPool, size);
-    } else {
-        hPtr = Rp_Malloc(size);
-    }
-    bucketPtr = tablePtr->buckets + hindex;
-    hPtr->nextPtr = *bucketPtr;
-    hPtr->hval = hval;
-    hPtr->clientData = 0;
+    hPtr = NewEntry(tablePtr, size, hval);
     strcpy(hPtr->key.string, key);
-    *bucketPtr = hPtr;
-    tablePtr->numEntries++;
-
-    /*
-     * If the table has exceeded a decent size, rebuild it with many
-     * more buckets.
-     */
-
-    if (tablePtr->numEntries >= tablePtr->rebuildSize) {
-        RebuildTable(tablePtr);
-    }
+    InsertEntry(tablePtr, hPtr);
     return hPtr;
 }
 
-#if (SIZEOF_VOID_P == 8)
-/*
- *----------------------------------------------------------------------
- *
- * HashOneWord --
- *
- *  Compute a one-word hash value of a 64-bit word, which then can
- *  be used to generate a hash index.
- *
- *  From Knuth, it's a multiplicative hash.  Multiplies an unsigned
- *  64-bit value with the golden ratio (sqrt(5) - 1) / 2.  The
- *  downshift value is 64 - n, when n is the log2 of the size of
- *  the hash table.
- *
- * Results:
- *  The return value is a one-word summary of the information in
- *  64 bit word.
- *
- * Side effects:
- *  None.
- *
- *----------------------------------------------------------------------
- */
-static Rp_Hash
-HashOneWord(
-    Rp_HashTable *tablePtr,
-    CONST void *key)
-{
-    uint64_t a0, a1;
-    uint64_t y0, y1;
-    uint64_t y2, y3;
-    uint64_t p1, p2;
-    uint64_t result;
-    /* Compute key * GOLDEN_RATIO in 128-bit arithmetic */
-    a0 = (uint64_t)key & 0x00000000FFFFFFFF; 
-    a1 = (uint64_t)key >> 32;
-
-    y0 = a0 * 0x000000007f4a7c13;
-    y1 = a0 * 0x000000009e3779b9;
-    y2 = a1 * 0x000000007f4a7c13;
-    y3 = a1 * 0x000000009e3779b9;
-    y1 += y0 >> 32;     /* Can't carry */
-    y1 += y2;           /* Might carry */
-    if (y1 < y2) {
-        y3 += (1LL << 32);  /* Propagate */
-    }
-
-    /* 128-bit product: p1 = loword, p2 = hiword */
-    p1 = ((y1 & 0x00000000FFFFFFFF) << 32) + (y0 & 0x00000000FFFFFFFF);
-    p2 = y3 + (y1 >> 32);
-
-    /* Left shift the value downward by the size of the table */
-    if (tablePtr->downShift > 0) {
-        if (tablePtr->downShift < 64) {
-            result = ((p2 << (64 - tablePtr->downShift)) |
-                      (p1 >> (tablePtr->downShift & 63)));
-        } else {
-            result = p2 >> (tablePtr->downShift & 63);
-        }
-    } else {
-        result = p1;
-    }
-    /* Finally mask off the high bits */
-    return (Rp_Hash)(result & tablePtr->mask);
-}
-
-#endif /* SIZEOF_VOID_P == 8 */
-
 /*
  *----------------------------------------------------------------------
  *
@@ -377,21 +540,7 @@ OneWordFind(
     Rp_HashTable *tablePtr,     /* Table in which to lookup entry. */
     register CONST void *key)   /* Key to use to find matching entry. */
 {
-    register Rp_HashEntry *hPtr;
-    size_t hindex;
-
-    hindex = RANDOM_INDEX(tablePtr, key);
-
-    /*
-     * Search all of the entries in the appropriate bucket.
-     */
-    for (hPtr = tablePtr->buckets[hindex]; hPtr != NULL;
-        hPtr = hPtr->nextPtr) {
-        if (hPtr->key.oneWordValue == key) {
-            return hPtr;
-        }
-    }
-    return NULL;
+    return LookupEntry(tablePtr, KEY_ONE_WORD, key, MixHash((Rp_Hash)key));
 }
 
 /*
@@ -422,53 +571,27 @@ OneWordCreate(
     int *newPtr)            /* Store info here telling whether a new
                              * entry was created. */
 {
-    Rp_HashEntry **bucketPtr;
+    Rp_Hash hval;
     register Rp_HashEntry *hPtr;
-    size_t hindex;
 
-    hindex = RANDOM_INDEX(tablePtr, key);
-
-    /*
-     * Search all of the entries in this bucket.
-     */
-    for (hPtr = tablePtr->buckets[hindex]; hPtr != NULL;
-        hPtr = hPtr->nextPtr) {
-        if (hPtr->key.oneWordValue == key) {
-            *newPtr = FALSE;
-            return hPtr;
-        }
+    hval = MixHash((Rp_Hash)key);
+    hPtr = LookupEntry(tablePtr, KEY_ONE_WORD, key, hval);
+    if (hPtr != NULL) {
+        *newPtr = FALSE;
+        return hPtr;
     }
 
     /*
-     * Entry not found.  Add a new one to the bucket.
+     * Entry not found.  Add a new one to the table.
      */
 
     *newPtr = TRUE;
-    if (tablePtr->hPool != NULL) {
-        hPtr = Rp_PoolAllocItem(tablePtr->hPool, sizeof(Rp_HashEntry));
-    } else {
-        hPtr = Rp_Malloc(sizeof(Rp_HashEntry));
-    }
-    bucketPtr = tablePtr->buckets + hindex;
-    hPtr->nextPtr = *bucketPtr;
-    hPtr->hval = (Rp_Hash)key;
-    hPtr->clientData = 0;
+    hPtr = NewEntry(tablePtr, sizeof(Rp_HashEntry), hval);
     hPtr->key.oneWordValue = (void *)key;   /* CONST XXXX */
-    *bucketPtr = hPtr;
-    tablePtr->numEntries++;
-
-    /*
-     * If the table has exceeded a decent size, rebuild it with many
-     * more buckets.
-     */
-
-    if (tablePtr->numEntries >= tablePtr->rebuildSize) {
-        RebuildTable(tablePtr);
-    }
+    InsertEntry(tablePtr, hPtr);
     return hPtr;
 }
 
-
 #if (SIZEOF_VOID_P == 4)
 /*
  * --------------------------------------------------------------------
@@ -703,34 +826,8 @@ ArrayFind(
     Rp_HashTable *tablePtr, /* Table in which to lookup entry. */
     CONST void *key)        /* Key to use to find matching entry. */
 {
-    Rp_Hash hval;
-    register Rp_HashEntry *hPtr;
-    size_t hindex;
-
-    hval = HashArray(key, tablePtr->keyType);
-    hindex = hval & tablePtr->mask;
-    /*
-     * Search all of the entries in the appropriate bucket.
-     */
-
-    for (hPtr = tablePtr->buckets[hindex]; hPtr != NULL;
-        hPtr = hPtr->nextPtr) {
-        if (hPtr->hval == hval) {
-            register unsigned int *iPtr1, *iPtr2;
-            unsigned int count;
-
-            for (iPtr1 = (uint32_t *)key, iPtr2 = (uint32_t *)hPtr->key.words,
-                 count = tablePtr->keyType; ; count--, iPtr1++, iPtr2++) {
-                if (count == 0) {
-                    return hPtr;
-                }
-                if (*iPtr1 != *iPtr2) {
-                    break;
-                }
-            }
-        }
-    }
-    return NULL;
+    return LookupEntry(tablePtr, KEY_ARRAY, key,
+                       HashArray(key, tablePtr->keyType));
 }
 
 /*
@@ -762,65 +859,26 @@ ArrayCreate(
                                  * entry was created. */
 {
     Rp_Hash hval;
-    Rp_HashEntry **bucketPtr;
-    int count;
     register Rp_HashEntry *hPtr;
-    register uint32_t *iPtr1, *iPtr2;
-    size_t size, hindex;
+    size_t size;
 
     hval = HashArray(key, tablePtr->keyType);
-    hindex = hval & tablePtr->mask;
-
-    /*
-     * Search all of the entries in the appropriate bucket.
-     */
-    for (hPtr = tablePtr->buckets[hindex]; hPtr != NULL;
-        hPtr = hPtr->nextPtr) {
-        if (hPtr->hval == hval) {
-            for (iPtr1 = (uint32_t *)key, iPtr2 = (uint32_t *)hPtr->key.words,
-                 count = tablePtr->keyType; ; count--, iPtr1++, iPtr2++) {
-                if (count == 0) {
-                    *newPtr = FALSE;
-                    return hPtr;
-                }
-                if (*iPtr1 != *iPtr2) {
-                    break;
-                }
-            }
-        }
+    hPtr = LookupEntry(tablePtr, KEY_ARRAY, key, hval);
+    if (hPtr != NULL) {
+        *newPtr = FALSE;
+        return hPtr;
     }
 
     /*
-     * Entry not found.  Add a new one to the bucket.
+     * Entry not found.  Add a new one to the table.
      */
     *newPtr = TRUE;
     /* We assume here that the size of the key is at least 2 words */
     size = sizeof(Rp_HashEntry) + tablePtr->keyType * sizeof(uint32_t) -
         sizeof(Rp_HashKey);
-    if (tablePtr->hPool != NULL) {
-        hPtr = Rp_PoolAllocItem(tablePtr->hPool, size);
-    } else {
-        hPtr = Rp_Malloc(size);
-    }
-    bucketPtr = tablePtr->buckets + hindex;
-    hPtr->nextPtr = *bucketPtr;
-    hPtr->hval = hval;
-    hPtr->clientData = 0;
-    count = tablePtr->keyType;
-    for (iPtr1 = (uint32_t *)key, iPtr2 = (uint32_t *)hPtr->key.words;
-         count > 0; count--, iPtr1++, iPtr2++) {
-        *iPtr2 = *iPtr1;
-    }
-    *bucketPtr = hPtr;
-    tablePtr->numEntries++;
-
-    /*
-     * If the table has exceeded a decent size, rebuild it with many
-     * more buckets.
-     */
-    if (tablePtr->numEntries >= tablePtr->rebuildSize) {
-        RebuildTable(tablePtr);
-    }
+    hPtr = NewEntry(tablePtr, size, hval);
+    memcpy(hPtr->key.words, key, tablePtr->keyType * sizeof(uint32_t));
+    InsertEntry(tablePtr, hPtr);
     return hPtr;
 }
 
@@ -886,83 +944,82 @@ BogusCreate(
  *
  * RebuildTable --
  *
- *  This procedure is invoked when the ratio of entries to hash
- *  buckets becomes too large.  It creates a new table with a
- *  larger bucket array and moves all of the entries into the
- *  new table.
+ *  This procedure is invoked when there are no more empty slots
+ *  that can be used.  If at least half of the used slots hold
+ *  deleted entries, the slots are rebuilt in place to get rid of
+ *  them.  Otherwise the slot array is doubled in size.
  *
  * Results:
  *  None.
  *
  * Side effects:
  *  Memory gets reallocated and entries get re-hashed to new
- *  buckets.
+ *  slots.
  *
  *----------------------------------------------------------------------
  */
 static void
 RebuildTable(Rp_HashTable *tablePtr) /* Table to enlarge. */
 {
-    Rp_HashEntry **bucketPtr, **oldBuckets;
-    register Rp_HashEntry **oldChainPtr, **endPtr;
-    register Rp_HashEntry *hPtr, *nextPtr;
-    size_t hindex;
+    Rp_HashGroup *oldBuckets, smallBuckets[1];
+    size_t oldGroups, newGroups, i;
 
     oldBuckets = tablePtr->buckets;
-    endPtr = tablePtr->buckets + tablePtr->numBuckets;
+    oldGroups = tablePtr->numBuckets / GROUP_SIZE;
+    if (oldBuckets == tablePtr->staticBuckets) {
+        smallBuckets[0] = tablePtr->staticBuckets[0];
+        oldBuckets = smallBuckets;
+    }
+
+    newGroups = oldGroups;
+    if (tablePtr->numEntries > MAX_LOAD(tablePtr->numBuckets) / 2) {
+        newGroups <<= 1;
+    }
+
     /*
-     * Allocate and initialize the new bucket array, and set up
+     * Allocate and initialize the new slot array, and set up
      * hashing constants for new array size.
      */
-    tablePtr->numBuckets <<= 2;
-    tablePtr->buckets = Rp_Calloc(tablePtr->numBuckets,
-                           sizeof(Rp_HashEntry *));
-    tablePtr->rebuildSize <<= 2;
-    tablePtr->downShift -= 2;
-    tablePtr->mask = tablePtr->numBuckets - 1;
+    if (newGroups == 1) {
+        tablePtr->buckets = tablePtr->staticBuckets;
+    } else {
+        tablePtr->buckets = Rp_Malloc(newGroups * sizeof(Rp_HashGroup));
+    }
+    for (i = 0; i < newGroups; i++) {
+        memset(tablePtr->buckets[i].ctrl, CTRL_EMPTY, GROUP_SIZE);
+    }
+    tablePtr->numBuckets = newGroups * GROUP_SIZE;
+    tablePtr->mask = (Rp_Hash)(newGroups - 1);
+    tablePtr->growthLeft = MAX_LOAD(tablePtr->numBuckets) -
+        tablePtr->numEntries;
 
     /*
-     * Move all of the existing entries into the new bucket array,
+     * Move all of the existing entries into the new slot array,
      * based on their hash values.
      */
-    if (tablePtr->keyType == RP_ONE_WORD_KEYS) {
-    /*
-     * RP_ONE_WORD_KEYS are handled slightly differently because
-     * they use the current table size (number of buckets) to be
-     * distributed.
-     */
-        for (oldChainPtr = oldBuckets; oldChainPtr < endPtr; oldChainPtr++) {
-            for (hPtr = *oldChainPtr; hPtr != NULL; hPtr = nextPtr) {
-                nextPtr = hPtr->nextPtr;
-                hindex = RANDOM_INDEX(tablePtr, hPtr->key.oneWordValue);
-                bucketPtr = tablePtr->buckets + hindex;
-                hPtr->nextPtr = *bucketPtr;
-                *bucketPtr = hPtr;
-            }
-        }
-    } else {
-        for (oldChainPtr = oldBuckets; oldChainPtr < endPtr; oldChainPtr++) {
-            for (hPtr = *oldChainPtr; hPtr != NULL; hPtr = nextPtr) {
-                nextPtr = hPtr->nextPtr;
-                hindex = hPtr->hval & tablePtr->mask;
-                bucketPtr = tablePtr->buckets + hindex;
-                hPtr->nextPtr = *bucketPtr;
-                *bucketPtr = hPtr;
-            }
+    for (i = 0; i < oldGroups; i++) {
+        unsigned int match;
+
+        for (match = MatchFull(oldBuckets[i].ctrl); match != 0;
+             match &= match - 1) {
+            Rp_HashEntry *hPtr;
+            size_t j;
+
+            hPtr = oldBuckets[i].slots[LowestBit(match)];
+            j = FindFreeSlot(tablePtr, hPtr->hval);
+            CTRL(tablePtr, j) = CTRL_BITS(hPtr->hval);
+            SLOT(tablePtr, j) = hPtr;
         }
     }
 
     /*
-     * Free up the old bucket array, if it was dynamically allocated.
+     * Free up the old slot array, if it was dynamically allocated.
      */
-    if (oldBuckets != tablePtr->staticBuckets) {
+    if (oldBuckets != smallBuckets) {
         Rp_Free(oldBuckets);
     }
 }
 
-
-/* Public hash table routines */
-
 /*
  *----------------------------------------------------------------------
  *
@@ -986,22 +1043,16 @@ Rp_InitHashTable(
                                          * is supplied by the caller. */
     size_t keyType)                     /* Type of keys to use in table. */
 {
-#if (RP_SMALL_HASH_TABLE != 4)
-    Rp_Panic("Rp_InitHashTable: RP_SMALL_HASH_TABLE is %d, not 4\n",
-        RP_SMALL_HASH_TABLE);
-#endif
     tablePtr->buckets = tablePtr->staticBuckets;
     tablePtr->numBuckets = RP_SMALL_HASH_TABLE;
-    tablePtr->staticBuckets[0] = tablePtr->staticBuckets[1] = 0;
-    tablePtr->staticBuckets[2] = tablePtr->staticBuckets[3] = 0;
+    memset(tablePtr->staticBuckets[0].ctrl, CTRL_EMPTY, RP_SMALL_HASH_TABLE);
     tablePtr->numEntries = 0;
-    tablePtr->rebuildSize = RP_SMALL_HASH_TABLE * REBUILD_MULTIPLIER;
-    tablePtr->downShift = DOWNSHIFT_START;
+    tablePtr->growthLeft = MAX_LOAD(RP_SMALL_HASH_TABLE);
 
-    /* The number of buckets is always a power of 2, so we can
+    /* The number of groups is always a power of 2, so we can
      * generate the mask by simply subtracting 1 from the number of
-     * buckets. */
-    tablePtr->mask = (Rp_Hash)(tablePtr->numBuckets - 1);
+     * groups. */
+    tablePtr->mask = (Rp_Hash)(RP_SMALL_HASH_TABLE / GROUP_SIZE - 1);
     tablePtr->keyType = keyType;
 
     switch (keyType) {
@@ -1033,7 +1084,7 @@ Rp_InitHashTable(
  * Rp_InitHashTableWithPool --
  *
  *  Given storage for a hash table, set up the fields to prepare
- *  the hash table for use.  The only difference between this 
+ *  the hash table for use.  The only difference between this
  *  routine and Rp_InitHashTable is that is uses a pool allocator
  *  to allocate memory for hash table entries.  The type of pool
  *  is either fixed or variable size (string) keys.
@@ -1084,28 +1135,40 @@ Rp_DeleteHashEntry(
     Rp_HashTable *tablePtr,
     Rp_HashEntry *entryPtr)
 {
-    register Rp_HashEntry *prevPtr;
-    Rp_HashEntry **bucketPtr;
-    size_t hindex;
+    size_t group, step, i;
+    unsigned char bits;
 
-    if (tablePtr->keyType == RP_ONE_WORD_KEYS) {
-        hindex = RANDOM_INDEX(tablePtr, (CONST void *)entryPtr->hval);
-    } else {
-        hindex = (entryPtr->hval & tablePtr->mask);
-    }
-    bucketPtr = tablePtr->buckets + hindex;
-    if (*bucketPtr == entryPtr) {
-        *bucketPtr = entryPtr->nextPtr;
-    } else {
-        for (prevPtr = *bucketPtr; /*empty*/; prevPtr = prevPtr->nextPtr) {
-            if (prevPtr == NULL) {
-                Rp_Panic("malformed bucket chain in Rp_DeleteHashEntry");
-            }
-            if (prevPtr->nextPtr == entryPtr) {
-                prevPtr->nextPtr = entryPtr->nextPtr;
-                break;
+    /*
+     * Follow the entry's probe sequence to the slot holding it.
+     */
+    bits = CTRL_BITS(entryPtr->hval);
+    group = GROUP_INDEX(entryPtr->hval) & tablePtr->mask;
+    for (step = 1; /*empty*/; step++) {
+        unsigned int match;
+
+        match = MatchByte(tablePtr->buckets[group].ctrl, bits);
+        for (/*empty*/; match != 0; match &= match - 1) {
+            i = group * GROUP_SIZE + LowestBit(match);
+            if (SLOT(tablePtr, i) == entryPtr) {
+                goto found;
             }
         }
+        if (step > tablePtr->mask) {
+            Rp_Panic("entry not found in Rp_DeleteHashEntry");
+        }
+        group = (group + step) & tablePtr->mask;
+    }
+ found:
+
+    /*
+     * If the group still has an empty slot, no lookup ever went past
+     * it and the slot can be made empty again.
+     */
+    if (MatchEmpty(tablePtr->buckets[group].ctrl) != 0) {
+        CTRL(tablePtr, i) = CTRL_EMPTY;
+        tablePtr->growthLeft++;
+    } else {
+        CTRL(tablePtr, i) = CTRL_DELETED;
     }
     tablePtr->numEntries--;
     if (tablePtr->hPool != NULL) {
@@ -1141,25 +1204,24 @@ Rp_DeleteHashTable(Rp_HashTable *tablePtr)	/* Table to delete. */
         Rp_PoolDestroy(tablePtr->hPool);
         tablePtr->hPool = NULL;
     } else {
-        register Rp_HashEntry *hPtr, *nextPtr;
         size_t i;
 
         for (i = 0; i < tablePtr->numBuckets; i++) {
-            hPtr = tablePtr->buckets[i];
-            while (hPtr != NULL) {
-                nextPtr = hPtr->nextPtr;
-                Rp_Free(hPtr);
-                hPtr = nextPtr;
+            if ((CTRL(tablePtr, i) & CTRL_EMPTY) == 0) {
+                Rp_Free(SLOT(tablePtr, i));
             }
         }
     }
 
     /*
-     * Free up the bucket array, if it was dynamically allocated.
+     * Free up the slot array, if it was dynamically allocated.
      */
     if (tablePtr->buckets != tablePtr->staticBuckets) {
         Rp_Free(tablePtr->buckets);
     }
+    tablePtr->buckets = tablePtr->staticBuckets;
+    tablePtr->numBuckets = 0;
+    tablePtr->numEntries = 0;
 
     /*
      * Arrange for panics if the table is used again without
@@ -1210,7 +1272,9 @@ Rp_FirstHashEntry(
  *
  *  Once a hash table enumeration has been initiated by calling
  *  Rp_FirstHashEntry, this procedure may be called to return
- *  successive elements of the table.
+ *  successive elements of the table.  The entry last returned
+ *  may be deleted before calling it again; entries must not be
+ *  added during the enumeration.
  *
  * Results:
  *  The return value is the next entry in the hash table being
@@ -1224,19 +1288,34 @@ Rp_FirstHashEntry(
 Rp_HashEntry *
 Rp_NextHashEntry(Rp_HashSearch *searchPtr)
 {
-    Rp_HashEntry *hPtr;
+    Rp_HashTable *tablePtr;
+    size_t i;
 
-    while (searchPtr->nextEntryPtr == NULL) {
-        if (searchPtr->nextIndex >= searchPtr->tablePtr->numBuckets) {
-            return NULL;
+    tablePtr = searchPtr->tablePtr;
+    i = searchPtr->nextIndex;
+    while (i < tablePtr->numBuckets) {
+        unsigned int match;
+
+        if ((CTRL(tablePtr, i) & CTRL_EMPTY) == 0) {
+            searchPtr->nextIndex = i + 1;
+            return SLOT(tablePtr, i);
         }
-        searchPtr->nextEntryPtr =
-                searchPtr->tablePtr->buckets[searchPtr->nextIndex];
-        searchPtr->nextIndex++;
+
+        /*
+         * Look at the rest of the group the index is in, so that
+         * runs of empty slots are skipped a group at a time.
+         */
+        match = MatchFull(tablePtr->buckets[i / GROUP_SIZE].ctrl);
+        match &= ~0U << (i % GROUP_SIZE);
+        if (match != 0) {
+            i = (i & ~(size_t)(GROUP_SIZE - 1)) + LowestBit(match);
+            searchPtr->nextIndex = i + 1;
+            return SLOT(tablePtr, i);
+        }
+        i = (i | (GROUP_SIZE - 1)) + 1;
     }
-    hPtr = searchPtr->nextEntryPtr;
-    searchPtr->nextEntryPtr = hPtr->nextPtr;
-    return hPtr;
+    searchPtr->nextIndex = i;
+    return NULL;
 }
 
 /*
@@ -1244,8 +1323,9 @@ Rp_NextHashEntry(Rp_HashSearch *searchPtr)
  *
  * Rp_HashStats --
  *
- *  Return statistics describing the layout of the hash table
- *  in its hash buckets.
+ *  Return statistics describing the layout of the hash table:
+ *  how full it is, and how many groups of slots have to be
+ *  probed to find each entry.
  *
  * Results:
  *  The return value is a malloc-ed string containing information
@@ -1261,26 +1341,35 @@ char *
 Rp_HashStats(Rp_HashTable *tablePtr) /* Table for which to produce stats. */
 {
 #define NUM_COUNTERS 10
-    size_t count[NUM_COUNTERS], overflow, i, j, max;
-    double average, tmp;
-    register Rp_HashEntry *hPtr;
-    Rp_HashEntry **bucketPtr, **endPtr;
+    unsigned long count[NUM_COUNTERS], overflow, deleted, max;
+    double average;
+    size_t i;
     char *result, *p;
 
     /*
-     * Compute a histogram of bucket usage.
+     * Compute a histogram of the number of groups probed to find
+     * each entry.
      */
     for (i = 0; i < NUM_COUNTERS; i++) {
         count[i] = 0;
     }
-    overflow = 0;
+    overflow = deleted = max = 0;
     average = 0.0;
-    max = 0;
-    endPtr = tablePtr->buckets + tablePtr->numBuckets;
-    for (bucketPtr = tablePtr->buckets; bucketPtr < endPtr; bucketPtr++) {
-        j = 0;
-        for (hPtr = *bucketPtr; hPtr != NULL; hPtr = hPtr->nextPtr) {
-            j++;
+    for (i = 0; i < tablePtr->numBuckets; i++) {
+        Rp_HashEntry *hPtr;
+        size_t group;
+        unsigned long j;
+
+        if (CTRL(tablePtr, i) == CTRL_DELETED) {
+            deleted++;
+        }
+        if ((CTRL(tablePtr, i) & CTRL_EMPTY) != 0) {
+            continue;
+        }
+        hPtr = SLOT(tablePtr, i);
+        group = GROUP_INDEX(hPtr->hval) & tablePtr->mask;
+        for (j = 1; group != i / GROUP_SIZE; j++) {
+            group = (group + j) & tablePtr->mask;
         }
         if (j > max) {
             max = j;
@@ -1290,46 +1379,27 @@ Rp_HashStats(Rp_HashTable *tablePtr) /* Table for which to produce stats. */
         } else {
             overflow++;
         }
-        tmp = j;
-        average += (tmp+1.0)*(tmp/tablePtr->numEntries)/2.0;
+        average += (double)j / tablePtr->numEntries;
     }
 
     /*
      * Print out the histogram and a few other pieces of information.
      */
     result = Rp_Malloc((unsigned) ((NUM_COUNTERS*60) + 300));
-#if SIZEOF_VOID_P == 8
-    sprintf(result, "%ld entries in table, %ld buckets\n",
-            tablePtr->numEntries, tablePtr->numBuckets);
-#else
-    sprintf(result, "%d entries in table, %d buckets\n",
-            tablePtr->numEntries, tablePtr->numBuckets);
-#endif
+    sprintf(result, "%lu entries in table, %lu slots, %lu deleted\n",
+            (unsigned long)tablePtr->numEntries,
+            (unsigned long)tablePtr->numBuckets, deleted);
     p = result + strlen(result);
-    for (i = 0; i < NUM_COUNTERS; i++) {
-#if SIZEOF_VOID_P == 8
-        sprintf(p, "number of buckets with %ld entries: %ld\n",
-                i, count[i]);
-#else
-        sprintf(p, "number of buckets with %d entries: %d\n",
-                i, count[i]);
-#endif
+    for (i = 1; i < NUM_COUNTERS; i++) {
+        sprintf(p, "number of entries found in %lu groups: %lu\n",
+                (unsigned long)i, count[i]);
         p += strlen(p);
     }
-#if SIZEOF_VOID_P == 8
-    sprintf(p, "number of buckets with %d or more entries: %ld\n",
+    sprintf(p, "number of entries found in %d or more groups: %lu\n",
             NUM_COUNTERS, overflow);
-#else
-    sprintf(p, "number of buckets with %d or more entries: %d\n",
-            NUM_COUNTERS, overflow);
-#endif
     p += strlen(p);
     sprintf(p, "average search distance for entry: %.2f\n", average);
     p += strlen(p);
-#if SIZEOF_VOID_P == 8
-    sprintf(p, "maximum search distance for entry: %ld", max);
-#else
-    sprintf(p, "maximum search distance for entry: %d", max);
-#endif
+    sprintf(p, "maximum search distance for entry: %lu", max);
     return result;
 }
@@ -0,0 +1,164 @@
+
+/*
+ * ----------------------------------------------------------------------
+ *  RpHashBench -
+ *
+ *  Measure the rates of inserts, lookups, deletes and iteration on
+ *  Rp_HashTable, with one-word and string keys, for tables of 1k to
+ *  maxEntries entries (1M unless given on the command line):
+ *
+ *      RpHashBench ?maxEntries?
+ *
+ *  The results of every operation are checked, so this also serves
+ *  as a quick test of the hash table.
+ *
+ * ======================================================================
+ *  Copyright (c) 2004-2012  HUBzero Foundation, LLC
+ *
+ *  See the file "license.terms" for information on usage and
+ *  redistribution of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ * ======================================================================
+ */
+
+#include <RpInt.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "RpHash.h"
+
+static double
+Now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static void
+Report(const char *keys, const char *op, size_t n, double t)
+{
+    printf("%-8s %9lu %-8s %8.2f Mops/s\n", keys, (unsigned long)n, op,
+           (t > 0.0) ? n / t * 1e-6 : 0.0);
+}
+
+static void
+Check(int ok, const char *what)
+{
+    if (!ok) {
+        fprintf(stderr, "RpHashBench: %s\n", what);
+        exit(1);
+    }
+}
+
+/*
+ * Keys are scattered so that neither the pointer nor the string
+ * keys come in hash order.
+ */
+static size_t
+KeyOf(size_t i)
+{
+    return i * 2654435761UL;
+}
+
+static void
+Bench(size_t n, int stringKeys, char *keys)
+{
+    Rp_HashTable table;
+    Rp_HashSearch search;
+    Rp_HashEntry *hPtr;
+    const char *name;
+    size_t i, count;
+    double t;
+    int isNew;
+
+    name = (stringKeys) ? "string" : "oneword";
+#define KEY(i) \
+    ((stringKeys) ? (void *)(keys + (i) * 24) : (void *)(KeyOf(i) * 8 + 8))
+
+    Rp_InitHashTable(&table, (stringKeys) ? RP_STRING_KEYS : RP_ONE_WORD_KEYS);
+
+    t = Now();
+    for (i = 0; i < n; i++) {
+        hPtr = Rp_CreateHashEntry(&table, KEY(i), &isNew);
+        Rp_SetHashValue(hPtr, i + 1);
+    }
+    Report(name, "insert", n, Now() - t);
+    Check(table.numEntries == n, "wrong number of entries after insert");
+
+    t = Now();
+    for (i = 0; i < n; i++) {
+        hPtr = Rp_FindHashEntry(&table, KEY(i));
+        Check((hPtr != NULL) && ((size_t)Rp_GetHashValue(hPtr) == i + 1),
+              "entry not found");
+    }
+    Report(name, "find", n, Now() - t);
+
+    t = Now();
+    for (i = n; i < 2 * n; i++) {
+        Check(Rp_FindHashEntry(&table, KEY(i)) == NULL, "found missing key");
+    }
+    Report(name, "miss", n, Now() - t);
+
+    t = Now();
+    count = 0;
+    for (hPtr = Rp_FirstHashEntry(&table, &search); hPtr != NULL;
+         hPtr = Rp_NextHashEntry(&search)) {
+        count += (size_t)Rp_GetHashValue(hPtr);
+    }
+    Report(name, "iterate", n, Now() - t);
+    Check(count == n * (n + 1) / 2, "iteration missed entries");
+
+    /* delete every other entry, then look up what's left */
+    t = Now();
+    for (i = 0; i < n; i += 2) {
+        hPtr = Rp_FindHashEntry(&table, KEY(i));
+        Rp_DeleteHashEntry(&table, hPtr);
+    }
+    Report(name, "delete", (n + 1) / 2, Now() - t);
+    Check(table.numEntries == n / 2, "wrong number of entries after delete");
+    for (i = 0; i < n; i++) {
+        hPtr = Rp_FindHashEntry(&table, KEY(i));
+        Check((hPtr == NULL) == ((i % 2) == 0), "wrong entry after delete");
+    }
+
+    /* put them back, reusing the deleted slots */
+    t = Now();
+    for (i = 0; i < n; i += 2) {
+        hPtr = Rp_CreateHashEntry(&table, KEY(i), &isNew);
+        Check(isNew, "deleted entry still there");
+    }
+    Report(name, "reinsert", (n + 1) / 2, Now() - t);
+    Check(table.numEntries == n, "wrong number of entries after reinsert");
+
+    Rp_DeleteHashTable(&table);
+#undef KEY
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t maxEntries, n, i;
+    char *keys;
+
+    maxEntries = 1000000;
+    if (argc > 1) {
+        maxEntries = strtoul(argv[1], NULL, 10);
+    }
+
+    /* string keys, with room for the misses too */
+    keys = malloc(2 * maxEntries * 24);
+    for (i = 0; i < 2 * maxEntries; i++) {
+        sprintf(keys + i * 24, "key%lu", (unsigned long)KeyOf(i));
+    }
+
+    for (n = 1000; n <= maxEntries; n *= 10) {
+        Bench(n, 0, keys);
+        Bench(n, 1, keys);
+    }
+    free(keys);
+    return 0;
+}
@@ -13,6 +13,8 @@
 
 #include "RpHistogram.h"
 #include "RpArray1DUniform.h"
+#include "RpNumFormat.h"
+#include "RpEncode.h"
 
 using namespace Rappture;
 
@@ -367,12 +369,22 @@ Histogram::xml(size_t indent, size_t tabstop)
         _tmpBuf.appendf("%3$*2$s</%1$s>\n",tmpAxis->name(),l1width,sp);
     }
 
-    _tmpBuf.appendf("%3$*1$s<component>\n%3$*2$s<xhw>\n",l1width,l2width,sp);
-    for (size_t idx=0; idx < nmemb; idx++) {
-        for (size_t dim=0; dim < dims(); dim++) {
-            _tmpBuf.appendf("%10g",dataArr[dim][idx]);
+    // with the "encoding" property set to RPENC_DOUBLES, the values
+    // are stored as binary instead of text
+    Rappture::Buffer encBuf;
+    const char *enc = propstr("encoding");
+    if ((enc != NULL) && (strcmp(enc,RPENC_DOUBLES) == 0) &&
+        (encoding::encodeDoubles(_status,encBuf,dataArr,dims(),nmemb))) {
+        _tmpBuf.appendf("%3$*1$s<component>\n%3$*2$s<xhw encoding=\"%4$s\">",
+            l1width,l2width,sp,RPENC_DOUBLES);
+        _tmpBuf.append(encBuf.bytes(),encBuf.size());
+        if ((encBuf.size() > 0) && (encBuf.bytes()[encBuf.size()-1] != '\n')) {
+            _tmpBuf.append("\n",1);
         }
-        _tmpBuf.append("\n",1);
+    } else {
+        _tmpBuf.appendf("%3$*1$s<component>\n%3$*2$s<xhw>\n",
+            l1width,l2width,sp);
+        numformat::appendColumns(_tmpBuf,dataArr,dims(),nmemb,10);
     }
     _tmpBuf.appendf("%4$*3$s</xhw>\n%4$*2$s</component>\n%4$*1$s</curve>",
         indent,l1width,l2width,sp);
@@ -75,6 +75,7 @@ Library::loadXml (const char *xmltext)
     //_objStorage.backup();
     _objStorage.clear();
     __parseTree2ObjectList(p);
+    Rp_ParserXmlDestroy(&p);
     /*
     if (!_status) {
         _objStorage.save();
@@ -14,6 +14,9 @@
 #ifndef _RP_LIBRARY_H
 #define _RP_LIBRARY_H
 
+/* RpLibrary.h defines the same constants; the guard lets both be included */
+#ifndef RP_LIBRARY_CONSTS_DEFINED
+#define RP_LIBRARY_CONSTS_DEFINED
 enum RP_LIBRARY_CONSTS {
     RPLIB_OVERWRITE     = 0,
     RPLIB_APPEND        = 1,
@@ -22,6 +25,7 @@ enum RP_LIBRARY_CONSTS {
     RPLIB_NO_COMPRESS   = 0,
     RPLIB_COMPRESS      = 1,
 };
+#endif
 
 
 #ifdef __cplusplus
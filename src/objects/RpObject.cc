@@ -424,6 +424,7 @@ Object::__configureFromXml(ClientData c)
     Rp_ParserXml *p = Rp_ParserXmlCreate();
     Rp_ParserXmlParse(p, xmltext);
     __configureFromTree(p);
+    Rp_ParserXmlDestroy(&p);
 
     return;
 }
@@ -12,9 +12,12 @@
  */
 
 #include <errno.h>
+#include <ctype.h>
+#include <stdlib.h>
 #include <expat.h>
 #include <string.h>
 #include <stdarg.h>
+#include <string>
 #include "RpParserXML.h"
 #include "RpSimpleBuffer.h"
 #include "RpPath.h"
@@ -24,13 +27,251 @@ struct Rp_ParserXmlStruct {
     Rp_TreeNode curr;
     Rappture::Path *path;
     Rappture::SimpleCharBuffer *buf;
+    Rp_Arena arena;             // The tree's own arena.  Holds the
+                                // tree's nodes and values, every
+                                // attribute and value string and the
+                                // child index.  Strings from the
+                                // document are never freed one at a
+                                // time; the whole arena goes when the
+                                // last token for the tree is released.
+    Rp_HashTable childTable;    // (parent node, child name) ->
+                                // Rp_ParserXmlChildIndex of the children
+                                // of the parent with that name.
+    Rp_HashTable valueTable;    // node -> Rp_ParserXmlValue holding the
+                                // value last stored by Rp_ParserXmlPut
+                                // and friends.
 };
 
+// Space for a value stored with Rp_ParserXmlPut, Rp_ParserXmlPutF or
+// Rp_ParserXmlAppendF.  Unlike text from the document it is allocated
+// on its own, so it can be grown or freed when the value changes.
+typedef struct {
+    char *bytes;
+    size_t size;                // bytes allocated
+} Rp_ParserXmlValue;
+
+// Children of one node that share a name (or a name and an id), in
+// document order.  Most names appear once under a parent, so the first
+// node is stored in the list itself and the array is only allocated
+// for the second.
+typedef struct {
+    Rp_TreeNode first;
+    Rp_TreeNode *nodes;
+    size_t numNodes;
+    size_t numAlloc;
+} Rp_ParserXmlNodeList;
+
+typedef struct {
+    Rp_ParserXmlNodeList all;   // Every child with the name.
+    Rp_HashTable *idTable;      // id -> Rp_ParserXmlNodeList of the
+                                // children with that id, or NULL if
+                                // none of them has an id.
+} Rp_ParserXmlChildIndex;
+
+typedef struct {
+    Rp_TreeNode parent;
+    Rp_TreeKey name;
+} Rp_ParserXmlChildKey;
+
+#define RP_PARSERXML_CHILDKEY_WORDS \
+    (sizeof(Rp_ParserXmlChildKey) / sizeof(int))
+
 const char *Rp_ParserXml_Field_ID = "id";
 const char *Rp_ParserXml_Field_VALUE = "value";
 const char *Rp_ParserXml_Field_VISITED = "visited";
 const char *Rp_ParserXml_TreeRootName = "rapptureTree";
 
+// Copies len bytes of s into the parser's arena as a NUL terminated
+// string.
+static char *
+Rp_ParserXmlStrdup(Rp_ParserXml *inf, const char *s, size_t len)
+{
+    char *d = Rp_ArenaAllocString(inf->arena, len+1);
+    memcpy(d,s,len);
+    d[len] = '\0';
+    return d;
+}
+
+static void
+Rp_ParserXmlNodeListAppend(Rp_ParserXml *inf, Rp_ParserXmlNodeList *l,
+    Rp_TreeNode node)
+{
+    if (l->numNodes == 0) {
+        l->first = node;
+    } else {
+        if (l->numNodes >= l->numAlloc) {
+            size_t newAlloc = (l->numAlloc == 0) ? 4 : 2*l->numAlloc;
+            Rp_TreeNode *nodes = (Rp_TreeNode *)
+                Rp_ArenaAlloc(inf->arena, newAlloc*sizeof(Rp_TreeNode));
+            if (l->numAlloc == 0) {
+                nodes[0] = l->first;
+            } else {
+                memcpy(nodes, l->nodes, l->numNodes*sizeof(Rp_TreeNode));
+                Rp_ArenaFree(inf->arena, l->nodes,
+                    l->numAlloc*sizeof(Rp_TreeNode));
+            }
+            l->nodes = nodes;
+            l->numAlloc = newAlloc;
+        }
+        l->nodes[l->numNodes] = node;
+    }
+    l->numNodes++;
+}
+
+// Returns the nth (counting from 1) node in the list, or NULL.
+static Rp_TreeNode
+Rp_ParserXmlNodeListGet(Rp_ParserXmlNodeList *l, size_t degree)
+{
+    if ((degree == 0) || (degree > l->numNodes)) {
+        return NULL;
+    }
+    return (l->numAlloc == 0) ? l->first : l->nodes[degree-1];
+}
+
+static Rp_ParserXmlNodeList *
+Rp_ParserXmlNodeListCreate(Rp_ParserXml *inf)
+{
+    Rp_ParserXmlNodeList *l = (Rp_ParserXmlNodeList *)
+        Rp_ArenaAlloc(inf->arena, sizeof(Rp_ParserXmlNodeList));
+    memset(l,0,sizeof(Rp_ParserXmlNodeList));
+    return l;
+}
+
+// Adds a new child node to the index of its parent's children.  Must
+// be called after the child's id (if any) has been set.
+static void
+Rp_ParserXmlIndexChild(Rp_ParserXml *inf, Rp_TreeNode parent,
+    Rp_TreeNode child)
+{
+    Rp_ParserXmlChildKey key;
+    Rp_ParserXmlChildIndex *indexPtr = NULL;
+    Rp_HashEntry *hPtr = NULL;
+    int isNew = 0;
+
+    memset(&key,0,sizeof(key));
+    key.parent = parent;
+    key.name = Rp_TreeNodeLabel(child);
+    hPtr = Rp_CreateHashEntry(&inf->childTable, (char *)&key, &isNew);
+    if (isNew) {
+        indexPtr = (Rp_ParserXmlChildIndex *)
+            Rp_ArenaAlloc(inf->arena, sizeof(Rp_ParserXmlChildIndex));
+        memset(indexPtr,0,sizeof(Rp_ParserXmlChildIndex));
+        Rp_SetHashValue(hPtr, indexPtr);
+    } else {
+        indexPtr = (Rp_ParserXmlChildIndex *) Rp_GetHashValue(hPtr);
+    }
+    Rp_ParserXmlNodeListAppend(inf, &indexPtr->all, child);
+
+    const char *id = NULL;
+    Rp_TreeGetValue(inf->tree,child,Rp_ParserXml_Field_ID,(void **)&id);
+    if (id == NULL) {
+        return;
+    }
+    if (indexPtr->idTable == NULL) {
+        indexPtr->idTable = (Rp_HashTable *)
+            Rp_ArenaAlloc(inf->arena, sizeof(Rp_HashTable));
+        Rp_InitHashTable(indexPtr->idTable, RP_STRING_KEYS);
+    }
+    hPtr = Rp_CreateHashEntry(indexPtr->idTable, id, &isNew);
+    if (isNew) {
+        Rp_SetHashValue(hPtr, Rp_ParserXmlNodeListCreate(inf));
+    }
+    Rp_ParserXmlNodeListAppend(inf,
+        (Rp_ParserXmlNodeList *) Rp_GetHashValue(hPtr), child);
+}
+
+// Frees the id tables of the child index.  The index structures and
+// their arrays live in the parser's arena.
+static void
+Rp_ParserXmlFreeIndex(Rp_ParserXml *inf)
+{
+    Rp_HashSearch iter;
+    Rp_HashEntry *hPtr = NULL;
+
+    for (hPtr = Rp_FirstHashEntry(&inf->childTable, &iter); hPtr != NULL;
+         hPtr = Rp_NextHashEntry(&iter)) {
+        Rp_ParserXmlChildIndex *indexPtr = (Rp_ParserXmlChildIndex *)
+            Rp_GetHashValue(hPtr);
+        if (indexPtr->idTable != NULL) {
+            Rp_DeleteHashTable(indexPtr->idTable);
+        }
+    }
+    Rp_DeleteHashTable(&inf->childTable);
+}
+
+// Returns space in which to store a value for the node, followed by
+// n more bytes and the NUL.  If append is set and the node has a
+// value, the space starts with that value and *offsetPtr is its
+// length; otherwise *offsetPtr is 0.  Space from an earlier call is
+// reused, or doubled and the old space freed, so appending to a value
+// takes linear time.  Values that didn't come from here (text from the
+// document) are left in the arena.
+static char *
+Rp_ParserXmlValueSpace(Rp_ParserXml *p, Rp_TreeNode node, int append,
+    size_t n, size_t *offsetPtr)
+{
+    const char *oldval = NULL;
+    Rp_ParserXmlValue *valPtr = NULL;
+    Rp_HashEntry *hPtr = NULL;
+    size_t oldLen = 0;
+    int isNew = 0;
+
+    Rp_TreeGetValue(p->tree,node,Rp_ParserXml_Field_VALUE,(void **)&oldval);
+    hPtr = Rp_CreateHashEntry(&p->valueTable, (char *)node, &isNew);
+    if (isNew) {
+        valPtr = (Rp_ParserXmlValue *)
+            Rp_ArenaAlloc(p->arena, sizeof(Rp_ParserXmlValue));
+        memset(valPtr,0,sizeof(Rp_ParserXmlValue));
+        Rp_SetHashValue(hPtr, valPtr);
+    } else {
+        valPtr = (Rp_ParserXmlValue *) Rp_GetHashValue(hPtr);
+    }
+    if (valPtr->bytes != oldval) {
+        // the value was replaced some other way; its old space may
+        // still be referenced, so leave it to the arena
+        valPtr->bytes = NULL;
+        valPtr->size = 0;
+    }
+
+    if (append && (oldval != NULL)) {
+        oldLen = strlen(oldval);
+    }
+    if (oldLen + n + 1 > valPtr->size) {
+        size_t size = (valPtr->size == 0) ? 16 : valPtr->size;
+        while (size < oldLen + n + 1) {
+            size *= 2;
+        }
+        char *bytes = (char *) Rp_ArenaAlloc(p->arena, size);
+        if (oldLen > 0) {
+            memcpy(bytes, oldval, oldLen);
+        }
+        if (valPtr->bytes != NULL) {
+            Rp_ArenaFree(p->arena, valPtr->bytes, valPtr->size);
+        }
+        valPtr->bytes = bytes;
+        valPtr->size = size;
+    }
+    *offsetPtr = oldLen;
+    return valPtr->bytes;
+}
+
+// Stores the text collected since the last tag as the value of the
+// current node.  Expat hands over character data in pieces (a line at
+// a time), so the pieces are gathered in inf->buf and stored once.
+static void
+Rp_ParserXmlFlushText(Rp_ParserXml *inf)
+{
+    size_t len = inf->buf->nmemb();
+
+    if (len == 0) {
+        return;
+    }
+
+    char *d = Rp_ParserXmlStrdup(inf,inf->buf->bytes(),len);
+    Rp_TreeSetValue(inf->tree,inf->curr,Rp_ParserXml_Field_VALUE,(void *)d);
+    inf->buf->clear();
+}
+
 static void XMLCALL
 Rp_ParserXmlStartHandler(
     void *data,
@@ -38,20 +279,20 @@ Rp_ParserXmlStartHandler(
     const char **attr)
 {
     Rp_ParserXml *inf = (Rp_ParserXml *) data;
+    Rp_TreeNode parent = inf->curr;
     size_t i = 0;
 
-    inf->curr = Rp_TreeCreateNode(inf->tree, inf->curr, el, -1);
+    Rp_ParserXmlFlushText(inf);
+    inf->curr = Rp_TreeCreateNode(inf->tree, parent, el, -1);
 
     // store the attributes in the node
     while (attr[i] != NULL) {
         const char *attrName = attr[i++];
-        size_t attrValueLen = strlen(attr[i]);
-        // FIXME: memory leak originating from this new call
-        // I'm not sure where/when the attrValue is deleted yet
-        char *attrValue = new char[attrValueLen+1];
-        strcpy(attrValue,attr[i++]);
+        char *attrValue = Rp_ParserXmlStrdup(inf,attr[i],strlen(attr[i]));
+        i++;
         Rp_TreeSetValue(inf->tree,inf->curr,attrName,(void *)attrValue);
     }
+    Rp_ParserXmlIndexChild(inf, parent, inf->curr);
     inf->path->add(el);
 }
 
@@ -66,6 +307,8 @@ Rp_ParserXmlEndHandler(
         return;
     }
 
+    Rp_ParserXmlFlushText(inf);
+
     char *value = NULL;
     Rp_TreeGetValue(inf->tree,inf->curr,Rp_ParserXml_Field_VALUE,(void **)&value);
 
@@ -91,13 +334,9 @@ Rp_ParserXmlEndHandler(
         }
 
         if (j > 0) {
-            // reallocate the trimmed string
-            char *newValue = new char[i-j+1+1];
-            strcpy(newValue,value+j);
+            // point the value past the leading spaces
             Rp_TreeSetValue(inf->tree,inf->curr,Rp_ParserXml_Field_VALUE,
-                (void *)newValue);
-            delete[] value;
-            value = NULL;
+                (void *)(value+j));
         }
     }
 
@@ -113,19 +352,11 @@ Rp_ParserXmlDefaultCharHandler(
 {
     Rp_ParserXml *inf = (Rp_ParserXml *) data;
 
-    if (inf == NULL) {
+    if ((inf == NULL) || (s == NULL)) {
         return;
     }
 
-    // FIXME: where/when is this deallocated
-    char *d = new char[len+1];
-
-    if ( s != NULL) {
-        strncpy(d,s,len);
-    }
-
-    d[len] = '\0';
-    Rp_TreeSetValue(inf->tree,inf->curr,Rp_ParserXml_Field_VALUE,(void *)d);
+    inf->buf->append(s,len);
 }
 
 Rp_ParserXml *
@@ -133,11 +364,15 @@ Rp_ParserXmlCreate()
 {
     Rp_ParserXml *p = new Rp_ParserXml();
 
+    // the parser's own allocations share the tree's arena, which lives
+    // until the last token for the tree is released.
     Rp_TreeCreate(Rp_ParserXml_TreeRootName,&(p->tree));
+    p->arena = Rp_TreeArena(p->tree);
     p->curr = Rp_TreeRootNode(p->tree);
     p->path = new Rappture::Path();
     p->buf = new Rappture::SimpleCharBuffer();
-
+    Rp_InitHashTable(&p->childTable, RP_PARSERXML_CHILDKEY_WORDS);
+    Rp_InitHashTable(&p->valueTable, RP_ONE_WORD_KEYS);
 
     return p;
 }
@@ -153,9 +388,13 @@ Rp_ParserXmlDestroy(Rp_ParserXml **p)
         return;
     }
 
-    Rp_TreeReleaseToken((*p)->tree);
+    Rp_ParserXmlFreeIndex(*p);
+    // the values themselves stay with the tree
+    Rp_DeleteHashTable(&(*p)->valueTable);
     delete (*p)->buf;
     delete (*p)->path;
+    // frees the arena unless other tokens for the tree are still held
+    Rp_TreeReleaseToken((*p)->tree);
     delete *p;
     *p = NULL;
 }
@@ -169,6 +408,8 @@ Rp_ParserXmlParse(
         return;
     }
 
+    p->buf->clear();
+
     XML_Parser parser = XML_ParserCreate(NULL);
     XML_SetUserData(parser,p);
     XML_SetElementHandler(parser, Rp_ParserXmlStartHandler,
@@ -187,6 +428,7 @@ Rp_ParserXmlParse(
     }
 
     XML_ParserFree(parser);
+    Rp_ParserXmlFlushText(p);
 
     // reset the root node
     p->curr = Rp_TreeFirstChild(Rp_TreeRootNode(p->tree));
@@ -209,13 +451,10 @@ Rp_ParserXmlCreateNode(
     Rp_TreeNode child = Rp_TreeCreateNode(p->tree, parent, type, -1);
 
     if (id != NULL) {
-        size_t attrValueLen = strlen(id);
-        // FIXME: memory leak originating from this new call
-        // I'm not sure where/when the attrValue is deleted yet
-        char *attrValue = new char[attrValueLen+1];
-        strcpy(attrValue,id);
+        char *attrValue = Rp_ParserXmlStrdup(p,id,strlen(id));
         Rp_TreeSetValue(p->tree,child,Rp_ParserXml_Field_ID,(void *)attrValue);
     }
+    Rp_ParserXmlIndexChild(p, parent, child);
 
     return child;
 }
@@ -242,7 +481,7 @@ Rp_ParserXmlNodeIdentify(
             const char *nodeId = NULL;
             Rp_TreeGetValue(p->tree,n,Rp_ParserXml_Field_ID,
                 (void **)&nodeId);
-            if (strcmp(id,nodeId) == 0) {
+            if ((nodeId != NULL) && (strcmp(id,nodeId) == 0)) {
                 criteriaMet++;
             }
         }
@@ -285,36 +524,107 @@ Rp_ParserXmlFindChild(
     }
 
     *numFound = 0;
-    *child = Rp_TreeFindChild(parent,childName);
-    if (*child == NULL) {
-        // no nodes with the name childName exist
+    *child = NULL;
+    if ((parent == NULL) || (childName == NULL)) {
         return;
     }
 
-    while (*child != NULL) {
-        if (Rp_ParserXmlNodeIdentify(p,*child,childName,childId) == 0) {
-            // found a child with the correct name and id
-            (*numFound)++;
-            if (degree == *numFound) {
-                // found a node with the correct degree
-                break;
-            }
+    // look up the children with the name, and then the ones with
+    // the id, in the index instead of walking the siblings
+    Rp_ParserXmlChildKey key;
+    memset(&key,0,sizeof(key));
+    key.parent = parent;
+    key.name = Rp_TreeGetKey(childName);
+    Rp_HashEntry *hPtr = Rp_FindHashEntry(&p->childTable, (char *)&key);
+    if (hPtr == NULL) {
+        // no nodes with the name childName exist
+        return;
+    }
+    Rp_ParserXmlChildIndex *indexPtr =
+        (Rp_ParserXmlChildIndex *) Rp_GetHashValue(hPtr);
+    Rp_ParserXmlNodeList *l = &indexPtr->all;
+    if (childId != NULL) {
+        if (indexPtr->idTable == NULL) {
+            return;
         }
-
-        // check the next child for the correct name and id
-        *child = Rp_TreeNextSibling(*child);
+        hPtr = Rp_FindHashEntry(indexPtr->idTable, childId);
+        if (hPtr == NULL) {
+            return;
+        }
+        l = (Rp_ParserXmlNodeList *) Rp_GetHashValue(hPtr);
     }
 
+    *child = Rp_ParserXmlNodeListGet(l, degree);
+    *numFound = (*child != NULL) ? degree : l->numNodes;
     return;
 }
 
+// Splits off the next component of a path like
+// "input.number2(temp).current" in place, following the rules of
+// Rappture::Path: a type, an optional degree, and an optional (id).
+// Digits right at the start of the whole path are part of the type.
+// Returns the start of the following component, or NULL if this was
+// the last one.
+static char *
+Rp_ParserXmlNextComponent(
+    char *path,
+    char *start,
+    const char **typePtr,
+    const char **idPtr,
+    size_t *degreePtr)
+{
+    char *typeEnd = NULL;
+    char *idOpen = NULL;
+    char *idClose = NULL;
+    char *next = NULL;
+    char *q = NULL;
+
+    *degreePtr = 1;
+    for (q = start; *q != '\0'; q++) {
+        int outsideParens = ((idOpen == NULL) || (idClose > idOpen));
+        if (*q == '(') {
+            idOpen = q;
+            if (typeEnd == NULL) {
+                typeEnd = q;
+            }
+        } else if (*q == ')') {
+            idClose = q;
+        } else if (outsideParens && (q != path) && isdigit((unsigned char)*q)) {
+            if (typeEnd == NULL) {
+                typeEnd = q;
+            }
+            char *end = NULL;
+            *degreePtr = (size_t) strtoul(q, &end, 10);
+            if (*degreePtr == 0) {
+                // interpret degree of 0 same as degree of 1
+                *degreePtr = 1;
+            }
+            q = end - 1;
+        } else if (outsideParens && (*q == '.')) {
+            next = q + 1;
+            break;
+        }
+    }
+    if (typeEnd == NULL) {
+        typeEnd = q;
+    }
+    *idPtr = NULL;
+    if ((idOpen != NULL) && (idClose > idOpen)) {
+        *idClose = '\0';
+        *idPtr = idOpen + 1;
+    }
+    *q = '\0';
+    *typeEnd = '\0';
+    *typePtr = start;
+    return next;
+}
+
 Rp_TreeNode
 Rp_ParserXmlSearch(
     Rp_ParserXml *p,
     const char *path,
     int create)
 {
-    Rappture::Path pathObj(path);
     Rp_TreeNode parent = NULL;
     Rp_TreeNode child = NULL;
 
@@ -328,13 +638,25 @@ Rp_ParserXmlSearch(
     // if (path == NULL) return the base node
     child = p->curr;
 
-    pathObj.first();
-    while ( (!pathObj.eof()) &&
+    if (path == NULL) {
+        return child;
+    }
+
+    // split a copy of the path in place, on the stack unless it's long
+    char staticSpace[256];
+    size_t len = strlen(path);
+    char *copy = (len < sizeof(staticSpace)) ? staticSpace : new char[len+1];
+    memcpy(copy,path,len+1);
+
+    char *comp = copy;
+    while ( (comp != NULL) &&
             (parent != NULL) ) {
 
-        const char *childName = pathObj.type();
-        const char *childId = pathObj.id();
-        size_t childDegree = pathObj.degree();
+        const char *childName = NULL;
+        const char *childId = NULL;
+        size_t childDegree = 1;
+        char *next = Rp_ParserXmlNextComponent(copy, comp, &childName,
+            &childId, &childDegree);
 
         size_t foundCnt = 0;
         Rp_ParserXmlFindChild(p, parent, childName, childId,
@@ -344,7 +666,7 @@ Rp_ParserXmlSearch(
             // no nodes with the name childName exist
             // FIXME: use the RPXML_CREATE flag
             if (create) {
-                for (size_t i = foundCnt; i < pathObj.degree(); i++) {
+                for (size_t i = foundCnt; i < childDegree; i++) {
                     child = Rp_ParserXmlCreateNode(p, parent,
                                 childName, childId);
                     if (child == NULL) {
@@ -360,9 +682,12 @@ Rp_ParserXmlSearch(
         }
 
         parent = child;
-        pathObj.next();
+        comp = next;
     }
 
+    if (copy != staticSpace) {
+        delete[] copy;
+    }
     return child;
 }
 
@@ -389,10 +714,8 @@ Rp_ParserXmlPut(
     const char *val,
     int append)
 {
-    const char *oldval = NULL;
     char *newval = NULL;
     size_t oldval_len = 0;
-    size_t val_len = 0;
 
     if (val == NULL) {
         // no value, do nothing
@@ -406,32 +729,21 @@ Rp_ParserXmlPut(
         return;
     }
 
-    // check to see if there is already a value
-    if (RP_OK == Rp_TreeGetValue(p->tree,child,
-                    Rp_ParserXml_Field_VALUE,
-                    (void **)&oldval)) {
-        if (oldval != NULL) {
-            // FIXME: use the RPXML_APPEND flag
-            if (append) {
-                oldval_len = strlen(oldval);
-                val_len = strlen(val);
-                newval = new char[oldval_len + val_len + 1];
-                strncpy(newval,oldval,oldval_len);
-            }
-            // free the old data
-            delete[] oldval;
-            oldval = NULL;
-        }
-    }
-
-    // allocate space for our new value if needed
-    if (newval == NULL) {
-        // set the new value for the node
-        val_len = strlen(val);
-        newval = new char[val_len + 1];
+    // val may be part of the old value, whose space can be reused or
+    // freed below, so copy it first
+    const char *oldval = NULL;
+    std::string valCopy;
+    Rp_TreeGetValue(p->tree,child,Rp_ParserXml_Field_VALUE,(void **)&oldval);
+    if ((oldval != NULL) && (val >= oldval)
+            && (val <= oldval+strlen(oldval))) {
+        valCopy = val;
+        val = valCopy.c_str();
     }
 
-    strcpy(newval+oldval_len,val);
+    // FIXME: use the RPXML_APPEND flag
+    newval = Rp_ParserXmlValueSpace(p, child, append, strlen(val),
+        &oldval_len);
+    memcpy(newval+oldval_len,val,strlen(val)+1);
 
     // set the value of the child node
     if (RP_ERROR == Rp_TreeSetValue(p->tree,child,
@@ -469,36 +781,34 @@ Rp_ParserXmlPutF(
         return;
     }
 
-    // check to see if there is already a value
-    const char *oldval = NULL;
-    if (RP_OK == Rp_TreeGetValue(p->tree,child,
-                    Rp_ParserXml_Field_VALUE,
-                    (void **)&oldval)) {
-        if (oldval != NULL) {
-            // free the old data
-            delete[] oldval;
-            oldval = NULL;
-        }
-    }
-
     // store the formatted string in the tree node
-    size_t stackSize = 1024;
-    char *stackSpace = new char[stackSize];
+    char stackSpace[1024];
     va_list lst;
     size_t n;
+    size_t offset = 0;
 
     va_start(lst, format);
-    n = vsnprintf(stackSpace, stackSize, format, lst);
-    if (n >= stackSize) {
-        delete[] stackSpace;
-        stackSpace = new char[n];
-        vsnprintf(stackSpace, n, format, lst);
+    n = vsnprintf(stackSpace, sizeof(stackSpace), format, lst);
+    va_end(lst);
+    char *text = stackSpace;
+    if (n >= sizeof(stackSpace)) {
+        // format it here first: the arguments may be part of the old
+        // value, whose space can be reused
+        text = new char[n+1];
+        va_start(lst, format);
+        vsnprintf(text, n+1, format, lst);
+        va_end(lst);
+    }
+    char *newval = Rp_ParserXmlValueSpace(p, child, 0, n, &offset);
+    memcpy(newval, text, n+1);
+    if (text != stackSpace) {
+        delete[] text;
     }
 
     // set the value of the child node
     if (RP_ERROR == Rp_TreeSetValue(p->tree,child,
                         Rp_ParserXml_Field_VALUE,
-                        (void *)stackSpace)) {
+                        (void *)newval)) {
         fprintf(stderr,"error while setting value of %s\n",path);
     }
 
@@ -531,36 +841,28 @@ Rp_ParserXmlAppendF(
         return;
     }
 
-    // check to see if there is already a value
-    const char *oldval = NULL;
-    Rp_TreeGetValue(p->tree,child, Rp_ParserXml_Field_VALUE, (void **)&oldval);
-
-    // get the formatted string
-    size_t stackSize = 1024;
-    char *stackSpace = new char[stackSize];
+    // add the formatted string to the end of the old value, if any
+    char stackSpace[1024];
     va_list lst;
     size_t n;
+    size_t oldval_len = 0;
 
     va_start(lst, format);
-    n = vsnprintf(stackSpace, stackSize, format, lst);
-    if (n >= stackSize) {
-        delete[] stackSpace;
-        stackSpace = new char[n];
-        vsnprintf(stackSpace, n, format, lst);
-    }
-
-    // concatenate the formatted string and the old value
-    char *newval = stackSpace;
-    if (oldval != NULL) {
-        size_t oldval_len = strlen(oldval);
-        newval = new char[n+oldval_len+1];
-        strcpy(newval, oldval);
-        strcat(newval,stackSpace);
-        // free the old data
-        delete[] oldval;
-        oldval = NULL;
-        delete[] stackSpace;
-        stackSpace = NULL;
+    n = vsnprintf(stackSpace, sizeof(stackSpace), format, lst);
+    va_end(lst);
+    char *text = stackSpace;
+    if (n >= sizeof(stackSpace)) {
+        // format it here first: the arguments may be part of the old
+        // value, which can be moved
+        text = new char[n+1];
+        va_start(lst, format);
+        vsnprintf(text, n+1, format, lst);
+        va_end(lst);
+    }
+    char *newval = Rp_ParserXmlValueSpace(p, child, 1, n, &oldval_len);
+    memcpy(newval+oldval_len, text, n+1);
+    if (text != stackSpace) {
+        delete[] text;
     }
 
     // set the value of the child node
@@ -580,7 +882,63 @@ Rp_ParserXmlAppendF(
     return;
 }
 
+/*
+ * Sets the attribute name="val" on the element at path, creating the
+ * element if needed.  Element ids are set through the path, as in
+ * "curve(myid)", not with this function.
+ */
+const char *
+Rp_ParserXmlGetAttr(
+    Rp_ParserXml *p,
+    const char *path,
+    const char *name)
+{
+    const char *value = NULL;
+    Rp_TreeNode child = NULL;
 
+    if (name == NULL) {
+        return NULL;
+    }
+
+    child = Rp_ParserXmlSearch(p, path, 0);
+    if (child != NULL) {
+        Rp_TreeGetValue(p->tree,child,name,(void **)&value);
+    }
+
+    return value;
+}
+
+void
+Rp_ParserXmlPutAttr(
+    Rp_ParserXml *p,
+    const char *path,
+    const char *name,
+    const char *val)
+{
+    if ((name == NULL) || (val == NULL)) {
+        return;
+    }
+
+    Rp_TreeNode child = Rp_ParserXmlSearch(p, path, 1);
+
+    if (child == NULL) {
+        fprintf(stderr, "child node %s does not exist", path);
+        return;
+    }
+
+    char *newval = Rp_ParserXmlStrdup(p, val, strlen(val));
+    if (RP_ERROR == Rp_TreeSetValue(p->tree,child,name,(void *)newval)) {
+        fprintf(stderr,"error while setting attribute %s of %s\n",name,path);
+    }
+    return;
+}
+
+
+/*
+ * Returns a new token for the parser's tree.  The tree, and the text
+ * of its values, stay valid until the token is released with
+ * Rp_TreeReleaseToken, even if the parser is destroyed first.
+ */
 Rp_Tree
 Rp_ParserXmlTreeClient(
     Rp_ParserXml *p)
@@ -38,6 +38,10 @@ const char *Rp_ParserXmlGet(Rp_ParserXml *p, const char *path);
 void Rp_ParserXmlPut(Rp_ParserXml *p, const char *path, const char *val, int append);
 void Rp_ParserXmlPutF(Rp_ParserXml *p, const char *path, const char *val, ...);
 void Rp_ParserXmlAppendF(Rp_ParserXml *p, const char *path, const char *val, ...);
+const char *Rp_ParserXmlGetAttr(Rp_ParserXml *p, const char *path,
+    const char *name);
+void Rp_ParserXmlPutAttr(Rp_ParserXml *p, const char *path, const char *name,
+    const char *val);
 
 Rp_Tree Rp_ParserXmlTreeClient(Rp_ParserXml *p);
 
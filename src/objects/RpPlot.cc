@@ -345,7 +345,26 @@ Plot::__dumpToTree(ClientData c)
 
         }
 
+        // the plot's "lod" and "encoding" properties apply to curves
+        // that don't have their own.  they're only lent to the curve
+        // for this dump, so later changes to the plot still apply.
+        const char *props[] = { "lod", "encoding" };
+        bool lent[2] = { false, false };
+        for (size_t i = 0; i < 2; i++) {
+            const char *val = propstr(props[i]);
+            if ((val != NULL) && (c->propstr(props[i]) == NULL)) {
+                c->propstr(props[i],val);
+                lent[i] = true;
+            }
+        }
+
         c->dump(RPCONFIG_TREE,parser);
+
+        for (size_t i = 0; i < 2; i++) {
+            if (lent[i]) {
+                c->propremove(props[i]);
+            }
+        }
         l = Rp_ChainNextLink(l);
     }
 }
@@ -127,12 +127,15 @@ VariablePoolAllocItem(poolPtr, size)
      */
         chainPtr = malloc(sizeof(Rp_PoolChain) + size);
         if (poolPtr->headPtr == NULL) {
+            chainPtr->nextPtr = NULL;
             poolPtr->headPtr = chainPtr;
         } else {
             chainPtr->nextPtr = poolPtr->headPtr->nextPtr;
             poolPtr->headPtr->nextPtr = chainPtr;
         }
-        memPtr = (void *)chainPtr;
+        poolPtr->nChunks++;
+        poolPtr->chunkBytes += size;
+        memPtr = (void *)(chainPtr + 1);
     } else {
         if (poolPtr->bytesLeft >= size) {
             poolPtr->bytesLeft -= size;
@@ -145,11 +148,14 @@ VariablePoolAllocItem(poolPtr, size)
             chainPtr = malloc(sizeof(Rp_PoolChain) + poolPtr->bytesLeft);
             chainPtr->nextPtr = poolPtr->headPtr;
             poolPtr->headPtr = chainPtr;
+            poolPtr->nChunks++;
+            poolPtr->chunkBytes += poolPtr->bytesLeft;
             /* Peel off a new item. */
             poolPtr->bytesLeft -= size;
             memPtr = (char *)(chainPtr + 1) + poolPtr->bytesLeft;
         }
     }
+    poolPtr->bytesInUse += size;
     return memPtr;
 }
 
@@ -208,12 +214,15 @@ StringPoolAllocItem(poolPtr, size)
          */
         chainPtr = malloc(sizeof(Rp_PoolChain) + size);
         if (poolPtr->headPtr == NULL) {
+            chainPtr->nextPtr = NULL;
             poolPtr->headPtr = chainPtr;
         } else {
             chainPtr->nextPtr = poolPtr->headPtr->nextPtr;
             poolPtr->headPtr->nextPtr = chainPtr;
         }
-        memPtr = (void *)chainPtr;
+        poolPtr->nChunks++;
+        poolPtr->chunkBytes += size;
+        memPtr = (void *)(chainPtr + 1);
     } else {
         if (poolPtr->bytesLeft >= size) {
             poolPtr->bytesLeft -= size;
@@ -227,11 +236,14 @@ StringPoolAllocItem(poolPtr, size)
             chainPtr = malloc(sizeof(Rp_PoolChain) + poolPtr->bytesLeft);
             chainPtr->nextPtr = poolPtr->headPtr;
             poolPtr->headPtr = chainPtr;
+            poolPtr->nChunks++;
+            poolPtr->chunkBytes += poolPtr->bytesLeft;
             /* Peel off a new item. */
             poolPtr->bytesLeft -= size;
             memPtr = (char *)(chainPtr + 1) + poolPtr->bytesLeft;
         }
     }
+    poolPtr->bytesInUse += size;
     return memPtr;
 }
 
@@ -349,11 +361,14 @@ FixedPoolAllocItem(poolPtr, size)
         chainPtr = malloc(sizeof(Rp_PoolChain) + poolPtr->bytesLeft);
         chainPtr->nextPtr = poolPtr->headPtr;
         poolPtr->headPtr = chainPtr;
+        poolPtr->nChunks++;
+        poolPtr->chunkBytes += poolPtr->bytesLeft;
 
         /* Peel off a new item. */
         poolPtr->bytesLeft -= poolPtr->itemSize;
         newPtr = (char *)(poolPtr->headPtr + 1) + poolPtr->bytesLeft;
     }
+    poolPtr->bytesInUse += poolPtr->itemSize;
     return newPtr;
 }
 
@@ -384,6 +399,7 @@ FixedPoolFreeItem(poolPtr, item)
     /* Prepend the newly deallocated item to the free list. */
     chainPtr->nextPtr = poolPtr->freePtr;
     poolPtr->freePtr = chainPtr;
+    poolPtr->bytesInUse -= poolPtr->itemSize;
 }
 
 /*
@@ -424,6 +440,7 @@ Rp_PoolCreate(type)
     poolPtr->headPtr = poolPtr->freePtr = NULL;
     poolPtr->waste = poolPtr->bytesLeft = 0;
     poolPtr->poolSize = poolPtr->itemSize = 0;
+    poolPtr->nChunks = poolPtr->chunkBytes = poolPtr->bytesInUse = 0;
     return poolPtr;
 }
 
@@ -456,3 +473,722 @@ Rp_PoolDestroy(poolPtr)
     free(poolPtr);
 }
 
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_PoolReset --
+ *
+ *      Frees every item in the pool at once.  The chunks are given
+ *      back and the pool starts over, as if it was just created.
+ *
+ * Results:
+ *      None.
+ *
+ * Side Effects:
+ *      All memory used by the pool is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Rp_PoolReset(poolPtr)
+    struct Rp_PoolStruct *poolPtr;
+{
+    register Rp_PoolChain *chainPtr, *nextPtr;
+
+    for (chainPtr = poolPtr->headPtr; chainPtr != NULL; chainPtr = nextPtr) {
+        nextPtr = chainPtr->nextPtr;
+        free(chainPtr);
+    }
+    poolPtr->headPtr = poolPtr->freePtr = NULL;
+    poolPtr->waste = poolPtr->bytesLeft = 0;
+    poolPtr->poolSize = 0;
+    poolPtr->nChunks = poolPtr->chunkBytes = poolPtr->bytesInUse = 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_PoolGetStats --
+ *
+ *      Reports the memory used by the pool.
+ *
+ * Results:
+ *      None.  The counts are stored in *statsPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Rp_PoolGetStats(poolPtr, statsPtr)
+    struct Rp_PoolStruct *poolPtr;
+    Rp_PoolStats *statsPtr;
+{
+    statsPtr->bytesInUse = poolPtr->bytesInUse;
+    statsPtr->chunkBytes = poolPtr->chunkBytes;
+    statsPtr->waste = poolPtr->waste;
+    statsPtr->nChunks = poolPtr->nChunks;
+}
+
+/*
+ * Rp_Arena --
+ *
+ *      Items up to RP_ARENA_MAX_ITEM bytes are rounded up to one of
+ *      the size classes below and come from the fixed size pool of
+ *      that class.  Classes are 16 bytes apart up to 128 bytes, and
+ *      four to each power of two above that, so no more than a
+ *      fifth of an item is lost to rounding.
+ *
+ *      An arena from Rp_ArenaCreate belongs to one thread at a time
+ *      and is never locked.  A shared arena, from
+ *      Rp_ArenaCreateShared, guards its pools with a lock, and each
+ *      thread using it has a cache with a list of free items for
+ *      each class.  Items are allocated from and freed to the cache
+ *      without locking.  An empty list is refilled with ARENA_BATCH
+ *      items from the pool, and a list holding more than
+ *      ARENA_CACHE_MAX items gives half of them back.  The caches
+ *      are found through a thread-specific data key of the arena,
+ *      and keys are scarce, so only shared arenas have one.
+ *
+ *      Resetting the arena bumps its generation.  A thread's cache
+ *      from an older generation holds items that no longer exist,
+ *      so its lists are emptied the next time the thread uses it.
+ */
+
+#define ARENA_NUM_CLASSES       28
+#define ARENA_BATCH             16
+#define ARENA_CACHE_MAX         64
+
+#ifndef _WIN32
+#define ARENA_THREADS           1
+#include <pthread.h>
+#endif /* _WIN32 */
+
+/*
+ * Rp_ArenaGetStats reads the byte counts of other threads' caches
+ * while they change them, so the counts are updated atomically.
+ * Without atomics, threads don't keep caches.
+ */
+#if defined(ARENA_THREADS) && defined(__ATOMIC_RELAXED)
+#define ARENA_CACHES            1
+#define CacheCount(x)           __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define CacheAdd(x, n)          __atomic_add_fetch(&(x), (n), __ATOMIC_RELAXED)
+#define CacheSet(x, n)          __atomic_store_n(&(x), (n), __ATOMIC_RELAXED)
+#endif
+
+static size_t arenaClassSizes[ARENA_NUM_CLASSES] = {
+      16,   32,   48,   64,   80,   96,  112,  128,
+     160,  192,  224,  256,  320,  384,  448,  512,
+     640,  768,  896, 1024, 1280, 1536, 1792, 2048,
+    2560, 3072, 3584, 4096
+};
+
+typedef struct {
+    Rp_PoolChain *freePtr;      /* Free items of the class. */
+    size_t nItems;              /* # of items on the list. */
+} ArenaBin;
+
+typedef struct ArenaCacheStruct {
+    struct Rp_ArenaStruct *arenaPtr;
+    struct ArenaCacheStruct *prevPtr, *nextPtr;
+                                /* Caches of the other threads using
+                                 * the arena. */
+    unsigned int generation;    /* Generation of the arena the items
+                                 * in the bins belong to. */
+    long requested;             /* Bytes asked for by this thread,
+                                 * less the bytes it freed. */
+    long cachedBytes;           /* Bytes of the items in the bins. */
+    ArenaBin bins[ARENA_NUM_CLASSES];
+} ArenaCache;
+
+/*
+ * Items too large for any size class are malloc'ed with this header,
+ * so that they can all be found and freed when the arena is reset.
+ */
+typedef struct ArenaBigStruct {
+    struct ArenaBigStruct *prevPtr, *nextPtr;
+    size_t size;
+    double align;               /* Aligns the item that follows. */
+} ArenaBig;
+
+struct Rp_ArenaStruct {
+    Rp_Pool pools[ARENA_NUM_CLASSES];
+    Rp_Pool stringPool;         /* Holds Rp_ArenaAllocString items. */
+    ArenaBig *bigPtr;           /* List of large items. */
+    size_t nBig, bigBytes;      /* # and size of the large items. */
+    long requested;             /* Bytes asked for from the pools
+                                 * outside of any thread's cache. */
+    unsigned int generation;    /* Incremented on every reset. */
+    ArenaCache *cachePtr;       /* List of the thread caches. */
+#ifdef ARENA_THREADS
+    int shared;                 /* If non-zero, several threads may
+                                 * use the arena and it is locked. */
+    pthread_mutex_t lock;
+#endif /* ARENA_THREADS */
+#ifdef ARENA_CACHES
+    pthread_key_t key;          /* Thread's cache of the arena. */
+    int haveKey;                /* If zero, the arena isn't shared or
+                                 * the key couldn't be created, and
+                                 * threads don't keep caches. */
+#endif /* ARENA_CACHES */
+};
+
+#ifdef ARENA_THREADS
+#define ArenaLock(a) \
+    do { if ((a)->shared) pthread_mutex_lock(&(a)->lock); } while (0)
+#define ArenaUnlock(a) \
+    do { if ((a)->shared) pthread_mutex_unlock(&(a)->lock); } while (0)
+#else
+#define ArenaLock(a)
+#define ArenaUnlock(a)
+#endif /* ARENA_THREADS */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * SizeClass --
+ *
+ *      Returns the index of the smallest size class holding items
+ *      of the given size.  The size must be between 1 and
+ *      RP_ARENA_MAX_ITEM.
+ *
+ *----------------------------------------------------------------------
+ */
+static INLINE int
+SizeClass(size_t size)
+{
+    size_t n;
+    int lg;
+
+    if (size <= 128) {
+        return (size == 0) ? 0 : (int)((size - 1) >> 4);
+    }
+    n = size - 1;
+    for (lg = 7; (n >> (lg + 1)) != 0; lg++) {
+        /* empty */
+    }
+    return 8 + (lg - 7) * 4 + (int)(n >> (lg - 2)) - 4;
+}
+
+#ifdef ARENA_CACHES
+/*
+ *----------------------------------------------------------------------
+ *
+ * FlushCache --
+ *
+ *      Gives the items of the cache back to the pools of the arena.
+ *      The arena must be locked.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+FlushCache(struct Rp_ArenaStruct *arenaPtr, ArenaCache *cachePtr)
+{
+    Rp_PoolChain *itemPtr, *nextPtr;
+    int i;
+
+    if (cachePtr->generation != arenaPtr->generation) {
+        return;                 /* The items are already gone. */
+    }
+    for (i = 0; i < ARENA_NUM_CLASSES; i++) {
+        for (itemPtr = cachePtr->bins[i].freePtr; itemPtr != NULL;
+             itemPtr = nextPtr) {
+            nextPtr = itemPtr->nextPtr;
+            Rp_PoolFreeItem(arenaPtr->pools[i], itemPtr);
+        }
+        cachePtr->bins[i].freePtr = NULL;
+        cachePtr->bins[i].nItems = 0;
+    }
+    arenaPtr->requested += CacheCount(cachePtr->requested);
+    CacheSet(cachePtr->requested, 0);
+    CacheSet(cachePtr->cachedBytes, 0);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ThreadExitProc --
+ *
+ *      Called when a thread that used the arena exits.  The items in
+ *      its cache go back to the arena.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+ThreadExitProc(void *clientData)
+{
+    ArenaCache *cachePtr = clientData;
+    struct Rp_ArenaStruct *arenaPtr = cachePtr->arenaPtr;
+
+    ArenaLock(arenaPtr);
+    FlushCache(arenaPtr, cachePtr);
+    if (cachePtr->prevPtr != NULL) {
+        cachePtr->prevPtr->nextPtr = cachePtr->nextPtr;
+    } else {
+        arenaPtr->cachePtr = cachePtr->nextPtr;
+    }
+    if (cachePtr->nextPtr != NULL) {
+        cachePtr->nextPtr->prevPtr = cachePtr->prevPtr;
+    }
+    ArenaUnlock(arenaPtr);
+    free(cachePtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetCache --
+ *
+ *      Returns the calling thread's cache for the arena, creating it
+ *      the first time the thread uses the arena.
+ *
+ * Results:
+ *      Returns the cache, or NULL if threads don't keep caches.
+ *
+ *----------------------------------------------------------------------
+ */
+static INLINE ArenaCache *
+GetCache(struct Rp_ArenaStruct *arenaPtr)
+{
+    ArenaCache *cachePtr;
+
+    if (!arenaPtr->haveKey) {
+        return NULL;
+    }
+    cachePtr = pthread_getspecific(arenaPtr->key);
+    if (cachePtr == NULL) {
+        cachePtr = calloc(1, sizeof(ArenaCache));
+        if (cachePtr == NULL) {
+            return NULL;
+        }
+        cachePtr->arenaPtr = arenaPtr;
+        ArenaLock(arenaPtr);
+        cachePtr->generation = arenaPtr->generation;
+        cachePtr->nextPtr = arenaPtr->cachePtr;
+        if (arenaPtr->cachePtr != NULL) {
+            arenaPtr->cachePtr->prevPtr = cachePtr;
+        }
+        arenaPtr->cachePtr = cachePtr;
+        ArenaUnlock(arenaPtr);
+        pthread_setspecific(arenaPtr->key, cachePtr);
+    } else if (cachePtr->generation != arenaPtr->generation) {
+        ArenaLock(arenaPtr);
+        memset(cachePtr->bins, 0, sizeof(cachePtr->bins));
+        CacheSet(cachePtr->requested, 0);
+        CacheSet(cachePtr->cachedBytes, 0);
+        cachePtr->generation = arenaPtr->generation;
+        ArenaUnlock(arenaPtr);
+    }
+    return cachePtr;
+}
+#endif /* ARENA_CACHES */
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewArena --
+ *
+ *      Creates a new arena, shared by threads or not.
+ *
+ *----------------------------------------------------------------------
+ */
+static Rp_Arena
+NewArena(int shared)
+{
+    struct Rp_ArenaStruct *arenaPtr;
+    int i;
+
+    arenaPtr = calloc(1, sizeof(struct Rp_ArenaStruct));
+    for (i = 0; i < ARENA_NUM_CLASSES; i++) {
+        arenaPtr->pools[i] = Rp_PoolCreate(RP_FIXED_SIZE_ITEMS);
+    }
+    arenaPtr->stringPool = Rp_PoolCreate(RP_STRING_ITEMS);
+#ifdef ARENA_THREADS
+    arenaPtr->shared = shared;
+    if (shared) {
+        pthread_mutex_init(&arenaPtr->lock, NULL);
+    }
+#endif /* ARENA_THREADS */
+#ifdef ARENA_CACHES
+    arenaPtr->haveKey = shared &&
+        (pthread_key_create(&arenaPtr->key, ThreadExitProc) == 0);
+#endif /* ARENA_CACHES */
+    return arenaPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_ArenaCreate --
+ *
+ *      Creates a new arena for use by one thread at a time.
+ *
+ * Results:
+ *      Returns a pointer to the new arena.
+ *
+ *----------------------------------------------------------------------
+ */
+Rp_Arena
+Rp_ArenaCreate()
+{
+    return NewArena(0);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_ArenaCreateShared --
+ *
+ *      Creates a new arena that several threads can use at once.
+ *
+ * Results:
+ *      Returns a pointer to the new arena.
+ *
+ *----------------------------------------------------------------------
+ */
+Rp_Arena
+Rp_ArenaCreateShared()
+{
+    return NewArena(1);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_ArenaReset --
+ *
+ *      Frees every item in the arena at once.  The arena can still
+ *      be used afterwards.
+ *
+ * Results:
+ *      None.
+ *
+ * Side Effects:
+ *      The memory of the pools and of the large items is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Rp_ArenaReset(arenaPtr)
+    struct Rp_ArenaStruct *arenaPtr;
+{
+    ArenaBig *bigPtr, *nextPtr;
+    int i;
+
+    ArenaLock(arenaPtr);
+    for (i = 0; i < ARENA_NUM_CLASSES; i++) {
+        Rp_PoolReset(arenaPtr->pools[i]);
+    }
+    Rp_PoolReset(arenaPtr->stringPool);
+    for (bigPtr = arenaPtr->bigPtr; bigPtr != NULL; bigPtr = nextPtr) {
+        nextPtr = bigPtr->nextPtr;
+        free(bigPtr);
+    }
+    arenaPtr->bigPtr = NULL;
+    arenaPtr->nBig = arenaPtr->bigBytes = 0;
+    arenaPtr->requested = 0;
+    arenaPtr->generation++;
+    ArenaUnlock(arenaPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_ArenaDestroy --
+ *
+ *      Destroys the arena and every item in it.
+ *
+ * Results:
+ *      None.
+ *
+ * Side Effects:
+ *      All memory used by the arena is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Rp_ArenaDestroy(arenaPtr)
+    struct Rp_ArenaStruct *arenaPtr;
+{
+    ArenaCache *cachePtr, *nextPtr;
+    int i;
+
+    Rp_ArenaReset(arenaPtr);
+#ifdef ARENA_CACHES
+    if (arenaPtr->haveKey) {
+        pthread_key_delete(arenaPtr->key);
+    }
+#endif /* ARENA_CACHES */
+#ifdef ARENA_THREADS
+    if (arenaPtr->shared) {
+        pthread_mutex_destroy(&arenaPtr->lock);
+    }
+#endif /* ARENA_THREADS */
+    for (cachePtr = arenaPtr->cachePtr; cachePtr != NULL; cachePtr = nextPtr) {
+        nextPtr = cachePtr->nextPtr;
+        free(cachePtr);
+    }
+    for (i = 0; i < ARENA_NUM_CLASSES; i++) {
+        Rp_PoolDestroy(arenaPtr->pools[i]);
+    }
+    Rp_PoolDestroy(arenaPtr->stringPool);
+    free(arenaPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_ArenaAlloc --
+ *
+ *      Allocates an item of the given size from the arena.  Like
+ *      other pool items, it is aligned on a word boundary.
+ *
+ * Results:
+ *      Returns a pointer to the item.
+ *
+ *----------------------------------------------------------------------
+ */
+void *
+Rp_ArenaAlloc(arenaPtr, size)
+    struct Rp_ArenaStruct *arenaPtr;
+    size_t size;
+{
+    void *itemPtr;
+    int i;
+
+    if (size > RP_ARENA_MAX_ITEM) {
+        ArenaBig *bigPtr;
+
+        bigPtr = malloc(sizeof(ArenaBig) + size);
+        if (bigPtr == NULL) {
+            return NULL;
+        }
+        bigPtr->size = size;
+        bigPtr->prevPtr = NULL;
+        ArenaLock(arenaPtr);
+        bigPtr->nextPtr = arenaPtr->bigPtr;
+        if (arenaPtr->bigPtr != NULL) {
+            arenaPtr->bigPtr->prevPtr = bigPtr;
+        }
+        arenaPtr->bigPtr = bigPtr;
+        arenaPtr->nBig++;
+        arenaPtr->bigBytes += size;
+        ArenaUnlock(arenaPtr);
+        return bigPtr + 1;
+    }
+    i = SizeClass(size);
+#ifdef ARENA_CACHES
+    {
+        ArenaCache *cachePtr;
+
+        cachePtr = GetCache(arenaPtr);
+        if (cachePtr != NULL) {
+            ArenaBin *binPtr = cachePtr->bins + i;
+            Rp_PoolChain *chainPtr;
+
+            if (binPtr->freePtr == NULL) {
+                int j;
+
+                ArenaLock(arenaPtr);
+                for (j = 0; j < ARENA_BATCH; j++) {
+                    chainPtr = Rp_PoolAllocItem(arenaPtr->pools[i],
+                        arenaClassSizes[i]);
+                    chainPtr->nextPtr = binPtr->freePtr;
+                    binPtr->freePtr = chainPtr;
+                }
+                binPtr->nItems = ARENA_BATCH;
+                CacheAdd(cachePtr->cachedBytes,
+                    (long)(ARENA_BATCH * arenaClassSizes[i]));
+                ArenaUnlock(arenaPtr);
+            }
+            chainPtr = binPtr->freePtr;
+            binPtr->freePtr = chainPtr->nextPtr;
+            binPtr->nItems--;
+            CacheAdd(cachePtr->cachedBytes, -(long)arenaClassSizes[i]);
+            CacheAdd(cachePtr->requested, (long)size);
+            return chainPtr;
+        }
+    }
+#endif /* ARENA_CACHES */
+    ArenaLock(arenaPtr);
+    itemPtr = Rp_PoolAllocItem(arenaPtr->pools[i], arenaClassSizes[i]);
+    arenaPtr->requested += size;
+    ArenaUnlock(arenaPtr);
+    return itemPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_ArenaFree --
+ *
+ *      Frees an item allocated from the arena.  The size must be
+ *      the one the item was allocated with.
+ *
+ * Results:
+ *      None.
+ *
+ * Side Effects:
+ *      The item may be reused by later allocations.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Rp_ArenaFree(arenaPtr, item, size)
+    struct Rp_ArenaStruct *arenaPtr;
+    void *item;
+    size_t size;
+{
+    int i;
+
+    if (item == NULL) {
+        return;
+    }
+    if (size > RP_ARENA_MAX_ITEM) {
+        ArenaBig *bigPtr = (ArenaBig *)item - 1;
+
+        assert(bigPtr->size == size);
+        ArenaLock(arenaPtr);
+        if (bigPtr->prevPtr != NULL) {
+            bigPtr->prevPtr->nextPtr = bigPtr->nextPtr;
+        } else {
+            arenaPtr->bigPtr = bigPtr->nextPtr;
+        }
+        if (bigPtr->nextPtr != NULL) {
+            bigPtr->nextPtr->prevPtr = bigPtr->prevPtr;
+        }
+        arenaPtr->nBig--;
+        arenaPtr->bigBytes -= size;
+        ArenaUnlock(arenaPtr);
+        free(bigPtr);
+        return;
+    }
+    i = SizeClass(size);
+#ifdef ARENA_CACHES
+    {
+        ArenaCache *cachePtr;
+
+        cachePtr = GetCache(arenaPtr);
+        if (cachePtr != NULL) {
+            ArenaBin *binPtr = cachePtr->bins + i;
+            Rp_PoolChain *chainPtr = item;
+
+            chainPtr->nextPtr = binPtr->freePtr;
+            binPtr->freePtr = chainPtr;
+            binPtr->nItems++;
+            CacheAdd(cachePtr->cachedBytes, (long)arenaClassSizes[i]);
+            CacheAdd(cachePtr->requested, -(long)size);
+            if (binPtr->nItems > ARENA_CACHE_MAX) {
+                /* Give half of the list back to the pool. */
+                ArenaLock(arenaPtr);
+                while (binPtr->nItems > ARENA_CACHE_MAX / 2) {
+                    chainPtr = binPtr->freePtr;
+                    binPtr->freePtr = chainPtr->nextPtr;
+                    binPtr->nItems--;
+                    CacheAdd(cachePtr->cachedBytes,
+                        -(long)arenaClassSizes[i]);
+                    Rp_PoolFreeItem(arenaPtr->pools[i], chainPtr);
+                }
+                ArenaUnlock(arenaPtr);
+            }
+            return;
+        }
+    }
+#endif /* ARENA_CACHES */
+    ArenaLock(arenaPtr);
+    Rp_PoolFreeItem(arenaPtr->pools[i], item);
+    arenaPtr->requested -= size;
+    ArenaUnlock(arenaPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_ArenaAllocString --
+ *
+ *      Allocates size bytes for a string.  The bytes are packed
+ *      one after the other with no alignment, and can't be freed
+ *      other than by resetting or destroying the arena.
+ *
+ * Results:
+ *      Returns a pointer to the bytes.
+ *
+ *----------------------------------------------------------------------
+ */
+char *
+Rp_ArenaAllocString(arenaPtr, size)
+    struct Rp_ArenaStruct *arenaPtr;
+    size_t size;
+{
+    char *string;
+
+    ArenaLock(arenaPtr);
+    string = Rp_PoolAllocItem(arenaPtr->stringPool, size);
+    ArenaUnlock(arenaPtr);
+    return string;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_ArenaGetStats --
+ *
+ *      Reports the memory used by the arena.  Items cached by the
+ *      threads are not counted as in use.  Other threads may be
+ *      using their caches meanwhile, so for a shared arena in use
+ *      the counts are only approximate.
+ *
+ * Results:
+ *      None.  The counts are stored in *statsPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Rp_ArenaGetStats(arenaPtr, statsPtr)
+    struct Rp_ArenaStruct *arenaPtr;
+    Rp_PoolStats *statsPtr;
+{
+    Rp_PoolStats poolStats;
+#ifdef ARENA_CACHES
+    ArenaCache *cachePtr;
+#endif /* ARENA_CACHES */
+    size_t classBytes;
+    long requested;
+    int i;
+
+    memset(statsPtr, 0, sizeof(Rp_PoolStats));
+    ArenaLock(arenaPtr);
+    for (i = 0; i < ARENA_NUM_CLASSES; i++) {
+        Rp_PoolGetStats(arenaPtr->pools[i], &poolStats);
+        statsPtr->bytesInUse += poolStats.bytesInUse;
+        statsPtr->chunkBytes += poolStats.chunkBytes;
+        statsPtr->waste += poolStats.waste;
+        statsPtr->nChunks += poolStats.nChunks;
+    }
+    requested = arenaPtr->requested;
+#ifdef ARENA_CACHES
+    for (cachePtr = arenaPtr->cachePtr; cachePtr != NULL;
+         cachePtr = cachePtr->nextPtr) {
+        if (cachePtr->generation != arenaPtr->generation) {
+            continue;
+        }
+        statsPtr->bytesInUse -= CacheCount(cachePtr->cachedBytes);
+        requested += CacheCount(cachePtr->requested);
+    }
+#endif /* ARENA_CACHES */
+    /* Bytes lost to rounding items up to their size class. */
+    classBytes = statsPtr->bytesInUse;
+    if ((requested >= 0) && ((size_t)requested < classBytes)) {
+        statsPtr->waste += classBytes - (size_t)requested;
+    }
+
+    Rp_PoolGetStats(arenaPtr->stringPool, &poolStats);
+    statsPtr->bytesInUse += poolStats.bytesInUse;
+    statsPtr->chunkBytes += poolStats.chunkBytes;
+    statsPtr->waste += poolStats.waste;
+    statsPtr->nChunks += poolStats.nChunks;
+
+    statsPtr->bytesInUse += arenaPtr->bigBytes;
+    statsPtr->chunkBytes += arenaPtr->bigBytes;
+    statsPtr->nChunks += arenaPtr->nBig;
+    ArenaUnlock(arenaPtr);
+}
@@ -23,14 +23,72 @@ struct Rp_PoolStruct {
     size_t bytesLeft;       /* # of bytes left in the current chunk. */
     size_t waste;
 
+    size_t nChunks;         /* # of chunks malloc'ed. */
+    size_t chunkBytes;      /* Bytes in the chunks, less their headers. */
+    size_t bytesInUse;      /* Bytes handed out.  Only fixed size
+                             * items are ever given back. */
+
     Rp_PoolAllocProc *allocProc;
     Rp_PoolFreeProc *freeProc;
 };
 
-extern Rp_Pool Rp_PoolCreate _ANSI_ARGS_((int type));
-extern void Rp_PoolDestroy _ANSI_ARGS_((Rp_Pool pool));
+/*
+ * Rp_PoolStats --
+ *
+ *  Memory used by a pool or an arena.
+ */
+typedef struct {
+    size_t bytesInUse;      /* Bytes handed out and not yet freed. */
+    size_t chunkBytes;      /* Bytes malloc'ed in chunks. */
+    size_t waste;           /* Bytes that can't be handed out: the
+                             * unused ends of chunks, and for arenas,
+                             * the rounding up of items to their
+                             * size class. */
+    size_t nChunks;         /* # of chunks malloc'ed. */
+} Rp_PoolStats;
+
+EXTERN Rp_Pool Rp_PoolCreate _ANSI_ARGS_((int type));
+EXTERN void Rp_PoolDestroy _ANSI_ARGS_((Rp_Pool pool));
+EXTERN void Rp_PoolReset _ANSI_ARGS_((Rp_Pool pool));
+EXTERN void Rp_PoolGetStats _ANSI_ARGS_((Rp_Pool pool,
+    Rp_PoolStats *statsPtr));
 
 #define Rp_PoolAllocItem(poolPtr, n) (*((poolPtr)->allocProc))(poolPtr, n)
 #define Rp_PoolFreeItem(poolPtr, item) (*((poolPtr)->freeProc))(poolPtr, item)
 
+/*
+ * Rp_Arena --
+ *
+ *  An allocator for items of any size, built from a fixed size pool
+ *  for each size class.  Items larger than RP_ARENA_MAX_ITEM are
+ *  malloc'ed one at a time.
+ *
+ *  An arena from Rp_ArenaCreate must be used by one thread at a time.
+ *  One from Rp_ArenaCreateShared can be used by several threads at
+ *  once: each thread keeps a small cache of free items per size class
+ *  and only takes the arena's lock to refill or drain it.  Each shared
+ *  arena uses up a thread-specific data key, so create a few long-lived
+ *  ones rather than one per object.
+ *
+ *  Rp_ArenaFree must be given the size the item was allocated with.
+ *  Rp_ArenaAllocString hands out unaligned bytes that are freed only
+ *  by Rp_ArenaReset or Rp_ArenaDestroy.  Resetting or destroying the
+ *  arena frees every item in it at once; no other thread may be
+ *  using the arena at the time.
+ */
+#define RP_ARENA_MAX_ITEM       4096
+
+typedef struct Rp_ArenaStruct *Rp_Arena;
+
+EXTERN Rp_Arena Rp_ArenaCreate _ANSI_ARGS_((void));
+EXTERN Rp_Arena Rp_ArenaCreateShared _ANSI_ARGS_((void));
+EXTERN void Rp_ArenaDestroy _ANSI_ARGS_((Rp_Arena arena));
+EXTERN void Rp_ArenaReset _ANSI_ARGS_((Rp_Arena arena));
+EXTERN void *Rp_ArenaAlloc _ANSI_ARGS_((Rp_Arena arena, size_t size));
+EXTERN void Rp_ArenaFree _ANSI_ARGS_((Rp_Arena arena, void *item,
+    size_t size));
+EXTERN char *Rp_ArenaAllocString _ANSI_ARGS_((Rp_Arena arena, size_t size));
+EXTERN void Rp_ArenaGetStats _ANSI_ARGS_((Rp_Arena arena,
+    Rp_PoolStats *statsPtr));
+
 #endif /* RP_POOL_H */
@@ -45,28 +45,14 @@ static Rp_TreeApplyProc SizeApplyProc;
 #define TREE_THREAD_KEY     "BLT Tree Data"
 #define TREE_MAGIC          ((unsigned int) 0x46170277)
 #define TREE_DESTROYED      (1<<0)
+#define TREE_OWN_ARENA      (1<<1)  /* The tree created its arena and
+                                     * destroys it with the tree. */
 
 typedef struct Rp_TreeNodeStruct Node;
 typedef struct Rp_TreeClientStruct TreeClient;
 typedef struct Rp_TreeObjectStruct TreeObject;
 typedef struct Rp_TreeValueStruct Value;
 
-/*
- * Rp_TreeValue --
- *
- *  Tree nodes contain heterogeneous data fields, represented as a
- *  chain of these structures.  Each field contains the key of the
- *  field (Rp_TreeKey) and the value (Tcl_Obj) containing the
- *  actual data representations.
- *
- */
-struct Rp_TreeValueStruct {
-    Rp_TreeKey key;     /* String identifying the data field */
-    void *objPtr;       /* Data representation. */
-    Rp_Tree owner;      /* Non-NULL if privately owned. */
-    Rp_TreeValue next;  /* Next value in the chain. */
-};
-
 #include <stdio.h>
 #include <string.h>
 /* The following header is required for LP64 compilation */
@@ -119,6 +105,11 @@ static Value *TreeNextValue _ANSI_ARGS_((Rp_TreeKeySearch *srchPtr));
 
 #define DOWNSHIFT_START     (BITSPERWORD - 2)
 
+#ifndef ALIGN
+#define ALIGN(a) \
+    (((size_t)a + (sizeof(void *) - 1)) & (~(sizeof(void *) - 1)))
+#endif /* ALIGN */
+
 /*
  * Procedure prototypes for static procedures in this file:
  */
@@ -132,10 +123,12 @@ static Rp_Hash HashOneWord _ANSI_ARGS_((uint64_t mask, unsigned int downshift,
 
 /*
  * The hash table below is used to keep track of all the Rp_TreeKeys
- * created so far.
+ * created so far.  Keys are never freed, so its entries are packed
+ * into a pool.  keyBytes counts the bytes they use.
  */
 static Rp_HashTable keyTable;
 static int keyTableInitialized = 0;
+static size_t keyBytes = 0;
 
 typedef struct {
     Rp_HashTable treeTable; /* Table of trees. */
@@ -224,7 +217,7 @@ NewNode(TreeObject *treeObjPtr, CONST char *name, size_t inode)
     Node *nodePtr;
 
     /* Create the node structure */
-    nodePtr = Rp_PoolAllocItem(treeObjPtr->nodePool, sizeof(Node));
+    nodePtr = Rp_ArenaAlloc(treeObjPtr->arena, sizeof(Node));
     nodePtr->inode = inode;
     nodePtr->treeObject = treeObjPtr;
     nodePtr->parent = NULL;
@@ -236,6 +229,15 @@ NewNode(TreeObject *treeObjPtr, CONST char *name, size_t inode)
     nodePtr->values = NULL;
     nodePtr->logSize = 0;
     nodePtr->nValues = 0;
+#if (RP_TREE_INLINE_VALUES > 0)
+    {
+        int i;
+
+        for (i = 0; i < RP_TREE_INLINE_VALUES; i++) {
+            nodePtr->inlineValues[i].key = NULL;
+        }
+    }
+#endif
     nodePtr->label = NULL;
     if (name != NULL) {
         nodePtr->label = Rp_TreeGetKey(name);
@@ -408,7 +410,7 @@ FreeNode(TreeObject *treeObjPtr, Node *nodePtr)
     hPtr = Rp_FindHashEntry(&treeObjPtr->nodeTable, (char *)nodePtr->inode);
     assert(hPtr);
     Rp_DeleteHashEntry(&treeObjPtr->nodeTable, hPtr);
-    Rp_PoolFreeItem(treeObjPtr->nodePool, (char *)nodePtr);
+    Rp_ArenaFree(treeObjPtr->arena, nodePtr, sizeof(Node));
 }
 
 /*
@@ -417,7 +419,9 @@ FreeNode(TreeObject *treeObjPtr, Node *nodePtr)
  * NewTreeObject --
  *
  *  Creates and initializes a new tree object. Trees always
- *  contain a root node, so one is allocated here.
+ *  contain a root node, so one is allocated here.  The nodes
+ *  and values of the tree come from the given arena, or from
+ *  an arena of the tree's own if arena is NULL.
  *
  * Results:
  *  Returns a pointer to the new tree object is successful, NULL
@@ -427,7 +431,7 @@ FreeNode(TreeObject *treeObjPtr, Node *nodePtr)
  * -------------------------------------------------------------- */
 static TreeObject *
 // NewTreeObject(TreeInterpData *dataPtr, CONST char *treeName)
-NewTreeObject(CONST char *treeName)
+NewTreeObject(CONST char *treeName, Rp_Arena arena)
 {
     TreeObject *treeObjPtr;
     int isNew;
@@ -440,8 +444,11 @@ NewTreeObject(CONST char *treeName)
     }
     treeObjPtr->name = Rp_Strdup(treeName);
     //treeObjPtr->interp = interp;
-    treeObjPtr->valuePool = Rp_PoolCreate(RP_FIXED_SIZE_ITEMS);
-    treeObjPtr->nodePool = Rp_PoolCreate(RP_FIXED_SIZE_ITEMS);
+    if (arena == NULL) {
+        arena = Rp_ArenaCreate();
+        treeObjPtr->flags |= TREE_OWN_ARENA;
+    }
+    treeObjPtr->arena = arena;
     treeObjPtr->clients = Rp_ChainCreate();
     treeObjPtr->depth = 1;
     treeObjPtr->notifyFlags = 0;
@@ -529,36 +536,6 @@ FindTreeInNamespace(
 //    return treeObjPtr;
 //}
 
-/*
- * ----------------------------------------------------------------------
- *
- * TeardownTree --
- *
- *  Destroys an entire branch.  This is a special purpose routine
- *  used to speed up the final clean up of the tree.
- *
- * Results:
- *  None.
- *
- * ---------------------------------------------------------------------- 
- */
-static void
-TeardownTree(TreeObject *treeObjPtr, Node *nodePtr)
-{
-    if (nodePtr->first != NULL) {
-        Node *childPtr, *nextPtr;
-
-        for (childPtr = nodePtr->first; childPtr != NULL; childPtr = nextPtr) {
-            nextPtr = childPtr->next;
-            TeardownTree(treeObjPtr, childPtr);
-        }
-    }
-    if (nodePtr->values != NULL) {
-        TreeDestroyValues(nodePtr);
-    }
-    Rp_PoolFreeItem(treeObjPtr->nodePool, (char *)nodePtr);
-}
-
 static void
 DestroyTreeObject(TreeObject *treeObjPtr)
 {
@@ -579,9 +556,14 @@ DestroyTreeObject(TreeObject *treeObjPtr)
     }
     Rp_ChainDestroy(treeObjPtr->clients);
 
-    TeardownTree(treeObjPtr, treeObjPtr->root);
-    Rp_PoolDestroy(treeObjPtr->nodePool);
-    Rp_PoolDestroy(treeObjPtr->valuePool);
+    /*
+     * The nodes and values are freed all at once with the arena.  If
+     * the arena isn't the tree's own, they stay in it until its owner
+     * resets or destroys it.
+     */
+    if (treeObjPtr->flags & TREE_OWN_ARENA) {
+        Rp_ArenaDestroy(treeObjPtr->arena);
+    }
     Rp_DeleteHashTable(&treeObjPtr->nodeTable);
 
     if (treeObjPtr->hashPtr != NULL) {
@@ -777,13 +759,64 @@ DestroyTreeObject(TreeObject *treeObjPtr)
 //    }
 //}
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * NewValue --
+ *
+ *  Allocates a value for the node.  A free slot inside the node
+ *  is used if there is one, otherwise the value comes from the
+ *  tree's arena.
+ *
+ * Results:
+ *  Returns a pointer to the new value.  Its fields other than the
+ *  key are not initialized.
+ *
+ *----------------------------------------------------------------------
+ */
+static Value *
+NewValue(Node *nodePtr, Rp_TreeKey key)
+{
+    TreeObject *treeObjPtr = nodePtr->treeObject;
+    Value *valuePtr;
+
+#if (RP_TREE_INLINE_VALUES > 0)
+    int i;
+
+    for (i = 0; i < RP_TREE_INLINE_VALUES; i++) {
+        valuePtr = nodePtr->inlineValues + i;
+        if (valuePtr->key == NULL) {
+            valuePtr->key = key;
+            treeObjPtr->nValues++;
+            treeObjPtr->nInlineValues++;
+            return valuePtr;
+        }
+    }
+#endif
+    valuePtr = Rp_ArenaAlloc(treeObjPtr->arena, sizeof(Value));
+    valuePtr->key = key;
+    treeObjPtr->nValues++;
+    return valuePtr;
+}
+
 static void
 FreeValue(Node *nodePtr, Value *valuePtr)
 {
+    TreeObject *treeObjPtr = nodePtr->treeObject;
+
     if (valuePtr->objPtr != NULL) {
         // Tcl_DecrRefCount(valuePtr->objPtr);
     }
-    Rp_PoolFreeItem(nodePtr->treeObject->valuePool, valuePtr);
+    treeObjPtr->nValues--;
+#if (RP_TREE_INLINE_VALUES > 0)
+    if ((valuePtr >= nodePtr->inlineValues) &&
+        (valuePtr < nodePtr->inlineValues + RP_TREE_INLINE_VALUES)) {
+        valuePtr->key = NULL;
+        treeObjPtr->nInlineValues--;
+        return;
+    }
+#endif
+    Rp_ArenaFree(treeObjPtr->arena, valuePtr, sizeof(Value));
 }
 
 
@@ -805,10 +838,14 @@ Rp_TreeGetKey(string)
     int isNew;
 
     if (!keyTableInitialized) {
-        Rp_InitHashTable(&keyTable, RP_STRING_KEYS);
+        Rp_InitHashTableWithPool(&keyTable, RP_STRING_KEYS);
         keyTableInitialized = 1;
     }
     hPtr = Rp_CreateHashEntry(&keyTable, string, &isNew);
+    if (isNew) {
+        keyBytes += ALIGN(sizeof(Rp_HashEntry) - sizeof(Rp_HashKey) +
+                          strlen(string) + 1);
+    }
     return (Rp_TreeKey)Rp_GetHashKey(&keyTable, hPtr);
 }
 
@@ -1891,9 +1928,36 @@ NewTreeClient(TreeObject *treeObjPtr)
 
 int
 Rp_TreeCreate(
+    CONST char *name,           /* Name of tree in namespace.  Tree
+                                 * must not already exist. */
+    TreeClient **clientPtrPtr)  /* (out) Client token of newly created
+                                 * tree.  Releasing the token will
+                                 * free the tree.  If NULL, no token
+                                 * is generated. */
+{
+    return Rp_TreeCreateWithArena(name, NULL, clientPtrPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_TreeCreateWithArena --
+ *
+ *  Creates a tree whose nodes and values come from the given
+ *  arena.  Several trees, and any other allocations of a
+ *  document, can share the arena and be freed together by
+ *  destroying it.  Releasing the tree doesn't give its nodes
+ *  back to the arena.  If arena is NULL, the tree has an arena
+ *  of its own, as trees made by Rp_TreeCreate do.
+ *
+ *----------------------------------------------------------------------
+ */
+int
+Rp_TreeCreateWithArena(
 //    Tcl_Interp *interp,         /* Interpreter to report errors back to. */
     CONST char *name,           /* Name of tree in namespace.  Tree
                                  * must not already exist. */
+    Rp_Arena arena,             /* Arena for the nodes and values. */
     TreeClient **clientPtrPtr)  /* (out) Client token of newly created
                                  * tree.  Releasing the token will
                                  * free the tree.  If NULL, no token
@@ -1949,7 +2013,7 @@ Rp_TreeCreate(
 //    }
 //    name = Rp_GetQualifiedName(nsPtr, treeName, &dString);
     // treeObjPtr = NewTreeObject(dataPtr, name);
-    treeObjPtr = NewTreeObject(name);
+    treeObjPtr = NewTreeObject(name, arena);
     if (treeObjPtr == NULL) {
         fprintf(stderr, "can't allocate tree \"%s\"", name);
 //        Tcl_DStringFree(&dString);
@@ -2111,6 +2175,45 @@ Rp_TreeSize(Node *nodePtr)
     return sum;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * Rp_TreeMemoryUsage --
+ *
+ *  Reports the bytes used by the nodes, values and tables of the
+ *  tree, and by the keys interned for all trees.
+ *
+ * Results:
+ *  None.  The counts are stored in *statsPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+void
+Rp_TreeMemoryUsage(
+    TreeClient *clientPtr,
+    Rp_TreeMemoryStats *statsPtr)
+{
+    TreeObject *treeObjPtr = clientPtr->treeObject;
+    Rp_HashTable *tablePtr = &treeObjPtr->nodeTable;
+
+    statsPtr->nNodes = treeObjPtr->nNodes;
+    statsPtr->nValues = treeObjPtr->nValues;
+    statsPtr->nInlineValues = treeObjPtr->nInlineValues;
+    statsPtr->nodeBytes = treeObjPtr->nNodes * sizeof(Node);
+    statsPtr->valueBytes = (treeObjPtr->nValues - treeObjPtr->nInlineValues)
+        * sizeof(Value);
+    statsPtr->tableBytes = treeObjPtr->bucketBytes +
+        tablePtr->numEntries * sizeof(Rp_HashEntry);
+    if (tablePtr->buckets != tablePtr->staticBuckets) {
+        statsPtr->tableBytes += (tablePtr->mask + 1) * sizeof(Rp_HashGroup);
+    }
+    statsPtr->totalBytes = statsPtr->nodeBytes + statsPtr->valueBytes +
+        statsPtr->tableBytes;
+    statsPtr->bytesPerNode = (statsPtr->nNodes > 0) ?
+        statsPtr->totalBytes / statsPtr->nNodes : 0;
+    statsPtr->keyBytes = keyBytes;
+}
+
 
 void
 Rp_TreeCreateEventHandler(
@@ -2727,7 +2830,9 @@ RebuildTable(Node *nodePtr)     /* Table to enlarge. */
      */
     nodePtr->logSize += 2;
     nBuckets = (1 << nodePtr->logSize);
-    buckets = Rp_Calloc(nBuckets, sizeof(Value *));
+    buckets = Rp_ArenaAlloc(nodePtr->treeObject->arena,
+        nBuckets * sizeof(Value *));
+    memset(buckets, 0, nBuckets * sizeof(Value *));
 
     /*
      * Move all of the existing entries into the new bucket array,
@@ -2744,7 +2849,10 @@ RebuildTable(Node *nodePtr)     /* Table to enlarge. */
         }
     }
     nodePtr->values = (Value *)buckets;
-    Rp_Free(oldBuckets);
+    nodePtr->treeObject->bucketBytes += (nBuckets - (nBuckets >> 2)) *
+        sizeof(Value *);
+    Rp_ArenaFree(nodePtr->treeObject->arena, oldBuckets,
+        (nBuckets >> 2) * sizeof(Value *));
 }
 
 static void
@@ -2761,7 +2869,9 @@ ConvertValues(Node *nodePtr)
      */
     nodePtr->logSize = START_LOGSIZE;
     nBuckets = 1 << nodePtr->logSize;
-    buckets = Rp_Calloc(nBuckets, sizeof(Value *));
+    buckets = Rp_ArenaAlloc(nodePtr->treeObject->arena,
+        nBuckets * sizeof(Value *));
+    memset(buckets, 0, nBuckets * sizeof(Value *));
     mask = nBuckets - 1;
     downshift = DOWNSHIFT_START - nodePtr->logSize;
     for (valuePtr = nodePtr->values; valuePtr != NULL; valuePtr = nextPtr) {
@@ -2771,6 +2881,7 @@ ConvertValues(Node *nodePtr)
         *bucketPtr = valuePtr;
     }
     nodePtr->values = (Value *)buckets;
+    nodePtr->treeObject->bucketBytes += nBuckets * sizeof(Value *);
 }
 
 /*
@@ -2867,7 +2978,7 @@ TreeDestroyValues(Node *nodePtr)
     /*
      * Free up all the entries in the table.
      */
-    if (nodePtr->values != NULL) {
+    if (nodePtr->values == NULL) {
         return;
     }
     if (nodePtr->logSize > 0) {
@@ -2883,7 +2994,9 @@ TreeDestroyValues(Node *nodePtr)
                 FreeValue(nodePtr, valuePtr);
             }
         }
-        Rp_Free(buckets);
+        Rp_ArenaFree(nodePtr->treeObject->arena, buckets,
+            nBuckets * sizeof(Value *));
+        nodePtr->treeObject->bucketBytes -= nBuckets * sizeof(Value *);
     } else {
         for (valuePtr = nodePtr->values; valuePtr != NULL; valuePtr = nextPtr) {
             nextPtr = valuePtr->next;
@@ -3082,9 +3195,7 @@ TreeCreateValue(
 
         /* Value not found. Add a new value to the bucket. */
         *newPtr = TRUE;
-        valuePtr = Rp_PoolAllocItem(nodePtr->treeObject->valuePool, 
-                sizeof(Value));
-        valuePtr->key = key;
+        valuePtr = NewValue(nodePtr, key);
         valuePtr->owner = NULL;
         valuePtr->next = *bucketPtr;
         valuePtr->objPtr = NULL;
@@ -3112,9 +3223,7 @@ TreeCreateValue(
         }
         /* Value not found. Add a new value to the list. */
         *newPtr = TRUE;
-        valuePtr = Rp_PoolAllocItem(nodePtr->treeObject->valuePool,
-                sizeof(Value));
-        valuePtr->key = key;
+        valuePtr = NewValue(nodePtr, key);
         valuePtr->owner = NULL;
         valuePtr->next = NULL;
         valuePtr->objPtr = NULL;
@@ -88,6 +88,29 @@ typedef struct {
                                  * the current bucket. */
 } Rp_TreeKeySearch;
 
+/*
+ * Rp_TreeMemoryStats --
+ *
+ *  Bytes in use by a tree, as reported by Rp_TreeMemoryUsage.
+ *  These are the bytes of live nodes, values and tables; space
+ *  the pools have allocated but not handed out is not counted.
+ */
+typedef struct {
+    size_t nNodes;          /* # of nodes, counting the root. */
+    size_t nValues;         /* # of values in all nodes. */
+    size_t nInlineValues;   /* # of values stored inside their node. */
+    size_t nodeBytes;       /* Bytes of nodes, including the values
+                             * stored inside them. */
+    size_t valueBytes;      /* Bytes of values from the arena. */
+    size_t tableBytes;      /* Bytes of the node table and of the
+                             * value hash tables of large nodes. */
+    size_t totalBytes;      /* Sum of the above. */
+    size_t bytesPerNode;    /* totalBytes / nNodes */
+    size_t keyBytes;        /* Bytes of interned keys.  Keys are
+                             * shared by all trees, so these are
+                             * not part of totalBytes. */
+} Rp_TreeMemoryStats;
+
 /*
  * Rp_TreeObject --
  *
@@ -131,8 +154,8 @@ struct Rp_TreeObjectStruct {
 
     Rp_Chain *clients;      /* List of clients using this tree */
 
-    Rp_Pool nodePool;
-    Rp_Pool valuePool;
+    Rp_Arena arena;         /* Holds the nodes, values and value
+                             * hash tables of the tree. */
 
     Rp_HashTable nodeTable; /* Table of node identifiers. Used to
                              * search for a node pointer given an inode.*/
@@ -147,6 +170,35 @@ struct Rp_TreeObjectStruct {
     unsigned int notifyFlags;   /* Notification flags. See definitions
                                  * below. */
 
+    size_t nValues;         /* # of values in all nodes. */
+    size_t nInlineValues;   /* # of values stored inside their node
+                             * rather than in the arena. */
+    size_t bucketBytes;     /* Bytes of value hash table buckets. */
+
+};
+
+/*
+ * Rp_TreeValueStruct --
+ *
+ *  Tree nodes contain heterogeneous data fields, represented as a
+ *  chain of these structures.  Each field contains the key of the
+ *  field (Rp_TreeKey) and the value (Tcl_Obj) containing the
+ *  actual data representations.
+ *
+ *  The first RP_TREE_INLINE_VALUES values of a node are kept in the
+ *  node itself, the rest come from the tree's arena.  Nodes of
+ *  an XML document hold about one value each.  A slot in the node
+ *  is free when its key is NULL.
+ */
+#ifndef RP_TREE_INLINE_VALUES
+#define RP_TREE_INLINE_VALUES   1
+#endif
+
+struct Rp_TreeValueStruct {
+    Rp_TreeKey key;     /* String identifying the data field */
+    void *objPtr;       /* Data representation. */
+    Rp_Tree owner;      /* Non-NULL if privately owned. */
+    Rp_TreeValue next;  /* Next value in the chain. */
 };
 
 /*
@@ -197,6 +249,12 @@ struct Rp_TreeNodeStruct {
     unsigned short depth;   /* The depth of this node in the tree. */
 
     unsigned short flags;
+
+#if (RP_TREE_INLINE_VALUES > 0)
+    struct Rp_TreeValueStruct inlineValues[RP_TREE_INLINE_VALUES];
+                            /* Storage for the node's first few
+                             * values. */
+#endif
 };
 
 struct Rp_TreeTagEntryStruct {
@@ -402,6 +460,9 @@ EXTERN int Rp_TreeSortNode _ANSI_ARGS_((Rp_Tree tree, Rp_TreeNode node,
 EXTERN int Rp_TreeCreate _ANSI_ARGS_((CONST char *name,
         Rp_Tree *treePtr));
 
+EXTERN int Rp_TreeCreateWithArena _ANSI_ARGS_((CONST char *name,
+        Rp_Arena arena, Rp_Tree *treePtr));
+
 // EXTERN int Rp_TreeExists _ANSI_ARGS_((CONST char *name));
 
 // EXTERN int Rp_TreeGetToken _ANSI_ARGS_((CONST char *name,
@@ -414,6 +475,9 @@ EXTERN void Rp_TreeReleaseToken _ANSI_ARGS_((Rp_Tree tree));
 
 EXTERN int Rp_TreeSize _ANSI_ARGS_((Rp_TreeNode node));
 
+EXTERN void Rp_TreeMemoryUsage _ANSI_ARGS_((Rp_Tree tree,
+        Rp_TreeMemoryStats *statsPtr));
+
 EXTERN Rp_TreeTrace Rp_TreeCreateTrace _ANSI_ARGS_((Rp_Tree tree,
         Rp_TreeNode node, CONST char *keyPattern, CONST char *tagName,
         unsigned int mask, Rp_TreeTraceProc *proc, ClientData clientData));
@@ -450,6 +514,7 @@ EXTERN Rp_HashEntry *Rp_TreeFirstTag _ANSI_ARGS_((Rp_Tree tree,
         Rp_HashSearch *searchPtr));
 
 #define Rp_TreeName(token)              ((token)->treeObject->name)
+#define Rp_TreeArena(token)             ((token)->treeObject->arena)
 #define Rp_TreeRootNode(token)          ((token)->root)
 #define Rp_TreeChangeRoot(token, node)  ((token)->root = (node))
 
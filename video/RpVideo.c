@@ -17,6 +17,9 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
 
 #include "config.h"
 
@@ -70,6 +73,96 @@
 #define avio_close		url_fclose
 #endif
 
+/*
+ * Key frames found in the video stream when it's opened for reading.
+ * Seeking to the key frame at or before a target frame and decoding
+ * forward from there reaches any frame by decoding at most one group
+ * of pictures.
+ */
+typedef struct VideoKeyFrame {
+    int frame;                  /* frame number of the key frame */
+    int64_t timestamp;          /* dts (or pts) of its packet, or
+                                 * AV_NOPTS_VALUE if unknown */
+    int64_t pos;                /* byte position of its packet */
+} VideoKeyFrame;
+
+/*
+ * Frames already converted to RGB, kept in most-recently-used order.
+ * Stepping back and forth over the same frames, or playing frames
+ * decoded ahead of time by the prefetch thread, only costs a copy.
+ */
+typedef struct VideoCacheEntry {
+    int frame;                  /* frame number */
+    int width, height;          /* size of the RGB image */
+    uint8_t *rgb;               /* width*height packed RGB pixels */
+    struct VideoCacheEntry *prevPtr;    /* more recently used */
+    struct VideoCacheEntry *nextPtr;    /* less recently used */
+} VideoCacheEntry;
+
+typedef struct VideoCache {
+    pthread_mutex_t lock;       /* guards the entries and the request */
+    pthread_cond_t wakeup;      /* signals a new request or quit */
+    VideoCacheEntry *headPtr;   /* most recently used entry */
+    VideoCacheEntry *tailPtr;   /* least recently used entry */
+    int numEntries;
+    int maxEntries;
+
+    /* background prefetch, using its own decoder for the same file */
+    VideoObj *decoderPtr;
+    pthread_t thread;
+    int threadStarted;
+    int quit;
+    int serial;                 /* changes with each new request */
+    int reqFrame;               /* frame being shown */
+    int reqDir;                 /* +1 to read ahead, -1 to read behind */
+    int reqCount;               /* number of frames to prefetch */
+    int reqWidth, reqHeight;    /* size of the images being shown */
+} VideoCache;
+
+/*
+ * Frames being written out.  VideoPutFrame() copies each RGB frame into
+ * a free slot; a pool of worker threads converts slots to the encoder's
+ * YUV format (sws_scale) in parallel; and one encoder thread takes the
+ * converted slots in order and encodes them.  The fixed number of slots
+ * keeps the producer from getting too far ahead.
+ */
+#define VIDEO_SLOT_FREE         0   /* available to VideoPutFrame() */
+#define VIDEO_SLOT_FILLING      1   /* RGB pixels being copied in */
+#define VIDEO_SLOT_RGB          2   /* waiting for a converter */
+#define VIDEO_SLOT_CONVERTING   3   /* being converted */
+#define VIDEO_SLOT_YUV          4   /* waiting for the encoder */
+#define VIDEO_SLOT_ENCODING     5   /* being encoded */
+
+typedef struct VideoOutSlot {
+    int state;
+    int seq;                    /* order in which frames were put */
+    uint8_t *rgb;               /* packed RGB pixels */
+    int rgbw, rgbh;
+    AVFrame *yuvFrame;          /* converted frame for the encoder */
+    uint8_t *yuvbuffer;
+} VideoOutSlot;
+
+typedef struct VideoOutput {
+    pthread_mutex_t lock;       /* guards everything below */
+    pthread_cond_t changed;     /* broadcast whenever a slot changes */
+    VideoOutSlot *slots;
+    int numSlots;
+    int nextSeq;                /* sequence number of the next frame put */
+    int encodeSeq;              /* sequence number of the next to encode */
+    int quit;
+    int error;                  /* set if the encoder failed */
+
+    pthread_t *converters;
+    int numConverters;
+    pthread_t encoder;
+    int encoderStarted;
+
+    /* timing, from the first frame put to the last one encoded */
+    int numFrames;
+    struct timeval startTime;
+    struct timeval endTime;
+} VideoOutput;
+
 /*
  * Each video object is represented by the following data:
  */
@@ -79,12 +172,32 @@ struct VideoObjRec {
     /* video input */
     AVFormatContext *pFormatCtx;
     int videoStream;
-    int frameNumber;
+    int frameNumber;            /* last frame decoded */
+    int viewFrame;              /* frame being shown, which may come
+                                 * from the cache instead */
     int atEnd;
+    int64_t pktPts;             /* pts of the packet being decoded */
+
+    /* key frame index for seeking */
+    VideoKeyFrame *keyFrames;
+    int numKeyFrames;
+    int maxKeyFrames;
+    int indexLastFrame;
+
+    /* cache of RGB frames and its prefetch thread */
+    VideoCache *cachePtr;
+    int cacheFrames;
+    int prefetchFrames;
 
     /* video output */
     AVFormatContext *outFormatCtx;
+    int outHeaderWritten;       /* frames and trailer need the header */
     AVStream *outVideoStr;
+    VideoOutput *outputPtr;
+    uint8_t *outbuf;
+    int outbufSize;
+    int outNumFrames;           /* timing of the last video written */
+    double outSeconds;
 
     /* used for both input/output */
     AVFrame *pFrameYUV;
@@ -119,10 +232,32 @@ static int VideoTime2Frame (AVStream *streamPtr, int64_t tval);
 static int64_t VideoFrame2Time (AVStream *streamPtr, int fval);
 static void VideoNextFrame (VideoObj *vidPtr);
 
-uint64_t global_video_pkt_pts = AV_NOPTS_VALUE;
+static int VideoBuildIndex (VideoObj *vidPtr);
+static void VideoFreeIndex (VideoObj *vidPtr);
+static VideoKeyFrame *VideoFindKeyFrame (VideoObj *vidPtr, int frame);
+static int VideoSeekKeyFrame (VideoObj *vidPtr, VideoKeyFrame *keyPtr);
+static int VideoDecodeToN (VideoObj *vidPtr, int n);
+static int VideoScaleFrame (VideoObj *vidPtr, int width, int height);
+static int VideoFillImage (VideoObj *vidPtr, int width, int height);
+
+static VideoCache *VideoCacheCreate (VideoObj *vidPtr);
+static void VideoCacheDestroy (VideoObj *vidPtr);
+static VideoCacheEntry *VideoCacheFind (VideoCache *cachePtr, int frame,
+    int width, int height);
+static void VideoCacheAdd (VideoCache *cachePtr, int frame, int width,
+    int height, const uint8_t *rgb);
+static void VideoCachePrefetch (VideoObj *vidPtr, int width, int height);
+static void *VideoCacheThread (void *clientData);
+static VideoObj *VideoOpenDecoder (VideoObj *vidPtr);
+static void *VideoThumbnailThread (void *clientData);
+static VideoGrayFrameProc VideoAnalyzeFrame;
+
 static int VideoAvGetBuffer (struct AVCodecContext *c, AVFrame *fr);
 static void VideoAvReleaseBuffer (struct AVCodecContext *c, AVFrame *fr);
 static int VideoWriteFrame (VideoObj *vidPtr, AVFrame *framePtr);
+static void *VideoConvertThread (void *clientData);
+static void *VideoEncodeThread (void *clientData);
+static void VideoFinishOutput (VideoObj *vidPtr);
 
 static int VideoAllocImgBuffer (VideoObj *vidPtr, int width, int height);
 static int VideoFreeImgBuffer (VideoObj *vidPtr);
@@ -155,10 +290,27 @@ VideoSetData()
     vid->pFormatCtx = NULL;
     vid->videoStream = 0;
     vid->frameNumber = -1;
+    vid->viewFrame = -1;
     vid->atEnd = 0;
+    vid->pktPts = AV_NOPTS_VALUE;
+
+    vid->keyFrames = NULL;
+    vid->numKeyFrames = 0;
+    vid->maxKeyFrames = 0;
+    vid->indexLastFrame = -1;
+
+    vid->cachePtr = NULL;
+    vid->cacheFrames = 32;
+    vid->prefetchFrames = 8;
 
     vid->outFormatCtx = NULL;
+    vid->outHeaderWritten = 0;
     vid->outVideoStr = NULL;
+    vid->outputPtr = NULL;
+    vid->outbuf = NULL;
+    vid->outbufSize = 0;
+    vid->outNumFrames = 0;
+    vid->outSeconds = 0.0;
 
     vid->pFrameYUV = NULL;
     vid->yuvbuffer = NULL;
@@ -187,7 +339,9 @@ VideoSetData()
  * ------------------------------------------------------------------------
  *  VideoFindLastFrame()
  *
- *  Find the last readable frame.
+ *  Find the last readable frame.  This comes from the key frame index
+ *  when there is one.  Otherwise, seek near the end of the stream and
+ *  decode forward until no more frames can be read.
  * ------------------------------------------------------------------------
  */
 int
@@ -212,6 +366,11 @@ VideoFindLastFrame(vidPtr,lastframe)
         return -1;
     }
 
+    if (vidPtr->numKeyFrames > 0) {
+        *lastframe = vidPtr->indexLastFrame;
+        return 0;
+    }
+
     // calculate an estimate of the last frame
     vstreamPtr = vidPtr->pFormatCtx->streams[vidPtr->videoStream];
     nframe = VideoTime2Frame(vstreamPtr,
@@ -221,13 +380,13 @@ VideoFindLastFrame(vidPtr,lastframe)
     // is 50 frames far enough to go back
     // to be outside of the last key frame?
     f = vidPtr->frameNumber;
-    cur = VideoGoToN(vidPtr,nframe-50);
+    cur = VideoDecodeToN(vidPtr,nframe-50);
     while (cur != nframe) {
         cur = nframe;
-        nframe = VideoGoNext(vidPtr);
+        nframe = VideoDecodeToN(vidPtr,vidPtr->frameNumber+1);
     }
     *lastframe = nframe;
-    VideoGoToN(vidPtr,f);
+    vidPtr->viewFrame = VideoDecodeToN(vidPtr,f);
 
     return 0;
 }
@@ -423,6 +582,7 @@ VideoModeRead(vidPtr)
 
     vcodecCtx->get_buffer = VideoAvGetBuffer;
     vcodecCtx->release_buffer = VideoAvReleaseBuffer;
+    vcodecCtx->opaque = vidPtr;
 
     vidPtr->pFrameYUV = avcodec_alloc_frame();
     vidPtr->pFrameRGB = avcodec_alloc_frame();
@@ -457,6 +617,181 @@ VideoModeRead(vidPtr)
         return -9;
     }
 
+    /*
+     * Index the key frames for seeking.  If this fails, seeking falls
+     * back to searching from an estimated time.  A prefetch decoder
+     * is handed a copy of the index it's opened with.
+     */
+    if (vidPtr->numKeyFrames == 0) {
+        VideoBuildIndex(vidPtr);
+    }
+
+    return 0;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoBuildIndex()
+ *
+ *  Reads through the packets of the video stream without decoding them,
+ *  recording the frame number, timestamp, and byte position of each key
+ *  frame along with the last frame number in the stream.  Rewinds the
+ *  stream to the beginning when done.
+ *
+ *  Returns 0 if successful, or -1 if no key frames could be found.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoBuildIndex(vidPtr)
+    VideoObj *vidPtr;
+{
+    AVStream *vstreamPtr;
+    AVPacket packet;
+    VideoKeyFrame *keyPtr;
+    int64_t ts;
+    int frame;
+
+    VideoFreeIndex(vidPtr);
+    if (vidPtr->pFormatCtx == NULL) {
+        return -1;
+    }
+    vstreamPtr = vidPtr->pFormatCtx->streams[vidPtr->videoStream];
+
+    while (av_read_frame(vidPtr->pFormatCtx, &packet) >= 0) {
+        if (packet.stream_index == vidPtr->videoStream) {
+            /* frame numbers follow VideoNextFrame(), which uses the dts */
+            ts = (packet.dts != AV_NOPTS_VALUE) ? packet.dts : packet.pts;
+            if (ts != AV_NOPTS_VALUE) {
+                frame = VideoTime2Frame(vstreamPtr, ts);
+            } else {
+                frame = vidPtr->indexLastFrame + 1;
+            }
+            if (frame > vidPtr->indexLastFrame) {
+                vidPtr->indexLastFrame = frame;
+            }
+            if (packet.flags & AV_PKT_FLAG_KEY) {
+                if (vidPtr->numKeyFrames == vidPtr->maxKeyFrames) {
+                    int newMax;
+                    VideoKeyFrame *newKeys;
+
+                    newMax = (vidPtr->maxKeyFrames == 0) ? 256 :
+                        vidPtr->maxKeyFrames * 2;
+                    newKeys = realloc(vidPtr->keyFrames,
+                        newMax * sizeof(VideoKeyFrame));
+                    if (newKeys == NULL) {
+                        av_free_packet(&packet);
+                        VideoFreeIndex(vidPtr);
+                        break;
+                    }
+                    vidPtr->keyFrames = newKeys;
+                    vidPtr->maxKeyFrames = newMax;
+                }
+                keyPtr = vidPtr->keyFrames + vidPtr->numKeyFrames++;
+                keyPtr->frame = frame;
+                keyPtr->timestamp = ts;
+                keyPtr->pos = packet.pos;
+            }
+        }
+        av_free_packet(&packet);
+    }
+
+    /* go back to the start, where the stream was when it was opened */
+    if (vidPtr->numKeyFrames > 0) {
+        VideoSeekKeyFrame(vidPtr, vidPtr->keyFrames);
+    } else {
+        av_seek_frame(vidPtr->pFormatCtx, vidPtr->videoStream,
+            vstreamPtr->start_time, AVSEEK_FLAG_BACKWARD);
+        avcodec_flush_buffers(vstreamPtr->codec);
+    }
+    vidPtr->frameNumber = -1;
+    vidPtr->viewFrame = -1;
+    vidPtr->atEnd = 0;
+
+    return (vidPtr->numKeyFrames > 0) ? 0 : -1;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoFreeIndex()
+ *
+ *  Discards the key frame index built by VideoBuildIndex().
+ * ------------------------------------------------------------------------
+ */
+void
+VideoFreeIndex(vidPtr)
+    VideoObj *vidPtr;
+{
+    if (vidPtr->keyFrames != NULL) {
+        free(vidPtr->keyFrames);
+        vidPtr->keyFrames = NULL;
+    }
+    vidPtr->numKeyFrames = 0;
+    vidPtr->maxKeyFrames = 0;
+    vidPtr->indexLastFrame = -1;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoFindKeyFrame()
+ *
+ *  Returns the last key frame at or before the given frame, or the
+ *  first key frame if the frame comes before all of them.  The index
+ *  must not be empty.
+ * ------------------------------------------------------------------------
+ */
+VideoKeyFrame *
+VideoFindKeyFrame(vidPtr, frame)
+    VideoObj *vidPtr;
+    int frame;
+{
+    int low, high, mid;
+
+    low = 0;
+    high = vidPtr->numKeyFrames - 1;
+    while (low < high) {
+        mid = (low + high + 1) / 2;
+        if (vidPtr->keyFrames[mid].frame <= frame) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return vidPtr->keyFrames + low;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoSeekKeyFrame()
+ *
+ *  Moves the stream to the given key frame and resets the decoder, so
+ *  the next call to VideoNextFrame() decodes that key frame.  Seeks by
+ *  timestamp, or by byte position for packets without one.
+ *
+ *  Returns 0 if successful, or -1 if the seek failed.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoSeekKeyFrame(vidPtr, keyPtr)
+    VideoObj *vidPtr;
+    VideoKeyFrame *keyPtr;
+{
+    AVStream *vstreamPtr;
+    int result;
+
+    vstreamPtr = vidPtr->pFormatCtx->streams[vidPtr->videoStream];
+    if (keyPtr->timestamp != AV_NOPTS_VALUE) {
+        result = av_seek_frame(vidPtr->pFormatCtx, vidPtr->videoStream,
+            keyPtr->timestamp, AVSEEK_FLAG_BACKWARD);
+    } else {
+        result = av_seek_frame(vidPtr->pFormatCtx, vidPtr->videoStream,
+            keyPtr->pos, AVSEEK_FLAG_BYTE);
+    }
+    if (result < 0) {
+        return -1;
+    }
+    avcodec_flush_buffers(vstreamPtr->codec);
+    vidPtr->frameNumber = keyPtr->frame - 1;
+    vidPtr->atEnd = 0;
     return 0;
 }
 
@@ -732,7 +1067,7 @@ VideoNextFrame(vidPtr)
             if (av_read_frame(vidPtr->pFormatCtx, &packet) >= 0) {
                 if (packet.stream_index == vidPtr->videoStream) {
                     /* save pts so we can grab it again in VideoAvGetBuffer */
-                    global_video_pkt_pts = packet.pts;
+                    vidPtr->pktPts = packet.pts;
 
 #ifdef HAVE_AVCODEC_DECODE_VIDEO2
                     // new avcodec decode video function
@@ -772,7 +1107,9 @@ VideoNextFrame(vidPtr)
  *  These two routines are called whenever a frame buffer is allocated,
  *  which means that we're starting a new frame.  Grab the global pts
  *  counter and squirrel it away in the opaque slot of the frame.  This
- *  will give us a pts value that we can trust later.
+ *  will give us a pts value that we can trust later.  The counter is
+ *  kept in the video object (the codec's opaque slot), since the
+ *  prefetch thread decodes at the same time as the main thread.
  * ------------------------------------------------------------------------
  */
 int
@@ -780,9 +1117,10 @@ VideoAvGetBuffer(c,fr)
     AVCodecContext *c;  /* codec doing the frame decoding */
     AVFrame *fr;        /* frame being decoded */
 {
+    VideoObj *vidPtr = c->opaque;
     int rval = avcodec_default_get_buffer(c, fr);
     uint64_t *ptsPtr = av_malloc(sizeof(uint64_t));
-    *ptsPtr = global_video_pkt_pts;
+    *ptsPtr = (vidPtr != NULL) ? vidPtr->pktPts : AV_NOPTS_VALUE;
     fr->opaque = ptsPtr;
     return rval;
 }
@@ -916,7 +1254,7 @@ VideoGoNext(vidPtr)
         return -1;
     }
 
-    nabs = vidPtr->frameNumber + 1;
+    nabs = vidPtr->viewFrame + 1;
     return VideoGoToN(vidPtr, nabs);
 }
 
@@ -931,7 +1269,7 @@ VideoGoPlusMinusN(vidPtr, n)
         return -1;
     }
 
-    nabs = vidPtr->frameNumber + n;
+    nabs = vidPtr->viewFrame + n;
     return VideoGoToN(vidPtr, nabs);
 }
 
@@ -939,6 +1277,55 @@ int
 VideoGoToN(vidPtr, n)
     VideoObj *vidPtr;
     int n;
+{
+    VideoCache *cachePtr;
+    int found;
+
+    if (vidPtr == NULL) {
+        return -1;
+    }
+
+    if (vidPtr->pFormatCtx == NULL) {
+        // "internal error: video stream is not open",
+        return -1;
+    }
+
+    if (n < 0) {
+        n = 0;
+    }
+
+    /*
+     * A frame already in the cache at the size being shown doesn't
+     * need to be decoded.  VideoGetImage() copies it from there.
+     */
+    cachePtr = vidPtr->cachePtr;
+    if (cachePtr != NULL) {
+        pthread_mutex_lock(&cachePtr->lock);
+        found = (VideoCacheFind(cachePtr, n, cachePtr->reqWidth,
+            cachePtr->reqHeight) != NULL);
+        pthread_mutex_unlock(&cachePtr->lock);
+        if (found) {
+            vidPtr->viewFrame = n;
+            return n;
+        }
+    }
+    vidPtr->viewFrame = VideoDecodeToN(vidPtr, n);
+    return vidPtr->viewFrame;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoDecodeToN()
+ *
+ *  Moves the decoder to frame n, seeking and decoding as needed.  The
+ *  decoded frame is left in pFrameYUV.  Returns the frame number
+ *  reached, which is short of n at the end of the stream.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoDecodeToN(vidPtr, n)
+    VideoObj *vidPtr;
+    int n;
 {
     int nrel, nabs, seekFlags, gotframe;
     int64_t nseek;
@@ -959,6 +1346,28 @@ VideoGoToN(vidPtr, n)
         nabs = 0;
     }
 
+    /*
+     * With a key frame index, seek to the key frame before the target
+     * whenever going backward or when it's past the current frame, and
+     * decode forward from there.
+     */
+    if (vidPtr->numKeyFrames > 0) {
+        VideoKeyFrame *keyPtr;
+
+        keyPtr = VideoFindKeyFrame(vidPtr, nabs);
+        if ((nabs < vidPtr->frameNumber) ||
+            (keyPtr->frame > vidPtr->frameNumber)) {
+            if (VideoSeekKeyFrame(vidPtr, keyPtr) != 0) {
+                goto noIndex;
+            }
+        }
+        while ((vidPtr->frameNumber < nabs) && !vidPtr->atEnd) {
+            VideoNextFrame(vidPtr);
+        }
+        return vidPtr->frameNumber;
+    }
+
+noIndex:
     if (nabs < vidPtr->frameNumber) {
         seekFlags = AVSEEK_FLAG_BACKWARD;
     } else {
@@ -1006,7 +1415,7 @@ VideoGoToN(vidPtr, n)
             if (vidPtr->frameNumber > nabs) {
                 // we are probably at a key frame, just past
                 // the requested frame and need to seek backwards.
-                VideoGoToN(vidPtr,n);
+                VideoDecodeToN(vidPtr,n);
             } else {
                 VideoNextFrame(vidPtr);
             }
@@ -1043,25 +1452,77 @@ VideoGetImage(vidPtr, iw, ih, img, bufSize)
     void **img;
     int *bufSize;
 {
+    if (vidPtr == NULL) {
+        return -1;
+    }
 
-    int numBytes;
-    AVCodecContext *vcodecCtx;
+    if (VideoFillImage(vidPtr, iw, ih) != 0) {
+        return -1;
+    }
+
+    *img = vidPtr->img;
+    *bufSize = (vidPtr->imgWidth*3*vidPtr->imgHeight) + vidPtr->imgHeaderLen;
+    return 0;
+}
 
+/*
+ * ------------------------------------------------------------------------
+ *  VideoGetPixels()
+ *
+ *  Like VideoGetImage(), but returns the current frame as bare packed
+ *  RGB pixels (3 bytes each, rows width*3 bytes apart) along with the
+ *  actual width and height, so it can go straight into a photo image
+ *  without writing and parsing a PPM.  The pixels belong to the video
+ *  object and are good until the next call.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoGetPixels(vidPtr, iw, ih, pixels, width, height)
+    VideoObj *vidPtr;
+    int iw;
+    int ih;
+    unsigned char **pixels;
+    int *width;
+    int *height;
+{
     if (vidPtr == NULL) {
         return -1;
     }
 
-    if (VideoModeRead(vidPtr) != 0) {
+    if (VideoFillImage(vidPtr, iw, ih) != 0) {
         return -1;
     }
 
-    /*
-    if (vidPtr->pFormatCtx) {
-        vcodecCtx = vidPtr->pFormatCtx->streams[vidPtr->videoStream]->codec;
-    } else {
-        vcodecCtx = NULL;
+    *pixels = (unsigned char *)vidPtr->img + vidPtr->imgHeaderLen;
+    *width = vidPtr->imgWidth;
+    *height = vidPtr->imgHeight;
+    return 0;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoFillImage()
+ *
+ *  Fills the image buffer with the current frame at the desired size
+ *  (the native size for a width or height less than 0), behind a PPM
+ *  header.  Returns 0 if successful, or -1 if the video isn't open.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoFillImage(vidPtr, iw, ih)
+    VideoObj *vidPtr;
+    int iw;
+    int ih;
+{
+    AVCodecContext *vcodecCtx;
+    VideoCache *cachePtr;
+    VideoCacheEntry *entryPtr;
+    uint8_t *pixels;
+    int found;
+
+    if (VideoModeRead(vidPtr) != 0) {
+        return -1;
     }
-    */
 
     if (vidPtr->pFormatCtx == NULL) {
         // vidPtr->pFormatCtx is NULL, video not open
@@ -1069,12 +1530,6 @@ VideoGetImage(vidPtr, iw, ih, img, bufSize)
     }
     vcodecCtx = vidPtr->pFormatCtx->streams[vidPtr->videoStream]->codec;
 
-    /*
-     * Query the size for this photo and make sure that we have a
-     * buffer of the appropriate size for software scaling and
-     * format conversion.
-     */
-
     // if the user's desired size is less then 0,
     // use the default size
 
@@ -1085,7 +1540,82 @@ VideoGetImage(vidPtr, iw, ih, img, bufSize)
         ih = vcodecCtx->height;
     }
 
+    if ((vidPtr->img == NULL) ||
+        (vidPtr->imgWidth != iw) || (vidPtr->imgHeight != ih)) {
+        // new height or width
+        // resize the image buffer
+        VideoFreeImgBuffer(vidPtr);
+        VideoAllocImgBuffer(vidPtr,iw,ih);
+    }
+    pixels = (uint8_t *)vidPtr->img + vidPtr->imgHeaderLen;
+
+    if ((vidPtr->cachePtr == NULL) && (vidPtr->cacheFrames > 0)) {
+        vidPtr->cachePtr = VideoCacheCreate(vidPtr);
+    }
+    cachePtr = vidPtr->cachePtr;
+
+    /*
+     * Copy the frame from the cache if it's there.  Otherwise decode
+     * it (if the cache said it was there when we moved to it), rescale
+     * it to the desired size, translate into RGB format, and save a
+     * copy in the cache.
+     */
+    found = 0;
+    if ((cachePtr != NULL) && (vidPtr->viewFrame >= 0)) {
+        pthread_mutex_lock(&cachePtr->lock);
+        entryPtr = VideoCacheFind(cachePtr, vidPtr->viewFrame, iw, ih);
+        if (entryPtr != NULL) {
+            memcpy(pixels, entryPtr->rgb, iw*3*ih);
+            found = 1;
+        }
+        pthread_mutex_unlock(&cachePtr->lock);
+    }
+    if (!found) {
+        if ((vidPtr->viewFrame >= 0) &&
+            (vidPtr->frameNumber != vidPtr->viewFrame)) {
+            vidPtr->viewFrame = VideoDecodeToN(vidPtr, vidPtr->viewFrame);
+        }
+        if (VideoScaleFrame(vidPtr, iw, ih) == 0) {
+            // Write pixel data
+            memcpy(pixels, vidPtr->pFrameRGB->data[0], iw*3*ih);
+            if ((cachePtr != NULL) && (vidPtr->frameNumber >= 0)) {
+                pthread_mutex_lock(&cachePtr->lock);
+                VideoCacheAdd(cachePtr, vidPtr->frameNumber, iw, ih, pixels);
+                pthread_mutex_unlock(&cachePtr->lock);
+            }
+        }
+    }
+
+    if (cachePtr != NULL) {
+        VideoCachePrefetch(vidPtr, iw, ih);
+    }
+    return 0;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoScaleFrame()
+ *
+ *  Rescales the last decoded frame to the desired size and translates
+ *  it into RGB format in pFrameRGB.  Returns 0 if successful, or -1 if
+ *  no frame has been decoded yet.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoScaleFrame(vidPtr, iw, ih)
+    VideoObj *vidPtr;
+    int iw;
+    int ih;
+{
+    int numBytes;
+    AVCodecContext *vcodecCtx;
+
+    vcodecCtx = vidPtr->pFormatCtx->streams[vidPtr->videoStream]->codec;
 
+    /*
+     * Make sure that we have a buffer of the appropriate size for
+     * software scaling and format conversion.
+     */
     if (iw != vidPtr->rgbw || ih != vidPtr->rgbh) {
         if (vidPtr->rgbbuffer) {
             av_free(vidPtr->rgbbuffer);
@@ -1104,67 +1634,849 @@ VideoGetImage(vidPtr, iw, ih, img, bufSize)
             iw, ih, PIX_FMT_RGB24, SWS_BICUBIC|SWS_PRINT_INFO, NULL, NULL, NULL);
     }
 
-    /*
-     * Rescale the current frame to the desired size, and translate
-     * into RGB format so we can copy into the destination image.
-     */
-    if (vidPtr->pFrameYUV && vidPtr->pFrameYUV->data[0]) {
-        sws_scale(vidPtr->scalingCtx, (const uint8_t * const*)
-            vidPtr->pFrameYUV->data, vidPtr->pFrameYUV->linesize,
-            0, vcodecCtx->height,
-            vidPtr->pFrameRGB->data, vidPtr->pFrameRGB->linesize);
-
-/*
-        iblock.pixelPtr  = (unsigned char*)vidPtr->pFrameRGB->data[0];
-        iblock.width     = iw;
-        iblock.height    = ih;
-        iblock.pitch     = vidPtr->pFrameRGB->linesize[0];
-        iblock.pixelSize = 3;
-        iblock.offset[0] = 0;
-        iblock.offset[1] = 1;
-        iblock.offset[2] = 2;
-        iblock.offset[3] = 0;
-
-        Tk_PhotoPutBlock_NoComposite(img, &iblock, 0, 0, iw, ih);
-*/
-
-        if (vidPtr->img == NULL) {
-            VideoAllocImgBuffer(vidPtr,iw,ih);
-        } else {
-            if ((vidPtr->imgWidth != iw) && (vidPtr->imgHeight != ih)) {
-                // new height or width
-                // resize the image buffer
-                free(vidPtr->img);
-                VideoAllocImgBuffer(vidPtr,iw,ih);
-            }
-        }
-
-        // Write pixel data
-        memcpy(vidPtr->img+vidPtr->imgHeaderLen,
-            vidPtr->pFrameRGB->data[0],
-            vidPtr->imgWidth*3*vidPtr->imgHeight);
+    if ((vidPtr->pFrameYUV == NULL) || (vidPtr->pFrameYUV->data[0] == NULL)) {
+        return -1;
     }
-    *img = vidPtr->img;
-    *bufSize = (vidPtr->imgWidth*3*vidPtr->imgHeight) + vidPtr->imgHeaderLen;
+    sws_scale(vidPtr->scalingCtx, (const uint8_t * const*)
+        vidPtr->pFrameYUV->data, vidPtr->pFrameYUV->linesize,
+        0, vcodecCtx->height,
+        vidPtr->pFrameRGB->data, vidPtr->pFrameRGB->linesize);
     return 0;
 }
 
-int
-VideoFrameRate (vidPtr, fr)
+/*
+ * ------------------------------------------------------------------------
+ *  VideoCacheCreate()
+ *
+ *  Creates an empty frame cache holding up to cacheFrames frames.  The
+ *  prefetch thread isn't started until the first frame is shown.
+ * ------------------------------------------------------------------------
+ */
+VideoCache *
+VideoCacheCreate(vidPtr)
     VideoObj *vidPtr;
-    double *fr;
 {
-    AVStream *vstreamPtr;
+    VideoCache *cachePtr;
 
-    if (vidPtr == NULL) {
-        return -1;
+    cachePtr = malloc(sizeof(VideoCache));
+    if (cachePtr == NULL) {
+        return NULL;
     }
+    memset(cachePtr, 0, sizeof(VideoCache));
+    pthread_mutex_init(&cachePtr->lock, NULL);
+    pthread_cond_init(&cachePtr->wakeup, NULL);
+    cachePtr->maxEntries = vidPtr->cacheFrames;
+    cachePtr->reqFrame = -1;
+    cachePtr->reqDir = 1;
+    cachePtr->reqWidth = -1;
+    cachePtr->reqHeight = -1;
+    return cachePtr;
+}
 
-    if (fr == NULL) {
-        return -1;
-    }
+/*
+ * ------------------------------------------------------------------------
+ *  VideoCacheDestroy()
+ *
+ *  Stops the prefetch thread, closes its decoder, and frees the cache.
+ *  Does nothing if there is no cache.
+ * ------------------------------------------------------------------------
+ */
+void
+VideoCacheDestroy(vidPtr)
+    VideoObj *vidPtr;
+{
+    VideoCache *cachePtr;
+    VideoCacheEntry *entryPtr, *nextPtr;
+
+    cachePtr = vidPtr->cachePtr;
+    if (cachePtr == NULL) {
+        return;
+    }
+    if (cachePtr->threadStarted > 0) {
+        pthread_mutex_lock(&cachePtr->lock);
+        cachePtr->quit = 1;
+        pthread_cond_signal(&cachePtr->wakeup);
+        pthread_mutex_unlock(&cachePtr->lock);
+        pthread_join(cachePtr->thread, NULL);
+    }
+    if (cachePtr->decoderPtr != NULL) {
+        VideoCleanup(cachePtr->decoderPtr);
+    }
+    for (entryPtr = cachePtr->headPtr; entryPtr != NULL; entryPtr = nextPtr) {
+        nextPtr = entryPtr->nextPtr;
+        free(entryPtr->rgb);
+        free(entryPtr);
+    }
+    pthread_cond_destroy(&cachePtr->wakeup);
+    pthread_mutex_destroy(&cachePtr->lock);
+    free(cachePtr);
+    vidPtr->cachePtr = NULL;
+}
 
-    if (vidPtr->pFormatCtx == NULL) {
+/*
+ * ------------------------------------------------------------------------
+ *  VideoCacheFind()
+ *
+ *  Looks for a frame of the given size in the cache and marks it as
+ *  the most recently used.  Returns NULL if it isn't there.  Must be
+ *  called with the cache locked.
+ * ------------------------------------------------------------------------
+ */
+VideoCacheEntry *
+VideoCacheFind(cachePtr, frame, width, height)
+    VideoCache *cachePtr;
+    int frame;
+    int width;
+    int height;
+{
+    VideoCacheEntry *entryPtr;
+
+    for (entryPtr = cachePtr->headPtr; entryPtr != NULL;
+         entryPtr = entryPtr->nextPtr) {
+        if ((entryPtr->frame == frame) && (entryPtr->width == width) &&
+            (entryPtr->height == height)) {
+            break;
+        }
+    }
+    if ((entryPtr == NULL) || (entryPtr == cachePtr->headPtr)) {
+        return entryPtr;
+    }
+
+    /* move it to the front of the list */
+    entryPtr->prevPtr->nextPtr = entryPtr->nextPtr;
+    if (entryPtr->nextPtr != NULL) {
+        entryPtr->nextPtr->prevPtr = entryPtr->prevPtr;
+    } else {
+        cachePtr->tailPtr = entryPtr->prevPtr;
+    }
+    entryPtr->prevPtr = NULL;
+    entryPtr->nextPtr = cachePtr->headPtr;
+    cachePtr->headPtr->prevPtr = entryPtr;
+    cachePtr->headPtr = entryPtr;
+    return entryPtr;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoCacheAdd()
+ *
+ *  Saves a copy of an RGB frame in the cache, reusing the least
+ *  recently used entry when the cache is full.  Must be called with
+ *  the cache locked.
+ * ------------------------------------------------------------------------
+ */
+void
+VideoCacheAdd(cachePtr, frame, width, height, rgb)
+    VideoCache *cachePtr;
+    int frame;
+    int width;
+    int height;
+    const uint8_t *rgb;
+{
+    VideoCacheEntry *entryPtr;
+    size_t numBytes;
+
+    if (VideoCacheFind(cachePtr, frame, width, height) != NULL) {
+        return;
+    }
+    numBytes = (size_t)width*3*height;
+    if (cachePtr->numEntries >= cachePtr->maxEntries) {
+        /* take the least recently used entry off the list */
+        entryPtr = cachePtr->tailPtr;
+        cachePtr->tailPtr = entryPtr->prevPtr;
+        if (cachePtr->tailPtr != NULL) {
+            cachePtr->tailPtr->nextPtr = NULL;
+        } else {
+            cachePtr->headPtr = NULL;
+        }
+        cachePtr->numEntries--;
+        if ((entryPtr->width != width) || (entryPtr->height != height)) {
+            free(entryPtr->rgb);
+            entryPtr->rgb = malloc(numBytes);
+        }
+    } else {
+        entryPtr = malloc(sizeof(VideoCacheEntry));
+        if (entryPtr == NULL) {
+            return;
+        }
+        entryPtr->rgb = malloc(numBytes);
+    }
+    if (entryPtr->rgb == NULL) {
+        free(entryPtr);
+        return;
+    }
+    entryPtr->frame = frame;
+    entryPtr->width = width;
+    entryPtr->height = height;
+    memcpy(entryPtr->rgb, rgb, numBytes);
+
+    entryPtr->prevPtr = NULL;
+    entryPtr->nextPtr = cachePtr->headPtr;
+    if (cachePtr->headPtr != NULL) {
+        cachePtr->headPtr->prevPtr = entryPtr;
+    } else {
+        cachePtr->tailPtr = entryPtr;
+    }
+    cachePtr->headPtr = entryPtr;
+    cachePtr->numEntries++;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoCachePrefetch()
+ *
+ *  Called after a frame is shown.  Asks the prefetch thread to decode
+ *  the next few frames in the direction we're moving, starting the
+ *  thread (with its own decoder opened on the same file) the first
+ *  time.  Any request still being worked on is abandoned.
+ * ------------------------------------------------------------------------
+ */
+void
+VideoCachePrefetch(vidPtr, width, height)
+    VideoObj *vidPtr;
+    int width;
+    int height;
+{
+    VideoCache *cachePtr;
+    VideoObj *decPtr;
+    int count;
+
+    cachePtr = vidPtr->cachePtr;
+    if ((cachePtr->threadStarted == 0) && (vidPtr->prefetchFrames > 0)) {
+        /* If anything fails, don't try again; the cache still works. */
+        cachePtr->threadStarted = -1;
+        decPtr = VideoOpenDecoder(vidPtr);
+        if (decPtr == NULL) {
+            return;
+        }
+        cachePtr->decoderPtr = decPtr;
+        if (pthread_create(&cachePtr->thread, NULL, VideoCacheThread,
+                cachePtr) != 0) {
+            VideoCleanup(decPtr);
+            cachePtr->decoderPtr = NULL;
+            return;
+        }
+        cachePtr->threadStarted = 1;
+    }
+
+    /* read no more than half the cache, so we don't push out the frames
+     * just shown */
+    count = vidPtr->prefetchFrames;
+    if (count > cachePtr->maxEntries / 2) {
+        count = cachePtr->maxEntries / 2;
+    }
+
+    pthread_mutex_lock(&cachePtr->lock);
+    if (vidPtr->viewFrame < cachePtr->reqFrame) {
+        cachePtr->reqDir = -1;
+    } else if (vidPtr->viewFrame > cachePtr->reqFrame) {
+        cachePtr->reqDir = 1;
+    }
+    cachePtr->reqFrame = vidPtr->viewFrame;
+    cachePtr->reqCount = count;
+    cachePtr->reqWidth = width;
+    cachePtr->reqHeight = height;
+    cachePtr->serial++;
+    if (cachePtr->threadStarted > 0) {
+        pthread_cond_signal(&cachePtr->wakeup);
+    }
+    pthread_mutex_unlock(&cachePtr->lock);
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoOpenDecoder()
+ *
+ *  Opens another video object on the same file, for decoding in a
+ *  separate thread.  It gets a copy of the key frame index instead of
+ *  building its own, and has no cache.  Must be called (and the result
+ *  cleaned up) on the main thread, since opening and closing codecs
+ *  isn't thread-safe.  Returns NULL if the file can't be opened.
+ * ------------------------------------------------------------------------
+ */
+VideoObj *
+VideoOpenDecoder(vidPtr)
+    VideoObj *vidPtr;
+{
+    VideoObj *decPtr;
+
+    decPtr = VideoSetData();
+    if (decPtr == NULL) {
+        return NULL;
+    }
+    decPtr->fileName = strdup(vidPtr->fileName);
+    decPtr->cacheFrames = 0;
+    decPtr->lastframe = vidPtr->lastframe;
+    if (vidPtr->numKeyFrames > 0) {
+        decPtr->keyFrames = malloc(vidPtr->numKeyFrames *
+            sizeof(VideoKeyFrame));
+        if (decPtr->keyFrames != NULL) {
+            memcpy(decPtr->keyFrames, vidPtr->keyFrames,
+                vidPtr->numKeyFrames * sizeof(VideoKeyFrame));
+            decPtr->numKeyFrames = vidPtr->numKeyFrames;
+            decPtr->maxKeyFrames = vidPtr->numKeyFrames;
+            decPtr->indexLastFrame = vidPtr->indexLastFrame;
+        }
+    }
+    if ((decPtr->fileName == NULL) || (VideoModeRead(decPtr) != 0) ||
+        (decPtr->pFormatCtx == NULL)) {
+        VideoCleanup(decPtr);
+        return NULL;
+    }
+    return decPtr;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoCacheThread()
+ *
+ *  Body of the prefetch thread.  Waits for a request, then decodes the
+ *  requested frames that aren't already cached, in increasing order so
+ *  the decoder moves forward from each key frame, and adds them to the
+ *  cache.  Drops the rest of a request as soon as a newer one arrives.
+ * ------------------------------------------------------------------------
+ */
+void *
+VideoCacheThread(clientData)
+    void *clientData;
+{
+    VideoCache *cachePtr = clientData;
+    VideoObj *decPtr = cachePtr->decoderPtr;
+    int serial, first, last, frame, got, width, height, scaled;
+
+    serial = 0;
+    pthread_mutex_lock(&cachePtr->lock);
+    while (!cachePtr->quit) {
+        if (cachePtr->serial == serial) {
+            pthread_cond_wait(&cachePtr->wakeup, &cachePtr->lock);
+            continue;
+        }
+        serial = cachePtr->serial;
+        if (cachePtr->reqDir < 0) {
+            first = cachePtr->reqFrame - cachePtr->reqCount;
+            last = cachePtr->reqFrame - 1;
+        } else {
+            first = cachePtr->reqFrame + 1;
+            last = cachePtr->reqFrame + cachePtr->reqCount;
+        }
+        if (first < 0) {
+            first = 0;
+        }
+        if (last > decPtr->lastframe) {
+            last = decPtr->lastframe;
+        }
+        width = cachePtr->reqWidth;
+        height = cachePtr->reqHeight;
+
+        for (frame = first; frame <= last; frame++) {
+            if ((cachePtr->quit) || (cachePtr->serial != serial)) {
+                break;
+            }
+            if (VideoCacheFind(cachePtr, frame, width, height) != NULL) {
+                continue;
+            }
+            pthread_mutex_unlock(&cachePtr->lock);
+            got = VideoDecodeToN(decPtr, frame);
+            scaled = (got >= frame) &&
+                (VideoScaleFrame(decPtr, width, height) == 0);
+            pthread_mutex_lock(&cachePtr->lock);
+            if (!scaled) {
+                break;
+            }
+            VideoCacheAdd(cachePtr, got, width, height,
+                decPtr->pFrameRGB->data[0]);
+            /* frame numbers can skip; carry on from the one we got */
+            frame = got;
+        }
+    }
+    pthread_mutex_unlock(&cachePtr->lock);
+    return NULL;
+}
+
+/*
+ * Work for one thumbnail thread: every step'th thumbnail starting with
+ * the first one, decoded with its own decoder.
+ */
+typedef struct VideoThumbnailJob {
+    VideoObj *decoderPtr;
+    int first, step, count;
+    int width, height;
+    int *frames;                /* in: frame wanted, out: frame read */
+    unsigned char **pixels;     /* where each thumbnail goes */
+    pthread_t thread;
+} VideoThumbnailJob;
+
+#define VIDEO_MAX_THUMBNAIL_THREADS 8
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoThumbnails()
+ *
+ *  Reads count evenly spaced frames, scaled to width x height, for a
+ *  strip of thumbnails.  Each frame is moved to a nearby key frame
+ *  when there is one, since those decode without decoding anything
+ *  else.  The frames are split among worker threads (one per CPU, up
+ *  to 8), each with its own decoder, and don't disturb the current
+ *  position of the video.
+ *
+ *  Fills frames with the frame numbers read and pixels with malloc'ed
+ *  packed RGB images (width*height*3 bytes), which the caller frees.
+ *  Returns 0 if successful, or -1 if the video can't be read.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoThumbnails(vidPtr, count, width, height, frames, pixels)
+    VideoObj *vidPtr;
+    int count;
+    int width;
+    int height;
+    int *frames;
+    unsigned char **pixels;
+{
+    VideoThumbnailJob jobs[VIDEO_MAX_THUMBNAIL_THREADS];
+    int i, numThreads, numStarted, nframes;
+    long ncpus;
+
+    if ((vidPtr == NULL) || (count <= 0) || (width <= 0) || (height <= 0)) {
+        return -1;
+    }
+    if (VideoModeRead(vidPtr) != 0) {
+        return -1;
+    }
+    if (vidPtr->pFormatCtx == NULL) {
+        return -1;
+    }
+
+    /*
+     * Pick frames in the middle of count equal parts of the video, and
+     * use the nearest key frame that's no more than a quarter part
+     * away.
+     */
+    nframes = vidPtr->lastframe + 1;
+    for (i = 0; i < count; i++) {
+        int frame;
+
+        frame = (int)(((double)i + 0.5) * nframes / count);
+        if (vidPtr->numKeyFrames > 0) {
+            VideoKeyFrame *keyPtr;
+            int best, slop;
+
+            keyPtr = VideoFindKeyFrame(vidPtr, frame);
+            best = keyPtr->frame;
+            if ((keyPtr + 1 < vidPtr->keyFrames + vidPtr->numKeyFrames) &&
+                ((keyPtr + 1)->frame - frame < frame - best)) {
+                best = (keyPtr + 1)->frame;
+            }
+            slop = nframes / (4 * count);
+            if (abs(best - frame) <= slop) {
+                frame = best;
+            }
+        }
+        frames[i] = frame;
+        pixels[i] = NULL;
+    }
+
+    ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    numThreads = (ncpus > 0) ? (int)ncpus : 1;
+    if (numThreads > VIDEO_MAX_THUMBNAIL_THREADS) {
+        numThreads = VIDEO_MAX_THUMBNAIL_THREADS;
+    }
+    if (numThreads > count) {
+        numThreads = count;
+    }
+
+    /* open the decoders here, where it's safe */
+    for (i = 0; i < numThreads; i++) {
+        jobs[i].decoderPtr = VideoOpenDecoder(vidPtr);
+        if (jobs[i].decoderPtr == NULL) {
+            break;
+        }
+    }
+    numThreads = i;
+    if (numThreads == 0) {
+        return -1;
+    }
+
+    numStarted = 0;
+    for (i = 0; i < numThreads; i++) {
+        jobs[i].first = i;
+        jobs[i].step = numThreads;
+        jobs[i].count = count;
+        jobs[i].width = width;
+        jobs[i].height = height;
+        jobs[i].frames = frames;
+        jobs[i].pixels = pixels;
+        if ((i > 0) && (pthread_create(&jobs[i].thread, NULL,
+                VideoThumbnailThread, jobs + i) == 0)) {
+            numStarted++;
+        } else if (i > 0) {
+            /* couldn't start a thread; its share is done below */
+            jobs[i].first = -1;
+        }
+    }
+    /* the calling thread does the first share, and any that didn't
+     * get a thread of their own */
+    VideoThumbnailThread(jobs);
+    for (i = 1; i < numThreads; i++) {
+        if (jobs[i].first < 0) {
+            jobs[0].first = i;
+            VideoThumbnailThread(jobs);
+        } else {
+            pthread_join(jobs[i].thread, NULL);
+        }
+    }
+
+    for (i = 0; i < numThreads; i++) {
+        VideoCleanup(jobs[i].decoderPtr);
+    }
+    for (i = 0; i < count; i++) {
+        if (pixels[i] == NULL) {
+            break;
+        }
+    }
+    if (i < count) {
+        for (i = 0; i < count; i++) {
+            free(pixels[i]);
+            pixels[i] = NULL;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoThumbnailThread()
+ *
+ *  Decodes and scales one thread's share of the thumbnails.  A
+ *  thumbnail that can't be read is left NULL.
+ * ------------------------------------------------------------------------
+ */
+void *
+VideoThumbnailThread(clientData)
+    void *clientData;
+{
+    VideoThumbnailJob *jobPtr = clientData;
+    VideoObj *decPtr = jobPtr->decoderPtr;
+    size_t numBytes;
+    int i;
+
+    numBytes = (size_t)jobPtr->width * 3 * jobPtr->height;
+    for (i = jobPtr->first; i < jobPtr->count; i += jobPtr->step) {
+        VideoDecodeToN(decPtr, jobPtr->frames[i]);
+        if (VideoScaleFrame(decPtr, jobPtr->width, jobPtr->height) != 0) {
+            continue;
+        }
+        jobPtr->pixels[i] = malloc(numBytes);
+        if (jobPtr->pixels[i] != NULL) {
+            memcpy(jobPtr->pixels[i], decPtr->pFrameRGB->data[0], numBytes);
+            jobPtr->frames[i] = decPtr->frameNumber;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoForEachGrayFrame()
+ *
+ *  Decodes frames first, first+step, ... up to last, converts each to
+ *  8-bit grayscale at width x height (the native size for a width or
+ *  height less than 0), and hands it to proc.  Decoding is done with a
+ *  separate decoder, so the current position of the video is left
+ *  alone, and going through consecutive frames never seeks.
+ *
+ *  Returns the number of frames handed to proc, or -1 if the video
+ *  can't be read.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoForEachGrayFrame(vidPtr, first, last, step, width, height, proc,
+        clientData)
+    VideoObj *vidPtr;
+    int first;
+    int last;
+    int step;
+    int width;
+    int height;
+    VideoGrayFrameProc *proc;
+    void *clientData;
+{
+    VideoObj *decPtr;
+    AVCodecContext *vcodecCtx;
+    struct SwsContext *grayCtx;
+    uint8_t *gray;
+    uint8_t *planes[4];
+    int linesizes[4];
+    int frame, got, count;
+
+    if ((vidPtr == NULL) || (proc == NULL) || (step <= 0)) {
+        return -1;
+    }
+    if (VideoModeRead(vidPtr) != 0) {
+        return -1;
+    }
+    if (vidPtr->pFormatCtx == NULL) {
+        return -1;
+    }
+    decPtr = VideoOpenDecoder(vidPtr);
+    if (decPtr == NULL) {
+        return -1;
+    }
+    vcodecCtx = decPtr->pFormatCtx->streams[decPtr->videoStream]->codec;
+    if (width < 0) {
+        width = vcodecCtx->width;
+    }
+    if (height < 0) {
+        height = vcodecCtx->height;
+    }
+    if (first < 0) {
+        first = 0;
+    }
+    if ((last < 0) || (last > vidPtr->lastframe)) {
+        last = vidPtr->lastframe;
+    }
+
+    grayCtx = sws_getContext(vcodecCtx->width, vcodecCtx->height,
+        vcodecCtx->pix_fmt, width, height, PIX_FMT_GRAY8, SWS_BILINEAR,
+        NULL, NULL, NULL);
+    /* a little extra room, since sws_scale may write whole vectors */
+    gray = av_malloc((size_t)width * height + 64);
+    if ((grayCtx == NULL) || (gray == NULL)) {
+        if (grayCtx != NULL) {
+            sws_freeContext(grayCtx);
+        }
+        av_free(gray);
+        VideoCleanup(decPtr);
+        return -1;
+    }
+    memset(planes, 0, sizeof(planes));
+    memset(linesizes, 0, sizeof(linesizes));
+    planes[0] = gray;
+    linesizes[0] = width;
+
+    count = 0;
+    for (frame = first; frame <= last; frame += step) {
+        got = VideoDecodeToN(decPtr, frame);
+        if ((got < frame) || (decPtr->pFrameYUV->data[0] == NULL)) {
+            break;                      /* end of the stream */
+        }
+        sws_scale(grayCtx, (const uint8_t * const*)decPtr->pFrameYUV->data,
+            decPtr->pFrameYUV->linesize, 0, vcodecCtx->height,
+            planes, linesizes);
+        count++;
+        if ((*proc)(clientData, got, gray, width, height) != 0) {
+            break;
+        }
+        /* frame numbers can skip; step on from the one we got */
+        frame = got;
+    }
+
+    av_free(gray);
+    sws_freeContext(grayCtx);
+    VideoCleanup(decPtr);
+    return count;
+}
+
+/*
+ * State carried between frames by VideoAnalyze().
+ */
+typedef struct VideoAnalyzeData {
+    int threshold;
+    VideoFrameStats *stats;     /* next place to store results */
+    uint8_t *prev;              /* previous frame, for differencing */
+    size_t prevSize;
+    int havePrev;
+} VideoAnalyzeData;
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoAnalyzeFrame()
+ *
+ *  Measures one grayscale frame for VideoAnalyze(): the area and
+ *  centroid of the pixels at or above the threshold, and the mean
+ *  absolute difference from the previous frame.  The inner loops are
+ *  branch-free byte arithmetic with per-row integer sums, which the
+ *  compiler turns into vector instructions.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoAnalyzeFrame(clientData, frame, gray, width, height)
+    void *clientData;
+    int frame;
+    const unsigned char *gray;
+    int width;
+    int height;
+{
+    VideoAnalyzeData *dataPtr = clientData;
+    VideoFrameStats *statsPtr = dataPtr->stats++;
+    const unsigned char *row, *prevRow;
+    uint64_t area, sumX, sumY, diff;
+    size_t numBytes;
+    int x, y;
+    unsigned char threshold;
+
+    threshold = (unsigned char)dataPtr->threshold;
+    numBytes = (size_t)width * height;
+    area = sumX = sumY = diff = 0;
+    for (y = 0; y < height; y++) {
+        unsigned int rowArea;
+        uint64_t rowSumX;
+
+        row = gray + (size_t)y * width;
+        rowArea = 0;
+        rowSumX = 0;
+        for (x = 0; x < width; x++) {
+            unsigned int on = (row[x] >= threshold);
+
+            rowArea += on;
+            rowSumX += on * (unsigned int)x;
+        }
+        area += rowArea;
+        sumX += rowSumX;
+        sumY += (uint64_t)rowArea * y;
+
+        if (dataPtr->havePrev) {
+            unsigned int rowDiff = 0;
+
+            prevRow = dataPtr->prev + (size_t)y * width;
+            for (x = 0; x < width; x++) {
+                int d = (int)row[x] - (int)prevRow[x];
+
+                rowDiff += (d < 0) ? -d : d;
+            }
+            diff += rowDiff;
+        }
+    }
+
+    statsPtr->frame = frame;
+    statsPtr->area = (int)area;
+    if (area > 0) {
+        statsPtr->cx = (double)sumX / area;
+        statsPtr->cy = (double)sumY / area;
+    } else {
+        statsPtr->cx = statsPtr->cy = -1.0;
+    }
+    statsPtr->diff = (dataPtr->havePrev && (numBytes > 0)) ?
+        (double)diff / numBytes : 0.0;
+
+    /* keep this frame for the next difference */
+    if (dataPtr->prevSize != numBytes) {
+        free(dataPtr->prev);
+        dataPtr->prev = malloc(numBytes);
+        dataPtr->prevSize = (dataPtr->prev != NULL) ? numBytes : 0;
+    }
+    if (dataPtr->prev != NULL) {
+        memcpy(dataPtr->prev, gray, numBytes);
+        dataPtr->havePrev = 1;
+    } else {
+        dataPtr->havePrev = 0;
+    }
+    return 0;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoAnalyze()
+ *
+ *  Measures frames first, first+step, ... up to last in grayscale at
+ *  width x height, for tracking particles: thresholding, the centroid
+ *  of the bright pixels, and frame differencing.  The stats array must
+ *  have room for (last-first)/step+1 results (last being the last
+ *  frame of the video if it's less than 0).  Returns the number of
+ *  frames measured, or -1 if the video can't be read.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoAnalyze(vidPtr, first, last, step, width, height, threshold, stats)
+    VideoObj *vidPtr;
+    int first;
+    int last;
+    int step;
+    int width;
+    int height;
+    int threshold;
+    VideoFrameStats *stats;
+{
+    VideoAnalyzeData data;
+    int count;
+
+    if ((threshold < 0) || (threshold > 255) || (stats == NULL)) {
+        return -1;
+    }
+    data.threshold = threshold;
+    data.stats = stats;
+    data.prev = NULL;
+    data.prevSize = 0;
+    data.havePrev = 0;
+    count = VideoForEachGrayFrame(vidPtr, first, last, step, width, height,
+        VideoAnalyzeFrame, &data);
+    free(data.prev);
+    return count;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoSetCacheSize()
+ *
+ *  Sets how many converted frames are cached and how many of them are
+ *  decoded ahead by the prefetch thread.  A cache size of 0 turns the
+ *  cache off, and a prefetch count of 0 turns off the thread.  The
+ *  cache is emptied and rebuilt with the next image.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoSetCacheSize(vidPtr, frames, prefetch)
+    VideoObj *vidPtr;
+    int frames;
+    int prefetch;
+{
+    if (vidPtr == NULL) {
+        return -1;
+    }
+    if ((frames < 0) || (prefetch < 0)) {
+        return -1;
+    }
+    VideoCacheDestroy(vidPtr);
+    vidPtr->cacheFrames = frames;
+    vidPtr->prefetchFrames = prefetch;
+    return 0;
+}
+
+int
+VideoGetCacheSize(vidPtr, frames, prefetch)
+    VideoObj *vidPtr;
+    int *frames;
+    int *prefetch;
+{
+    if (vidPtr == NULL) {
+        return -1;
+    }
+    if (frames != NULL) {
+        *frames = vidPtr->cacheFrames;
+    }
+    if (prefetch != NULL) {
+        *prefetch = vidPtr->prefetchFrames;
+    }
+    return 0;
+}
+
+int
+VideoFrameRate (vidPtr, fr)
+    VideoObj *vidPtr;
+    double *fr;
+{
+    AVStream *vstreamPtr;
+
+    if (vidPtr == NULL) {
+        return -1;
+    }
+
+    if (fr == NULL) {
+        return -1;
+    }
+
+    if (vidPtr->pFormatCtx == NULL) {
         // vidPtr->pFormatCtx is NULL, video not open
         return -1;
     }
@@ -1335,7 +2647,7 @@ VideoGetPositionCur(vidPtr, pos)
     }
 
     if (vidPtr->pFormatCtx) {
-        fnum = vidPtr->frameNumber;
+        fnum = vidPtr->viewFrame;
     }
 
     *pos = fnum;
@@ -1499,10 +2811,21 @@ VideoWriteFrame(vidPtr, framePtr)
     AVPacket pkt;
 
 #define OUTBUF_SIZE 500000
-    uint8_t outbuf[OUTBUF_SIZE];
+    uint8_t stackbuf[OUTBUF_SIZE];
+    uint8_t *outbuf;
+    int outbufSize;
+
+    /* VideoOpenOutput() allocates a buffer big enough for any frame */
+    if (vidPtr->outbuf != NULL) {
+        outbuf = vidPtr->outbuf;
+        outbufSize = vidPtr->outbufSize;
+    } else {
+        outbuf = stackbuf;
+        outbufSize = OUTBUF_SIZE;
+    }
 
     codecCtx = vidPtr->outVideoStr->codec;
-    numBytes = avcodec_encode_video(codecCtx, outbuf, OUTBUF_SIZE, framePtr);
+    numBytes = avcodec_encode_video(codecCtx, outbuf, outbufSize, framePtr);
 
     if (numBytes > 0) {
         av_init_packet(&pkt);
@@ -1527,6 +2850,473 @@ VideoWriteFrame(vidPtr, framePtr)
     return numBytes;
 }
 
+/*
+ * ------------------------------------------------------------------------
+ *  VideoOpenOutput()
+ *
+ *  Opens a file for writing a video of width x height frames at the
+ *  given frame rate, in one of the formats known to av_guess_format()
+ *  ("mpeg", "avi", "mov", "flv", ...).  The encoder is set up to use
+ *  one thread per CPU, and a pool of converter threads and an encoder
+ *  thread are started for VideoPutFrame().  Returns 0 if successful, or
+ *  -1 if the file or the encoder can't be opened.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoOpenOutput(vidPtr, fileName, fmt, width, height, frameRate, bitRate)
+    VideoObj *vidPtr;
+    const char *fileName;
+    const char *fmt;
+    int width;
+    int height;
+    double frameRate;
+    int bitRate;
+{
+    AVOutputFormat *oformatPtr;
+    AVCodecContext *codecCtx;
+    AVCodec *vcodec;
+    VideoOutput *outPtr;
+    long ncpus;
+    int i, numBytes;
+
+    if ((vidPtr == NULL) || (fileName == NULL) || (fmt == NULL) ||
+        (width < 2) || (height < 2) || (frameRate <= 0.0)) {
+        return -1;
+    }
+    if (VideoClose(vidPtr) != 0) {
+        return -1;
+    }
+    ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus < 1) {
+        ncpus = 1;
+    }
+
+    oformatPtr = av_guess_format(fmt, NULL, NULL);
+    if (oformatPtr == NULL) {
+        return -1;
+    }
+    vidPtr->outFormatCtx = avformat_alloc_context();
+    if (vidPtr->outFormatCtx == NULL) {
+        return -1;
+    }
+    vidPtr->outFormatCtx->oformat = oformatPtr;
+    strncpy(vidPtr->outFormatCtx->filename, fileName,
+        sizeof(vidPtr->outFormatCtx->filename) - 1);
+
+    vidPtr->outVideoStr = av_new_stream(vidPtr->outFormatCtx, 0);
+    if (vidPtr->outVideoStr == NULL) {
+        goto error;
+    }
+    codecCtx = vidPtr->outVideoStr->codec;
+    codecCtx->codec_id = oformatPtr->video_codec;
+    codecCtx->codec_type = AVMEDIA_TYPE_VIDEO;
+    codecCtx->bit_rate = (bitRate > 0) ? bitRate : 400000;
+    /* resolution must be a multiple of two */
+    codecCtx->width = (width/2)*2;
+    codecCtx->height = (height/2)*2;
+    codecCtx->time_base = av_d2q(1.0/frameRate, 65535);
+    codecCtx->gop_size = 12; /* emit one intra frame every so often */
+    codecCtx->pix_fmt = PIX_FMT_YUV420P;
+    if (codecCtx->codec_id == CODEC_ID_MPEG2VIDEO) {
+        codecCtx->max_b_frames = 2;
+    }
+    if (oformatPtr->flags & AVFMT_GLOBALHEADER) {
+        codecCtx->flags |= CODEC_FLAG_GLOBAL_HEADER;
+    }
+    /* let the encoder work on several frames at once */
+    codecCtx->thread_count = (int)ncpus;
+#ifdef FF_THREAD_FRAME
+    codecCtx->thread_type = FF_THREAD_FRAME;
+#endif
+
+    vcodec = avcodec_find_encoder(codecCtx->codec_id);
+    if (vcodec == NULL) {
+        goto error;
+    }
+#ifdef HAVE_AVCODEC_OPEN2
+    if (avcodec_open2(codecCtx, vcodec, NULL) < 0) {
+#else
+    if (avcodec_open(codecCtx, vcodec) < 0) {
+#endif
+        goto error;
+    }
+#ifdef HAVE_AVIO_CLOSE
+    if (avio_open(&vidPtr->outFormatCtx->pb, fileName, AVIO_FLAG_WRITE) < 0) {
+#else
+    if (url_fopen(&vidPtr->outFormatCtx->pb, fileName, URL_WRONLY) < 0) {
+#endif
+        goto error;
+    }
+#ifdef HAVE_AVFORMAT_WRITE_HEADER
+    if (avformat_write_header(vidPtr->outFormatCtx, NULL) < 0) {
+#else
+    if (av_write_header(vidPtr->outFormatCtx) < 0) {
+#endif
+        goto error;
+    }
+    vidPtr->outHeaderWritten = 1;
+
+    /* an uncompressed frame is more than any encoded one needs */
+    vidPtr->outbufSize = codecCtx->width * codecCtx->height * 4 + 10000;
+    if (vidPtr->outbufSize < OUTBUF_SIZE) {
+        vidPtr->outbufSize = OUTBUF_SIZE;
+    }
+    vidPtr->outbuf = av_malloc(vidPtr->outbufSize);
+    if (vidPtr->outbuf == NULL) {
+        goto error;
+    }
+
+    /*
+     * Set up the slots and start the threads: a converter per CPU and
+     * twice as many slots, so every converter has work while the
+     * encoder is busy.
+     */
+    outPtr = malloc(sizeof(VideoOutput));
+    if (outPtr == NULL) {
+        goto error;
+    }
+    memset(outPtr, 0, sizeof(VideoOutput));
+    pthread_mutex_init(&outPtr->lock, NULL);
+    pthread_cond_init(&outPtr->changed, NULL);
+    vidPtr->outputPtr = outPtr;
+
+    outPtr->numSlots = 2 * (int)ncpus + 2;
+    outPtr->slots = calloc(outPtr->numSlots, sizeof(VideoOutSlot));
+    outPtr->converters = calloc(ncpus, sizeof(pthread_t));
+    if ((outPtr->slots == NULL) || (outPtr->converters == NULL)) {
+        goto error;
+    }
+    numBytes = avpicture_get_size(codecCtx->pix_fmt, codecCtx->width,
+        codecCtx->height);
+    for (i = 0; i < outPtr->numSlots; i++) {
+        VideoOutSlot *slotPtr = outPtr->slots + i;
+
+        slotPtr->state = VIDEO_SLOT_FREE;
+        slotPtr->yuvFrame = avcodec_alloc_frame();
+        slotPtr->yuvbuffer = av_malloc(numBytes);
+        if ((slotPtr->yuvFrame == NULL) || (slotPtr->yuvbuffer == NULL)) {
+            goto error;
+        }
+        avpicture_fill((AVPicture*)slotPtr->yuvFrame, slotPtr->yuvbuffer,
+            codecCtx->pix_fmt, codecCtx->width, codecCtx->height);
+    }
+    for (i = 0; i < ncpus; i++) {
+        if (pthread_create(outPtr->converters + i, NULL, VideoConvertThread,
+                vidPtr) != 0) {
+            break;
+        }
+        outPtr->numConverters++;
+    }
+    if (outPtr->numConverters == 0) {
+        goto error;
+    }
+    if (pthread_create(&outPtr->encoder, NULL, VideoEncodeThread,
+            vidPtr) != 0) {
+        goto error;
+    }
+    outPtr->encoderStarted = 1;
+
+    strcpy(vidPtr->mode, "output");
+    return 0;
+
+ error:
+    VideoClose(vidPtr);
+    return -1;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoPutFrame()
+ *
+ *  Queues one frame of packed RGB pixels (width*3 bytes per row) for
+ *  the video opened by VideoOpenOutput().  Frames of a different size
+ *  are scaled.  Waits only when all the slots are busy.  Returns 0 if
+ *  successful, or -1 if there's no output or the encoder has failed.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoPutFrame(vidPtr, rgb, width, height)
+    VideoObj *vidPtr;
+    const unsigned char *rgb;
+    int width;
+    int height;
+{
+    VideoOutput *outPtr;
+    VideoOutSlot *slotPtr;
+    size_t numBytes;
+    int i;
+
+    if ((vidPtr == NULL) || (vidPtr->outputPtr == NULL) || (rgb == NULL) ||
+        (width <= 0) || (height <= 0)) {
+        return -1;
+    }
+    outPtr = vidPtr->outputPtr;
+
+    pthread_mutex_lock(&outPtr->lock);
+    if (outPtr->nextSeq == 0) {
+        gettimeofday(&outPtr->startTime, NULL);
+    }
+    slotPtr = NULL;
+    while (!outPtr->error) {
+        for (i = 0; i < outPtr->numSlots; i++) {
+            if (outPtr->slots[i].state == VIDEO_SLOT_FREE) {
+                slotPtr = outPtr->slots + i;
+                break;
+            }
+        }
+        if (slotPtr != NULL) {
+            break;
+        }
+        pthread_cond_wait(&outPtr->changed, &outPtr->lock);
+    }
+    if (slotPtr == NULL) {
+        pthread_mutex_unlock(&outPtr->lock);
+        return -1;
+    }
+    slotPtr->state = VIDEO_SLOT_FILLING;
+    pthread_mutex_unlock(&outPtr->lock);
+
+    numBytes = (size_t)width * 3 * height;
+    if ((slotPtr->rgb == NULL) || (slotPtr->rgbw != width) ||
+        (slotPtr->rgbh != height)) {
+        free(slotPtr->rgb);
+        slotPtr->rgb = malloc(numBytes);
+        slotPtr->rgbw = width;
+        slotPtr->rgbh = height;
+    }
+    if (slotPtr->rgb != NULL) {
+        memcpy(slotPtr->rgb, rgb, numBytes);
+    }
+
+    pthread_mutex_lock(&outPtr->lock);
+    if (slotPtr->rgb == NULL) {
+        slotPtr->state = VIDEO_SLOT_FREE;
+        pthread_mutex_unlock(&outPtr->lock);
+        return -1;
+    }
+    slotPtr->seq = outPtr->nextSeq++;
+    slotPtr->state = VIDEO_SLOT_RGB;
+    pthread_cond_broadcast(&outPtr->changed);
+    pthread_mutex_unlock(&outPtr->lock);
+    return 0;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoConvertThread()
+ *
+ *  Body of each converter thread.  Takes queued RGB frames (oldest
+ *  first) and converts them to the encoder's size and pixel format,
+ *  with a scaling context of its own.
+ * ------------------------------------------------------------------------
+ */
+void *
+VideoConvertThread(clientData)
+    void *clientData;
+{
+    VideoObj *vidPtr = clientData;
+    VideoOutput *outPtr = vidPtr->outputPtr;
+    AVCodecContext *codecCtx = vidPtr->outVideoStr->codec;
+    struct SwsContext *swsCtx = NULL;
+    VideoOutSlot *slotPtr;
+    const uint8_t *planes[4];
+    int linesizes[4];
+    int i;
+
+    pthread_mutex_lock(&outPtr->lock);
+    while (!outPtr->quit) {
+        slotPtr = NULL;
+        for (i = 0; i < outPtr->numSlots; i++) {
+            if ((outPtr->slots[i].state == VIDEO_SLOT_RGB) &&
+                ((slotPtr == NULL) || (outPtr->slots[i].seq < slotPtr->seq))) {
+                slotPtr = outPtr->slots + i;
+            }
+        }
+        if (slotPtr == NULL) {
+            pthread_cond_wait(&outPtr->changed, &outPtr->lock);
+            continue;
+        }
+        slotPtr->state = VIDEO_SLOT_CONVERTING;
+        pthread_mutex_unlock(&outPtr->lock);
+
+        swsCtx = sws_getCachedContext(swsCtx,
+            slotPtr->rgbw, slotPtr->rgbh, PIX_FMT_RGB24,
+            codecCtx->width, codecCtx->height, codecCtx->pix_fmt,
+            SWS_BICUBIC, NULL, NULL, NULL);
+        memset(planes, 0, sizeof(planes));
+        memset(linesizes, 0, sizeof(linesizes));
+        planes[0] = slotPtr->rgb;
+        linesizes[0] = slotPtr->rgbw * 3;
+        if (swsCtx != NULL) {
+            sws_scale(swsCtx, planes, linesizes, 0, slotPtr->rgbh,
+                slotPtr->yuvFrame->data, slotPtr->yuvFrame->linesize);
+        }
+
+        pthread_mutex_lock(&outPtr->lock);
+        slotPtr->state = VIDEO_SLOT_YUV;
+        pthread_cond_broadcast(&outPtr->changed);
+    }
+    pthread_mutex_unlock(&outPtr->lock);
+    if (swsCtx != NULL) {
+        sws_freeContext(swsCtx);
+    }
+    return NULL;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoEncodeThread()
+ *
+ *  Body of the encoder thread.  Encodes the converted frames in the
+ *  order they were put, and frees their slots.
+ * ------------------------------------------------------------------------
+ */
+void *
+VideoEncodeThread(clientData)
+    void *clientData;
+{
+    VideoObj *vidPtr = clientData;
+    VideoOutput *outPtr = vidPtr->outputPtr;
+    VideoOutSlot *slotPtr;
+    int i, result;
+
+    pthread_mutex_lock(&outPtr->lock);
+    while (!outPtr->quit) {
+        slotPtr = NULL;
+        for (i = 0; i < outPtr->numSlots; i++) {
+            if ((outPtr->slots[i].state == VIDEO_SLOT_YUV) &&
+                (outPtr->slots[i].seq == outPtr->encodeSeq)) {
+                slotPtr = outPtr->slots + i;
+                break;
+            }
+        }
+        if (slotPtr == NULL) {
+            pthread_cond_wait(&outPtr->changed, &outPtr->lock);
+            continue;
+        }
+        slotPtr->state = VIDEO_SLOT_ENCODING;
+        pthread_mutex_unlock(&outPtr->lock);
+
+        slotPtr->yuvFrame->pts = slotPtr->seq;
+        result = VideoWriteFrame(vidPtr, slotPtr->yuvFrame);
+
+        pthread_mutex_lock(&outPtr->lock);
+        if (result < 0) {
+            outPtr->error = 1;
+        }
+        slotPtr->state = VIDEO_SLOT_FREE;
+        outPtr->encodeSeq++;
+        outPtr->numFrames++;
+        gettimeofday(&outPtr->endTime, NULL);
+        pthread_cond_broadcast(&outPtr->changed);
+    }
+    pthread_mutex_unlock(&outPtr->lock);
+    return NULL;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoFinishOutput()
+ *
+ *  Waits for the queued frames to be encoded, stops the threads, and
+ *  frees the slots.  Called by VideoClose() before the encoder is
+ *  flushed and the file is finished.
+ * ------------------------------------------------------------------------
+ */
+void
+VideoFinishOutput(vidPtr)
+    VideoObj *vidPtr;
+{
+    VideoOutput *outPtr = vidPtr->outputPtr;
+    int i;
+
+    if (outPtr == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&outPtr->lock);
+    while ((outPtr->encoderStarted) && (!outPtr->error) &&
+           (outPtr->encodeSeq < outPtr->nextSeq)) {
+        pthread_cond_wait(&outPtr->changed, &outPtr->lock);
+    }
+    outPtr->quit = 1;
+    pthread_cond_broadcast(&outPtr->changed);
+    pthread_mutex_unlock(&outPtr->lock);
+
+    for (i = 0; i < outPtr->numConverters; i++) {
+        pthread_join(outPtr->converters[i], NULL);
+    }
+    if (outPtr->encoderStarted) {
+        pthread_join(outPtr->encoder, NULL);
+    }
+    if (outPtr->slots != NULL) {
+        for (i = 0; i < outPtr->numSlots; i++) {
+            free(outPtr->slots[i].rgb);
+            av_free(outPtr->slots[i].yuvbuffer);
+            av_free(outPtr->slots[i].yuvFrame);
+        }
+        free(outPtr->slots);
+    }
+    free(outPtr->converters);
+    pthread_cond_destroy(&outPtr->changed);
+    pthread_mutex_destroy(&outPtr->lock);
+
+    /* keep the timing around for VideoOutputStats() */
+    vidPtr->outNumFrames = outPtr->numFrames;
+    vidPtr->outSeconds = (outPtr->numFrames == 0) ? 0.0 :
+        (outPtr->endTime.tv_sec - outPtr->startTime.tv_sec) +
+        1.0e-6 * (outPtr->endTime.tv_usec - outPtr->startTime.tv_usec);
+    free(outPtr);
+    vidPtr->outputPtr = NULL;
+}
+
+/*
+ * ------------------------------------------------------------------------
+ *  VideoOutputStats()
+ *
+ *  Reports how many frames were encoded for the last video written
+ *  (or the one being written), how long that took from the first
+ *  frame put to the last one encoded, and the resulting frames per
+ *  second.
+ * ------------------------------------------------------------------------
+ */
+int
+VideoOutputStats(vidPtr, numFrames, seconds, framesPerSec)
+    VideoObj *vidPtr;
+    int *numFrames;
+    double *seconds;
+    double *framesPerSec;
+{
+    int n;
+    double t;
+
+    if (vidPtr == NULL) {
+        return -1;
+    }
+    if (vidPtr->outputPtr != NULL) {
+        VideoOutput *outPtr = vidPtr->outputPtr;
+
+        pthread_mutex_lock(&outPtr->lock);
+        n = outPtr->numFrames;
+        t = (n == 0) ? 0.0 :
+            (outPtr->endTime.tv_sec - outPtr->startTime.tv_sec) +
+            1.0e-6 * (outPtr->endTime.tv_usec - outPtr->startTime.tv_usec);
+        pthread_mutex_unlock(&outPtr->lock);
+    } else {
+        n = vidPtr->outNumFrames;
+        t = vidPtr->outSeconds;
+    }
+    if (numFrames != NULL) {
+        *numFrames = n;
+    }
+    if (seconds != NULL) {
+        *seconds = t;
+    }
+    if (framesPerSec != NULL) {
+        *framesPerSec = (t > 0.0) ? n / t : 0.0;
+    }
+    return 0;
+}
+
 #ifdef notdef
 /*
  * ------------------------------------------------------------------------
@@ -1626,6 +3416,9 @@ VideoClose(vidPtr)
         return -1;
     }
 
+    /* stop the prefetch thread before anything it uses goes away */
+    VideoCacheDestroy(vidPtr);
+
     if (vidPtr->yuvbuffer) {
         av_free(vidPtr->yuvbuffer);
         vidPtr->yuvbuffer = NULL;
@@ -1652,6 +3445,7 @@ VideoClose(vidPtr)
         sws_freeContext(vidPtr->scalingCtx);
         vidPtr->scalingCtx = NULL;
     }
+    VideoFreeIndex(vidPtr);
     if (vidPtr->pFormatCtx && vidPtr->videoStream >= 0) {
         vcodecCtx = vidPtr->pFormatCtx->streams[vidPtr->videoStream]->codec;
         if (vcodecCtx) {
@@ -1667,11 +3461,16 @@ VideoClose(vidPtr)
         vidPtr->pFormatCtx = NULL;
     }
 
+    /* encode everything still queued, then stop the output threads */
+    VideoFinishOutput(vidPtr);
+
     if (vidPtr->outFormatCtx) {
-        while (VideoWriteFrame(vidPtr, NULL) > 0)
-            ; /* write out any remaining frames */
+        if (vidPtr->outHeaderWritten) {
+            while (VideoWriteFrame(vidPtr, NULL) > 0)
+                ; /* write out any remaining frames */
 
-        av_write_trailer(vidPtr->outFormatCtx);
+            av_write_trailer(vidPtr->outFormatCtx);
+        }
 
         for (i=0; i < vidPtr->outFormatCtx->nb_streams; i++) {
             avcodec_close(vidPtr->outFormatCtx->streams[i]->codec);
@@ -1685,6 +3484,13 @@ VideoClose(vidPtr)
 
         av_free(vidPtr->outFormatCtx);
         vidPtr->outFormatCtx = NULL;
+        vidPtr->outHeaderWritten = 0;
+        vidPtr->outVideoStr = NULL;
+    }
+    if (vidPtr->outbuf) {
+        av_free(vidPtr->outbuf);
+        vidPtr->outbuf = NULL;
+        vidPtr->outbufSize = 0;
     }
 
     /* reset the mode to null */
@@ -22,12 +22,32 @@ extern "C" {
 
 typedef struct VideoObjRec VideoObj;
 
+/*
+ * Measurements of one grayscale frame, from VideoAnalyze().
+ */
+typedef struct VideoFrameStats {
+    int frame;          /* frame number */
+    int area;           /* # of pixels at or above the threshold */
+    double cx, cy;      /* centroid of those pixels, or -1 if none */
+    double diff;        /* mean absolute difference from the previous
+                         * frame analyzed (0 for the first) */
+} VideoFrameStats;
+
+/*
+ * Called by VideoForEachGrayFrame() for each frame, with width*height
+ * 8-bit pixels.  Returns 0 to keep going, or non-zero to stop.
+ */
+typedef int (VideoGrayFrameProc) (void *clientData, int frame,
+    const unsigned char *gray, int width, int height);
+
 VideoObj *VideoInit ();
 int VideoCleanup (VideoObj *vidPtr);
 int VideoOpenFile (VideoObj *vidPtr,
     const char *fileName, const char *mode);
 int VideoGetImage (VideoObj *vidPtr,
     int width, int height, void **img, int *bufSize);
+int VideoGetPixels (VideoObj *vidPtr, int width, int height,
+    unsigned char **pixels, int *actualWidth, int *actualHeight);
 int VideoGetPositionCur (VideoObj *vidPtr, int *pos);
 int VideoGetPositionEnd (VideoObj *vidPtr, int *pos);
 int VideoFrameRate (VideoObj *vidPtr, double *fr);
@@ -41,6 +61,20 @@ int VideoGoPlusMinusN (VideoObj *vidPtr, int n);
 int VideoGoToN (VideoObj *vidPtr, int n);
 int VideoSize (VideoObj *vidPtr, int *width, int *height);
 int VideoClose (VideoObj *vidPtr);
+int VideoOpenOutput (VideoObj *vidPtr, const char *fileName,
+    const char *fmt, int width, int height, double frameRate, int bitRate);
+int VideoPutFrame (VideoObj *vidPtr, const unsigned char *rgb,
+    int width, int height);
+int VideoOutputStats (VideoObj *vidPtr, int *numFrames, double *seconds,
+    double *framesPerSec);
+int VideoSetCacheSize (VideoObj *vidPtr, int frames, int prefetch);
+int VideoGetCacheSize (VideoObj *vidPtr, int *frames, int *prefetch);
+int VideoThumbnails (VideoObj *vidPtr, int count, int width, int height,
+    int *frames, unsigned char **pixels);
+int VideoForEachGrayFrame (VideoObj *vidPtr, int first, int last, int step,
+    int width, int height, VideoGrayFrameProc *proc, void *clientData);
+int VideoAnalyze (VideoObj *vidPtr, int first, int last, int step,
+    int width, int height, int threshold, VideoFrameStats *stats);
 
 #ifdef __cplusplus
 }
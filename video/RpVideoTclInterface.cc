@@ -13,6 +13,9 @@
  * ======================================================================
  */
 #include <tcl.h>
+#include <tk.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "RpVideo.h"
 
@@ -29,17 +32,29 @@ static Tcl_ObjCmdProc SizeOp;
 static Tcl_ObjCmdProc ReleaseOp;
 static Tcl_ObjCmdProc FilenameOp;
 static Tcl_ObjCmdProc FramerateOp;
+static Tcl_ObjCmdProc AnalyzeOp;
 static Tcl_ObjCmdProc AspectOp;
+static Tcl_ObjCmdProc CacheOp;
+static Tcl_ObjCmdProc ThumbnailsOp;
+static Tcl_ObjCmdProc WriteOp;
+static Tcl_ObjCmdProc PutOp;
+static Tcl_ObjCmdProc StatsOp;
 
 static Rp_OpSpec rpVideoOps[] = {
-    {"aspect",    1, (void *)AspectOp, 3, 3, "type",},
+    {"analyze",   2, (void *)AnalyzeOp, 2, 0, "?-start n? ?-end n? ?-step n? ?-threshold n? ?-width n? ?-height n?",},
+    {"aspect",    2, (void *)AspectOp, 3, 3, "type",},
+    {"cache",     1, (void *)CacheOp, 2, 4, "?frames? ?prefetch?",},
     {"filename",  1, (void *)FilenameOp, 2, 2, "",},
     {"framerate", 1, (void *)FramerateOp, 2, 2, "",},
-    {"get",       1, (void *)GetOp, 3, 5, "[image ?width height?]|[position cur|end]",},
+    {"get",       1, (void *)GetOp, 3, 6, "[image ?width height?]|[photo name ?width height?]|[position cur|end]",},
     {"next",      1, (void *)NextOp, 2, 2, "",},
+    {"put",       1, (void *)PutOp, 4, 4, "[image data]|[photo name]",},
     {"release",   1, (void *)ReleaseOp, 2, 2, "",},
-    {"seek",      1, (void *)SeekOp, 3, 3, "+n|-n|n",},
-    {"size",      1, (void *)SizeOp, 2, 2, "",},
+    {"seek",      2, (void *)SeekOp, 3, 3, "+n|-n|n",},
+    {"size",      2, (void *)SizeOp, 2, 2, "",},
+    {"stats",     2, (void *)StatsOp, 2, 2, "",},
+    {"thumbnails", 1, (void *)ThumbnailsOp, 5, 5, "count width height",},
+    {"write",     1, (void *)WriteOp, 5, 11, "fileName width height ?-format fmt? ?-framerate fps? ?-bitrate bps?",},
 };
 
 static int nRpVideoOps = sizeof(rpVideoOps) / sizeof(Rp_OpSpec);
@@ -64,6 +79,10 @@ Rpvideo_Init(Tcl_Interp *interp)
 
 /*
  * USAGE: Video <type> <data>
+ *        Video output
+ *
+ * "Video output" makes an object with nothing open, for writing a
+ * new video with its write and put operations.
  */
 static int
 VideoCmd(ClientData clientData, Tcl_Interp *interp, int objc,
@@ -75,15 +94,18 @@ VideoCmd(ClientData clientData, Tcl_Interp *interp, int objc,
     const char *data = NULL;
     int err = 0;
 
-    if (objc != 3) {
+    if ((objc == 2) && (strcmp(Tcl_GetString(objv[1]),"output") == 0)) {
+        type = "output";
+        data = "";
+    } else if (objc != 3) {
         Tcl_AppendResult(interp, "wrong # args: should be \"",
-            "Video <type> <data>\"", (char*)NULL);
+            "Video <type> <data>\" or \"Video output\"", (char*)NULL);
         return TCL_ERROR;
+    } else {
+        type = Tcl_GetString(objv[1]);
+        data = Tcl_GetString(objv[2]);
     }
 
-    type = Tcl_GetString(objv[1]);
-    data = Tcl_GetString(objv[2]);
-
     // create a new command
     VideoObj *movie = NULL;
     movie = VideoInit();
@@ -141,6 +163,7 @@ VideoCallCmd(ClientData clientData, Tcl_Interp *interp, int objc,
  * get position cur
  * get position end
  * get image ?width height?
+ * get photo imageName ?width height?
  * get framerate
  * get filename
  * get aspectratio
@@ -155,9 +178,10 @@ GetOp (ClientData clientData, Tcl_Interp *interp, int objc,
     /*
      * Decode the first arg and figure out how we're supposed to advance.
      */
-    if (objc > 5) {
+    if (objc > 6) {
         Tcl_AppendResult(interp, "wrong # args: should be \"", cmd,
-            " [image width height]|[position cur|end]\"", (char*)NULL);
+            " [image width height]|[photo name width height]",
+            "|[position cur|end]\"", (char*)NULL);
         return TCL_ERROR;
     }
 
@@ -207,6 +231,71 @@ GetOp (ClientData clientData, Tcl_Interp *interp, int objc,
         Tcl_SetByteArrayObj(Tcl_GetObjResult(interp),
                             (const unsigned char*)img, bufSize);
     }
+    else if ((*info == 'p') && (strcmp(info,"photo") == 0)) {
+        // copy the frame straight into a Tk photo image,
+        // instead of going through a PPM and "image put"
+        if ((objc != 4) && (objc != 6)) {
+            Tcl_AppendResult(interp, "wrong # args: should be \"", cmd,
+                " photo imageName ?width height?\"", (char*)NULL);
+            return TCL_ERROR;
+        }
+
+        if (Tk_MainWindow(interp) == NULL) {
+            Tcl_ResetResult(interp);
+            Tcl_AppendResult(interp, "can't copy into photo image \"",
+                Tcl_GetString(objv[3]), "\": Tk isn't loaded", (char*)NULL);
+            return TCL_ERROR;
+        }
+        const char *imageName = Tcl_GetString(objv[3]);
+        Tk_PhotoHandle photo = Tk_FindPhoto(interp, imageName);
+        if (photo == NULL) {
+            Tcl_AppendResult(interp, "bad value \"", imageName,
+                "\": expected photo image", (char*)NULL);
+            return TCL_ERROR;
+        }
+
+        unsigned char *pixels = NULL;
+        int width = -1;
+        int height = -1;
+
+        if (objc == 6) {
+            if ((Tcl_GetIntFromObj(interp, objv[4], &width) != TCL_OK) ||
+                (Tcl_GetIntFromObj(interp, objv[5], &height) != TCL_OK)) {
+                return TCL_ERROR;
+            }
+        }
+
+        if (VideoGetPixels((VideoObj *)clientData, width, height,
+                &pixels, &width, &height) != 0) {
+            Tcl_AppendResult(interp, "error while reading frame",
+                (char*)NULL);
+            return TCL_ERROR;
+        }
+
+        Tk_PhotoImageBlock block;
+        block.pixelPtr  = pixels;
+        block.width     = width;
+        block.height    = height;
+        block.pitch     = width*3;
+        block.pixelSize = 3;
+        block.offset[0] = 0;
+        block.offset[1] = 1;
+        block.offset[2] = 2;
+        block.offset[3] = 3;        // past the pixel: no alpha channel
+
+#if TK_MAJOR_VERSION > 8 || (TK_MAJOR_VERSION == 8 && TK_MINOR_VERSION > 4)
+        if ((Tk_PhotoSetSize(interp, photo, width, height) != TCL_OK) ||
+            (Tk_PhotoPutBlock(interp, photo, &block, 0, 0, width, height,
+                TK_PHOTO_COMPOSITE_SET) != TCL_OK)) {
+            return TCL_ERROR;
+        }
+#else
+        Tk_PhotoSetSize(photo, width, height);
+        Tk_PhotoPutBlock(photo, &block, 0, 0, width, height,
+            TK_PHOTO_COMPOSITE_SET);
+#endif
+        Tcl_ResetResult(interp);
+    }
 /*
     else if ((*info == 'f') && (strcmp(info,"framerate") == 0)) {
         if (objc != 3) {
@@ -271,7 +360,8 @@ GetOp (ClientData clientData, Tcl_Interp *interp, int objc,
 */
     else {
         Tcl_AppendResult(interp, "unrecognized command \"", info, "\": should be \"", cmd,
-            " [image width height]|[position cur|end]|[framerate]\"", (char*)NULL);
+            " [image width height]|[photo name width height]",
+            "|[position cur|end]\"", (char*)NULL);
         return TCL_ERROR;
     }
 
@@ -451,6 +541,106 @@ FramerateOp (ClientData clientData, Tcl_Interp *interp, int objc,
     return TCL_OK;
 }
 
+/**********************************************************************/
+// FUNCTION: AnalyzeOp()
+/// Measure a range of frames for particle tracking
+/**
+ * Return one {frame area cx cy diff} list for each frame in the range,
+ * measured in grayscale: the number of pixels at or above the
+ * threshold (0-255, default 128), their centroid (-1 -1 if there are
+ * none), and the mean absolute difference from the previous frame
+ * measured.  The frames are measured at their native size unless
+ * -width and -height say otherwise, and the current position is left
+ * alone.
+ * Full function call:
+ *
+ * analyze
+ * analyze -start 100 -end 200 -step 2 -threshold 200
+ *
+ */
+static int
+AnalyzeOp (ClientData clientData, Tcl_Interp *interp, int objc,
+         Tcl_Obj *const *objv)
+{
+    static const char *switches[] = {
+        "-end", "-height", "-start", "-step", "-threshold", "-width", NULL
+    };
+    enum { SW_END, SW_HEIGHT, SW_START, SW_STEP, SW_THRESHOLD, SW_WIDTH };
+    int values[6];
+    int i;
+
+    values[SW_END] = -1;
+    values[SW_HEIGHT] = -1;
+    values[SW_START] = 0;
+    values[SW_STEP] = 1;
+    values[SW_THRESHOLD] = 128;
+    values[SW_WIDTH] = -1;
+
+    if (objc & 1) {
+        Tcl_AppendResult(interp, "wrong # args: should be \"",
+            Tcl_GetString(objv[0]), " analyze ?-start n? ?-end n? ",
+            "?-step n? ?-threshold n? ?-width n? ?-height n?\"",
+            (char*)NULL);
+        return TCL_ERROR;
+    }
+    for (i = 2; i < objc; i += 2) {
+        int index;
+
+        if ((Tcl_GetIndexFromObj(interp, objv[i], switches, "switch", 0,
+                &index) != TCL_OK) ||
+            (Tcl_GetIntFromObj(interp, objv[i+1], values + index) != TCL_OK)) {
+            return TCL_ERROR;
+        }
+    }
+    if ((values[SW_STEP] <= 0) || (values[SW_THRESHOLD] < 0) ||
+        (values[SW_THRESHOLD] > 255)) {
+        Tcl_AppendResult(interp, "bad analyze values: -step should be > 0 ",
+            "and -threshold should be 0-255", (char*)NULL);
+        return TCL_ERROR;
+    }
+
+    int start = (values[SW_START] < 0) ? 0 : values[SW_START];
+    int end = 0;
+    VideoGetPositionEnd((VideoObj *)clientData, &end);
+    if ((values[SW_END] >= 0) && (values[SW_END] < end)) {
+        end = values[SW_END];
+    }
+    Tcl_Obj *listObj = Tcl_NewListObj(0, NULL);
+    if (end < start) {
+        Tcl_SetObjResult(interp, listObj);
+        return TCL_OK;
+    }
+
+    int maxFrames = (end - start) / values[SW_STEP] + 1;
+    VideoFrameStats *stats =
+        (VideoFrameStats *)ckalloc(maxFrames * sizeof(VideoFrameStats));
+    int count = VideoAnalyze((VideoObj *)clientData, start, end,
+        values[SW_STEP], values[SW_WIDTH], values[SW_HEIGHT],
+        values[SW_THRESHOLD], stats);
+    if (count < 0) {
+        ckfree((char *)stats);
+        Tcl_DecrRefCount(listObj);
+        Tcl_AppendResult(interp, "error while analyzing frames",
+            (char*)NULL);
+        return TCL_ERROR;
+    }
+
+    for (i = 0; i < count; i++) {
+        Tcl_Obj *objPtrs[5];
+
+        objPtrs[0] = Tcl_NewIntObj(stats[i].frame);
+        objPtrs[1] = Tcl_NewIntObj(stats[i].area);
+        objPtrs[2] = Tcl_NewDoubleObj(stats[i].cx);
+        objPtrs[3] = Tcl_NewDoubleObj(stats[i].cy);
+        objPtrs[4] = Tcl_NewDoubleObj(stats[i].diff);
+        Tcl_ListObjAppendElement(interp, listObj, Tcl_NewListObj(5, objPtrs));
+    }
+    ckfree((char *)stats);
+    Tcl_SetObjResult(interp, listObj);
+
+    return TCL_OK;
+}
+
 /**********************************************************************/
 // FUNCTION: AspectOp()
 /// Get the aspect ratio of the video
@@ -499,6 +689,124 @@ AspectOp (ClientData clientData, Tcl_Interp *interp, int objc,
 
     return TCL_OK;
 }
+/**********************************************************************/
+// FUNCTION: CacheOp()
+/// Get or set the size of the decoded frame cache
+/**
+ * Return the number of converted frames kept in the cache and the
+ * number decoded ahead in the background, after setting them if
+ * values are given.  0 frames turns off the cache; 0 prefetch turns
+ * off the background decoding.
+ * Full function call:
+ *
+ * cache
+ * cache 64
+ * cache 64 16
+ *
+ */
+static int
+CacheOp (ClientData clientData, Tcl_Interp *interp, int objc,
+         Tcl_Obj *const *objv)
+{
+    int frames = 0;
+    int prefetch = 0;
+    Tcl_Obj *sizes = NULL;
+
+    VideoGetCacheSize((VideoObj *)clientData, &frames, &prefetch);
+    if (objc > 2) {
+        if (Tcl_GetIntFromObj(interp, objv[2], &frames) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        if ((objc > 3) &&
+            (Tcl_GetIntFromObj(interp, objv[3], &prefetch) != TCL_OK)) {
+            return TCL_ERROR;
+        }
+        if (VideoSetCacheSize((VideoObj *)clientData, frames, prefetch)) {
+            Tcl_AppendResult(interp, "bad cache size \"",
+                Tcl_GetString(objv[2]), "\": should be frames >= 0 and ",
+                "prefetch >= 0", (char*)NULL);
+            return TCL_ERROR;
+        }
+    }
+
+    sizes = Tcl_NewListObj(0, NULL);
+    Tcl_ListObjAppendElement(interp, sizes, Tcl_NewIntObj(frames));
+    Tcl_ListObjAppendElement(interp, sizes, Tcl_NewIntObj(prefetch));
+    Tcl_SetObjResult(interp, sizes);
+
+    return TCL_OK;
+}
+
+/**********************************************************************/
+// FUNCTION: ThumbnailsOp()
+/// Get evenly spaced frames from a video as small images
+/**
+ * Return a list of frame numbers and images (in the same PPM format
+ * as "get image"), for count frames spread evenly over the video and
+ * scaled to width x height.  The frames are decoded in parallel, and
+ * the current position is left alone.
+ * Full function call:
+ *
+ * thumbnails 10 96 54
+ *
+ */
+static int
+ThumbnailsOp (ClientData clientData, Tcl_Interp *interp, int objc,
+         Tcl_Obj *const *objv)
+{
+    int count = 0;
+    int width = 0;
+    int height = 0;
+
+    if ((Tcl_GetIntFromObj(interp, objv[2], &count) != TCL_OK) ||
+        (Tcl_GetIntFromObj(interp, objv[3], &width) != TCL_OK) ||
+        (Tcl_GetIntFromObj(interp, objv[4], &height) != TCL_OK)) {
+        return TCL_ERROR;
+    }
+    if ((count <= 0) || (width <= 0) || (height <= 0)) {
+        Tcl_AppendResult(interp, "bad thumbnails \"",
+            Tcl_GetString(objv[2]), " ", Tcl_GetString(objv[3]), " ",
+            Tcl_GetString(objv[4]), "\": count, width, and height ",
+            "should be > 0", (char*)NULL);
+        return TCL_ERROR;
+    }
+
+    int *frames = (int *)ckalloc(count * sizeof(int));
+    unsigned char **pixels =
+        (unsigned char **)ckalloc(count * sizeof(unsigned char *));
+
+    if (VideoThumbnails((VideoObj *)clientData, count, width, height,
+            frames, pixels) != 0) {
+        ckfree((char *)frames);
+        ckfree((char *)pixels);
+        Tcl_AppendResult(interp, "error while reading thumbnails",
+            (char*)NULL);
+        return TCL_ERROR;
+    }
+
+    char header[64];
+    sprintf(header, "P6\n%d %d\n255\n", width, height);
+    int headerLen = strlen(header);
+    int numBytes = width*3*height;
+
+    Tcl_Obj *listObj = Tcl_NewListObj(0, NULL);
+    for (int i = 0; i < count; i++) {
+        Tcl_Obj *imgObj = Tcl_NewByteArrayObj(NULL, 0);
+        unsigned char *bytes =
+            Tcl_SetByteArrayLength(imgObj, headerLen + numBytes);
+        memcpy(bytes, header, headerLen);
+        memcpy(bytes + headerLen, pixels[i], numBytes);
+        free(pixels[i]);
+        Tcl_ListObjAppendElement(interp, listObj, Tcl_NewIntObj(frames[i]));
+        Tcl_ListObjAppendElement(interp, listObj, imgObj);
+    }
+    ckfree((char *)frames);
+    ckfree((char *)pixels);
+    Tcl_SetObjResult(interp, listObj);
+
+    return TCL_OK;
+}
+
 /**********************************************************************/
 // FUNCTION: ReleaseOp()
 /// Clean up memory from an open video in a movie player object
@@ -520,3 +828,226 @@ ReleaseOp (ClientData clientData, Tcl_Interp *interp, int objc,
     return TCL_OK;
 }
 
+/**********************************************************************/
+// FUNCTION: WriteOp()
+/// Start writing a new video
+/**
+ * Close whatever is open in the movie object and open fileName for
+ * writing width x height frames, added with the put operation.  The
+ * format is any name known to ffmpeg (mpeg, avi, mov, flv, ...);
+ * frames are converted and encoded on background threads.  The file
+ * is finished by the release operation.
+ * Full function call:
+ *
+ * write out.mpg 640 480
+ * write out.mov 640 480 -format mov -framerate 30 -bitrate 2000000
+ *
+ */
+static int
+WriteOp (ClientData clientData, Tcl_Interp *interp, int objc,
+         Tcl_Obj *const *objv)
+{
+    static const char *switches[] = {
+        "-bitrate", "-format", "-framerate", NULL
+    };
+    enum { SW_BITRATE, SW_FORMAT, SW_FRAMERATE };
+    const char *fileName = Tcl_GetString(objv[2]);
+    const char *fmt = "mpeg";
+    double frameRate = 25.0;
+    int bitRate = 0;
+    int width = 0;
+    int height = 0;
+    int i;
+
+    if ((objc & 1) == 0) {
+        Tcl_AppendResult(interp, "wrong # args: should be \"",
+            Tcl_GetString(objv[0]), " write fileName width height ",
+            "?-format fmt? ?-framerate fps? ?-bitrate bps?\"", (char*)NULL);
+        return TCL_ERROR;
+    }
+    if ((Tcl_GetIntFromObj(interp, objv[3], &width) != TCL_OK) ||
+        (Tcl_GetIntFromObj(interp, objv[4], &height) != TCL_OK)) {
+        return TCL_ERROR;
+    }
+    for (i = 5; i < objc; i += 2) {
+        int index;
+
+        if (Tcl_GetIndexFromObj(interp, objv[i], switches, "switch", 0,
+                &index) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        switch (index) {
+        case SW_BITRATE:
+            if (Tcl_GetIntFromObj(interp, objv[i+1], &bitRate) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            break;
+        case SW_FORMAT:
+            fmt = Tcl_GetString(objv[i+1]);
+            break;
+        case SW_FRAMERATE:
+            if (Tcl_GetDoubleFromObj(interp, objv[i+1], &frameRate)
+                    != TCL_OK) {
+                return TCL_ERROR;
+            }
+            break;
+        }
+    }
+    if ((width < 2) || (height < 2) || (frameRate <= 0.0)) {
+        Tcl_AppendResult(interp, "bad write values: width and height ",
+            "should be >= 2 and -framerate should be > 0", (char*)NULL);
+        return TCL_ERROR;
+    }
+
+    if (VideoOpenOutput((VideoObj *)clientData, fileName, fmt, width,
+            height, frameRate, bitRate) != 0) {
+        Tcl_AppendResult(interp, "can't write video \"", fileName,
+            "\" in format \"", fmt, "\"", (char*)NULL);
+        return TCL_ERROR;
+    }
+    Tcl_ResetResult(interp);
+    return TCL_OK;
+}
+
+/**********************************************************************/
+// FUNCTION: PutOp()
+/// Add a frame to the video being written
+/**
+ * Queue one frame for the video opened by the write operation, either
+ * from a PPM image like the ones returned by "get image", or straight
+ * from a Tk photo image.  Frames of a different size are scaled.
+ * Full function call:
+ *
+ * put image [$in get image]
+ * put photo imageName
+ *
+ */
+static int
+PutOp (ClientData clientData, Tcl_Interp *interp, int objc,
+         Tcl_Obj *const *objv)
+{
+    const char *info = Tcl_GetString(objv[2]);
+    int result = 0;
+
+    if ((*info == 'i') && (strcmp(info,"image") == 0)) {
+        int length = 0;
+        int width = 0;
+        int height = 0;
+        int offset = 0;
+
+        const unsigned char *bytes = Tcl_GetByteArrayFromObj(objv[3],
+            &length);
+        if ((length < 2) || (bytes[0] != 'P') || (bytes[1] != '6')) {
+            Tcl_AppendResult(interp, "bad image: expected PPM data",
+                (char*)NULL);
+            return TCL_ERROR;
+        }
+
+        // the header is short, so look at it as a string
+        char header[64];
+        int n = (length < (int)sizeof(header)-1) ? length : sizeof(header)-1;
+        memcpy(header, bytes, n);
+        header[n] = '\0';
+        if ((sscanf(header, "P6 %d %d 255%n", &width, &height, &offset) != 2)
+              || (offset == 0) || (width <= 0) || (height <= 0)
+              || (length - (offset+1) < width*3*height)) {
+            Tcl_AppendResult(interp, "bad image: expected PPM data",
+                (char*)NULL);
+            return TCL_ERROR;
+        }
+        result = VideoPutFrame((VideoObj *)clientData, bytes + offset + 1,
+            width, height);
+    }
+    else if ((*info == 'p') && (strcmp(info,"photo") == 0)) {
+        if (Tk_MainWindow(interp) == NULL) {
+            Tcl_ResetResult(interp);
+            Tcl_AppendResult(interp, "can't copy from photo image \"",
+                Tcl_GetString(objv[3]), "\": Tk isn't loaded", (char*)NULL);
+            return TCL_ERROR;
+        }
+        const char *imageName = Tcl_GetString(objv[3]);
+        Tk_PhotoHandle photo = Tk_FindPhoto(interp, imageName);
+        if (photo == NULL) {
+            Tcl_AppendResult(interp, "bad value \"", imageName,
+                "\": expected photo image", (char*)NULL);
+            return TCL_ERROR;
+        }
+
+        Tk_PhotoImageBlock block;
+        Tk_PhotoGetImage(photo, &block);
+        if ((block.width <= 0) || (block.height <= 0)) {
+            Tcl_AppendResult(interp, "photo image \"", imageName,
+                "\" is empty", (char*)NULL);
+            return TCL_ERROR;
+        }
+
+        // pack the photo's pixels into RGB triples
+        unsigned char *rgb =
+            (unsigned char *)ckalloc(block.width*3*block.height);
+        unsigned char *dest = rgb;
+        for (int y = 0; y < block.height; y++) {
+            const unsigned char *src = block.pixelPtr + y*block.pitch;
+            for (int x = 0; x < block.width; x++) {
+                *dest++ = src[block.offset[0]];
+                *dest++ = src[block.offset[1]];
+                *dest++ = src[block.offset[2]];
+                src += block.pixelSize;
+            }
+        }
+        result = VideoPutFrame((VideoObj *)clientData, rgb, block.width,
+            block.height);
+        ckfree((char *)rgb);
+    }
+    else {
+        Tcl_AppendResult(interp, "bad option \"", info,
+            "\": should be image or photo", (char*)NULL);
+        return TCL_ERROR;
+    }
+
+    if (result != 0) {
+        Tcl_AppendResult(interp, "error while writing frame",
+            (char*)NULL);
+        return TCL_ERROR;
+    }
+    Tcl_ResetResult(interp);
+    return TCL_OK;
+}
+
+/**********************************************************************/
+// FUNCTION: StatsOp()
+/// Report how fast the last video was written
+/**
+ * Return a list of the frames encoded, the seconds taken from the
+ * first frame put to the last frame encoded, and the frames per
+ * second, for the video being written or the last one released.
+ * Full function call:
+ *
+ * stats
+ *
+ */
+static int
+StatsOp (ClientData clientData, Tcl_Interp *interp, int objc,
+         Tcl_Obj *const *objv)
+{
+    int numFrames = 0;
+    double seconds = 0.0;
+    double framesPerSec = 0.0;
+
+    if (VideoOutputStats((VideoObj *)clientData, &numFrames, &seconds,
+            &framesPerSec) != 0) {
+        Tcl_AppendResult(interp, "error while reading output stats",
+            (char*)NULL);
+        return TCL_ERROR;
+    }
+
+    Tcl_Obj *listObj = Tcl_NewListObj(0, NULL);
+    Tcl_ListObjAppendElement(interp, listObj, Tcl_NewStringObj("frames", -1));
+    Tcl_ListObjAppendElement(interp, listObj, Tcl_NewIntObj(numFrames));
+    Tcl_ListObjAppendElement(interp, listObj, Tcl_NewStringObj("seconds", -1));
+    Tcl_ListObjAppendElement(interp, listObj, Tcl_NewDoubleObj(seconds));
+    Tcl_ListObjAppendElement(interp, listObj, Tcl_NewStringObj("rate", -1));
+    Tcl_ListObjAppendElement(interp, listObj, Tcl_NewDoubleObj(framesPerSec));
+    Tcl_SetObjResult(interp, listObj);
+
+    return TCL_OK;
+}